@@ -120,6 +120,13 @@ Flash_Err_Code DRV_FLASH_Write(void *src, void *dst, size_t len, int do_verify);
  */
 Flash_Err_Code DRV_FLASH_Erase_Sector(void *addr, int is_64KB_sect, int wait_for_finish);
 
+/**
+ * @brief Check whether the last program or erase command is still running, without waiting
+ *
+ * @return 0 if the flash takes a new command. Others if it is still busy.
+ */
+int DRV_FLASH_Is_Busy(void);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -43,6 +43,7 @@
 /* I2C Transaction Event */
 #define GDMA_EVENT_TRANSACTION_DONE (1UL << 0)  /**< Transactiond done */
 #define GDMA_EVENT_TRANSACTION_ERROR (1UL << 1) /**< Transactiond error */
+#define GDMA_EVENT_CHANNEL_RESUMED (1UL << 2)   /**< Acquired channel is usable again after sleep */
 
 /** @} drv_gdma_constants */
 
@@ -64,7 +65,8 @@ typedef enum {
   DRV_GDMA_ERROR_TIMEOUT,    /**< Operation timeout */
   DRV_GDMA_ERROR_UNINIT,     /**< Driver not yet initialized */
   DRV_GDMA_ERROR_INIT,       /**< Driver already initialized */
-  DRV_GDMA_ERROR_PWRMNGR     /**< Power management operation error */
+  DRV_GDMA_ERROR_PWRMNGR,    /**< Power management operation error */
+  DRV_GDMA_ERROR_NO_CHANNEL  /**< No free channel to be acquired */
 } DRV_GDMA_Status;
 
 /**
@@ -82,6 +84,22 @@ typedef enum {
   DRV_GDMA_Channel_MAX    /**< Maximum channel */
 } DRV_GDMA_Channel;
 
+/**
+ * @brief Enumeration of peripheral transfer direction.
+ */
+typedef enum {
+  DRV_GDMA_PERIPH_TO_MEM = 0, /**< Read from a fixed peripheral register into memory */
+  DRV_GDMA_MEM_TO_PERIPH      /**< Write from memory into a fixed peripheral register */
+} DRV_GDMA_Periph_Dir;
+
+/**
+ * @brief Enumeration of peripheral register access width.
+ */
+typedef enum {
+  DRV_GDMA_PERIPH_WIDTH_8BIT = 0, /**< Byte access */
+  DRV_GDMA_PERIPH_WIDTH_16BIT     /**< Halfword access */
+} DRV_GDMA_Periph_Width;
+
 /**
  * @brief Definition of GDMA callback function prototype.
  */
@@ -161,6 +179,88 @@ DRV_GDMA_Status DRV_GDMA_Transfer_Block(DRV_GDMA_Channel channel, void *dest, co
 DRV_GDMA_Status DRV_GDMA_Transfer_Nonblock(DRV_GDMA_Channel channel, void *dest, const void *src,
                                            size_t n);
 
+/**
+ * @brief DRV_GDMA_Acquire_Channel() reserves a free channel for exclusive use by a driver. Channels
+ * are searched from the highest number down so that the low-numbered channels which applications
+ * address directly stay available.
+ *
+ * @param [out] channel: The reserved channel.
+ * @return DRV_GDMA_Status DRV_GDMA_ERROR_NO_CHANNEL if every channel is already reserved.
+ */
+DRV_GDMA_Status DRV_GDMA_Acquire_Channel(DRV_GDMA_Channel *channel);
+
+/**
+ * @brief DRV_GDMA_Release_Channel() returns a channel reserved by DRV_GDMA_Acquire_Channel() and
+ * unregisters its callback.
+ *
+ * @param [in] channel: Channel to be released.
+ * @return DRV_GDMA_Status
+ */
+DRV_GDMA_Status DRV_GDMA_Release_Channel(DRV_GDMA_Channel channel);
+
+/**
+ * @brief DRV_GDMA_Transfer_Periph_Nonblock() performs a non-blocking transfer between memory and a
+ * peripheral data register. The peripheral address is kept fixed and every access waits for the
+ * peripheral ready handshake.
+ *
+ * @param [in] channel: Target DMA channel to be operated.
+ * @param [out] dest: Destination pointer of DMA.
+ * @param [in] src: Source pointer of DMA.
+ * @param [in] n: Size of the data to be transferred by DMA in bytes.
+ * @param [in] dir: Which side of the transfer is the peripheral register.
+ * @param [in] width: Access width on both sides of the transfer.
+ * @return DRV_GDMA_Status
+ */
+DRV_GDMA_Status DRV_GDMA_Transfer_Periph_Nonblock(DRV_GDMA_Channel channel, void *dest,
+                                                  const void *src, size_t n,
+                                                  DRV_GDMA_Periph_Dir dir,
+                                                  DRV_GDMA_Periph_Width width);
+
+/**
+ * @brief DRV_GDMA_Is_Transfer_Done() polls the status written back by the GDMA for the latest
+ * command of the channel.
+ *
+ * @param [in] channel: Target DMA channel.
+ * @return int32_t 1 if the latest command has completed, 0 otherwise.
+ */
+int32_t DRV_GDMA_Is_Transfer_Done(DRV_GDMA_Channel channel);
+
+/**
+ * @brief DRV_GDMA_Get_Transferred_Count() reads how far the latest command of the channel got, from
+ * the address the GDMA has reached on its incrementing side. The GDMA reports that address only for
+ * the command it is working on, so the count is known for a channel holding the engine, e.g. one
+ * stalled on the ready handshake of a peripheral, or for a completed command.
+ *
+ * @param [in] channel: Target DMA channel.
+ * @return int32_t Bytes moved by the latest command, -1 if the GDMA status shows another command,
+ * of another channel or an earlier one of this channel.
+ */
+int32_t DRV_GDMA_Get_Transferred_Count(DRV_GDMA_Channel channel);
+
+/**
+ * @brief DRV_GDMA_Stop_Channel() drops the command armed on a channel, the way
+ * DRV_GDMA_Uninitialize() empties every command FIFO. Nothing is read or written for it afterwards
+ * and its completion is not reported. The channel stays acquired and can be armed again.
+ *
+ * @param [in] channel: Target DMA channel.
+ * @return DRV_GDMA_Status
+ */
+DRV_GDMA_Status DRV_GDMA_Stop_Channel(DRV_GDMA_Channel channel);
+
+/**
+ * @brief DRV_GDMA_Disable_Irq() masks the interrupt of a channel.
+ *
+ * @param [in] channel: Target DMA channel.
+ */
+void DRV_GDMA_Disable_Irq(DRV_GDMA_Channel channel);
+
+/**
+ * @brief DRV_GDMA_Enable_Irq() unmasks the interrupt of a channel.
+ *
+ * @param [in] channel: Target DMA channel.
+ */
+void DRV_GDMA_Enable_Irq(DRV_GDMA_Channel channel);
+
 /** @} drv_gmda_apis */
 
 /*! @cond Doxygen_Suppress */
@@ -26,6 +26,7 @@
 
 #include <stdio.h>
 #include DEVICE_HEADER
+#include "DRV_GDMA.h"
 /**
  * @defgroup uart_driver UART Low-Level Driver
  * @{
@@ -185,7 +186,19 @@ typedef struct {
   size_t be_cnt;      /*!< Break error counter */
   size_t oe_cnt;      /*!< Overrun error counter */
   size_t fe_cnt;      /*!< Frame error counter */
+  size_t rx_cnt_dma;  /*!< Received character by GDMA counter */
+  size_t tx_cnt_dma;  /*!< Transmitted character by GDMA counter */
+  size_t rx_drop_cnt; /*!< Received character dropped on ringbuffer full in GDMA mode */
+  size_t rx_burst_cnt; /*!< Receive activity records, one per ISR invocation or GDMA batch */
+  size_t tx_burst_cnt; /*!< Transmit activity records, one per ISR invocation or GDMA transfer */
 } DRV_UART_Statistic;
+
+/*! @brief Definition of the UART GDMA mode parameter */
+typedef struct {
+  uint16_t *rx_buffer;   /*!< Space for the two ping-pong receive halves. NULL keeps Rx in IRQ mode */
+  size_t rx_buffer_size; /*!< Size of rx_buffer in bytes. Each received character takes 2 bytes */
+  uint8_t tx_enable;     /*!< Non-zero to move DRV_UART_Send_Nonblock data by GDMA */
+} DRV_UART_DMA_Config;
 /*! @brief Definition of UART handler */
 struct _uart_handle {
   UART_Type *base; /*!< UART controller base address */
@@ -214,6 +227,17 @@ struct _uart_handle {
   DRV_UART_EventCallback_t callback;  /*!< Callback function to notify user space */
   void *user_data;  /*!< Parameter of callback function */
 
+  /* GDMA mode */
+  uint8_t rx_dma_enabled;             /*!< Rx bytes are moved by GDMA instead of the Rx IRQ */
+  uint8_t tx_dma_enabled;             /*!< Tx requests are moved by GDMA instead of the Tx IRQ */
+  uint8_t tx_dma_busy;                /*!< A GDMA Tx transfer is in flight */
+  DRV_GDMA_Channel rx_dma_channel;    /*!< GDMA channel used for receiving */
+  DRV_GDMA_Channel tx_dma_channel;    /*!< GDMA channel used for sending */
+  uint16_t *rx_dma_buffer[2];         /*!< Ping-pong receive halves of data register samples */
+  size_t rx_dma_buffer_len;           /*!< Number of samples in each receive half */
+  uint8_t rx_dma_active;              /*!< Index of the half being filled by GDMA */
+  size_t rx_dma_delivered;            /*!< Samples of the active half already handed to consumers */
+
   /* Statistic info */
   DRV_UART_Statistic stat; /*!< UART running statistic */
 };
@@ -431,11 +455,17 @@ uint32_t DRV_UART_Get_RI(UART_Type *base);
  */
 int32_t DRV_UART_Abort_Receive(DRV_UART_Handle *handle);
 
+/**
+ * @brief Returned by DRV_UART_Abort_Send() for a GDMA send whose progress GDMA could not report
+ */
+#define DRV_UART_ABORT_COUNT_UNKNOWN (-2)
+
 /**
  * @brief abort on non-blocking send
  *
  * @param handle UART handle
- * @return int32_t Data length that have been written to tx FIFO
+ * @return int32_t Data length that have been written to tx FIFO. -1 if no send was in progress,
+ * DRV_UART_ABORT_COUNT_UNKNOWN if a GDMA send was stopped and the length is unknown.
  */
 int32_t DRV_UART_Abort_Send(DRV_UART_Handle *handle);
 
@@ -471,6 +501,31 @@ int32_t DRV_UART_Is_Uart_Busy(UART_Type *base);
  * @return DRV_UART_Status Return the status code
  */
 DRV_UART_Status DRV_UART_Get_Statistic(DRV_UART_Handle *handle, DRV_UART_Statistic *stat);
+
+/**
+ * @brief Move UART data by GDMA instead of per-FIFO interrupts.
+ * Rx runs on two ping-pong halves of config->rx_buffer. Each half is handed to the pending
+ * non-blocking request and the ringbuffer when it fills up, when the line goes idle (Rx timeout)
+ * or when DRV_UART_DMA_Poll is called.
+ * Tx requests of DRV_UART_Send_Nonblock are sent from the caller buffer and CB_TX_COMPLETE is
+ * notified once the whole request is written to the Tx FIFO. The GDMA driver must be initialized.
+ * If no GDMA channel is free for a direction, that direction stays in IRQ mode. GDMA mode lasts
+ * until DRV_UART_Uninitialize.
+ *
+ * @param handle UART handle
+ * @param config GDMA mode parameters
+ * @return DRV_UART_Status DRV_UART_ERROR_BUSY if a requested direction fell back to IRQ mode
+ */
+DRV_UART_Status DRV_UART_Enable_DMA(DRV_UART_Handle *handle, const DRV_UART_DMA_Config *config);
+
+/**
+ * @brief Hand the characters that GDMA already stored in the active Rx half to the consumers.
+ * The Rx timeout interrupt only fires while characters are left in the FIFO, so a consumer waiting
+ * on a non-blocking receive should call this periodically to pick up data ending on a burst.
+ *
+ * @param handle UART handle
+ */
+void DRV_UART_DMA_Poll(DRV_UART_Handle *handle);
 /** @} drv_uart_apis */
 #if defined(__cplusplus)
 }
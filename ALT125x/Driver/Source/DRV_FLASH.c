@@ -397,6 +397,8 @@ Flash_Err_Code DRV_FLASH_Read(void *src, void *dst, size_t size) {
   return FLASH_ERROR_NONE;
 }
 
+int DRV_FLASH_Is_Busy(void) { return serial_flash_is_device_busy(); }
+
 Flash_Err_Code DRV_FLASH_Initialize(void) { return FLASH_ERROR_NONE; }
 
 Flash_Err_Code DRV_FLASH_Uninitialize(void) { return FLASH_ERROR_NONE; }
@@ -68,6 +68,16 @@
 
 #define GDMA_BUSYWAIT_CNT 1000
 
+/* Command addressing fields */
+#define GDMA_ADDR_MODE_FIXED 0
+#define GDMA_ADDR_MODE_INCREMENT 1
+#define GDMA_ADDR_INC_STEP_DEFAULT 3
+#define GDMA_BUS_WIDTH_DEFAULT 3
+
+/* Command id: the channel in the low bits, a generation bumped on every arm above them */
+#define GDMA_CMD_ID_GEN_SHIFT 3
+#define GDMA_CMD_ID_GEN_STEP (1U << GDMA_CMD_ID_GEN_SHIFT)
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -143,6 +153,7 @@ struct Drv_GDMA_Peripheral {
   bool registered_sleep_notify; /**< Registration indicator of sleep notification */
   int32_t sleep_notify_idx;     /**< Sleep notification index */
 #endif
+  bool acquired[DRV_GDMA_Channel_MAX]; /**< Channels reserved by DRV_GDMA_Acquire_Channel */
 };
 
 /****************************************************************************
@@ -160,6 +171,8 @@ struct Drv_GDMA_Peripheral gdma_peripheral = {
     false,
     -1
 #endif
+    ,
+    {false}
 };
 
 /****************************************************************************
@@ -169,6 +182,40 @@ struct Drv_GDMA_Peripheral gdma_peripheral = {
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
+static void DRV_GDMA_Set_Mem_Mode(DRV_GDMA_Command *dma_cmd) {
+  dma_cmd->dma_ctrl_b.RD_ADDR_MODE = GDMA_ADDR_MODE_INCREMENT;
+  dma_cmd->dma_ctrl_b.RD_ADDR_INC_STEP = GDMA_ADDR_INC_STEP_DEFAULT;
+  dma_cmd->dma_ctrl_b.RD_BUS_WIDTH = GDMA_BUS_WIDTH_DEFAULT;
+  dma_cmd->dma_ctrl_b.WR_ADDR_MODE = GDMA_ADDR_MODE_INCREMENT;
+  dma_cmd->dma_ctrl_b.WR_ADDR_INC_STEP = GDMA_ADDR_INC_STEP_DEFAULT;
+  dma_cmd->dma_ctrl_b.WR_BUS_WIDTH = GDMA_BUS_WIDTH_DEFAULT;
+  dma_cmd->dma_ctrl_b.WAIT4READY = 0;
+  dma_cmd->dma_ctrl_b.MAX_BURST_LEN = 3;
+  dma_cmd->dma_ctrl_b.MAX_OUTSTANDING_TRANS = 2;
+}
+
+static void DRV_GDMA_Set_Periph_Mode(DRV_GDMA_Command *dma_cmd, DRV_GDMA_Periph_Dir dir,
+                                     DRV_GDMA_Periph_Width width) {
+  /* Peripheral data registers pop on every access, so the peripheral side is fixed, both sides use
+   * the register width and the transfer runs single-beat with the ready handshake. The width enum
+   * follows the BUS_WIDTH/ADDR_INC_STEP encoding (log2 of the access size). */
+  if (dir == DRV_GDMA_PERIPH_TO_MEM) {
+    dma_cmd->dma_ctrl_b.RD_ADDR_MODE = GDMA_ADDR_MODE_FIXED;
+    dma_cmd->dma_ctrl_b.WR_ADDR_MODE = GDMA_ADDR_MODE_INCREMENT;
+  } else {
+    dma_cmd->dma_ctrl_b.RD_ADDR_MODE = GDMA_ADDR_MODE_INCREMENT;
+    dma_cmd->dma_ctrl_b.WR_ADDR_MODE = GDMA_ADDR_MODE_FIXED;
+  }
+  dma_cmd->dma_ctrl_b.RD_ADDR_INC_STEP = width;
+  dma_cmd->dma_ctrl_b.RD_BUS_WIDTH = width;
+  dma_cmd->dma_ctrl_b.WR_ADDR_INC_STEP = width;
+  dma_cmd->dma_ctrl_b.WR_BUS_WIDTH = width;
+  dma_cmd->dma_ctrl_b.WAIT4READY = 1;
+  dma_cmd->dma_ctrl_b.DIS_RD_BYTE_EN = 0;
+  dma_cmd->dma_ctrl_b.MAX_BURST_LEN = 0;
+  dma_cmd->dma_ctrl_b.MAX_OUTSTANDING_TRANS = 0;
+}
+
 void DRV_GDMA_IrqHandler(DRV_GDMA_Channel channel) {
   GDMA_ASSERT(channel < DRV_GDMA_Channel_MAX);
 
@@ -238,6 +285,14 @@ static int32_t DRV_GDMA_HandleSleepNotify(DRV_SLEEP_NotifyType sleep_state, DRV_
         DRV_GDMA_CMD_IDX(n) = 0;
         DRV_GDMA_CMD_SIZE(n) = 1;
       }
+
+      /* Commands armed on acquired channels were lost, let their owners re-arm them */
+      for (n = 0; n < DRV_GDMA_Channel_MAX; n++) {
+        if (gdma_peripheral.acquired[n] && gdma_peripheral.evt_cb[n].event_callback) {
+          gdma_peripheral.evt_cb[n].event_callback(GDMA_EVENT_CHANNEL_RESUMED, n,
+                                                   gdma_peripheral.evt_cb[n].user_data);
+        }
+      }
     }
   }
 
@@ -398,9 +453,11 @@ DRV_GDMA_Status DRV_GDMA_Transfer_Block(DRV_GDMA_Channel channel, void *dest, co
   DRV_GDMA_Command *dma_cmd;
 
   dma_cmd = &gdma_peripheral.dma_cmd[channel];
+  DRV_GDMA_Set_Mem_Mode(dma_cmd);
   dma_cmd->read_addr = (uint32_t)src;
   dma_cmd->write_addr = (uint32_t)dest;
   dma_cmd->cmd_translen_b.transaction_len = n;
+  dma_cmd->cmd_translen_b.cmd_id += GDMA_CMD_ID_GEN_STEP;
   dma_cmd->dma_ctrl_b.INTR_MODE = 0;
   dma_cmd->dma_ctrl_b.STAT_INTR_EMITTED = 0;
   dma_cmd->dma_ctrl_b.STAT_FIFO_SECURITY_ERR = 0;
@@ -438,9 +495,41 @@ DRV_GDMA_Status DRV_GDMA_Transfer_Nonblock(DRV_GDMA_Channel channel, void *dest,
   DRV_GDMA_Command *dma_cmd;
 
   dma_cmd = &gdma_peripheral.dma_cmd[channel];
+  DRV_GDMA_Set_Mem_Mode(dma_cmd);
+  dma_cmd->read_addr = (uint32_t)src;
+  dma_cmd->write_addr = (uint32_t)dest;
+  dma_cmd->cmd_translen_b.transaction_len = n;
+  dma_cmd->cmd_translen_b.cmd_id += GDMA_CMD_ID_GEN_STEP;
+  dma_cmd->dma_ctrl_b.INTR_MODE = 1;
+  dma_cmd->dma_ctrl_b.STAT_INTR_EMITTED = 0;
+  dma_cmd->dma_ctrl_b.STAT_FIFO_SECURITY_ERR = 0;
+  dma_cmd->dma_ctrl_b.STAT_FIFO_VALIDNESS = 0;
+  // Start DMA action
+  DRV_GDMA_CMD_CNT_INC(channel) = 1;
+
+  return DRV_GDMA_OK;
+}
+
+DRV_GDMA_Status DRV_GDMA_Transfer_Periph_Nonblock(DRV_GDMA_Channel channel, void *dest,
+                                                  const void *src, size_t n,
+                                                  DRV_GDMA_Periph_Dir dir,
+                                                  DRV_GDMA_Periph_Width width) {
+  if (!gdma_peripheral.is_init) {
+    return DRV_GDMA_ERROR_UNINIT;
+  }
+
+  if (channel >= DRV_GDMA_Channel_MAX) {
+    return DRV_GDMA_ERROR_INVALID_CH;
+  }
+
+  DRV_GDMA_Command *dma_cmd;
+
+  dma_cmd = &gdma_peripheral.dma_cmd[channel];
+  DRV_GDMA_Set_Periph_Mode(dma_cmd, dir, width);
   dma_cmd->read_addr = (uint32_t)src;
   dma_cmd->write_addr = (uint32_t)dest;
   dma_cmd->cmd_translen_b.transaction_len = n;
+  dma_cmd->cmd_translen_b.cmd_id += GDMA_CMD_ID_GEN_STEP;
   dma_cmd->dma_ctrl_b.INTR_MODE = 1;
   dma_cmd->dma_ctrl_b.STAT_INTR_EMITTED = 0;
   dma_cmd->dma_ctrl_b.STAT_FIFO_SECURITY_ERR = 0;
@@ -450,3 +539,122 @@ DRV_GDMA_Status DRV_GDMA_Transfer_Nonblock(DRV_GDMA_Channel channel, void *dest,
 
   return DRV_GDMA_OK;
 }
+
+int32_t DRV_GDMA_Is_Transfer_Done(DRV_GDMA_Channel channel) {
+  GDMA_ASSERT(channel < DRV_GDMA_Channel_MAX);
+
+  return gdma_peripheral.dma_cmd[channel].dma_ctrl_b.STAT_FIFO_VALIDNESS ? 1 : 0;
+}
+
+int32_t DRV_GDMA_Get_Transferred_Count(DRV_GDMA_Channel channel) {
+  GDMA_ASSERT(channel < DRV_GDMA_Channel_MAX);
+
+  DRV_GDMA_Command *dma_cmd;
+  uint32_t start, cur;
+
+  dma_cmd = &gdma_peripheral.dma_cmd[channel];
+  if (dma_cmd->dma_ctrl_b.STAT_FIFO_VALIDNESS) {
+    return dma_cmd->cmd_translen_b.transaction_len;
+  }
+
+  /* The engine shows the progress of one command only, the one it works on. The generation in the
+   * command id tells it from an earlier command of the channel that the engine worked on last. */
+  if (gdma_peripheral.reg->DMA_CMD_CMD_LEN_STAT_b.CMD_ID != dma_cmd->cmd_translen_b.cmd_id) {
+    return -1;
+  }
+  if (dma_cmd->dma_ctrl_b.RD_ADDR_MODE == GDMA_ADDR_MODE_INCREMENT) {
+    start = dma_cmd->read_addr;
+    cur = gdma_peripheral.reg->DMA_CMD_RD_ADDR_STAT;
+  } else {
+    start = dma_cmd->write_addr;
+    cur = gdma_peripheral.reg->DMA_CMD_WR_ADDR_STAT;
+  }
+  if (cur < start || cur - start > dma_cmd->cmd_translen_b.transaction_len) {
+    return -1;
+  }
+  return (int32_t)(cur - start);
+}
+
+DRV_GDMA_Status DRV_GDMA_Acquire_Channel(DRV_GDMA_Channel *channel) {
+  if (!gdma_peripheral.is_init) {
+    return DRV_GDMA_ERROR_UNINIT;
+  }
+
+  GDMA_ASSERT(channel);
+
+  int n;
+  DRV_GDMA_Status ret = DRV_GDMA_ERROR_NO_CHANNEL;
+  uint32_t irqmask;
+
+  irqmask = ((__get_PRIMASK() != 0U) || (__get_BASEPRI() != 0U));
+  __disable_irq();
+  for (n = DRV_GDMA_Channel_MAX - 1; n >= 0; n--) {
+    if (!gdma_peripheral.acquired[n]) {
+      gdma_peripheral.acquired[n] = true;
+      *channel = (DRV_GDMA_Channel)n;
+      ret = DRV_GDMA_OK;
+      break;
+    }
+  }
+  if (!irqmask) {
+    __enable_irq();
+  }
+
+  return ret;
+}
+
+DRV_GDMA_Status DRV_GDMA_Release_Channel(DRV_GDMA_Channel channel) {
+  if (!gdma_peripheral.is_init) {
+    return DRV_GDMA_ERROR_UNINIT;
+  }
+
+  if (channel >= DRV_GDMA_Channel_MAX) {
+    return DRV_GDMA_ERROR_INVALID_CH;
+  }
+
+  DRV_GDMA_RegisterIrqCallback(channel, NULL);
+  gdma_peripheral.acquired[channel] = false;
+  return DRV_GDMA_OK;
+}
+
+DRV_GDMA_Status DRV_GDMA_Stop_Channel(DRV_GDMA_Channel channel) {
+  if (!gdma_peripheral.is_init) {
+    return DRV_GDMA_ERROR_UNINIT;
+  }
+
+  if (channel >= DRV_GDMA_Channel_MAX) {
+    return DRV_GDMA_ERROR_INVALID_CH;
+  }
+
+  uint32_t irq_enabled;
+
+  irq_enabled = NVIC_GetEnableIRQ(gdma_peripheral.irq_num[channel]);
+  NVIC_DisableIRQ(gdma_peripheral.irq_num[channel]);
+
+  /* Empty the command FIFO, then point it back at the channel command */
+  DRV_GDMA_CMD_SIZE(channel) = 0;
+  DRV_GDMA_CMD_IDX(channel) = 0;
+  DRV_GDMA_CMD_BASEADDR(channel) = (uint32_t)&gdma_peripheral.dma_cmd[channel];
+  DRV_GDMA_CMD_SIZE(channel) = 1;
+  gdma_peripheral.dma_cmd[channel].dma_ctrl_b.INTR_MODE = 0;
+
+  /* Drop a completion which raced with the stop */
+  (void)DRV_GDMA_DONE_INT_STAT(channel);
+  NVIC_ClearPendingIRQ(gdma_peripheral.irq_num[channel]);
+  if (irq_enabled) {
+    NVIC_EnableIRQ(gdma_peripheral.irq_num[channel]);
+  }
+  return DRV_GDMA_OK;
+}
+
+void DRV_GDMA_Disable_Irq(DRV_GDMA_Channel channel) {
+  GDMA_ASSERT(channel < DRV_GDMA_Channel_MAX);
+
+  NVIC_DisableIRQ(gdma_peripheral.irq_num[channel]);
+}
+
+void DRV_GDMA_Enable_Irq(DRV_GDMA_Channel channel) {
+  GDMA_ASSERT(channel < DRV_GDMA_Channel_MAX);
+
+  NVIC_EnableIRQ(gdma_peripheral.irq_num[channel]);
+}
@@ -54,6 +54,17 @@
 
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
 #define HIFC_LOOP (100)
+
+/* GDMA mode */
+#define UART_FIFO_DEPTH (32)
+#define UART_DMACR_OFFSET (0x48)
+#define UART_DMACR_RXDMAE (1UL << 0)
+#define UART_DMACR_TXDMAE (1UL << 1)
+#define UART_DMACR(base) REGISTER((uint32_t)(base) + UART_DMACR_OFFSET)
+#define UART_DMA_RX_FIFO_LEVEL (2) /* Rx burst request at 1/2 full */
+/* Data register reads keep bits [15:12] clear, so an all-ones sample marks a slot not yet written */
+#define UART_DMA_RX_EMPTY_SAMPLE (0xFFFF)
+#define UART_DMA_TX_MIN_LEN (16) /* Shorter requests fit the Tx FIFO without the GDMA setup */
 static UART_Type *uart_bases[] = UART_BASE_PTR;
 static DRV_UART_Handle *uart_handles[ARRAY_SIZE(uart_bases)];
 
@@ -197,15 +208,10 @@ static uint8_t DRV_UART_Get_Instance_From_Base(UART_Type *base) {
   UART_ASSERT(0);
 }
 
-static inline DRV_UART_Status DRV_UART_Is_Valid_Data(DRV_UART_Handle *handle, uint8_t *data) {
-  UART_ASSERT(handle);
-  UART_ASSERT(data);
-
-  uint32_t uartdr;
+static inline DRV_UART_Status DRV_UART_Check_Data(DRV_UART_Handle *handle, uint32_t uartdr,
+                                                  uint8_t *data) {
   DRV_UART_Status ret = DRV_UART_ERROR_NONE;
 
-  reset_inactivity_timer(handle->base);
-  uartdr = handle->base->DR;
   if (uartdr & UARTF0_DR_FE_Msk) {
     ret = DRV_UART_ERROR_FRAME;
     handle->stat.fe_cnt++;
@@ -228,6 +234,225 @@ static inline DRV_UART_Status DRV_UART_Is_Valid_Data(DRV_UART_Handle *handle, ui
   return ret;
 }
 
+static inline DRV_UART_Status DRV_UART_Is_Valid_Data(DRV_UART_Handle *handle, uint8_t *data) {
+  UART_ASSERT(handle);
+  UART_ASSERT(data);
+
+  return DRV_UART_Check_Data(handle, handle->base->DR, data);
+}
+
+/*
+  Record one burst of receive activity (an ISR invocation or a batch of GDMA samples) for HiFC and
+  the power manager, instead of refreshing them for every character.
+*/
+static void DRV_UART_Rx_Activity(DRV_UART_Handle *handle) {
+  reset_inactivity_timer(handle->base);
+#if (configUSE_ALT_SLEEP == 1)
+  pwr_mngr_refresh_uart_activity(DRV_UART_Get_Instance_From_Base(handle->base));
+#endif
+  handle->stat.rx_burst_cnt++;
+}
+
+static void DRV_UART_Tx_Activity(DRV_UART_Handle *handle) {
+  reset_inactivity_timer(handle->base);
+  handle->stat.tx_burst_cnt++;
+}
+
+/*
+  Hand one received character to the pending non-blocking request or to the ringbuffer.
+*/
+static void DRV_UART_Rx_Put(DRV_UART_Handle *handle, uint8_t data) {
+  if (handle->rx_data_remaining_byte != 0) {
+    *handle->rx_data = data;
+    handle->rx_data++;
+    handle->rx_data_remaining_byte--;
+
+    if (handle->rx_data_remaining_byte == 0 && handle->callback) {
+      handle->callback(handle, CB_RX_COMPLETE, handle->user_data);
+      handle->rx_data = NULL;
+      handle->rx_line_state = DRV_UART_LINE_STATE_IDLE;
+    }
+  } else if (Is_Ringbuffer_Full(handle) == false) {
+    handle->rx_ringbuffer[handle->ringbuffer_head] = data;
+    if (handle->ringbuffer_head + 1 == handle->ringbuffer_size) {
+      handle->ringbuffer_head = 0;
+    } else {
+      handle->ringbuffer_head++;
+    }
+  } else {
+    // GDMA keeps receiving, so there is no flow control to hold the data back
+    handle->stat.rx_drop_cnt++;
+  }
+}
+
+static void DRV_UART_Rx_Irq_Disable(DRV_UART_Handle *handle) {
+  DRV_UART_Disable_Interrupt(handle->base, RX_FULL | RX_TIMEOUT);
+  if (handle->rx_dma_enabled) {
+    DRV_GDMA_Disable_Irq(handle->rx_dma_channel);
+  }
+}
+
+static void DRV_UART_Rx_Irq_Enable(DRV_UART_Handle *handle) {
+  if (handle->rx_dma_enabled) {
+    // Rx timeout is the idle-line detection, GDMA interrupt is the half-full detection
+    DRV_UART_Enable_Interrupt(handle->base, RX_TIMEOUT);
+    DRV_GDMA_Enable_Irq(handle->rx_dma_channel);
+  } else {
+    DRV_UART_Enable_Interrupt(handle->base, RX_FULL | RX_TIMEOUT);
+  }
+}
+
+static void DRV_UART_Dma_Rx_Arm(DRV_UART_Handle *handle) {
+  DRV_GDMA_Transfer_Periph_Nonblock(
+      handle->rx_dma_channel, handle->rx_dma_buffer[handle->rx_dma_active],
+      (const void *)&handle->base->DR, handle->rx_dma_buffer_len * sizeof(uint16_t),
+      DRV_GDMA_PERIPH_TO_MEM, DRV_GDMA_PERIPH_WIDTH_16BIT);
+}
+
+/**
+ * @brief Hand the samples of a receive half from rx_dma_delivered on to the consumers. Stops at the
+ * first slot that GDMA has not written yet.
+ */
+static void DRV_UART_Dma_Rx_Deliver(DRV_UART_Handle *handle, volatile uint16_t *half) {
+  size_t i = handle->rx_dma_delivered;
+  uint16_t sample;
+  uint8_t data;
+  DRV_UART_Status st;
+
+  while (i < handle->rx_dma_buffer_len) {
+    sample = half[i];
+    if (sample == UART_DMA_RX_EMPTY_SAMPLE) {
+      break;
+    }
+
+    st = DRV_UART_Check_Data(handle, sample, &data);
+    if (st == DRV_UART_ERROR_NONE || st == DRV_UART_ERROR_OVERRUN) {
+      DRV_UART_Rx_Put(handle, data);
+      handle->stat.rx_cnt_dma++;
+    }
+    i++;
+  }
+
+  if (i != handle->rx_dma_delivered) {
+    handle->rx_dma_delivered = i;
+    DRV_UART_Rx_Activity(handle);
+  }
+}
+
+/**
+ * @brief Swap the receive halves once GDMA has filled the active one. Safe to call again after the
+ * swap: the status of the newly armed command is not done yet.
+ */
+static void DRV_UART_Dma_Rx_Service(DRV_UART_Handle *handle) {
+  uint16_t *done;
+
+  if (!DRV_GDMA_Is_Transfer_Done(handle->rx_dma_channel)) {
+    return;
+  }
+
+  // keep GDMA draining the FIFO into the other half while this one is handed off
+  done = handle->rx_dma_buffer[handle->rx_dma_active];
+  handle->rx_dma_active ^= 1;
+  DRV_UART_Dma_Rx_Arm(handle);
+
+  DRV_UART_Dma_Rx_Deliver(handle, done);
+  handle->rx_dma_delivered = 0;
+  memset(done, 0xFF, handle->rx_dma_buffer_len * sizeof(uint16_t));
+}
+
+static void DRV_UART_Dma_Rx_Idle(DRV_UART_Handle *handle) {
+  UART_Type *base = handle->base;
+  uint8_t data;
+  uint32_t i;
+  DRV_UART_Status st;
+
+  DRV_UART_Dma_Rx_Service(handle);
+  DRV_UART_Dma_Rx_Deliver(handle, handle->rx_dma_buffer[handle->rx_dma_active]);
+
+  // Less than a burst is left in the FIFO. Hold the DMA request while the CPU drains it so that the
+  // stream is never split between GDMA and the CPU.
+  UART_DMACR(base) &= ~UART_DMACR_RXDMAE;
+  for (i = 0; i < UART_FIFO_DEPTH && base->FR_b.RXFE == 0; i++) {
+    st = DRV_UART_Is_Valid_Data(handle, &data);
+    if (st == DRV_UART_ERROR_NONE || st == DRV_UART_ERROR_OVERRUN) {
+      DRV_UART_Rx_Put(handle, data);
+      handle->stat.rx_cnt_isr++;
+    }
+  }
+  if (i != 0) {
+    DRV_UART_Rx_Activity(handle);
+  }
+  UART_DMACR(base) |= UART_DMACR_RXDMAE;
+}
+
+static void DRV_UART_Dma_Rx_Callback(uint32_t event, DRV_GDMA_Channel channel, void *user_data) {
+  DRV_UART_Handle *handle = (DRV_UART_Handle *)user_data;
+
+  if (event & GDMA_EVENT_CHANNEL_RESUMED) {
+    // landed samples were delivered on suspending, restart the active half from its beginning
+    handle->rx_dma_delivered = 0;
+    memset(handle->rx_dma_buffer[handle->rx_dma_active], 0xFF,
+           handle->rx_dma_buffer_len * sizeof(uint16_t));
+    DRV_UART_Dma_Rx_Arm(handle);
+  } else if (event) {
+    DRV_UART_Dma_Rx_Service(handle);
+  }
+}
+
+static void DRV_UART_Dma_Request(UART_Type *base, uint32_t mask, bool enable) {
+  uint32_t reg;
+
+  // the Rx service toggles RXDMAE from interrupt context
+  do {
+    reg = __LDREXW(&UART_DMACR(base));
+    reg = enable ? (reg | mask) : (reg & ~mask);
+  } while (__STREXW(reg, &UART_DMACR(base)));
+}
+
+/**
+ * @brief Withdraw a GDMA Tx transfer in flight. The request goes first so that no further byte is
+ * moved, then the armed command is dropped so that nothing reads the caller's buffer afterwards.
+ *
+ * @return Bytes moved to the Tx FIFO, read while the command still stalls on the withdrawn request.
+ * -1 if GDMA could not tell.
+ */
+static int32_t DRV_UART_Dma_Tx_Stop(DRV_UART_Handle *handle) {
+  int32_t moved;
+
+  if (!handle->tx_dma_busy) {
+    return 0;
+  }
+  DRV_UART_Dma_Request(handle->base, UART_DMACR_TXDMAE, false);
+  moved = DRV_GDMA_Get_Transferred_Count(handle->tx_dma_channel);
+  DRV_GDMA_Stop_Channel(handle->tx_dma_channel);
+  handle->tx_dma_busy = 0;
+  return moved;
+}
+
+static void DRV_UART_Dma_Tx_Callback(uint32_t event, DRV_GDMA_Channel channel, void *user_data) {
+  DRV_UART_Handle *handle = (DRV_UART_Handle *)user_data;
+
+  if (!(event & (GDMA_EVENT_TRANSACTION_DONE | GDMA_EVENT_TRANSACTION_ERROR))) {
+    return;
+  }
+
+  handle->tx_dma_busy = 0;
+  if (handle->tx_line_state == DRV_UART_LINE_STATE_IDLE) {
+    return;  // aborted, the user has already been answered
+  }
+
+  DRV_UART_Tx_Activity(handle);
+  handle->stat.tx_cnt_dma += handle->tx_data_remaining_byte;
+  handle->tx_data += handle->tx_data_remaining_byte;
+  handle->tx_data_remaining_byte = 0;
+
+  if (handle->callback) {
+    handle->callback(handle, CB_TX_COMPLETE, handle->user_data);
+  }
+  handle->tx_line_state = DRV_UART_LINE_STATE_IDLE;
+  handle->tx_data = NULL;
+}
+
 static void DRV_UART_IrqHandler(DRV_UART_Handle *handle) {
   UART_ASSERT(handle);
   UART_ASSERT(handle->rx_ringbuffer);
@@ -238,10 +463,12 @@ static void DRV_UART_IrqHandler(DRV_UART_Handle *handle) {
 
   // process tx fifo empty interrupt
   if (base->MIS_b.TXMIS) {
+    if (handle->tx_data_remaining_byte && base->FR_b.TXFF == 0) {
+      DRV_UART_Tx_Activity(handle);
+    }
     while (handle->tx_data_remaining_byte) {
       if (base->FR_b.TXFF == 0)  // tx fifo has room
       {
-        reset_inactivity_timer(handle->base);
         base->DR = *handle->tx_data;
         handle->tx_data++;
         handle->tx_data_remaining_byte--;
@@ -263,15 +490,31 @@ static void DRV_UART_IrqHandler(DRV_UART_Handle *handle) {
     base->ICR_b.TXIC = 1;  // clear interrupt
   }                        // end of if( base->MIS_b.TXMIS)
 
+  // in GDMA mode only the idle line (Rx timeout) and break are left to the Rx interrupt
+  if (handle->rx_dma_enabled) {
+    if (base->MIS_b.RTMIS || base->MIS_b.BEMIS) {
+      DRV_UART_Dma_Rx_Idle(handle);
+      base->ICR_b.RTIC = 1;
+      if (be_flag || base->MIS_b.BEMIS) {
+        if (handle->callback) {
+          handle->callback(handle, CB_BREAK_ERROR, handle->user_data);
+        }
+        base->ICR_b.BEIC = 1;
+        be_flag = 0;
+      }
+    }
+    return;
+  }
+
   // process receive interrupt
   if (base->MIS_b.RXMIS || base->MIS_b.RTMIS) {
+    // one activity record covers the whole invocation, the FIFO is drained within the same tick
+    if (handle->rx_data_remaining_byte != 0 || base->FR_b.RXFE == 0) {
+      DRV_UART_Rx_Activity(handle);
+    }
+
     // if nonblocking read is not yet completed, save data to user buffer directly
     while (handle->rx_data_remaining_byte != 0) {
-#if (configUSE_ALT_SLEEP == 1)
-      if (base == UARTF0) {
-        pwr_mngr_refresh_uart_inactive_time();
-      }
-#endif
       if (base->FR_b.RXFE == 0) {
         st = DRV_UART_Is_Valid_Data(handle, &data);
         if (st == DRV_UART_ERROR_NONE || st == DRV_UART_ERROR_OVERRUN) {
@@ -300,11 +543,6 @@ static void DRV_UART_IrqHandler(DRV_UART_Handle *handle) {
     // If FIFO still has data and no pending user request, save data to ringbuffer
     while (base->FR_b.RXFE == 0) {
       if (Is_Ringbuffer_Full(handle) == false) {
-#if (configUSE_ALT_SLEEP == 1)
-        if (base == UARTF0) {
-          pwr_mngr_refresh_uart_inactive_time();
-        }
-#endif
         st = DRV_UART_Is_Valid_Data(handle, &data);
         if (st == DRV_UART_ERROR_NONE || st == DRV_UART_ERROR_OVERRUN) {
           handle->rx_ringbuffer[handle->ringbuffer_head] = data;
@@ -538,6 +776,8 @@ void DRV_UART_Update_Setting(UART_Type *base, const DRV_UART_Config *UART_config
   UART_ASSERT(base);
   UART_ASSERT(UART_config);
 
+  DRV_UART_Handle *handle;
+
   DRV_UART_Disable_Uart(base);
   DRV_UART_Disable_Fifo(base);
   DRV_UART_Set_Baudrate(base, (uint32_t)UART_config->BaudRate, clock);
@@ -546,12 +786,40 @@ void DRV_UART_Update_Setting(UART_Type *base, const DRV_UART_Config *UART_config
   DRV_UART_Set_Word_length(base, UART_config->WordLength);
   DRV_UART_Set_Hardware_Flow_Control(base, UART_config->HwFlowCtl);
   DRV_UART_Enable_Fifo(base);
+  handle = uart_handles[DRV_UART_Get_Instance_From_Base(base)];
+  if (handle && handle->rx_dma_enabled) {
+    base->IFLS_b.RXIFLSEL = UART_DMA_RX_FIFO_LEVEL;
+  }
   DRV_UART_Enable_Uart(base);
   // A dummy write to apply the settings while MAP is in sleep mode
   base->LCR_H = base->LCR_H;
 }
 
 #if (configUSE_ALT_SLEEP == 1)
+static void DRV_UART_Dma_Sleep_Notify(DRV_SLEEP_NotifyType sleep_state) {
+  DRV_UART_Handle *handle;
+  uint32_t i;
+
+  for (i = 0; i < ARRAY_SIZE(uart_handles); i++) {
+    handle = uart_handles[i];
+    if (!handle || (!handle->rx_dma_enabled && !handle->tx_dma_enabled)) {
+      continue;
+    }
+
+    if (sleep_state == DRV_SLEEP_NTFY_SUSPENDING) {
+      // the armed Rx command does not survive, hand what has landed so far to the consumers
+      if (handle->rx_dma_enabled) {
+        DRV_UART_Dma_Rx_Service(handle);
+        DRV_UART_Dma_Rx_Deliver(handle, handle->rx_dma_buffer[handle->rx_dma_active]);
+      }
+    } else {
+      // the Rx command is re-armed on GDMA_EVENT_CHANNEL_RESUMED
+      UART_DMACR(handle->base) = (handle->rx_dma_enabled ? UART_DMACR_RXDMAE : 0) |
+                                 (handle->tx_dma_enabled ? UART_DMACR_TXDMAE : 0);
+    }
+  }
+}
+
 int32_t DRV_UART_HandleSleepNotify(DRV_SLEEP_NotifyType sleep_state, DRV_PM_PwrMode pwr_mode,
                                    void *ptr_ctx) {
   if (pwr_mode == DRV_PM_MODE_STANDBY || pwr_mode == DRV_PM_MODE_SHUTDOWN) {
@@ -617,6 +885,7 @@ int32_t DRV_UART_HandleSleepNotify(DRV_SLEEP_NotifyType sleep_state, DRV_PM_PwrM
       UARTI2_REG_CFG[11] = REGISTER(UARTI2_BASE + 0x40);
       UARTI2_REG_CFG[12] = REGISTER(UARTI2_BASE + 0x44);
 #endif
+      DRV_UART_Dma_Sleep_Notify(sleep_state);
     } else if (sleep_state == DRV_SLEEP_NTFY_RESUMING) {
       /* UARTF0 */
       REGISTER(UARTF0_BASE + 0x24) = UARTF0_REG_CFG[4];
@@ -654,6 +923,7 @@ int32_t DRV_UART_HandleSleepNotify(DRV_SLEEP_NotifyType sleep_state, DRV_PM_PwrM
       REGISTER(UARTI2_BASE + 0x34) = UARTI2_REG_CFG[8];
       REGISTER(UARTI2_BASE + 0x38) = UARTI2_REG_CFG[9];
 #endif
+      DRV_UART_Dma_Sleep_Notify(sleep_state);
     }
   }
   return 0;
@@ -720,6 +990,18 @@ DRV_UART_Status DRV_UART_Uninitialize(DRV_UART_Handle *handle) {
   UART_Type *base = handle->base;
 
   DRV_UART_Disable_Interrupt(handle->base, RX_FULL | RX_TIMEOUT | TX_EMPTY);
+  if (handle->rx_dma_enabled || handle->tx_dma_enabled) {
+    DRV_UART_Dma_Tx_Stop(handle);
+    UART_DMACR(base) = 0;
+    // the Rx command stays armed into rx_buffer until it is dropped
+    if (handle->rx_dma_enabled) {
+      DRV_GDMA_Stop_Channel(handle->rx_dma_channel);
+      DRV_GDMA_Release_Channel(handle->rx_dma_channel);
+    }
+    if (handle->tx_dma_enabled) {
+      DRV_GDMA_Release_Channel(handle->tx_dma_channel);
+    }
+  }
   DRV_UART_Disable_Uart(base);
   DRV_UART_Disable_Fifo(base);
 
@@ -740,6 +1022,9 @@ DRV_UART_Status DRV_UART_Receive_Block(DRV_UART_Handle *handle, void *buffer, si
   int8_t *buf = (int8_t *)buffer;
 
   UART_Type *base = handle->base;
+  if (handle->rx_dma_enabled) {
+    return DRV_UART_ERROR_UNSUPPORTED;  // GDMA owns the data register
+  }
   if (handle->rx_line_state == DRV_UART_LINE_STATE_BUSY) {
     return DRV_UART_ERROR_BUSY;
   }
@@ -762,11 +1047,8 @@ DRV_UART_Status DRV_UART_Receive_Block(DRV_UART_Handle *handle, void *buffer, si
     // waiting for
     while (base->FR_b.RXFE == 1) {
     }
-#if (configUSE_ALT_SLEEP == 1)
-    if (base == UARTF0) {
-      pwr_mngr_refresh_uart_inactive_time();
-    }
-#endif
+    // the wait between characters is unbounded, so every character is a burst of its own
+    DRV_UART_Rx_Activity(handle);
     ret = DRV_UART_Is_Valid_Data(handle, &data);
     if (ret == DRV_UART_ERROR_NONE || ret == DRV_UART_ERROR_OVERRUN) {
       buf[i] = data;
@@ -799,7 +1081,11 @@ DRV_UART_Status DRV_UART_Receive_Nonblock(DRV_UART_Handle *handle, void *buffer,
   handle->rx_line_state = DRV_UART_LINE_STATE_BUSY;
   handle->rx_data_length_requested = length;
 
-  DRV_UART_Disable_Interrupt(handle->base, RX_FULL | RX_TIMEOUT);
+  DRV_UART_Rx_Irq_Disable(handle);
+  if (handle->rx_dma_enabled) {
+    DRV_UART_Dma_Rx_Service(handle);
+    DRV_UART_Dma_Rx_Deliver(handle, handle->rx_dma_buffer[handle->rx_dma_active]);
+  }
 
   copied_data = Get_Bytes_From_Ringbuffer(handle, buf, length);
   length -= copied_data;
@@ -819,17 +1105,27 @@ DRV_UART_Status DRV_UART_Receive_Nonblock(DRV_UART_Handle *handle, void *buffer,
     ret = DRV_UART_WAIT_CB;
   }
 
-  DRV_UART_Enable_Interrupt(handle->base, RX_FULL | RX_TIMEOUT);
+  DRV_UART_Rx_Irq_Enable(handle);
   return ret;
 }
 int32_t DRV_UART_Abort_Send(DRV_UART_Handle *handle) {
   UART_ASSERT(handle);
-  size_t sent;
+  int32_t sent, moved;
   DRV_UART_Disable_Interrupt(handle->base, TX_EMPTY);
   if (handle->tx_line_state == DRV_UART_LINE_STATE_IDLE) {
     sent = -1;
   } else {
-    sent = DRV_UART_Get_Transmitted_Tx_Count(handle);
+    moved = 0;
+    if (handle->tx_dma_busy) {
+      // tx_data_remaining_byte covers the whole transfer until GDMA reports it done
+      moved = DRV_UART_Dma_Tx_Stop(handle);
+      DRV_UART_Dma_Request(handle->base, UART_DMACR_TXDMAE, true);
+      if (moved > 0) {
+        handle->stat.tx_cnt_dma += moved;
+        handle->tx_data_remaining_byte -= moved;
+      }
+    }
+    sent = (moved < 0) ? DRV_UART_ABORT_COUNT_UNKNOWN : DRV_UART_Get_Transmitted_Tx_Count(handle);
     handle->tx_data = NULL;
     handle->tx_data_remaining_byte = 0;
     handle->tx_data_total_byte = 0;
@@ -842,7 +1138,7 @@ int32_t DRV_UART_Abort_Receive(DRV_UART_Handle *handle) {
   UART_ASSERT(handle);
 
   size_t received;
-  DRV_UART_Disable_Interrupt(handle->base, RX_FULL | RX_TIMEOUT);
+  DRV_UART_Rx_Irq_Disable(handle);
   if (handle->rx_line_state == DRV_UART_LINE_STATE_IDLE) {
     received = -1;
   } else {
@@ -855,7 +1151,7 @@ int32_t DRV_UART_Abort_Receive(DRV_UART_Handle *handle) {
     handle->rx_line_state = DRV_UART_LINE_STATE_IDLE;
   }
 
-  DRV_UART_Enable_Interrupt(handle->base, RX_FULL | RX_TIMEOUT);
+  DRV_UART_Rx_Irq_Enable(handle);
   return received;
 }
 
@@ -867,7 +1163,7 @@ DRV_UART_Status DRV_UART_Send_Nonblock(DRV_UART_Handle *handle, void *data, uint
   if (length == 0) {
     return DRV_UART_ERROR_PARAMETER;
   }
-  if (handle->tx_line_state == DRV_UART_LINE_STATE_BUSY) {
+  if (handle->tx_line_state == DRV_UART_LINE_STATE_BUSY || handle->tx_dma_busy) {
     return DRV_UART_ERROR_BUSY;
   }
   handle->tx_line_state = DRV_UART_LINE_STATE_BUSY;
@@ -877,9 +1173,27 @@ DRV_UART_Status DRV_UART_Send_Nonblock(DRV_UART_Handle *handle, void *data, uint
     handle->tx_line_state = DRV_UART_LINE_STATE_IDLE;
     return DRV_UART_ERROR_HIFC_TIMEOUT;
   }
+
+  if (handle->tx_dma_enabled && length >= UART_DMA_TX_MIN_LEN) {
+    DRV_UART_Tx_Activity(handle);
+    handle->tx_data = buf;
+    handle->tx_data_remaining_byte = length;
+    handle->tx_data_total_byte = length;
+    handle->tx_dma_busy = 1;
+
+    if (DRV_GDMA_Transfer_Periph_Nonblock(handle->tx_dma_channel, (void *)&handle->base->DR, buf,
+                                          length, DRV_GDMA_MEM_TO_PERIPH,
+                                          DRV_GDMA_PERIPH_WIDTH_8BIT) == DRV_GDMA_OK) {
+      return DRV_UART_WAIT_CB;
+    }
+    // fall back to the IRQ path
+    handle->tx_dma_busy = 0;
+  }
   // in order to generate tx_empty interupt, we need to fill up fifo first
+  if (handle->base->FR_b.TXFF == 0 && length != 0) {
+    DRV_UART_Tx_Activity(handle);
+  }
   while (handle->base->FR_b.TXFF == 0 && length != 0) {
-    reset_inactivity_timer(handle->base);
     handle->base->DR = *buf;
     buf++;
     length--;
@@ -922,7 +1236,7 @@ DRV_UART_Status DRV_UART_Send_Block(DRV_UART_Handle *handle, void *data, uint32_
     while (base->FR_b.TXFF == 1)  // tx fifo has room
     {
     }
-    reset_inactivity_timer(handle->base);
+    DRV_UART_Tx_Activity(handle);
     base->DR = *buf;
     buf++;
     length--;
@@ -941,3 +1255,71 @@ DRV_UART_Status DRV_UART_Get_Statistic(DRV_UART_Handle *handle, DRV_UART_Statist
 
   return DRV_UART_ERROR_NONE;
 }
+
+DRV_UART_Status DRV_UART_Enable_DMA(DRV_UART_Handle *handle, const DRV_UART_DMA_Config *config) {
+  UART_ASSERT(handle);
+  UART_ASSERT(config);
+
+  UART_Type *base = handle->base;
+  DRV_GDMA_EventCallback gdma_cb;
+  DRV_UART_Status ret = DRV_UART_ERROR_NONE;
+
+  if (config->rx_buffer &&
+      config->rx_buffer_size < 2 * UART_FIFO_DEPTH * sizeof(uint16_t)) {
+    return DRV_UART_ERROR_PARAMETER;
+  }
+
+  DRV_UART_Rx_Irq_Disable(handle);
+
+  if (config->rx_buffer && !handle->rx_dma_enabled) {
+    if (DRV_GDMA_Acquire_Channel(&handle->rx_dma_channel) == DRV_GDMA_OK) {
+      handle->rx_dma_buffer_len = config->rx_buffer_size / (2 * sizeof(uint16_t));
+      handle->rx_dma_buffer[0] = config->rx_buffer;
+      handle->rx_dma_buffer[1] = config->rx_buffer + handle->rx_dma_buffer_len;
+      handle->rx_dma_active = 0;
+      handle->rx_dma_delivered = 0;
+      memset(config->rx_buffer, 0xFF, 2 * handle->rx_dma_buffer_len * sizeof(uint16_t));
+
+      gdma_cb.user_data = handle;
+      gdma_cb.event_callback = DRV_UART_Dma_Rx_Callback;
+      DRV_GDMA_RegisterIrqCallback(handle->rx_dma_channel, &gdma_cb);
+
+      // characters still in the FIFO are picked up by GDMA in order
+      base->IFLS_b.RXIFLSEL = UART_DMA_RX_FIFO_LEVEL;
+      DRV_UART_Dma_Rx_Arm(handle);
+      UART_DMACR(base) |= UART_DMACR_RXDMAE;
+      handle->rx_dma_enabled = 1;
+    } else {
+      ret = DRV_UART_ERROR_BUSY;
+    }
+  }
+
+  if (config->tx_enable && !handle->tx_dma_enabled) {
+    if (DRV_GDMA_Acquire_Channel(&handle->tx_dma_channel) == DRV_GDMA_OK) {
+      gdma_cb.user_data = handle;
+      gdma_cb.event_callback = DRV_UART_Dma_Tx_Callback;
+      DRV_GDMA_RegisterIrqCallback(handle->tx_dma_channel, &gdma_cb);
+
+      UART_DMACR(base) |= UART_DMACR_TXDMAE;
+      handle->tx_dma_enabled = 1;
+    } else {
+      ret = DRV_UART_ERROR_BUSY;
+    }
+  }
+
+  DRV_UART_Rx_Irq_Enable(handle);
+  return ret;
+}
+
+void DRV_UART_DMA_Poll(DRV_UART_Handle *handle) {
+  UART_ASSERT(handle);
+
+  if (!handle->rx_dma_enabled) {
+    return;
+  }
+
+  DRV_UART_Rx_Irq_Disable(handle);
+  DRV_UART_Dma_Rx_Service(handle);
+  DRV_UART_Dma_Rx_Deliver(handle, handle->rx_dma_buffer[handle->rx_dma_active]);
+  DRV_UART_Rx_Irq_Enable(handle);
+}
@@ -321,7 +321,7 @@ static enum ALT1250_STATUS otp_sb_enable_check_error(int idx, enum ALT1250_STATU
 
 #define TRAN(x) ENDIAN_SWAP_32BYTES(x)
 
-static const unsigned long crc32_tab[] = {
+static const uint32_t crc32_tab[] = {
     TRAN(0x00000000L), TRAN(0x77073096L), TRAN(0xee0e612cL), TRAN(0x990951baL), TRAN(0x076dc419L),
     TRAN(0x706af48fL), TRAN(0xe963a535L), TRAN(0x9e6495a3L), TRAN(0x0edb8832L), TRAN(0x79dcb8a4L),
     TRAN(0xe0d5e91eL), TRAN(0x97d2d988L), TRAN(0x09b64c2bL), TRAN(0x7eb17cbdL), TRAN(0xe7b82d07L),
@@ -376,11 +376,22 @@ static const unsigned long crc32_tab[] = {
     TRAN(0x2d02ef8dL)};
 
 #define CRC32_CALC_WORD_SZ (4)
+
+// one word of the crc, its 4 table steps unrolled
+static inline uint32_t crc32_update_word(uint32_t crc, uint32_t word) {
+  const uint32_t *crc_tab = crc32_tab;
+
+  crc ^= word;
+  crc = crc_tab[crc >> 24] ^ (crc << 8);
+  crc = crc_tab[crc >> 24] ^ (crc << 8);
+  crc = crc_tab[crc >> 24] ^ (crc << 8);
+  return crc_tab[crc >> 24] ^ (crc << 8);
+}
+
 uint32_t crc32_calc_by_word(const uint8_t *buf, uint32_t len) {
   uint32_t crc = 0xffffffff;
-  const uint32_t *crc_tab = crc32_tab;
   const uint32_t *p = (const uint32_t *)buf;
-  uint32_t i, ret_val = 0;
+  uint32_t ret_val = 0;
 
   /* length must be a multiple of 4 */
   if (len == 0 || len % CRC32_CALC_WORD_SZ != 0) {
@@ -392,12 +403,8 @@ uint32_t crc32_calc_by_word(const uint8_t *buf, uint32_t len) {
   len = len / CRC32_CALC_WORD_SZ;
 
   while (len) {
-    crc ^= *p++;
+    crc = crc32_update_word(crc, *p++);
     len--;
-
-    for (i = 0; i < CRC32_CALC_WORD_SZ; i++) {
-      crc = crc_tab[((crc >> 24)) & 0xff] ^ (crc << 8);
-    }
   }
 
   ret_val = ENDIAN_RESVERSE_32BYTES(crc);
@@ -809,14 +816,53 @@ uint32_t swap_uint32(uint32_t val) {
   return (val << 16) | (val >> 16);
 }
 
+#define SB_HASH_BLOCK_WORDS (64 / 4)
+
+// Check the crc32 of a puk and hash it in the same pass, reading straight from flash instead of
+// copying it to the stack twice. The hash is over the byte swapped words.
+static otp_sb_enable_status_e sb_puk_verify(uint32_t addr, uint32_t *sha256_Out) {
+  const uint32_t *p = (const uint32_t *)addr;
+  uint32_t block[SB_HASH_BLOCK_WORDS];
+  uint32_t crc = 0xffffffff;
+  uint32_t calcChecksum, designatedChecksum;
+  mbedtls_sha256_context ctx;
+  int i, n = 0;
+
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts_ret(&ctx, 0);
+
+  for (i = 0; i < SB_PUK2_SIZE / 4; i++) {
+    crc = crc32_update_word(crc, p[i]);
+    block[n++] = swap_uint32(p[i]);
+    if (n == SB_HASH_BLOCK_WORDS || i == SB_PUK2_SIZE / 4 - 1) {
+      mbedtls_sha256_update_ret(&ctx, (const unsigned char *)block, n * 4);
+      n = 0;
+    }
+  }
+
+  mbedtls_sha256_finish_ret(&ctx, (unsigned char *)sha256_Out);
+  mbedtls_sha256_free(&ctx);
+
+  calcChecksum = ENDIAN_RESVERSE_32BYTES(crc) ^ 0xffffffff;
+  designatedChecksum = p[SB_PUK2_SIZE / 4];
+  printf("calcChecksum = 0x%08lx, designatedChecksum = 0x%08lx\n", calcChecksum,
+         designatedChecksum);
+
+  if (designatedChecksum != calcChecksum) {
+    printf("ERROR: Checksum mismatch 0x%08lx (calculated) vs. 0x%08lx (payload). abort...\n",
+           calcChecksum, designatedChecksum);
+    return (OTP_SB_ENABLE_CHECKSUM_ERROR);
+  }
+
+  return (OTP_SB_ENABLE_OK);
+}
+
 otp_sb_enable_status_e DRV_SB_Enable_MCU(uint32_t offset) {
   int puk_Idx, i;
   uint32_t pubKeyStartAddr = 0;
-  uint32_t calcChecksum = 0, designatedChecksum = 0;
+  otp_sb_enable_status_e sb_status;
   enum ALT1250_STATUS status;
   uint32_t setBitVal = 0;
-  uint32_t buffer[(SB_PUK2_SIZE + SB_CRC32_SIZE) / 4];
-  uint32_t mbuffer[(SB_PUK2_SIZE + SB_CRC32_SIZE) / 4];
   uint32_t sha256_Out[8] = {0}, msha256_Out[8] = {0};
   uint32_t otp_data[8] = {0}, motp_data[8] = {0};
   int mcuSecureBootEnableIdx, mcuDh0SecureBootEnableIdx;
@@ -838,30 +884,17 @@ otp_sb_enable_status_e DRV_SB_Enable_MCU(uint32_t offset) {
 
     // Read puk3_1
     printf("Going to read puk3_1 rsa key from flash start address=0x%08lx, length=%u\n",
-           pubKeyStartAddr, sizeof(buffer));
-
-    memcpy((ulong *)buffer, (ulong *)pubKeyStartAddr, sizeof(buffer));
-    // hex_dump((uint8_t *)buffer, sizeof(buffer));
+           pubKeyStartAddr, SB_PUK2_SIZE + SB_CRC32_SIZE);
 
-    printf("buffer[0] = 0x%08lx, buffer[4] = 0x%08lx\n", *(uint32_t *)&buffer[0],
-           *(uint32_t *)&buffer[4]);
-    designatedChecksum = *(uint32_t *)(buffer + SB_PUK2_SIZE / 4);
+    printf("buffer[0] = 0x%08lx, buffer[4] = 0x%08lx\n", ((uint32_t *)pubKeyStartAddr)[0],
+           ((uint32_t *)pubKeyStartAddr)[4]);
 
-    // calculate crc32 over puk3_1
-    calcChecksum = crc32((const char *)buffer, SB_PUK2_SIZE);
-    printf("calcChecksum = 0x%08lx, designatedChecksum = 0x%08lx\n", calcChecksum,
-           designatedChecksum);
-
-    if (designatedChecksum != calcChecksum) {
-      printf("ERROR: Checksum mismatch 0x%08lx (calculated) vs. 0x%08lx (payload). abort...\n",
-             calcChecksum, designatedChecksum);
-      return (OTP_SB_ENABLE_CHECKSUM_ERROR);
+    // check crc32 and calculate sha256 of puk3_1
+    sb_status = sb_puk_verify(pubKeyStartAddr, sha256_Out);
+    if (sb_status != OTP_SB_ENABLE_OK) {
+      return (sb_status);
     }
 
-    // calculate sha256 of puk3_1
-    for (i = 0; i < ((SB_PUK2_SIZE + SB_CRC32_SIZE) / 4); i++) mbuffer[i] = swap_uint32(buffer[i]);
-    calc_sha256((uint8_t *)mbuffer, SB_PUK2_SIZE, (uint8_t *)sha256_Out);
-
     printf("Calculated hash of puk3_1: \n");
     hex_dump((uint8_t *)sha256_Out, sizeof(sha256_Out));
 
@@ -906,28 +939,14 @@ otp_sb_enable_status_e DRV_SB_Enable_MCU(uint32_t offset) {
     // Read puk3_2
     pubKeyStartAddr += (SB_PUK2_SIZE + 4);  // puk3_2 is immediately after puk3_2 crc
     printf("Going to read puk3_2 rsa key from flash start address=0x%08lx, length=%u\n",
-           pubKeyStartAddr, sizeof(buffer));
-
-    memcpy((ulong *)buffer, (ulong *)pubKeyStartAddr, sizeof(buffer));
-    // hex_dump((uint8_t *)buffer, sizeof(buffer));
+           pubKeyStartAddr, SB_PUK2_SIZE + SB_CRC32_SIZE);
 
-    designatedChecksum = *(uint32_t *)(buffer + SB_PUK2_SIZE / 4);
-
-    // calculate crc32 over puk3_2
-    calcChecksum = crc32((const char *)buffer, SB_PUK2_SIZE);
-    printf("calcChecksum = 0x%08lx, designatedChecksum = 0x%08lx\n", calcChecksum,
-           designatedChecksum);
-
-    if (designatedChecksum != calcChecksum) {
-      printf("ERROR: Checksum mismatch 0x%08lx (calculated) vs. 0x%08lx (payload). abort...\n",
-             calcChecksum, designatedChecksum);
-      return (OTP_SB_ENABLE_CHECKSUM_ERROR);
+    // check crc32 and calculate sha256 of puk3_2
+    sb_status = sb_puk_verify(pubKeyStartAddr, sha256_Out);
+    if (sb_status != OTP_SB_ENABLE_OK) {
+      return (sb_status);
     }
 
-    // calculate sha256 of puk3_2
-    for (i = 0; i < ((SB_PUK2_SIZE + SB_CRC32_SIZE) / 4); i++) mbuffer[i] = swap_uint32(buffer[i]);
-    calc_sha256((uint8_t *)mbuffer, SB_PUK2_SIZE, (uint8_t *)sha256_Out);
-
     printf("Calculated hash of puk3_2: \n");
     hex_dump((uint8_t *)sha256_Out, sizeof(sha256_Out));
 
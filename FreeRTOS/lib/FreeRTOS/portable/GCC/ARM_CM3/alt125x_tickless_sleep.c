@@ -119,7 +119,9 @@ void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime) {
   PWR_MNGR_Configuation conf = {0};
 
   pwr_mngr_conf_get_settings(&conf);
-  PWR_MNGR_PwrMode pwr_mode = conf.mode, cfg_mode = conf.mode;
+  /* cfg_mode stays the user's mode, pwr_mode is what this sleep actually enters */
+  PWR_MNGR_PwrMode pwr_mode = conf.mode;
+  const PWR_MNGR_PwrMode cfg_mode = conf.mode;
   uint32_t cfg_duration = conf.duration;
 
   int32_t hibernate_ret_val = 0;
@@ -130,6 +132,12 @@ void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime) {
     if (pwr_mngr_check_allow2sleep() == 0) {
       pwr_mode = PWR_MNGR_MODE_SLEEP; /* graceful downgrade to default(sleep) mode */
     }
+#if (PWR_MNGR_EN_SLEEP_PLANNER == 1)
+    else {
+      /* the configured mode is the deepest one, the planner may pick a shallower one */
+      pwr_mode = pwr_mngr_plan_sleep(pwr_mode, xExpectedIdleTime * portTICK_PERIOD_MS);
+    }
+#endif
   }
 #endif
   /* Make sure the SysTick reload value does not overflow the counter. */
@@ -234,11 +242,9 @@ void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime) {
       hibernate_ret_val = hibernate_to_gpm(pwr_mode);
       //fallback if error
       if(hibernate_ret_val == (-2)) {
-        cfg_mode = pwr_mode;
         pwr_mode = PWR_MNGR_MODE_STANDBY;
       }
       else if(hibernate_ret_val == (-1)) {
-        cfg_mode = pwr_mode;
         pwr_mode = PWR_MNGR_MODE_STOP;
       }
 
@@ -290,7 +296,6 @@ void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime) {
 #if (PWR_MNGR_EN_HIBERNATE_SHUTDOWN == 1)
 #ifdef PWR_MNGR_SHUTDOWN_THRESHOLD 
           if((pwr_mode == PWR_MNGR_MODE_SHUTDOWN) && (ExpectedSleepTime < conf.threshold)) {
-            cfg_mode = pwr_mode;
             pwr_mode = PWR_MNGR_MODE_STANDBY; // temporary change to standby (for flash-wearing protect)
           }
 #endif
@@ -336,6 +341,10 @@ void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime) {
       ) {
       DRV_32KTIMER_Disable();
       DRV_32KTIMER_DisableInterrupt();
+#if (PWR_MNGR_EN_SLEEP_PLANNER == 1)
+      pwr_mngr_plan_learn(pwr_mode,
+                          pre_sleep_overhead + (DRV_32KTIMER_GetValue() * 1000 + 16384) / 32768);
+#endif
     }
 #endif
 
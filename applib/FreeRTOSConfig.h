@@ -124,6 +124,11 @@ __NO_RETURN void portASSERT(const char *, int, const char *, const char *);
 void trace_tick_count(const uint32_t);
 #define traceINCREASE_TICK_COUNT(x)                    trace_tick_count(x)
 
+#if defined(SFPLOG_TASK_RINGS) && (SFPLOG_TASK_RINGS == 1)
+void sfpring_task_deleted(void *);
+#define traceTASK_DELETE(pxTaskToDelete)               sfpring_task_deleted(pxTaskToDelete)
+#endif
+
 
 #if (configUSE_ALT_SLEEP == 1)
     #define configUSE_TICKLESS_IDLE                    1
@@ -96,7 +96,7 @@ $(1)_AR = $(BUILD_DIR)/$(1).a
 $$($(1)_OBJ_DIR)%.o: $$($(1)_REAL_ROOT)%.c $$($(1)_MAKEFILE) $(wildcard $(ROOT)*.mk) | $$($(1)_SRC_DIR)
 	$(vecho) "CC $$<"
 	$(Q) mkdir -p $$(dir $$@)
-	$$($(1)_CC_BASE) $$(CFLAGS) $$($(1)_CFLAGS) -c $$< -o $$@
+	$$($(1)_CC_BASE) $$(CFLAGS) $$($(1)_CFLAGS) $$(SFP_HASH_CFLAGS) -c $$< -o $$@
 	$$($(1)_CC_BASE) $$(CFLAGS) $$($(1)_CFLAGS) -MM -MT $$@ -MF $$(@:.o=.d) $$<
 
 $$($(1)_OBJ_DIR)%.o: $$($(1)_REAL_ROOT)%.cpp $$($(1)_MAKEFILE) $(wildcard $(ROOT)*.mk) | $$($(1)_SRC_DIR)
@@ -148,6 +148,9 @@ $(foreach component,$(COMPONENTS), 					\
 $(PROGRAM_OUT): $(WHOLE_ARCHIVES) $(COMPONENT_ARS) $(LINKER_SCRIPTS)
 	$(vecho) "LD $@"
 	$(Q) $(LD) $(LDFLAGS) -Wl,--whole-archive $(WHOLE_ARCHIVES) -Wl,--no-whole-archive -Wl,--start-group $(COMPONENT_ARS) $(LIB_ARGS) -Wl,--end-group -o $@
+ifeq ($(SFP_FILE_HASH),1)
+	$(Q) python $(SFPHASH) --collect $(BUILD_DIR) $(BUILD_DIR)/$(PROGRAM).sfpmap
+endif
 
 $(BUILD_DIR):
 	$(Q) mkdir -p $@
@@ -48,6 +48,9 @@ DECLARE_COMMAND("inActTime", do_setInactivityTime,
                 "Usage:<NEW_TIMEOUT_VAL> ")
 DECLARE_COMMAND("mapMode", do_setMAPmode,
                 "mapMode - Switch to MAP mode when MCU wakeup from warm boot. Usage:[on | off] ")
+DECLARE_COMMAND("hbnProf", do_hibernateProfile,
+                "hbnProf - Print the profile of the last hibernation, dump it for "
+                "utils/hbnreport.py. Usage:[show | dump]")
 DECLARE_COMMAND(
     "ioPark", do_ioPark,
     "ioPark - Configure IO Park pin. Usage:<PHYSICAL_GPIO_ID> [add | del | clr]")
@@ -669,6 +669,10 @@ int32_t do_configMonPin(char *s) {
 int32_t do_sleepStatistics(char *s) {
   DRV_PM_Statistics statistics;
   PWR_MNGR_PwrCounters counters;
+  PWR_MNGR_UartActivity uart_activity;
+#if (PWR_MNGR_EN_SLEEP_PLANNER == 1)
+  PWR_MNGR_SleepPlan plan;
+#endif
   char command[20], boot_type_str[20] = {0}, cause_str[20] = {0};
   int32_t argc = 0, ret_val = 0, res, i;
   char *tok, *strgp;
@@ -728,6 +732,10 @@ int32_t do_sleepStatistics(char *s) {
     if (res == 0) {
       printf(" Power manager disable               ---> %lu\r\n", counters.sleep_disable);
       printf(" CLI inactivity time                 ---> %lu\r\n", counters.uart_incativity_time);
+      if (pwr_mngr_get_uart_activity(DRV_UART_F0, &uart_activity) == 0) {
+        printf("   |---- CLI bursts %lu, idle %lu ms, max idle %lu ms\r\n",
+               uart_activity.activity_cnt, uart_activity.idle_time, uart_activity.max_idle_time);
+      }
       printf(" HiFC channel busy                   ---> %lu\r\n", counters.hifc_busy);
       printf(" Monitored GPIO busy                 ---> %lu\r\n", counters.mon_gpio_busy);
       printf(" Sleep manager total                 ---> %lu\r\n", counters.sleep_manager);
@@ -743,6 +751,21 @@ int32_t do_sleepStatistics(char *s) {
 #if (PWR_MNGR_EN_HIBERNATE_SHUTDOWN == 1)
       printf(" ------------------ Hibernation Debug ------------------\n");
       hibernate_dbg_dump();
+#endif
+      printf(" ------------------ Hibernation Codecs -----------------\n");
+      hibernate_dbg_codec_report();
+#if (PWR_MNGR_EN_SLEEP_PLANNER == 1)
+      if (pwr_mngr_get_sleep_plan(&plan) == 0) {
+        printf(" ------------------- Sleep planner ---------------------\r\n");
+        printf(" Last predicted idle      : %lu ms\r\n", plan.last_idle_ms);
+        printf(" Downgraded / hint cut    : %lu / %lu\r\n", plan.downgraded, plan.hint_cut);
+        printf(" Planned sleep/stop/standby/shutdown : %lu/%lu/%lu/%lu\r\n",
+               plan.chosen[PWR_MNGR_MODE_SLEEP], plan.chosen[PWR_MNGR_MODE_STOP],
+               plan.chosen[PWR_MNGR_MODE_STANDBY], plan.chosen[PWR_MNGR_MODE_SHUTDOWN]);
+        printf(" Cost stop/standby/shutdown          : %lu/%lu/%lu ms\r\n",
+               plan.cost_ms[PWR_MNGR_MODE_STOP], plan.cost_ms[PWR_MNGR_MODE_STANDBY],
+               plan.cost_ms[PWR_MNGR_MODE_SHUTDOWN]);
+      }
 #endif
     } else {
       printf("Error: Failed to get sleep counters!\r\n");
@@ -982,6 +1005,20 @@ int32_t do_setMAPmode(char *set_val) {
   return ret_val;
 }
 
+int32_t do_hibernateProfile(char *s) {
+  if (s == NULL || *s == '\0' || !strcmp(s, "show")) {
+    hibernate_dbg_profile_report(false);
+    printf(" ------------------ Hibernation Codecs -----------------\n");
+    hibernate_dbg_codec_report();
+  } else if (!strcmp(s, "dump")) {
+    hibernate_dbg_profile_report(true);
+  } else {
+    return (-1);
+  }
+
+  return 0;
+}
+
 // List all free blocks
 static void DoListFree(void) {
   struct hibernate_free_block *freeList = NULL, *cur_node;
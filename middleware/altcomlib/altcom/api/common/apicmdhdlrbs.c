@@ -42,6 +42,38 @@
  * Public Types
  ****************************************************************************/
 
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct apicmdhdlrbs_stats_s g_apicmdhdlrbs_stats;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: apicmdhdlrbs_latest_job
+ *
+ * Description:
+ *   Deliver the report pending in a slot when the worker gets to it.
+ *
+ ****************************************************************************/
+
+static void apicmdhdlrbs_latest_job(FAR void *arg) {
+  FAR struct apicmdhdlrbs_latest_s *latest = (FAR struct apicmdhdlrbs_latest_s *)arg;
+  FAR uint8_t *evt;
+
+  altcom_lock();
+  evt = latest->evt;
+  latest->evt = NULL;
+  altcom_unlock();
+
+  if (evt) {
+    latest->job((FAR void *)evt);
+  }
+}
+
 /****************************************************************************
  * Inline functions
  ****************************************************************************/
@@ -60,8 +92,77 @@ enum evthdlrc_e apicmdhdlrbs_do_runjob(FAR uint8_t *evt, uint16_t cmdid,
   if (0 >
       evthdlbs_runjob(WRKRID_API_CALLBACK_THREAD, (CODE thrdpool_jobif_t)job, (FAR void *)evt)) {
     altcom_free_cmd((FAR uint8_t *)evt);
+    altcom_lock();
+    g_apicmdhdlrbs_stats.dropped++;
+    altcom_unlock();
+    return EVTHDLRC_INTERNALERROR;
+  }
+
+  return EVTHDLRC_STARTHANDLE;
+}
+
+/****************************************************************************
+ * Name: apicmdhdlrbs_do_runjob_latest
+ *
+ * Description:
+ *   Like apicmdhdlrbs_do_runjob(), for reports where only the latest value
+ *   matters. While a job of the slot is queued, a new report replaces the
+ *   pending one instead of queuing another job, so a burst takes one worker
+ *   run and delivers its last value.
+ *
+ ****************************************************************************/
+
+enum evthdlrc_e apicmdhdlrbs_do_runjob_latest(FAR uint8_t *evt, uint16_t cmdid,
+                                              FAR struct apicmdhdlrbs_latest_s *latest) {
+  FAR uint8_t *old;
+
+  if (!evt || !latest) {
+    DBGIF_LOG_ERROR("NULL parameter");
+    return EVTHDLRC_INTERNALERROR;
+  }
+
+#if (ALTCOM_REPORT_COALESCE == 0)
+  return apicmdhdlrbs_do_runjob(evt, cmdid, latest->job);
+#endif
+
+  if (!apicmdgw_cmdid_compare(evt, cmdid)) {
+    return EVTHDLRC_UNSUPPORTEDEVENT;
+  }
+
+  altcom_lock();
+  old = latest->evt;
+  latest->evt = evt;
+  if (old) {
+    g_apicmdhdlrbs_stats.coalesced++;
+  }
+
+  altcom_unlock();
+
+  if (old) {
+    altcom_free_cmd(old);
+    return EVTHDLRC_STARTHANDLE;
+  }
+
+  if (0 > evthdlbs_runjob(WRKRID_API_CALLBACK_THREAD,
+                          (CODE thrdpool_jobif_t)apicmdhdlrbs_latest_job, (FAR void *)latest)) {
+    altcom_lock();
+    evt = latest->evt;
+    latest->evt = NULL;
+    g_apicmdhdlrbs_stats.dropped++;
+    altcom_unlock();
+
+    if (evt) {
+      altcom_free_cmd(evt);
+    }
+
     return EVTHDLRC_INTERNALERROR;
   }
 
   return EVTHDLRC_STARTHANDLE;
+}
+
+void apicmdhdlrbs_get_stats(FAR struct apicmdhdlrbs_stats_s *stats) {
+  altcom_lock();
+  *stats = g_apicmdhdlrbs_stats;
+  altcom_unlock();
 }
\ No newline at end of file
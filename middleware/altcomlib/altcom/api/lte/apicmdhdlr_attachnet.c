@@ -30,6 +30,7 @@
 #include "apicmd_atchnet.h"
 #include "evthdlbs.h"
 #include "apicmdhdlrbs.h"
+#include "lte_cache.h"
 
 /****************************************************************************
  * Public Data
@@ -66,6 +67,9 @@ static void attachnet_job(FAR void *arg) {
 
   data = (FAR struct apicmd_cmddat_atchnetres_s *)arg;
 
+  /* Whatever the result, the cached network state may be stale now */
+  lte_cache_invalidate(LTE_CACHE_NETSTAT);
+
   ALTCOM_GET_AND_CLR_CALLBACK(ret, g_attach_net_callback, callback, g_attach_net_cbpriv, cbpriv);
 
   if ((ret == 0) && (callback)) {
@@ -30,6 +30,7 @@
 #include "apicmd_dtchnet.h"
 #include "evthdlbs.h"
 #include "apicmdhdlrbs.h"
+#include "lte_cache.h"
 
 /****************************************************************************
  * Public Data
@@ -65,6 +66,9 @@ static void detachnet_job(FAR void *arg) {
 
   data = (FAR struct apicmd_cmddat_dtchnetres_s *)arg;
 
+  /* Whatever the result, the cached network state may be stale now */
+  lte_cache_invalidate(LTE_CACHE_NETSTAT);
+
   ALTCOM_GET_AND_CLR_CALLBACK(ret, g_detach_net_callback, callback, g_detach_net_cbpriv, cbpriv);
 
   if ((ret == 0) && (callback)) {
@@ -94,6 +94,7 @@ static void repcellinfo_job(FAR void *arg) {
   ALTCOM_GET_CALLBACK(g_cellinfo_callback, callback, g_cellinfo_cbpriv, cbpriv);
   if (!callback) {
     DBGIF_LOG_ERROR("g_cellinfo_callback is not registered.\n");
+    altcom_free_cmd((FAR uint8_t *)arg);
     return;
   }
 
@@ -169,6 +170,7 @@ static void repcellinfo_2g_job(FAR void *arg) {
   ALTCOM_GET_CALLBACK(g_cellinfo_2g_callback, callback, g_cellinfo_2g_cbpriv, cbpriv);
   if (!callback) {
     DBGIF_LOG_ERROR("g_cellinfo_2g_callback is not registered.\n");
+    altcom_free_cmd((FAR uint8_t *)arg);
     return;
   }
 
@@ -247,6 +249,17 @@ static void repcellinfo_2g_job(FAR void *arg) {
   altcom_free_cmd((FAR uint8_t *)arg);
 }
 
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Cell information is periodic, a burst is delivered as its last report */
+
+static struct apicmdhdlrbs_latest_s g_repcellinfo_latest =
+    APICMDHDLRBS_LATEST_INITIALIZER(repcellinfo_job);
+static struct apicmdhdlrbs_latest_s g_repcellinfo_2g_latest =
+    APICMDHDLRBS_LATEST_INITIALIZER(repcellinfo_2g_job);
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -270,9 +283,10 @@ static void repcellinfo_2g_job(FAR void *arg) {
  ****************************************************************************/
 
 enum evthdlrc_e apicmdhdlr_repcellinfo(FAR uint8_t *evt, uint32_t evlen) {
-  return apicmdhdlrbs_do_runjob(evt, APICMDID_REPORT_CELLINFO, repcellinfo_job);
+  return apicmdhdlrbs_do_runjob_latest(evt, APICMDID_REPORT_CELLINFO, &g_repcellinfo_latest);
 }
 
 enum evthdlrc_e apicmdhdlr_repcellinfo_2g(FAR uint8_t *evt, uint32_t evlen) {
-  return apicmdhdlrbs_do_runjob(evt, APICMDID_REPORT_CELLINFO_2G, repcellinfo_2g_job);
+  return apicmdhdlrbs_do_runjob_latest(evt, APICMDID_REPORT_CELLINFO_2G,
+                                       &g_repcellinfo_2g_latest);
 }
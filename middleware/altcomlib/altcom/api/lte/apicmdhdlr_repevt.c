@@ -30,6 +30,7 @@
 #include "apicmd_repevt.h"
 #include "evthdlbs.h"
 #include "apicmdhdlrbs.h"
+#include "lte_cache.h"
 
 /****************************************************************************
  * Public Data
@@ -60,6 +61,29 @@ extern void *g_fw_upgrade_evt_report_cbpriv;
 extern pdn_actevt_report_cb_t g_pdn_actevt_report_callback;
 extern void *g_pdn_actevt_report_cbpriv;
 
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+static void repevt_job(FAR void *arg);
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Reports of a state, a burst of one type is delivered as its last value.
+ * SIM, anti-tamper, scan result, FW upgrade and PDN activation reports are
+ * events and each of them is delivered.
+ */
+
+static struct apicmdhdlrbs_latest_s g_repevt_latest[APICMD_REPORT_EVT_TYPE_CONNPHASE + 1] = {
+    [APICMD_REPORT_EVT_TYPE_LTIME] = APICMDHDLRBS_LATEST_INITIALIZER(repevt_job),
+    [APICMD_REPORT_EVT_TYPE_REGSTATE] = APICMDHDLRBS_LATEST_INITIALIZER(repevt_job),
+    [APICMD_REPORT_EVT_TYPE_PSMSTATE] = APICMDHDLRBS_LATEST_INITIALIZER(repevt_job),
+    [APICMD_REPORT_EVT_TYPE_DYNPSM] = APICMDHDLRBS_LATEST_INITIALIZER(repevt_job),
+    [APICMD_REPORT_EVT_TYPE_DYNEDRX] = APICMDHDLRBS_LATEST_INITIALIZER(repevt_job),
+    [APICMD_REPORT_EVT_TYPE_CONNPHASE] = APICMDHDLRBS_LATEST_INITIALIZER(repevt_job)};
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -83,12 +107,6 @@ static void repevt_ltime_report(FAR struct apicmd_cmddat_ltime_s *ltime) {
   localtime_report_cb_t callback;
   void *cbpriv;
 
-  ALTCOM_GET_CALLBACK(g_localtime_report_callback, callback, g_localtime_report_cbpriv, cbpriv);
-  if (!callback) {
-    DBGIF_LOG_DEBUG("g_localtime_report_callback is not registered.\n");
-    return;
-  }
-
   result.year = ltime->year;
   result.mon = ltime->month;
   result.mday = ltime->day;
@@ -96,6 +114,13 @@ static void repevt_ltime_report(FAR struct apicmd_cmddat_ltime_s *ltime) {
   result.min = ltime->minutes;
   result.sec = ltime->seconds;
   result.tz_sec = ntohl(ltime->timezone);
+  lte_cache_report(LTE_CACHE_LTIME, &result, sizeof(result));
+
+  ALTCOM_GET_CALLBACK(g_localtime_report_callback, callback, g_localtime_report_cbpriv, cbpriv);
+  if (!callback) {
+    DBGIF_LOG_DEBUG("g_localtime_report_callback is not registered.\n");
+    return;
+  }
 
   callback(&result, cbpriv);
 }
@@ -119,12 +144,6 @@ static void repevt_simd_report(FAR struct apicmd_cmddat_repevt_simd_s *simd) {
   simstate_report_cb_t callback;
   void *cbpriv;
 
-  ALTCOM_GET_CALLBACK(g_simstat_report_callback, callback, g_simstat_report_cbpriv, cbpriv);
-  if (!callback) {
-    DBGIF_LOG_DEBUG("g_simstat_report_callback is not registered.\n");
-    return;
-  }
-
   switch (simd->status) {
     case APICMD_REPORT_EVT_SIMD_REMOVAL: {
       result = LTE_SIMSTAT_REMOVAL;
@@ -138,6 +157,14 @@ static void repevt_simd_report(FAR struct apicmd_cmddat_repevt_simd_s *simd) {
     }
   }
 
+  lte_cache_report(LTE_CACHE_SIMSTATE, &result, sizeof(result));
+
+  ALTCOM_GET_CALLBACK(g_simstat_report_callback, callback, g_simstat_report_cbpriv, cbpriv);
+  if (!callback) {
+    DBGIF_LOG_DEBUG("g_simstat_report_callback is not registered.\n");
+    return;
+  }
+
   callback(result, cbpriv);
 }
 
@@ -160,12 +187,6 @@ static void repevt_simstate_report(FAR struct apicmd_cmddat_repevt_simstate_s *s
   simstate_report_cb_t callback;
   void *cbpriv;
 
-  ALTCOM_GET_CALLBACK(g_simstat_report_callback, callback, g_simstat_report_cbpriv, cbpriv);
-  if (!callback) {
-    DBGIF_LOG_DEBUG("g_simstat_report_callback is not registered.\n");
-    return;
-  }
-
   switch (simstate->state) {
     case APICMD_REPORT_EVT_SIMSTATE_SIM_DEACTIVATED: {
       state = LTE_SIMSTAT_DEACTIVATED;
@@ -185,6 +206,14 @@ static void repevt_simstate_report(FAR struct apicmd_cmddat_repevt_simstate_s *s
     }
   }
 
+  lte_cache_report(LTE_CACHE_SIMSTATE, &state, sizeof(state));
+
+  ALTCOM_GET_CALLBACK(g_simstat_report_callback, callback, g_simstat_report_cbpriv, cbpriv);
+  if (!callback) {
+    DBGIF_LOG_DEBUG("g_simstat_report_callback is not registered.\n");
+    return;
+  }
+
   callback(state, cbpriv);
 }
 
@@ -207,12 +236,6 @@ static void repevt_regstate_report(FAR struct apicmd_cmddat_repregstate_s *regst
   regstate_report_cb_t callback;
   void *cbpriv;
 
-  ALTCOM_GET_CALLBACK(g_regstate_report_callback, callback, g_regstate_report_cbpriv, cbpriv);
-  if (!callback) {
-    DBGIF_LOG_DEBUG("g_regstate_report_callback is not registered.\n");
-    return;
-  }
-
   switch (regstate->state) {
     case APICMD_REP_REGST_NOTATCH_NOTSRCH: {
       state = LTE_REGSTAT_NOT_REGISTERED_NOT_SEARCHING;
@@ -238,6 +261,22 @@ static void repevt_regstate_report(FAR struct apicmd_cmddat_repregstate_s *regst
     }
   }
 
+  /* The attach state and the network provided settings follow the
+   * registration, they are queried again on the next read.
+   */
+
+  lte_cache_report(LTE_CACHE_REGSTATE, &state, sizeof(state));
+  lte_cache_invalidate(LTE_CACHE_NETSTAT);
+  lte_cache_invalidate(LTE_CACHE_PSM_NW);
+  lte_cache_invalidate(LTE_CACHE_EDRX_NW);
+  lte_cache_invalidate(LTE_CACHE_QUALITY);
+
+  ALTCOM_GET_CALLBACK(g_regstate_report_callback, callback, g_regstate_report_cbpriv, cbpriv);
+  if (!callback) {
+    DBGIF_LOG_DEBUG("g_regstate_report_callback is not registered.\n");
+    return;
+  }
+
   callback(state, cbpriv);
 }
 /****************************************************************************
@@ -285,12 +324,6 @@ static void repevt_psmstate_report(FAR struct apicmd_cmddat_reppsmstate_s *psmst
   psmstate_report_cb_t callback;
   void *cbpriv;
 
-  ALTCOM_GET_CALLBACK(g_psmstate_report_callback, callback, g_psmstate_report_cbpriv, cbpriv);
-  if (!callback) {
-    DBGIF_LOG_DEBUG("g_psmstate_report_callback is not registered.\n");
-    return;
-  }
-
   switch (psmstate->state) {
     case APICMD_REP_PSMST_NOT_ACTIVE: {
       state = LTE_PSMSTAT_NOT_ACTIVE;
@@ -310,6 +343,14 @@ static void repevt_psmstate_report(FAR struct apicmd_cmddat_reppsmstate_s *psmst
     }
   }
 
+  lte_cache_report(LTE_CACHE_PSMSTATE, &state, sizeof(state));
+
+  ALTCOM_GET_CALLBACK(g_psmstate_report_callback, callback, g_psmstate_report_cbpriv, cbpriv);
+  if (!callback) {
+    DBGIF_LOG_DEBUG("g_psmstate_report_callback is not registered.\n");
+    return;
+  }
+
   callback(state, cbpriv);
 }
 
@@ -332,17 +373,19 @@ static void repevt_dynpsm_report(FAR struct apicmd_cmddat_repdynpsm_s *dynPsmSet
   psm_settings_report_cb_t callback;
   void *cbpriv;
 
+  setting.func = LTE_PSM_ENABLE_FORCE_OFF;
+  setting.active_time.unit = dynPsmSetting->at_val.unit;
+  setting.active_time.time_val = dynPsmSetting->at_val.time_val;
+  setting.ext_periodic_tau_time.unit = dynPsmSetting->tau_val.unit;
+  setting.ext_periodic_tau_time.time_val = dynPsmSetting->tau_val.time_val;
+  lte_cache_report(LTE_CACHE_PSM_NW, &setting, sizeof(setting));
+
   ALTCOM_GET_CALLBACK(g_dynpsm_report_callback, callback, g_dynpsm_report_cbpriv, cbpriv);
   if (!callback) {
     DBGIF_LOG_DEBUG("g_dynpsm_report_callback is not registered.\n");
     return;
   }
 
-  setting.func = LTE_PSM_ENABLE_FORCE_OFF;
-  setting.active_time.unit = dynPsmSetting->at_val.unit;
-  setting.active_time.time_val = dynPsmSetting->at_val.time_val;
-  setting.ext_periodic_tau_time.unit = dynPsmSetting->tau_val.unit;
-  setting.ext_periodic_tau_time.time_val = dynPsmSetting->tau_val.time_val;
   callback(&setting, cbpriv);
 }
 
@@ -365,16 +408,18 @@ static void repevt_dynedrx_report(FAR struct apicmd_cmddat_repdynedrx_s *dynEdrx
   edrx_settings_report_cb_t callback;
   void *cbpriv;
 
+  setting.enable = LTE_ENABLE;
+  setting.act_type = (lteedrxtype_e)dynEdrxSetting->acttype;
+  setting.edrx_cycle = (lteedrxcyc_e)dynEdrxSetting->edrx_cycle;
+  setting.ptw_val = (lteedrxptw_e)dynEdrxSetting->ptw_val;
+  lte_cache_report(LTE_CACHE_EDRX_NW, &setting, sizeof(setting));
+
   ALTCOM_GET_CALLBACK(g_dynedrx_report_callback, callback, g_dynedrx_report_cbpriv, cbpriv);
   if (!callback) {
     DBGIF_LOG_DEBUG("g_dynedrx_report_callback is not registered.\n");
     return;
   }
 
-  setting.enable = LTE_ENABLE;
-  setting.act_type = (lteedrxtype_e)dynEdrxSetting->acttype;
-  setting.edrx_cycle = (lteedrxcyc_e)dynEdrxSetting->edrx_cycle;
-  setting.ptw_val = (lteedrxptw_e)dynEdrxSetting->ptw_val;
   callback(&setting, cbpriv);
 }
 
@@ -726,5 +771,15 @@ static void repevt_job(FAR void *arg) {
  ****************************************************************************/
 
 enum evthdlrc_e apicmdhdlr_repevt(FAR uint8_t *evt, uint32_t evlen) {
+  uint16_t type;
+
+  if (evt && apicmdgw_cmdid_compare(evt, APICMDID_REPORT_EVT)) {
+    type = ntohs(((FAR struct apicmd_cmddat_repevt_s *)evt)->type);
+    if (type < sizeof(g_repevt_latest) / sizeof(g_repevt_latest[0]) &&
+        g_repevt_latest[type].job) {
+      return apicmdhdlrbs_do_runjob_latest(evt, APICMDID_REPORT_EVT, &g_repevt_latest[type]);
+    }
+  }
+
   return apicmdhdlrbs_do_runjob(evt, APICMDID_REPORT_EVT, repevt_job);
 }
@@ -30,6 +30,7 @@
 #include "apicmd_repnetstat.h"
 #include "evthdlbs.h"
 #include "apicmdhdlrbs.h"
+#include "lte_cache.h"
 
 /****************************************************************************
  * Public Data
@@ -64,12 +65,17 @@ static void repnetstat_job(FAR void *arg) {
   void *cbpriv;
 
   data = (FAR struct apicmd_cmddat_repnetstat_s *)arg;
+  netstat = (ltenetstate_e)data->stat;
+
+  /* Only attach and detach are the state lte_get_netstat() returns */
+  if (LTE_NETSTAT_ATTACH == netstat || LTE_NETSTAT_DETACH == netstat) {
+    lte_cache_report(LTE_CACHE_NETSTAT, &netstat, sizeof(netstat));
+  }
 
   ALTCOM_GET_CALLBACK(g_netstat_report_callback, callback, g_netstat_report_cbpriv, cbpriv);
   if (!callback) {
     DBGIF_LOG_WARNING("When callback is null called report netstat.\n");
   } else {
-    netstat = (ltenetstate_e)data->stat;
     sessionid = data->sessionid;
     callback(sessionid, netstat, cbpriv);
   }
@@ -30,6 +30,7 @@
 #include "apicmd_repquality.h"
 #include "evthdlbs.h"
 #include "apicmdhdlrbs.h"
+#include "lte_cache.h"
 
 /****************************************************************************
  * Public Data
@@ -64,12 +65,6 @@ static void repquality_job(FAR void *arg) {
   quality_report_cb_t callback;
   void *cbpriv;
 
-  ALTCOM_GET_CALLBACK(g_quality_callback, callback, g_quality_cbpriv, cbpriv);
-  if (!callback) {
-    DBGIF_LOG_ERROR("g_cellinfo_callback is not registered.\n");
-    return;
-  }
-
   data = (FAR struct apicmd_cmddat_repquality_s *)arg;
 
   repdat = (lte_quality_t *)BUFFPOOL_ALLOC(sizeof(lte_quality_t));
@@ -99,7 +94,15 @@ static void repquality_job(FAR void *arg) {
       }
     }
 
-    callback(repdat, cbpriv);
+    lte_cache_report(LTE_CACHE_QUALITY, repdat, sizeof(*repdat));
+
+    ALTCOM_GET_CALLBACK(g_quality_callback, callback, g_quality_cbpriv, cbpriv);
+    if (!callback) {
+      DBGIF_LOG_ERROR("g_quality_callback is not registered.\n");
+    } else {
+      callback(repdat, cbpriv);
+    }
+
     (void)BUFFPOOL_FREE((FAR void *)repdat);
   }
 
@@ -118,7 +121,8 @@ static void repquality_2g_job(FAR void *arg) {
 
   ALTCOM_GET_CALLBACK(g_quality_2g_callback, callback, g_quality_2g_cbpriv, cbpriv);
   if (!callback) {
-    DBGIF_LOG_ERROR("g_cellinfo_callback is not registered.\n");
+    DBGIF_LOG_ERROR("g_quality_2g_callback is not registered.\n");
+    altcom_free_cmd((FAR uint8_t *)arg);
     return;
   }
 
@@ -145,6 +149,17 @@ static void repquality_2g_job(FAR void *arg) {
   altcom_free_cmd((FAR uint8_t *)arg);
 }
 
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Quality is periodic, a burst is delivered as its last report */
+
+static struct apicmdhdlrbs_latest_s g_repquality_latest =
+    APICMDHDLRBS_LATEST_INITIALIZER(repquality_job);
+static struct apicmdhdlrbs_latest_s g_repquality_2g_latest =
+    APICMDHDLRBS_LATEST_INITIALIZER(repquality_2g_job);
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -168,9 +183,9 @@ static void repquality_2g_job(FAR void *arg) {
  ****************************************************************************/
 
 enum evthdlrc_e apicmdhdlr_repquality(FAR uint8_t *evt, uint32_t evlen) {
-  return apicmdhdlrbs_do_runjob(evt, APICMDID_REPORT_QUALITY, repquality_job);
+  return apicmdhdlrbs_do_runjob_latest(evt, APICMDID_REPORT_QUALITY, &g_repquality_latest);
 }
 
 enum evthdlrc_e apicmdhdlr_repquality_2g(FAR uint8_t *evt, uint32_t evlen) {
-  return apicmdhdlrbs_do_runjob(evt, APICMDID_REPORT_QUALITY_2G, repquality_2g_job);
+  return apicmdhdlrbs_do_runjob_latest(evt, APICMDID_REPORT_QUALITY_2G, &g_repquality_2g_latest);
 }
@@ -0,0 +1,455 @@
+/*  ---------------------------------------------------------------------------
+
+    (c) copyright 2021 Altair Semiconductor, Ltd. All rights reserved.
+
+    This software, in source or object form (the "Software"), is the
+    property of Altair Semiconductor Ltd. (the "Company") and/or its
+    licensors, which have all right, title and interest therein, You
+    may use the Software only in  accordance with the terms of written
+    license agreement between you and the Company (the "License").
+    Except as expressly stated in the License, the Company grants no
+    licenses by implication, estoppel, or otherwise. If you are not
+    aware of or do not agree to the License terms, you may not use,
+    copy or modify the Software. You may use the source code of the
+    Software only for your internal purposes and may not distribute the
+    source code of the Software, any part thereof, or any derivative work
+    thereof, to any third party, except pursuant to the Company's prior
+    written consent.
+    The Software is the confidential information of the Company.
+
+   ------------------------------------------------------------------------- */
+
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "lte/lte_api.h"
+#include "dbg_if.h"
+#include "alt_osal.h"
+#include "apiutil.h"
+#include "lte_cache.h"
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct lte_cache_entry_s {
+  FAR void *value;
+  size_t len;
+  bool valid;
+  ltecachesrc_e src;
+  uint32_t tick;
+  uint32_t seq;
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static ltenetstate_e g_cache_netstat;
+static lte_psm_setting_t g_cache_psm[LTE_CFGTYPE_MAX];
+static lte_edrx_setting_t g_cache_edrx[LTE_CFGTYPE_MAX];
+static lte_localtime_t g_cache_ltime;
+static lte_quality_t g_cache_quality;
+static lteregstate_e g_cache_regstate;
+static ltesimstate_e g_cache_simstate;
+static ltepsmstate_e g_cache_psmstate;
+
+static struct lte_cache_entry_s g_lte_cache[LTE_CACHE_ITEM_NUM] = {
+    [LTE_CACHE_NETSTAT] = {&g_cache_netstat, sizeof(g_cache_netstat)},
+    [LTE_CACHE_PSM_REQ] = {&g_cache_psm[LTE_CFGTYPE_REQUESTED], sizeof(lte_psm_setting_t)},
+    [LTE_CACHE_PSM_NW] = {&g_cache_psm[LTE_CFGTYPE_NW_PROVIDED], sizeof(lte_psm_setting_t)},
+    [LTE_CACHE_EDRX_REQ] = {&g_cache_edrx[LTE_CFGTYPE_REQUESTED], sizeof(lte_edrx_setting_t)},
+    [LTE_CACHE_EDRX_NW] = {&g_cache_edrx[LTE_CFGTYPE_NW_PROVIDED], sizeof(lte_edrx_setting_t)},
+    [LTE_CACHE_LTIME] = {&g_cache_ltime, sizeof(g_cache_ltime)},
+    [LTE_CACHE_QUALITY] = {&g_cache_quality, sizeof(g_cache_quality)},
+    [LTE_CACHE_REGSTATE] = {&g_cache_regstate, sizeof(g_cache_regstate)},
+    [LTE_CACHE_SIMSTATE] = {&g_cache_simstate, sizeof(g_cache_simstate)},
+    [LTE_CACHE_PSMSTATE] = {&g_cache_psmstate, sizeof(g_cache_psmstate)}};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: lte_cache_store
+ *
+ * Description:
+ *   Store a value of an item. Must be called with altcom_lock() held.
+ *
+ ****************************************************************************/
+
+static void lte_cache_store(struct lte_cache_entry_s *entry, const void *value, size_t len,
+                            ltecachesrc_e src) {
+  if (ALTCOM_LTE_CACHE_MAX_AGE_MS == 0 || len != entry->len) {
+    return;
+  }
+
+  memcpy(entry->value, value, len);
+  entry->valid = true;
+  entry->src = src;
+  entry->tick = alt_osal_get_tick_count();
+  entry->seq++;
+}
+
+/****************************************************************************
+ * Name: lte_cache_age
+ *
+ * Description:
+ *   Milliseconds since a value was stored.
+ *
+ ****************************************************************************/
+
+static uint32_t lte_cache_age(uint32_t tick) {
+  uint64_t elapsed = (uint32_t)(alt_osal_get_tick_count() - tick);
+
+  elapsed = elapsed * 1000 / alt_osal_get_tick_freq();
+  return elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+}
+
+static void lte_cache_set_info(lte_cache_info_t *info, uint32_t age_ms, ltecachesrc_e src) {
+  if (info) {
+    info->age_ms = age_ms;
+    info->src = src;
+  }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: lte_cache_init
+ *
+ * Description:
+ *   Drop every cached value.
+ *
+ ****************************************************************************/
+
+void lte_cache_init(void) {
+  int i;
+
+  altcom_lock();
+  for (i = 0; i < LTE_CACHE_ITEM_NUM; i++) {
+    g_lte_cache[i].valid = false;
+    g_lte_cache[i].seq++;
+  }
+
+  altcom_unlock();
+}
+
+/****************************************************************************
+ * Name: lte_cache_report
+ *
+ * Description:
+ *   Store a value received in a report event.
+ *
+ ****************************************************************************/
+
+void lte_cache_report(lte_cache_item_e item, const void *value, size_t len) {
+  altcom_lock();
+  lte_cache_store(&g_lte_cache[item], value, len, LTE_CACHE_SRC_REPORT);
+  altcom_unlock();
+}
+
+uint32_t lte_cache_seq(lte_cache_item_e item) {
+  uint32_t seq;
+
+  altcom_lock();
+  seq = g_lte_cache[item].seq;
+  altcom_unlock();
+  return seq;
+}
+
+/****************************************************************************
+ * Name: lte_cache_query
+ *
+ * Description:
+ *   Store a query response, unless the item changed since seq was taken.
+ *
+ ****************************************************************************/
+
+void lte_cache_query(lte_cache_item_e item, const void *value, size_t len, uint32_t seq) {
+  altcom_lock();
+  if (g_lte_cache[item].seq == seq) {
+    lte_cache_store(&g_lte_cache[item], value, len, LTE_CACHE_SRC_QUERY);
+  }
+
+  altcom_unlock();
+}
+
+void lte_cache_invalidate(lte_cache_item_e item) {
+  altcom_lock();
+  g_lte_cache[item].valid = false;
+  g_lte_cache[item].seq++;
+  altcom_unlock();
+}
+
+/****************************************************************************
+ * Name: lte_cache_load
+ *
+ * Description:
+ *   Copy a value no older than max_age_ms and ALTCOM_LTE_CACHE_MAX_AGE_MS,
+ *   0 never takes a cached value.
+ *
+ * Returned Value:
+ *   true if the value was copied, false if there is no fresh one.
+ *
+ ****************************************************************************/
+
+bool lte_cache_load(lte_cache_item_e item, void *value, size_t len, uint32_t max_age_ms,
+                    lte_cache_info_t *info) {
+  struct lte_cache_entry_s *entry = &g_lte_cache[item];
+  uint32_t age_ms;
+  bool ret = false;
+
+  if (max_age_ms > ALTCOM_LTE_CACHE_MAX_AGE_MS) {
+    max_age_ms = ALTCOM_LTE_CACHE_MAX_AGE_MS;
+  }
+
+  if (max_age_ms == 0) {
+    return false;
+  }
+
+  altcom_lock();
+  if (entry->valid && len == entry->len) {
+    age_ms = lte_cache_age(entry->tick);
+    if (age_ms <= max_age_ms) {
+      memcpy(value, entry->value, len);
+      lte_cache_set_info(info, age_ms, entry->src);
+      ret = true;
+    } else if (age_ms > ALTCOM_LTE_CACHE_MAX_AGE_MS) {
+      entry->valid = false;
+    }
+  }
+
+  altcom_unlock();
+  return ret;
+}
+
+/**
+ * @brief lte_get_netstat_cached() get network state of the LTE like lte_get_netstat(), from the
+ * state cache when it holds a value no older than max_age_ms.
+ *
+ * @param [inout] state: The state of network state, and valid only if LTE_RESULT_OK returned.
+ * @param [in] max_age_ms: Oldest cached value accepted, in milliseconds. 0 always queries.
+ * @param [inout] info: Age and source of the value, or NULL.
+ *
+ * @return On success, LTE_RESULT_OK is returned. On failure,
+ * LTE_RESULT_ERR is returned.
+ */
+
+lteresult_e lte_get_netstat_cached(ltenetstate_e *state, uint32_t max_age_ms,
+                                   lte_cache_info_t *info) {
+  lteresult_e ret;
+
+  if (!state) {
+    DBGIF_LOG_ERROR("Input argument is NULL.\n");
+    return LTE_RESULT_ERROR;
+  }
+
+  if (lte_cache_load(LTE_CACHE_NETSTAT, state, sizeof(*state), max_age_ms, info)) {
+    return LTE_RESULT_OK;
+  }
+
+  ret = lte_get_netstat(state);
+  lte_cache_set_info(info, 0, LTE_CACHE_SRC_QUERY);
+  return ret;
+}
+
+/**
+ * @brief lte_get_psm_cached() get the requested/network provided PSM settings like
+ * lte_get_psm(), from the state cache when it holds a value no older than max_age_ms.
+ *
+ * @param [inout] settings: PSM settings, and it's valid only if LTE_RESULT_OK returned.
+ * @param [in] cfgType: Get setting from Requested/Network-Provided configuration.
+ * @param [in] max_age_ms: Oldest cached value accepted, in milliseconds. 0 always queries.
+ * @param [inout] info: Age and source of the value, or NULL.
+ *
+ * @return On success, LTE_RESULT_OK is returned. On failure,
+ * LTE_RESULT_ERR is returned.
+ */
+
+lteresult_e lte_get_psm_cached(lte_psm_setting_t *settings, ltecfgtype_e cfgType,
+                               uint32_t max_age_ms, lte_cache_info_t *info) {
+  lteresult_e ret;
+
+  if (!settings || LTE_CFGTYPE_MAX <= cfgType) {
+    DBGIF_LOG_ERROR("Invalid argument.\n");
+    return LTE_RESULT_ERROR;
+  }
+
+  if (lte_cache_load(LTE_CFGTYPE_REQUESTED == cfgType ? LTE_CACHE_PSM_REQ : LTE_CACHE_PSM_NW,
+                     settings, sizeof(*settings), max_age_ms, info)) {
+    return LTE_RESULT_OK;
+  }
+
+  ret = lte_get_psm(settings, cfgType);
+  lte_cache_set_info(info, 0, LTE_CACHE_SRC_QUERY);
+  return ret;
+}
+
+/**
+ * @brief lte_get_edrx_cached() get the requested/network provided eDRX settings like
+ * lte_get_edrx(), from the state cache when it holds a value no older than max_age_ms.
+ *
+ * @param [inout] settings: eDRX settings, and it's valid only if LTE_RESULT_OK returned.
+ * @param [in] cfgType: Get setting from Requested/Network-Provided configuration.
+ * @param [in] max_age_ms: Oldest cached value accepted, in milliseconds. 0 always queries.
+ * @param [inout] info: Age and source of the value, or NULL.
+ *
+ * @return On success, LTE_RESULT_OK is returned. On failure,
+ * LTE_RESULT_ERR is returned.
+ */
+
+lteresult_e lte_get_edrx_cached(lte_edrx_setting_t *settings, ltecfgtype_e cfgType,
+                                uint32_t max_age_ms, lte_cache_info_t *info) {
+  lteresult_e ret;
+
+  if (!settings || LTE_CFGTYPE_MAX <= cfgType) {
+    DBGIF_LOG_ERROR("Invalid argument.\n");
+    return LTE_RESULT_ERROR;
+  }
+
+  if (lte_cache_load(LTE_CFGTYPE_REQUESTED == cfgType ? LTE_CACHE_EDRX_REQ : LTE_CACHE_EDRX_NW,
+                     settings, sizeof(*settings), max_age_ms, info)) {
+    return LTE_RESULT_OK;
+  }
+
+  ret = lte_get_edrx(settings, cfgType);
+  lte_cache_set_info(info, 0, LTE_CACHE_SRC_QUERY);
+  return ret;
+}
+
+/**
+ * @brief lte_get_localtime_cached() get local time like lte_get_localtime(), from the state
+ * cache when it holds a value no older than max_age_ms.
+ *
+ * @param [inout] localtime: Local time, and it's valid only if LTE_RESULT_OK returned.
+ * @param [in] max_age_ms: Oldest cached value accepted, in milliseconds. 0 always queries.
+ * @param [inout] info: Age and source of the value, or NULL.
+ *
+ * @return On success, LTE_RESULT_OK is returned. On failure,
+ * LTE_RESULT_ERR is returned.
+ */
+
+lteresult_e lte_get_localtime_cached(lte_localtime_t *localtime, uint32_t max_age_ms,
+                                     lte_cache_info_t *info) {
+  lteresult_e ret;
+
+  if (!localtime) {
+    DBGIF_LOG_ERROR("Input argument is NULL.\n");
+    return LTE_RESULT_ERROR;
+  }
+
+  if (lte_cache_load(LTE_CACHE_LTIME, localtime, sizeof(*localtime), max_age_ms, info)) {
+    return LTE_RESULT_OK;
+  }
+
+  ret = lte_get_localtime(localtime);
+  lte_cache_set_info(info, 0, LTE_CACHE_SRC_QUERY);
+  return ret;
+}
+
+/**
+ * @brief lte_get_quality_cached() get the current cell quality information like
+ * lte_get_quality(), from the state cache when it holds a value no older than max_age_ms.
+ *
+ * @param [inout] quality: Quality information, and it's valid only if LTE_RESULT_OK returned.
+ * @param [in] max_age_ms: Oldest cached value accepted, in milliseconds. 0 always queries.
+ * @param [inout] info: Age and source of the value, or NULL.
+ *
+ * @return On success, LTE_RESULT_OK is returned. On failure,
+ * LTE_RESULT_ERR is returned.
+ */
+
+lteresult_e lte_get_quality_cached(lte_quality_t *quality, uint32_t max_age_ms,
+                                   lte_cache_info_t *info) {
+  lteresult_e ret;
+
+  if (!quality) {
+    DBGIF_LOG_ERROR("Input argument is NULL.\n");
+    return LTE_RESULT_ERROR;
+  }
+
+  if (lte_cache_load(LTE_CACHE_QUALITY, quality, sizeof(*quality), max_age_ms, info)) {
+    return LTE_RESULT_OK;
+  }
+
+  ret = lte_get_quality(quality);
+  lte_cache_set_info(info, 0, LTE_CACHE_SRC_QUERY);
+  return ret;
+}
+
+/**
+ * @brief lte_get_regstate_cached() get the last reported network registration state.
+ *
+ * @param [inout] regstate: Registration state, and it's valid only if LTE_RESULT_OK returned.
+ * @param [in] max_age_ms: Oldest reported value accepted, in milliseconds.
+ * @param [inout] info: Age and source of the value, or NULL.
+ *
+ * @return On success, LTE_RESULT_OK is returned. If no report no older than max_age_ms was
+ * received, LTE_RESULT_ERR is returned.
+ */
+
+lteresult_e lte_get_regstate_cached(lteregstate_e *regstate, uint32_t max_age_ms,
+                                    lte_cache_info_t *info) {
+  if (!regstate) {
+    DBGIF_LOG_ERROR("Input argument is NULL.\n");
+    return LTE_RESULT_ERROR;
+  }
+
+  return lte_cache_load(LTE_CACHE_REGSTATE, regstate, sizeof(*regstate), max_age_ms, info)
+             ? LTE_RESULT_OK
+             : LTE_RESULT_ERROR;
+}
+
+/**
+ * @brief lte_get_simstate_cached() get the last reported SIM state.
+ *
+ * @param [inout] simstate: SIM state, and it's valid only if LTE_RESULT_OK returned.
+ * @param [in] max_age_ms: Oldest reported value accepted, in milliseconds.
+ * @param [inout] info: Age and source of the value, or NULL.
+ *
+ * @return On success, LTE_RESULT_OK is returned. If no report no older than max_age_ms was
+ * received, LTE_RESULT_ERR is returned.
+ */
+
+lteresult_e lte_get_simstate_cached(ltesimstate_e *simstate, uint32_t max_age_ms,
+                                    lte_cache_info_t *info) {
+  if (!simstate) {
+    DBGIF_LOG_ERROR("Input argument is NULL.\n");
+    return LTE_RESULT_ERROR;
+  }
+
+  return lte_cache_load(LTE_CACHE_SIMSTATE, simstate, sizeof(*simstate), max_age_ms, info)
+             ? LTE_RESULT_OK
+             : LTE_RESULT_ERROR;
+}
+
+/**
+ * @brief lte_get_psmstate_cached() get the last reported PSM state.
+ *
+ * @param [inout] psmstate: PSM state, and it's valid only if LTE_RESULT_OK returned.
+ * @param [in] max_age_ms: Oldest reported value accepted, in milliseconds.
+ * @param [inout] info: Age and source of the value, or NULL.
+ *
+ * @return On success, LTE_RESULT_OK is returned. If no report no older than max_age_ms was
+ * received, LTE_RESULT_ERR is returned.
+ */
+
+lteresult_e lte_get_psmstate_cached(ltepsmstate_e *psmstate, uint32_t max_age_ms,
+                                    lte_cache_info_t *info) {
+  if (!psmstate) {
+    DBGIF_LOG_ERROR("Input argument is NULL.\n");
+    return LTE_RESULT_ERROR;
+  }
+
+  return lte_cache_load(LTE_CACHE_PSMSTATE, psmstate, sizeof(*psmstate), max_age_ms, info)
+             ? LTE_RESULT_OK
+             : LTE_RESULT_ERROR;
+}
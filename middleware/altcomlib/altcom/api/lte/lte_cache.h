@@ -0,0 +1,93 @@
+/*  ---------------------------------------------------------------------------
+
+    (c) copyright 2021 Altair Semiconductor, Ltd. All rights reserved.
+
+    This software, in source or object form (the "Software"), is the
+    property of Altair Semiconductor Ltd. (the "Company") and/or its
+    licensors, which have all right, title and interest therein, You
+    may use the Software only in  accordance with the terms of written
+    license agreement between you and the Company (the "License").
+    Except as expressly stated in the License, the Company grants no
+    licenses by implication, estoppel, or otherwise. If you are not
+    aware of or do not agree to the License terms, you may not use,
+    copy or modify the Software. You may use the source code of the
+    Software only for your internal purposes and may not distribute the
+    source code of the Software, any part thereof, or any derivative work
+    thereof, to any third party, except pursuant to the Company's prior
+    written consent.
+    The Software is the confidential information of the Company.
+
+   ------------------------------------------------------------------------- */
+
+
+#ifndef __MODULES_LTE_ALTCOM_API_LTE_LTE_CACHE_H
+#define __MODULES_LTE_ALTCOM_API_LTE_LTE_CACHE_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lte/lte_api.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Age bound of every cached value, older ones are queried again or, for
+ * the report only states, not returned. 0 disables the cache.
+ */
+
+#ifndef ALTCOM_LTE_CACHE_MAX_AGE_MS
+#  define ALTCOM_LTE_CACHE_MAX_AGE_MS (60000)
+#endif
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+typedef enum {
+  LTE_CACHE_NETSTAT = 0,
+  LTE_CACHE_PSM_REQ,
+  LTE_CACHE_PSM_NW,
+  LTE_CACHE_EDRX_REQ,
+  LTE_CACHE_EDRX_NW,
+  LTE_CACHE_LTIME,
+  LTE_CACHE_QUALITY,
+  LTE_CACHE_REGSTATE,
+  LTE_CACHE_SIMSTATE,
+  LTE_CACHE_PSMSTATE,
+  LTE_CACHE_ITEM_NUM
+} lte_cache_item_e;
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/* Drop every value, called when the library is initialized. */
+
+void lte_cache_init(void);
+
+/* Store a value received in a report event. */
+
+void lte_cache_report(lte_cache_item_e item, const void *value, size_t len);
+
+/* Store a query response. The getter takes lte_cache_seq() before sending
+ * the command, the response is dropped if a report or an invalidation came
+ * in meanwhile, as it may be older.
+ */
+
+uint32_t lte_cache_seq(lte_cache_item_e item);
+void lte_cache_query(lte_cache_item_e item, const void *value, size_t len, uint32_t seq);
+
+void lte_cache_invalidate(lte_cache_item_e item);
+
+/* Copy a value no older than max_age_ms, false if there is none. */
+
+bool lte_cache_load(lte_cache_item_e item, void *value, size_t len, uint32_t max_age_ms,
+                    lte_cache_info_t *info);
+
+#endif /* __MODULES_LTE_ALTCOM_API_LTE_LTE_CACHE_H */
@@ -32,6 +32,7 @@
 #include "apiutil.h"
 #include "apicmdgw.h"
 #include "apicmd_getedrx.h"
+#include "lte_cache.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -60,6 +61,8 @@ lteresult_e lte_get_edrx(lte_edrx_setting_t *settings, ltecfgtype_e cfgType) {
   uint16_t resLen = 0;
   FAR struct apicmd_cmddat_getedrx_s *cmd;
   FAR struct apicmd_cmddat_getedrxres_s *res = NULL;
+  lte_cache_item_e item;
+  uint32_t seq;
 
   /* Return error if parameter is invalid */
   if (!settings) {
@@ -78,6 +81,9 @@ lteresult_e lte_get_edrx(lte_edrx_setting_t *settings, ltecfgtype_e cfgType) {
     return LTE_RESULT_ERROR;
   }
 
+  item = LTE_CFGTYPE_REQUESTED == cfgType ? LTE_CACHE_EDRX_REQ : LTE_CACHE_EDRX_NW;
+  seq = lte_cache_seq(item);
+
   /* Allocate API command buffer to send */
   if (altcom_generic_alloc_cmdandresbuff((FAR void **)&cmd, APICMDID_GET_EDRX, GETEDRX_DATA_LEN,
                                          (FAR void **)&res, GETEDRX_RESP_LEN)) {
@@ -131,6 +137,8 @@ lteresult_e lte_get_edrx(lte_edrx_setting_t *settings, ltecfgtype_e cfgType) {
     if (LTE_EDRX_PTW_2048 < res->ptw_val) {
       DBGIF_LOG1_ERROR("Invalid parameter. ptw_val:%lu\n", (uint32_t)res->ptw_val);
     }
+
+    lte_cache_query(item, settings, sizeof(*settings), seq);
   } else {
     DBGIF_LOG1_ERROR("Unexpected API result: %ld\n", ret);
     ret = LTE_RESULT_ERROR;
@@ -29,6 +29,7 @@
 #include "lte/lte_api.h"
 #include "apiutil.h"
 #include "apicmd_ltime.h"
+#include "lte_cache.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -56,6 +57,7 @@ lteresult_e lte_get_localtime(lte_localtime_t *localtime) {
   uint16_t resLen = 0;
   FAR void *cmd;
   FAR struct apicmd_cmddat_getltimeres_s *res;
+  uint32_t seq;
 
   /* Return error if callback is NULL */
   if (!localtime) {
@@ -69,6 +71,8 @@ lteresult_e lte_get_localtime(lte_localtime_t *localtime) {
     return LTE_RESULT_ERROR;
   }
 
+  seq = lte_cache_seq(LTE_CACHE_LTIME);
+
   /* Allocate API command buffer to send */
   if (altcom_generic_alloc_cmdandresbuff((FAR void **)&cmd, APICMDID_GET_LTIME, GETLTIME_DATA_LEN,
                                          (FAR void **)&res, GETLTIME_RESP_LEN)) {
@@ -107,6 +111,9 @@ lteresult_e lte_get_localtime(lte_localtime_t *localtime) {
   localtime->min = res->ltime.minutes;
   localtime->sec = res->ltime.seconds;
   localtime->tz_sec = ntohl(res->ltime.timezone);
+  if (APICMD_GET_LTIME_RES_OK == ret) {
+    lte_cache_query(LTE_CACHE_LTIME, localtime, sizeof(*localtime), seq);
+  }
 
 errout_with_cmdfree:
   altcom_generic_free_cmdandresbuff(cmd, res);
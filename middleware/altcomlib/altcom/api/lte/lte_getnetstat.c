@@ -29,6 +29,7 @@
 #include "lte/lte_api.h"
 #include "apiutil.h"
 #include "apicmd_getnetstat.h"
+#include "lte_cache.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -56,6 +57,7 @@ lteresult_e lte_get_netstat(ltenetstate_e *state) {
   uint16_t resLen = 0;
   FAR void *cmd;
   FAR struct apicmd_cmddat_getnetstatres_s *res;
+  uint32_t seq;
 
   /* Return error if parameter is NULL */
   if (!state) {
@@ -69,6 +71,8 @@ lteresult_e lte_get_netstat(ltenetstate_e *state) {
     return LTE_RESULT_ERROR;
   }
 
+  seq = lte_cache_seq(LTE_CACHE_NETSTAT);
+
   /* Allocate API command buffer to send */
   if (altcom_generic_alloc_cmdandresbuff((FAR void **)&cmd, APICMDID_GET_NETSTAT,
                                          GETNETSTAT_DATA_LEN, (FAR void **)&res,
@@ -96,6 +100,9 @@ lteresult_e lte_get_netstat(ltenetstate_e *state) {
   /* Check API return code */
   ret = (int32_t)res->result;
   *state = APICMD_GETNETSTAT_RES_CNCT == res->state ? LTE_NETSTAT_ATTACH : LTE_NETSTAT_DETACH;
+  if (LTE_RESULT_OK == ret) {
+    lte_cache_query(LTE_CACHE_NETSTAT, state, sizeof(*state), seq);
+  }
 
 errout_with_cmdfree:
   altcom_generic_free_cmdandresbuff(cmd, res);
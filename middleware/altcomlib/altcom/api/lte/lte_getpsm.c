@@ -32,6 +32,7 @@
 #include "apiutil.h"
 #include "apicmdgw.h"
 #include "apicmd_getpsm.h"
+#include "lte_cache.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -64,6 +65,8 @@ lteresult_e lte_get_psm(lte_psm_setting_t *settings, ltecfgtype_e cfgType) {
   uint16_t resLen = 0;
   FAR struct apicmd_cmddat_getpsm_s *cmd;
   FAR struct apicmd_cmddat_getpsmres_s *res = NULL;
+  lte_cache_item_e item;
+  uint32_t seq;
 
   /* Return error if parameter is invalid */
   if (!settings) {
@@ -82,6 +85,9 @@ lteresult_e lte_get_psm(lte_psm_setting_t *settings, ltecfgtype_e cfgType) {
     return LTE_RESULT_ERROR;
   }
 
+  item = LTE_CFGTYPE_REQUESTED == cfgType ? LTE_CACHE_PSM_REQ : LTE_CACHE_PSM_NW;
+  seq = lte_cache_seq(item);
+
   /* Allocate API command buffer to send */
   if (altcom_generic_alloc_cmdandresbuff((FAR void **)&cmd, APICMDID_GET_PSM, GETPSM_DATA_LEN,
                                          (FAR void **)&res, GETPSM_RESP_LEN)) {
@@ -138,6 +144,8 @@ lteresult_e lte_get_psm(lte_psm_setting_t *settings, ltecfgtype_e cfgType) {
         APICMD_GETPSM_TIMER_MAX < res->tau_val.time_val) {
       DBGIF_LOG1_ERROR("Invalid parameter. TAU time_val:%lu\n", (uint32_t)res->tau_val.time_val);
     }
+
+    lte_cache_query(item, settings, sizeof(*settings), seq);
   }
 
 errout_with_cmdfree:
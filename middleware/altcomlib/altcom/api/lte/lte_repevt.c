@@ -30,6 +30,7 @@
 #include "buffpoolwrapper.h"
 #include "apiutil.h"
 #include "apicmd_repevt.h"
+#include "apicmdhdlrbs.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -423,3 +424,27 @@ int32_t lte_set_report_pdn_activation(pdn_actevt_report_cb_t pdn_evt_callback, v
                               (void **)&g_pdn_actevt_report_cbpriv, (void *)pdn_evt_callback,
                               (void *)userPriv);
 }
+
+/**
+ * @brief lte_get_report_stats() get the report delivery counters since the library was
+ * started.
+ *
+ * @param [inout] stats: Report delivery counters. See @ref lte_report_stats_t
+ *
+ * @return On success, LTE_RESULT_OK is returned. On failure,
+ * LTE_RESULT_ERR is returned.
+ */
+
+lteresult_e lte_get_report_stats(lte_report_stats_t *stats) {
+  struct apicmdhdlrbs_stats_s counters;
+
+  if (!stats) {
+    DBGIF_LOG_ERROR("Input argument is NULL.\n");
+    return LTE_RESULT_ERROR;
+  }
+
+  apicmdhdlrbs_get_stats(&counters);
+  stats->coalesced = counters.coalesced;
+  stats->dropped = counters.dropped;
+  return LTE_RESULT_OK;
+}
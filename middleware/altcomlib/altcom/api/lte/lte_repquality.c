@@ -30,6 +30,7 @@
 #include "buffpoolwrapper.h"
 #include "apiutil.h"
 #include "apicmd_repquality.h"
+#include "lte_cache.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -182,6 +183,7 @@ lteresult_e lte_get_quality(lte_quality_t *quality) {
   uint16_t resLen = 0;
   FAR void *cmd;
   FAR struct apicmd_cmddat_repquality_s *res;
+  uint32_t seq;
 
   /* Return error if callback is NULL */
   if (!quality) {
@@ -195,6 +197,8 @@ lteresult_e lte_get_quality(lte_quality_t *quality) {
     return LTE_RESULT_ERROR;
   }
 
+  seq = lte_cache_seq(LTE_CACHE_QUALITY);
+
   /* Allocate API command buffer to send */
   if (altcom_generic_alloc_cmdandresbuff((FAR void **)&cmd, APICMDID_GET_QUALITY,
                                          GET_QUALITY_DATA_LEN, (FAR void **)&res,
@@ -243,6 +247,7 @@ lteresult_e lte_get_quality(lte_quality_t *quality) {
     }
   }
 
+  lte_cache_query(LTE_CACHE_QUALITY, quality, sizeof(*quality), seq);
   ret = LTE_RESULT_OK;
 
 errout_with_cmdfree:
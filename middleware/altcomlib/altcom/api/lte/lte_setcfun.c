@@ -31,6 +31,7 @@
 #include "lte/lte_api.h"
 #include "apiutil.h"
 #include "apicmd_setcfun.h"
+#include "lte_cache.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -96,6 +97,9 @@ lteresult_e lte_set_cfun(ltecfunoptn_e fun) {
     goto errout_with_cmdfree;
   }
 
+  lte_cache_invalidate(LTE_CACHE_NETSTAT);
+  lte_cache_invalidate(LTE_CACHE_QUALITY);
+
   /* Check API return code */
   ret = (int32_t)res->result;
 
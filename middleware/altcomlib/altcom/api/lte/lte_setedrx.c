@@ -31,6 +31,7 @@
 #include "apiutil.h"
 #include "apicmdgw.h"
 #include "apicmd_setedrx.h"
+#include "lte_cache.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -98,6 +99,10 @@ lteresult_e lte_set_edrx(lte_edrx_setting_t *settings) {
     goto errout_with_cmdfree;
   }
 
+  /* The network provided settings are negotiated again */
+  lte_cache_invalidate(LTE_CACHE_EDRX_REQ);
+  lte_cache_invalidate(LTE_CACHE_EDRX_NW);
+
   /* Check API return code */
   ret = (int32_t)res->result;
   if (APICMD_SETEDRX_RES_OK != ret) {
@@ -31,6 +31,7 @@
 #include "apiutil.h"
 #include "apicmdgw.h"
 #include "apicmd_setpsm.h"
+#include "lte_cache.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -99,6 +100,10 @@ lteresult_e lte_set_psm(lte_psm_setting_t *settings) {
     goto errout_with_cmdfree;
   }
 
+  /* The network provided settings are negotiated again */
+  lte_cache_invalidate(LTE_CACHE_PSM_REQ);
+  lte_cache_invalidate(LTE_CACHE_PSM_NW);
+
   /* Check API return code */
   ret = (int32_t)res->result;
 
@@ -46,6 +46,7 @@
 #include "apicmd_cipher.h"
 #include "apiutil.h"
 #include "mbedtls/base64.h"
+#include "crypto_local.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -238,6 +239,16 @@ int mbedtls_base64_decode(unsigned char *dst, size_t dlen, size_t *olen,
   size_t                out_len = 0;
   struct base64_decode_req_s req;
 
+  if (ALTCOM_MBEDTLS_LOCAL_BASE64 == 1 || slen > APICMD_BASE64_DECODE_SRC_LEN)
+    {
+      if (src == NULL || olen == NULL)
+        {
+          return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+        }
+
+      return base64_local_decode(dst, dlen, olen, src, slen);
+    }
+
   if (dst == NULL || src == NULL || olen == NULL)
     {
       return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
@@ -0,0 +1,318 @@
+/*  ---------------------------------------------------------------------------
+
+    (c) copyright 2021 Altair Semiconductor, Ltd. All rights reserved.
+
+    This software, in source or object form (the "Software"), is the
+    property of Altair Semiconductor Ltd. (the "Company") and/or its
+    licensors, which have all right, title and interest therein, You
+    may use the Software only in  accordance with the terms of written
+    license agreement between you and the Company (the "License").
+    Except as expressly stated in the License, the Company grants no
+    licenses by implication, estoppel, or otherwise. If you are not
+    aware of or do not agree to the License terms, you may not use,
+    copy or modify the Software. You may use the source code of the
+    Software only for your internal purposes and may not distribute the
+    source code of the Software, any part thereof, or any derivative work
+    thereof, to any third party, except pursuant to the Company's prior
+    written consent.
+    The Software is the confidential information of the Company.
+
+   ------------------------------------------------------------------------- */
+
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include "mbedtls/base64.h"
+#include "crypto_local.h"
+
+#if defined(MBEDTLS_SELF_TEST)
+#include <stdio.h>
+#endif
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define BASE64_DEC_PAD     (64)
+#define BASE64_DEC_INVALID (127)
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const unsigned char g_base64_enc_map[64] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* 7-bit character to its 6-bit value, BASE64_DEC_PAD for '=' */
+
+static const unsigned char g_base64_dec_map[128] =
+{
+  127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127,
+  127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127,
+  127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127,  62, 127, 127, 127,  63,
+   52,  53,  54,  55,  56,  57,  58,  59,  60,  61, 127, 127, 127,  64, 127, 127,
+  127,   0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,
+   15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25, 127, 127, 127, 127, 127,
+  127,  26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40,
+   41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51, 127, 127, 127, 127, 127
+};
+
+#if defined(MBEDTLS_SELF_TEST)
+static const unsigned char g_base64_test_dec[64] =
+{
+  0x24, 0x48, 0x6E, 0x56, 0x87, 0x62, 0x5A, 0xBD,
+  0xBF, 0x17, 0xD9, 0xA2, 0xC4, 0x17, 0x1A, 0x01,
+  0x94, 0xED, 0x8F, 0x1E, 0x11, 0xB3, 0xD7, 0x09,
+  0x0C, 0xB6, 0xE9, 0x10, 0x6F, 0x22, 0xEE, 0x13,
+  0xCA, 0xB3, 0x07, 0x05, 0x76, 0xC9, 0xFA, 0x31,
+  0x6C, 0x08, 0x34, 0xFF, 0x8D, 0xC2, 0x6C, 0x38,
+  0x00, 0x43, 0xE9, 0x54, 0x97, 0xAF, 0x50, 0x4B,
+  0xD1, 0x41, 0xBA, 0x95, 0x31, 0x5A, 0x0B, 0x97
+};
+
+static const unsigned char g_base64_test_enc[] =
+  "JEhuVodiWr2/F9mixBcaAZTtjx4Rs9cJDLbpEG8i7hPK"
+  "swcFdsn6MWwINP+Nwmw4AEPpVJevUEvRQbqVMVoLlw==";
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: base64_local_encode
+ *
+ * Description:
+ *   Encode src on the MCU, with no limit on the size. dst is NUL
+ *   terminated, olen does not count the NUL. With a too small dst, olen
+ *   returns the size it needs.
+ *
+ ****************************************************************************/
+
+int base64_local_encode(unsigned char *dst, size_t dlen, size_t *olen,
+                        const unsigned char *src, size_t slen)
+{
+  unsigned char *p;
+  size_t        n;
+  size_t        i;
+  uint32_t      x;
+
+  if (slen == 0)
+    {
+      *olen = 0;
+      return 0;
+    }
+
+  n = slen / 3 + (slen % 3 != 0);
+  if (n > (SIZE_MAX - 1) / 4)
+    {
+      *olen = SIZE_MAX;
+      return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+    }
+
+  n *= 4;
+  if (dst == NULL || dlen < n + 1)
+    {
+      *olen = n + 1;
+      return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+    }
+
+  p = dst;
+  for (i = 0; i + 3 <= slen; i += 3)
+    {
+      x = ((uint32_t)src[i] << 16) | ((uint32_t)src[i + 1] << 8) |
+          src[i + 2];
+      *p++ = g_base64_enc_map[(x >> 18) & 0x3F];
+      *p++ = g_base64_enc_map[(x >> 12) & 0x3F];
+      *p++ = g_base64_enc_map[(x >> 6) & 0x3F];
+      *p++ = g_base64_enc_map[x & 0x3F];
+    }
+
+  if (i < slen)
+    {
+      x = (uint32_t)src[i] << 16;
+      if (i + 1 < slen)
+        {
+          x |= (uint32_t)src[i + 1] << 8;
+        }
+
+      *p++ = g_base64_enc_map[(x >> 18) & 0x3F];
+      *p++ = g_base64_enc_map[(x >> 12) & 0x3F];
+      *p++ = (i + 1 < slen) ? g_base64_enc_map[(x >> 6) & 0x3F] : '=';
+      *p++ = '=';
+    }
+
+  *olen = p - dst;
+  *p = 0;
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: base64_local_decode
+ *
+ * Description:
+ *   Decode src on the MCU, with no limit on the size. Line breaks and
+ *   spaces at the end of a line are skipped as by mbedtls. With a too
+ *   small or NULL dst, olen returns the size it needs.
+ *
+ ****************************************************************************/
+
+int base64_local_decode(unsigned char *dst, size_t dlen, size_t *olen,
+                        const unsigned char *src, size_t slen)
+{
+  unsigned char *p;
+  size_t        i;
+  size_t        n;
+  size_t        spaces;
+  uint32_t      j;
+  uint32_t      x;
+
+  /* First pass: validate and count the digits */
+
+  for (i = n = j = 0; i < slen; i++)
+    {
+      spaces = 0;
+      while (i < slen && src[i] == ' ')
+        {
+          i++;
+          spaces++;
+        }
+
+      if (i == slen)
+        {
+          break;
+        }
+
+      if ((slen - i) >= 2 && src[i] == '\r' && src[i + 1] == '\n')
+        {
+          continue;
+        }
+
+      if (src[i] == '\n')
+        {
+          continue;
+        }
+
+      /* Spaces are only allowed before a line break */
+
+      if (spaces != 0)
+        {
+          return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+        }
+
+      if (src[i] == '=' && ++j > 2)
+        {
+          return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+        }
+
+      if (src[i] > 127 || g_base64_dec_map[src[i]] == BASE64_DEC_INVALID)
+        {
+          return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+        }
+
+      if (g_base64_dec_map[src[i]] < BASE64_DEC_PAD && j != 0)
+        {
+          return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+        }
+
+      n++;
+    }
+
+  if (n == 0)
+    {
+      *olen = 0;
+      return 0;
+    }
+
+  n = ((n * 6) + 7) >> 3;
+  n -= j;
+
+  if (dst == NULL || dlen < n)
+    {
+      *olen = n;
+      return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+    }
+
+  /* Second pass: decode, the input is known to be valid */
+
+  for (j = 3, n = x = 0, p = dst; i > 0; i--, src++)
+    {
+      if (*src == '\r' || *src == '\n' || *src == ' ')
+        {
+          continue;
+        }
+
+      j -= (g_base64_dec_map[*src] == BASE64_DEC_PAD);
+      x = (x << 6) | (g_base64_dec_map[*src] & 0x3F);
+
+      if (++n == 4)
+        {
+          n = 0;
+          if (j > 0)
+            {
+              *p++ = (unsigned char)(x >> 16);
+            }
+
+          if (j > 1)
+            {
+              *p++ = (unsigned char)(x >> 8);
+            }
+
+          if (j > 2)
+            {
+              *p++ = (unsigned char)x;
+            }
+        }
+    }
+
+  *olen = p - dst;
+
+  return 0;
+}
+
+#if defined(MBEDTLS_SELF_TEST)
+int mbedtls_base64_self_test(int verbose)
+{
+  unsigned char buffer[128];
+  size_t        len;
+  int           ret = 0;
+
+  if (base64_local_encode(buffer, sizeof(buffer), &len, g_base64_test_dec,
+                          sizeof(g_base64_test_dec)) != 0 ||
+      len != sizeof(g_base64_test_enc) - 1 ||
+      memcmp(buffer, g_base64_test_enc, len) != 0)
+    {
+      ret = 1;
+    }
+
+  if (verbose != 0)
+    {
+      printf("  Base64 encoding test: %s\n", ret ? "failed" : "passed");
+    }
+
+  if (ret != 0)
+    {
+      return ret;
+    }
+
+  if (base64_local_decode(buffer, sizeof(buffer), &len, g_base64_test_enc,
+                          sizeof(g_base64_test_enc) - 1) != 0 ||
+      len != sizeof(g_base64_test_dec) ||
+      memcmp(buffer, g_base64_test_dec, len) != 0)
+    {
+      ret = 1;
+    }
+
+  if (verbose != 0)
+    {
+      printf("  Base64 decoding test: %s\n", ret ? "failed" : "passed");
+    }
+
+  return ret;
+}
+#endif
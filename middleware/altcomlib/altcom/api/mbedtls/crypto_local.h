@@ -0,0 +1,59 @@
+/*  ---------------------------------------------------------------------------
+
+    (c) copyright 2021 Altair Semiconductor, Ltd. All rights reserved.
+
+    This software, in source or object form (the "Software"), is the
+    property of Altair Semiconductor Ltd. (the "Company") and/or its
+    licensors, which have all right, title and interest therein, You
+    may use the Software only in  accordance with the terms of written
+    license agreement between you and the Company (the "License").
+    Except as expressly stated in the License, the Company grants no
+    licenses by implication, estoppel, or otherwise. If you are not
+    aware of or do not agree to the License terms, you may not use,
+    copy or modify the Software. You may use the source code of the
+    Software only for your internal purposes and may not distribute the
+    source code of the Software, any part thereof, or any derivative work
+    thereof, to any third party, except pursuant to the Company's prior
+    written consent.
+    The Software is the confidential information of the Company.
+
+   ------------------------------------------------------------------------- */
+
+#ifndef __MODULES_LTE_ALTCOM_API_MBEDTLS_CRYPTO_LOCAL_H
+#define __MODULES_LTE_ALTCOM_API_MBEDTLS_CRYPTO_LOCAL_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stddef.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Run the one-shot mbedtls_sha1() and mbedtls_base64_encode/decode() on the
+ * MCU (1) or on the modem (0). Inputs over the RPC payload always run on
+ * the MCU, and the streaming SHA-1 API is always local.
+ */
+
+#ifndef ALTCOM_MBEDTLS_LOCAL_SHA1
+#  define ALTCOM_MBEDTLS_LOCAL_SHA1 (1)
+#endif
+
+#ifndef ALTCOM_MBEDTLS_LOCAL_BASE64
+#  define ALTCOM_MBEDTLS_LOCAL_BASE64 (1)
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/* Same contract as mbedtls_base64_encode() and mbedtls_base64_decode() */
+
+int base64_local_encode(unsigned char *dst, size_t dlen, size_t *olen,
+                        const unsigned char *src, size_t slen);
+int base64_local_decode(unsigned char *dst, size_t dlen, size_t *olen,
+                        const unsigned char *src, size_t slen);
+
+#endif /* __MODULES_LTE_ALTCOM_API_MBEDTLS_CRYPTO_LOCAL_H */
@@ -46,6 +46,7 @@
 #include "apicmd_cipher.h"
 #include "apiutil.h"
 #include "mbedtls/sha1.h"
+#include "crypto_local.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -211,6 +212,22 @@ void mbedtls_sha1(const unsigned char *input, size_t ilen, unsigned char output[
       return;
     }
 
+  /* Hash locally unless the build asks for the modem, and always when
+   * the input does not fit one request.
+   */
+
+  if (ALTCOM_MBEDTLS_LOCAL_SHA1 == 1 || ilen > APICMD_SHA1_INPUT_LEN)
+    {
+      mbedtls_sha1_context ctx;
+
+      mbedtls_sha1_init(&ctx);
+      mbedtls_sha1_starts(&ctx);
+      mbedtls_sha1_update(&ctx, input, ilen);
+      mbedtls_sha1_finish(&ctx, output);
+      mbedtls_sha1_free(&ctx);
+      return;
+    }
+
   if (!altcom_isinit())
     {
       DBGIF_LOG_ERROR("Not intialized\n");
@@ -0,0 +1,331 @@
+/*  ---------------------------------------------------------------------------
+
+    (c) copyright 2021 Altair Semiconductor, Ltd. All rights reserved.
+
+    This software, in source or object form (the "Software"), is the
+    property of Altair Semiconductor Ltd. (the "Company") and/or its
+    licensors, which have all right, title and interest therein, You
+    may use the Software only in  accordance with the terms of written
+    license agreement between you and the Company (the "License").
+    Except as expressly stated in the License, the Company grants no
+    licenses by implication, estoppel, or otherwise. If you are not
+    aware of or do not agree to the License terms, you may not use,
+    copy or modify the Software. You may use the source code of the
+    Software only for your internal purposes and may not distribute the
+    source code of the Software, any part thereof, or any derivative work
+    thereof, to any third party, except pursuant to the Company's prior
+    written consent.
+    The Software is the confidential information of the Company.
+
+   ------------------------------------------------------------------------- */
+
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <string.h>
+#include "mbedtls/sha1.h"
+
+#if defined(MBEDTLS_SELF_TEST)
+#include <stdio.h>
+#endif
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define SHA1_BLOCK_LEN (64)
+
+#define SHA1_ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define SHA1_GET_BE32(b) \
+  (((uint32_t)(b)[0] << 24) | ((uint32_t)(b)[1] << 16) | \
+   ((uint32_t)(b)[2] << 8) | (uint32_t)(b)[3])
+
+#define SHA1_PUT_BE32(n, b) \
+  do \
+    { \
+      (b)[0] = (unsigned char)((n) >> 24); \
+      (b)[1] = (unsigned char)((n) >> 16); \
+      (b)[2] = (unsigned char)((n) >> 8); \
+      (b)[3] = (unsigned char)(n); \
+    } \
+  while (0)
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+#if defined(MBEDTLS_SELF_TEST)
+/* FIPS 180-2 test vectors, the last one is 1000 times its 64 byte block */
+
+static const struct
+{
+  const char    *msg;
+  int           repeat;
+  unsigned char sum[20];
+} g_sha1_test[] =
+{
+  {
+    "abc", 1,
+    {
+      0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e,
+      0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d
+    }
+  },
+  {
+    "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+    {
+      0x84, 0x98, 0x3e, 0x44, 0x1c, 0x3b, 0xd2, 0x6e, 0xba, 0xae,
+      0x4a, 0xa1, 0xf9, 0x51, 0x29, 0xe5, 0xe5, 0x46, 0x70, 0xf1
+    }
+  },
+  {
+    "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+    1000000 / 64,
+    {
+      0x34, 0xaa, 0x97, 0x3c, 0xd4, 0xc4, 0xda, 0xa4, 0xf6, 0x1e,
+      0xeb, 0x2b, 0xdb, 0xad, 0x27, 0x31, 0x65, 0x34, 0x01, 0x6f
+    }
+  }
+};
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+void mbedtls_sha1_init(mbedtls_sha1_context *ctx)
+{
+  memset(ctx, 0, sizeof(mbedtls_sha1_context));
+}
+
+void mbedtls_sha1_free(mbedtls_sha1_context *ctx)
+{
+  if (ctx == NULL)
+    {
+      return;
+    }
+
+  memset(ctx, 0, sizeof(mbedtls_sha1_context));
+}
+
+void mbedtls_sha1_clone(mbedtls_sha1_context *dst,
+                        const mbedtls_sha1_context *src)
+{
+  *dst = *src;
+}
+
+void mbedtls_sha1_starts(mbedtls_sha1_context *ctx)
+{
+  ctx->total[0] = 0;
+  ctx->total[1] = 0;
+
+  ctx->state[0] = 0x67452301;
+  ctx->state[1] = 0xefcdab89;
+  ctx->state[2] = 0x98badcfe;
+  ctx->state[3] = 0x10325476;
+  ctx->state[4] = 0xc3d2e1f0;
+}
+
+/****************************************************************************
+ * Name: mbedtls_sha1_process
+ *
+ * Description:
+ *   Compress one block. The message schedule is kept as a rolling window
+ *   of 16 words to save stack and code on the MCU.
+ *
+ ****************************************************************************/
+
+void mbedtls_sha1_process(mbedtls_sha1_context *ctx,
+                          const unsigned char data[64])
+{
+  uint32_t w[16];
+  uint32_t a;
+  uint32_t b;
+  uint32_t c;
+  uint32_t d;
+  uint32_t e;
+  uint32_t f;
+  uint32_t k;
+  uint32_t temp;
+  int      i;
+
+  for (i = 0; i < 16; i++)
+    {
+      w[i] = SHA1_GET_BE32(data + 4 * i);
+    }
+
+  a = ctx->state[0];
+  b = ctx->state[1];
+  c = ctx->state[2];
+  d = ctx->state[3];
+  e = ctx->state[4];
+
+  for (i = 0; i < 80; i++)
+    {
+      if (i >= 16)
+        {
+          temp = w[(i + 13) & 15] ^ w[(i + 8) & 15] ^
+                 w[(i + 2) & 15] ^ w[i & 15];
+          w[i & 15] = SHA1_ROL(temp, 1);
+        }
+
+      if (i < 20)
+        {
+          f = d ^ (b & (c ^ d));
+          k = 0x5a827999;
+        }
+      else if (i < 40)
+        {
+          f = b ^ c ^ d;
+          k = 0x6ed9eba1;
+        }
+      else if (i < 60)
+        {
+          f = (b & c) | (d & (b | c));
+          k = 0x8f1bbcdc;
+        }
+      else
+        {
+          f = b ^ c ^ d;
+          k = 0xca62c1d6;
+        }
+
+      temp = SHA1_ROL(a, 5) + f + e + k + w[i & 15];
+      e = d;
+      d = c;
+      c = SHA1_ROL(b, 30);
+      b = a;
+      a = temp;
+    }
+
+  ctx->state[0] += a;
+  ctx->state[1] += b;
+  ctx->state[2] += c;
+  ctx->state[3] += d;
+  ctx->state[4] += e;
+}
+
+void mbedtls_sha1_update(mbedtls_sha1_context *ctx,
+                         const unsigned char *input, size_t ilen)
+{
+  size_t   fill;
+  uint32_t left;
+
+  if (ilen == 0)
+    {
+      return;
+    }
+
+  left = ctx->total[0] & (SHA1_BLOCK_LEN - 1);
+  fill = SHA1_BLOCK_LEN - left;
+
+  ctx->total[0] += (uint32_t)ilen;
+  if (ctx->total[0] < (uint32_t)ilen)
+    {
+      ctx->total[1]++;
+    }
+
+  if (left && ilen >= fill)
+    {
+      memcpy(ctx->buffer + left, input, fill);
+      mbedtls_sha1_process(ctx, ctx->buffer);
+      input += fill;
+      ilen -= fill;
+      left = 0;
+    }
+
+  /* Whole blocks straight from the caller's buffer */
+
+  while (ilen >= SHA1_BLOCK_LEN)
+    {
+      mbedtls_sha1_process(ctx, input);
+      input += SHA1_BLOCK_LEN;
+      ilen -= SHA1_BLOCK_LEN;
+    }
+
+  if (ilen > 0)
+    {
+      memcpy(ctx->buffer + left, input, ilen);
+    }
+}
+
+void mbedtls_sha1_finish(mbedtls_sha1_context *ctx, unsigned char output[20])
+{
+  uint32_t used;
+  uint32_t high;
+  uint32_t low;
+  int      i;
+
+  /* Pad with 0x80, zeros and the bit length, in one or two blocks */
+
+  used = ctx->total[0] & (SHA1_BLOCK_LEN - 1);
+  ctx->buffer[used++] = 0x80;
+
+  if (used > SHA1_BLOCK_LEN - 8)
+    {
+      memset(ctx->buffer + used, 0, SHA1_BLOCK_LEN - used);
+      mbedtls_sha1_process(ctx, ctx->buffer);
+      used = 0;
+    }
+
+  memset(ctx->buffer + used, 0, SHA1_BLOCK_LEN - 8 - used);
+
+  high = (ctx->total[0] >> 29) | (ctx->total[1] << 3);
+  low = ctx->total[0] << 3;
+  SHA1_PUT_BE32(high, ctx->buffer + 56);
+  SHA1_PUT_BE32(low, ctx->buffer + 60);
+  mbedtls_sha1_process(ctx, ctx->buffer);
+
+  for (i = 0; i < 5; i++)
+    {
+      SHA1_PUT_BE32(ctx->state[i], output + 4 * i);
+    }
+}
+
+#if defined(MBEDTLS_SELF_TEST)
+int mbedtls_sha1_self_test(int verbose)
+{
+  mbedtls_sha1_context ctx;
+  unsigned char        sum[20];
+  size_t               i;
+  int                  j;
+  int                  ret = 0;
+
+  mbedtls_sha1_init(&ctx);
+
+  for (i = 0; i < sizeof(g_sha1_test) / sizeof(g_sha1_test[0]); i++)
+    {
+      mbedtls_sha1_starts(&ctx);
+      for (j = 0; j < g_sha1_test[i].repeat; j++)
+        {
+          mbedtls_sha1_update(&ctx,
+                              (const unsigned char *)g_sha1_test[i].msg,
+                              strlen(g_sha1_test[i].msg));
+        }
+
+      mbedtls_sha1_finish(&ctx, sum);
+
+      if (memcmp(sum, g_sha1_test[i].sum, sizeof(sum)) != 0)
+        {
+          ret = 1;
+        }
+
+      if (verbose != 0)
+        {
+          printf("  SHA-1 test #%d: %s\n", (int)i + 1,
+                 ret ? "failed" : "passed");
+        }
+
+      if (ret != 0)
+        {
+          break;
+        }
+    }
+
+  mbedtls_sha1_free(&ctx);
+  return ret;
+}
+#endif
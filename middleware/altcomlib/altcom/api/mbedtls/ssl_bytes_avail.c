@@ -45,6 +45,7 @@
 #include "apicmd_ssl.h"
 #include "apiutil.h"
 #include "mbedtls/ssl.h"
+#include "ssl_iobuf.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -195,6 +196,14 @@ size_t mbedtls_ssl_get_bytes_avail( const mbedtls_ssl_context *ssl )
 
   req.id = ssl->id;
 
+  /* Bytes read ahead are served first, no need to ask the modem */
+
+  avail_bytes = ssl_iobuf_rx_avail(req.id);
+  if (avail_bytes > 0)
+    {
+      return avail_bytes;
+    }
+
   avail_bytes = ssl_bytes_avail_request(&req);
 
   return avail_bytes;
@@ -45,6 +45,7 @@
 #include "apicmd_ssl.h"
 #include "apiutil.h"
 #include "mbedtls/ssl.h"
+#include "ssl_iobuf.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -190,6 +191,13 @@ int mbedtls_ssl_close_notify(mbedtls_ssl_context *ssl)
 
   req.id = ssl->id;
 
+  /* Queued writes go before the alert, best effort */
+
+  if (ssl_iobuf_tx_enabled(req.id))
+    {
+      (void)mbedtls_ssl_flush_output(ssl);
+    }
+
   result = ssl_close_notify_request(&req);
 
   return result;
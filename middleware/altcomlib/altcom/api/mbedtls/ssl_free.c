@@ -45,6 +45,7 @@
 #include "apicmd_ssl.h"
 #include "apiutil.h"
 #include "mbedtls/ssl.h"
+#include "ssl_iobuf.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -193,6 +194,8 @@ void mbedtls_ssl_free(mbedtls_ssl_context *ssl)
 
   req.id = ssl->id;
 
+  ssl_iobuf_release(req.id);
+
   result = ssl_free_request(&req);
 
   if (result != SSL_FREE_SUCCESS)
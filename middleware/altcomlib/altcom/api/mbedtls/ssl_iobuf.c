@@ -0,0 +1,415 @@
+/*  ---------------------------------------------------------------------------
+
+    (c) copyright 2021 Altair Semiconductor, Ltd. All rights reserved.
+
+    This software, in source or object form (the "Software"), is the
+    property of Altair Semiconductor Ltd. (the "Company") and/or its
+    licensors, which have all right, title and interest therein, You
+    may use the Software only in  accordance with the terms of written
+    license agreement between you and the Company (the "License").
+    Except as expressly stated in the License, the Company grants no
+    licenses by implication, estoppel, or otherwise. If you are not
+    aware of or do not agree to the License terms, you may not use,
+    copy or modify the Software. You may use the source code of the
+    Software only for your internal purposes and may not distribute the
+    source code of the Software, any part thereof, or any derivative work
+    thereof, to any third party, except pursuant to the Company's prior
+    written consent.
+    The Software is the confidential information of the Company.
+
+   ------------------------------------------------------------------------- */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <string.h>
+#include "dbg_if.h"
+#include "alt_osal.h"
+#include "buffpoolwrapper.h"
+#include "apicmd_ssl_read.h"
+#include "apicmd_ssl_write.h"
+#include "ctx_id_mgr.h"
+#include "ssl_iobuf.h"
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* Buffers of one SSL context. rx holds rx_len received bytes from rx_off
+ * on, tx holds tx_len bytes not sent yet.
+ */
+
+struct ssl_iobuf_s
+{
+  uint32_t      id;
+  unsigned char *rx;
+  size_t        rx_off;
+  size_t        rx_len;
+  unsigned char *tx;
+  size_t        tx_len;
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct ssl_iobuf_s g_ssl_iobuf[ALTCOM_SSL_IOBUF_NUM] =
+{
+  [0 ... ALTCOM_SSL_IOBUF_NUM - 1] = {.id = MBEDTLS_INVALID_CTX_ID}
+};
+static alt_osal_mutex_handle g_ssl_iobuf_mtx;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: ssl_iobuf_find
+ *
+ * Description:
+ *   Find the buffers of an SSL context, taking a free slot when create is
+ *   set. Slots are only taken and released under the mutex, a context is
+ *   used by one task at a time like any mbedtls context.
+ *
+ ****************************************************************************/
+
+static struct ssl_iobuf_s *ssl_iobuf_find(uint32_t id, bool create)
+{
+  struct ssl_iobuf_s *iobuf = NULL;
+  int i;
+
+  for (i = 0; i < ALTCOM_SSL_IOBUF_NUM; i++)
+    {
+      if (g_ssl_iobuf[i].id == id)
+        {
+          return &g_ssl_iobuf[i];
+        }
+    }
+
+  if (!create)
+    {
+      return NULL;
+    }
+
+  alt_osal_lock_mutex(&g_ssl_iobuf_mtx, ALT_OSAL_TIMEO_FEVR);
+  for (i = 0; i < ALTCOM_SSL_IOBUF_NUM; i++)
+    {
+      if (g_ssl_iobuf[i].id == MBEDTLS_INVALID_CTX_ID)
+        {
+          iobuf = &g_ssl_iobuf[i];
+          memset(iobuf, 0, sizeof(*iobuf));
+          iobuf->id = id;
+          break;
+        }
+    }
+
+  alt_osal_unlock_mutex(&g_ssl_iobuf_mtx);
+
+  if (iobuf == NULL)
+    {
+      DBGIF_LOG1_DEBUG("[ssl_iobuf]no slot for ctx id: %d\n", id);
+    }
+
+  return iobuf;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: ssl_iobuf_initialize
+ *
+ * Description:
+ *   Create the mutex of the slots and free them all, once from the ALTCOM
+ *   builder before any SSL context is used.
+ *
+ * Returned Value:
+ *   On success, 0 is returned.
+ *   On failure, negative value is returned.
+ *
+ ****************************************************************************/
+
+int32_t ssl_iobuf_initialize(void)
+{
+  int32_t ret;
+  int i;
+
+  ret = alt_osal_create_mutex(&g_ssl_iobuf_mtx, NULL);
+  DBGIF_ASSERT(0 == ret, "alt_osal_create_mutex().\n");
+  if (ret != 0)
+    {
+      return -1;
+    }
+
+  for (i = 0; i < ALTCOM_SSL_IOBUF_NUM; i++)
+    {
+      memset(&g_ssl_iobuf[i], 0, sizeof(g_ssl_iobuf[i]));
+      g_ssl_iobuf[i].id = MBEDTLS_INVALID_CTX_ID;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: ssl_iobuf_uninitialize
+ *
+ * Description:
+ *   Free the buffers left in the slots and delete the mutex.
+ *
+ * Returned Value:
+ *   On success, 0 is returned.
+ *   On failure, negative value is returned.
+ *
+ ****************************************************************************/
+
+int32_t ssl_iobuf_uninitialize(void)
+{
+  int i;
+
+  for (i = 0; i < ALTCOM_SSL_IOBUF_NUM; i++)
+    {
+      if (g_ssl_iobuf[i].id != MBEDTLS_INVALID_CTX_ID)
+        {
+          ssl_iobuf_release(g_ssl_iobuf[i].id);
+        }
+    }
+
+  return alt_osal_delete_mutex(&g_ssl_iobuf_mtx) == 0 ? 0 : -1;
+}
+
+/****************************************************************************
+ * Name: ssl_iobuf_rx_space
+ *
+ * Description:
+ *   Get the receive-ahead buffer of a context once it is empty.
+ *
+ * Returned Value:
+ *   The buffer and its size, or NULL to read without it.
+ *
+ ****************************************************************************/
+
+unsigned char *ssl_iobuf_rx_space(uint32_t id, size_t *size)
+{
+  struct ssl_iobuf_s *iobuf = ssl_iobuf_find(id, true);
+
+  if (iobuf == NULL || iobuf->rx_len != 0)
+    {
+      return NULL;
+    }
+
+  if (iobuf->rx == NULL)
+    {
+      iobuf->rx = (unsigned char *)BUFFPOOL_ALLOC(APICMD_SSL_READ_BUF_LEN);
+      if (iobuf->rx == NULL)
+        {
+          return NULL;
+        }
+    }
+
+  iobuf->rx_off = 0;
+  *size = APICMD_SSL_READ_BUF_LEN;
+  return iobuf->rx;
+}
+
+void ssl_iobuf_rx_commit(uint32_t id, size_t len)
+{
+  struct ssl_iobuf_s *iobuf = ssl_iobuf_find(id, false);
+
+  if (iobuf != NULL)
+    {
+      iobuf->rx_off = 0;
+      iobuf->rx_len = len;
+    }
+}
+
+/****************************************************************************
+ * Name: ssl_iobuf_rx_take
+ *
+ * Description:
+ *   Copy up to len received bytes to buf.
+ *
+ * Returned Value:
+ *   Bytes copied, 0 when nothing is buffered.
+ *
+ ****************************************************************************/
+
+size_t ssl_iobuf_rx_take(uint32_t id, unsigned char *buf, size_t len)
+{
+  struct ssl_iobuf_s *iobuf = ssl_iobuf_find(id, false);
+
+  if (iobuf == NULL || iobuf->rx_len == 0)
+    {
+      return 0;
+    }
+
+  if (len > iobuf->rx_len)
+    {
+      len = iobuf->rx_len;
+    }
+
+  memcpy(buf, iobuf->rx + iobuf->rx_off, len);
+  iobuf->rx_off += len;
+  iobuf->rx_len -= len;
+  return len;
+}
+
+size_t ssl_iobuf_rx_avail(uint32_t id)
+{
+  struct ssl_iobuf_s *iobuf = ssl_iobuf_find(id, false);
+
+  return iobuf != NULL ? iobuf->rx_len : 0;
+}
+
+/****************************************************************************
+ * Name: ssl_iobuf_tx_enable
+ *
+ * Description:
+ *   Start or stop coalescing the writes of a context. Nothing may be
+ *   pending when it is stopped.
+ *
+ * Returned Value:
+ *   0 on success, -1 without a slot or buffer.
+ *
+ ****************************************************************************/
+
+int ssl_iobuf_tx_enable(uint32_t id, bool enable)
+{
+  struct ssl_iobuf_s *iobuf = ssl_iobuf_find(id, enable);
+
+  if (!enable)
+    {
+      if (iobuf != NULL && iobuf->tx != NULL)
+        {
+          BUFFPOOL_FREE(iobuf->tx);
+          iobuf->tx = NULL;
+          iobuf->tx_len = 0;
+        }
+
+      return 0;
+    }
+
+  if (iobuf == NULL)
+    {
+      return -1;
+    }
+
+  if (iobuf->tx == NULL)
+    {
+      iobuf->tx = (unsigned char *)BUFFPOOL_ALLOC(APICMD_SSL_WRITE_BUF_LEN);
+      if (iobuf->tx == NULL)
+        {
+          return -1;
+        }
+
+      iobuf->tx_len = 0;
+    }
+
+  return 0;
+}
+
+bool ssl_iobuf_tx_enabled(uint32_t id)
+{
+  struct ssl_iobuf_s *iobuf = ssl_iobuf_find(id, false);
+
+  return iobuf != NULL && iobuf->tx != NULL;
+}
+
+size_t ssl_iobuf_tx_room(uint32_t id)
+{
+  struct ssl_iobuf_s *iobuf = ssl_iobuf_find(id, false);
+
+  if (iobuf == NULL || iobuf->tx == NULL)
+    {
+      return 0;
+    }
+
+  return APICMD_SSL_WRITE_BUF_LEN - iobuf->tx_len;
+}
+
+/****************************************************************************
+ * Name: ssl_iobuf_tx_append
+ *
+ * Description:
+ *   Queue a whole write, if it fits.
+ *
+ * Returned Value:
+ *   len when queued, 0 otherwise.
+ *
+ ****************************************************************************/
+
+size_t ssl_iobuf_tx_append(uint32_t id, const unsigned char *buf,
+                           size_t len)
+{
+  struct ssl_iobuf_s *iobuf = ssl_iobuf_find(id, false);
+
+  if (iobuf == NULL || iobuf->tx == NULL ||
+      len > APICMD_SSL_WRITE_BUF_LEN - iobuf->tx_len)
+    {
+      return 0;
+    }
+
+  memcpy(iobuf->tx + iobuf->tx_len, buf, len);
+  iobuf->tx_len += len;
+  return len;
+}
+
+const unsigned char *ssl_iobuf_tx_data(uint32_t id, size_t *len)
+{
+  struct ssl_iobuf_s *iobuf = ssl_iobuf_find(id, false);
+
+  if (iobuf == NULL || iobuf->tx == NULL)
+    {
+      *len = 0;
+      return NULL;
+    }
+
+  *len = iobuf->tx_len;
+  return iobuf->tx;
+}
+
+void ssl_iobuf_tx_consume(uint32_t id, size_t len)
+{
+  struct ssl_iobuf_s *iobuf = ssl_iobuf_find(id, false);
+
+  if (iobuf == NULL || iobuf->tx == NULL)
+    {
+      return;
+    }
+
+  if (len >= iobuf->tx_len)
+    {
+      iobuf->tx_len = 0;
+    }
+  else
+    {
+      iobuf->tx_len -= len;
+      memmove(iobuf->tx, iobuf->tx + len, iobuf->tx_len);
+    }
+}
+
+void ssl_iobuf_release(uint32_t id)
+{
+  struct ssl_iobuf_s *iobuf = ssl_iobuf_find(id, false);
+
+  if (iobuf == NULL)
+    {
+      return;
+    }
+
+  if (iobuf->rx != NULL)
+    {
+      BUFFPOOL_FREE(iobuf->rx);
+    }
+
+  if (iobuf->tx != NULL)
+    {
+      BUFFPOOL_FREE(iobuf->tx);
+    }
+
+  alt_osal_lock_mutex(&g_ssl_iobuf_mtx, ALT_OSAL_TIMEO_FEVR);
+  memset(iobuf, 0, sizeof(*iobuf));
+  iobuf->id = MBEDTLS_INVALID_CTX_ID;
+  alt_osal_unlock_mutex(&g_ssl_iobuf_mtx);
+}
@@ -46,6 +46,7 @@
 #include "apicmd_ssl.h"
 #include "apiutil.h"
 #include "mbedtls/ssl.h"
+#include "ssl_iobuf.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -236,6 +237,44 @@ int mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len)
     }
 
   req.id = ssl->id;
+
+  /* Pending coalesced writes go out before waiting for the peer */
+
+  if (ssl_iobuf_tx_enabled(req.id))
+    {
+      result = mbedtls_ssl_flush_output(ssl);
+      if (result < 0)
+        {
+          return result;
+        }
+    }
+
+  result = (int32_t)ssl_iobuf_rx_take(req.id, buf, len);
+  if (result > 0)
+    {
+      return result;
+    }
+
+  /* A short read asks for a full RPC payload and keeps the rest for the
+   * next calls, a long one goes straight to the caller's buffer.
+   */
+
+  if (0 < len && len < APICMD_SSL_READ_BUF_LEN)
+    {
+      req.buf = ssl_iobuf_rx_space(req.id, &req.len);
+      if (req.buf != NULL)
+        {
+          result = ssl_read_request(&req, req.buf);
+          if (result <= 0)
+            {
+              return result;
+            }
+
+          ssl_iobuf_rx_commit(req.id, result);
+          return (int32_t)ssl_iobuf_rx_take(req.id, buf, len);
+        }
+    }
+
   req.len = len;
 
   result = ssl_read_request(&req, buf);
@@ -43,6 +43,7 @@
 #include "apicmd_session.h"
 #include "apiutil.h"
 #include "mbedtls/ssl.h"
+#include "ssl_iobuf.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -152,6 +153,10 @@ int mbedtls_ssl_session_reset(mbedtls_ssl_context *ssl)
 
   req.ssl_id = ssl->id;
 
+  /* Data of the old session must not leak into the new one */
+
+  ssl_iobuf_release(req.ssl_id);
+
   result = ssl_session_reset_request(&req);
 
   return result;
@@ -46,6 +46,7 @@
 #include "apicmd_ssl.h"
 #include "apiutil.h"
 #include "mbedtls/ssl.h"
+#include "ssl_iobuf.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -207,6 +208,26 @@ int mbedtls_ssl_write(mbedtls_ssl_context *ssl, const unsigned char *buf, size_t
     }
 
   req.id = ssl->id;
+
+  /* Coalesce small writes, sending the queue first when it is full */
+
+  if (ssl_iobuf_tx_enabled(req.id))
+    {
+      if (len > ssl_iobuf_tx_room(req.id))
+        {
+          result = mbedtls_ssl_flush_output(ssl);
+          if (result < 0)
+            {
+              return result;
+            }
+        }
+
+      if (ssl_iobuf_tx_append(req.id, buf, len) == len)
+        {
+          return (int)len;
+        }
+    }
+
   req.buf = buf;
   req.len = len;
 
@@ -215,3 +236,62 @@ int mbedtls_ssl_write(mbedtls_ssl_context *ssl, const unsigned char *buf, size_t
   return result;
 }
 
+int mbedtls_ssl_flush_output(mbedtls_ssl_context *ssl)
+{
+  int32_t                result;
+  struct ssl_write_req_s req;
+
+  if (!altcom_isinit())
+    {
+      DBGIF_LOG_ERROR("Not intialized\n");
+      altcom_seterrno(ALTCOM_ENETDOWN);
+      return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+  req.id = ssl->id;
+
+  for (; ; )
+    {
+      req.buf = ssl_iobuf_tx_data(req.id, &req.len);
+      if (req.len == 0)
+        {
+          return 0;
+        }
+
+      result = ssl_write_request(&req);
+      if (result < 0)
+        {
+          return result;
+        }
+      else if (result == 0)
+        {
+          return MBEDTLS_ERR_SSL_WANT_WRITE;
+        }
+
+      ssl_iobuf_tx_consume(req.id, result);
+    }
+}
+
+int mbedtls_ssl_set_write_coalescing(mbedtls_ssl_context *ssl, int enable)
+{
+  int32_t result;
+
+  if (!enable)
+    {
+      /* Nothing may be left behind in the queue */
+
+      result = mbedtls_ssl_flush_output(ssl);
+      if (result < 0)
+        {
+          return result;
+        }
+    }
+
+  if (ssl_iobuf_tx_enable(ssl->id, enable != 0) != 0)
+    {
+      return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+
+  return 0;
+}
+
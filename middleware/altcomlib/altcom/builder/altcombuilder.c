@@ -81,6 +81,7 @@
 #endif /* __ENABLE_SOCKET_API__ */
 #ifdef __ENABLE_MBEDTLS_API__
 #include "apicmdhdlr_config_verify_callback.h"
+#include "ssl_iobuf.h"
 #endif /* __ENABLE_MBEDTLS_API__ */
 #ifdef __ENABLE_ATSOCKET_API__
 #include "apicmdhdlr_atsocketevt.h"
@@ -223,6 +224,7 @@ struct builder_if_s g_altcombuilder = {.buildmain = lte_buildmain,
 
 #ifdef __ENABLE_LTE_API__
 extern void lte_callback_init(void);
+extern void lte_cache_init(void);
 #endif
 #ifdef __ENABLE_GPS_API__
 extern void gps_callback_init(void);
@@ -665,6 +667,7 @@ static CODE int32_t lte_buildmain(FAR void *arg) {
 
 #ifdef __ENABLE_LTE_API__
   lte_callback_init();
+  lte_cache_init();
 #endif
 
 #ifdef __ENABLE_GPS_API__
@@ -707,13 +710,25 @@ static CODE int32_t lte_buildmain(FAR void *arg) {
     goto errout_with_evtdispatcher;
   }
 
-  ret = apicmdgw_initialize(initCfg->postpone_evt, initCfg->cbreg_only);
+#ifdef __ENABLE_MBEDTLS_API__
+  ret = ssl_iobuf_initialize();
   if (ret < 0) {
     goto errout_with_hal;
   }
+#endif /* __ENABLE_MBEDTLS_API__ */
+
+  ret = apicmdgw_initialize(initCfg->postpone_evt, initCfg->cbreg_only);
+  if (ret < 0) {
+    goto errout_with_iobuf;
+  }
 
   return 0;
 
+errout_with_iobuf:
+#ifdef __ENABLE_MBEDTLS_API__
+  (void)ssl_iobuf_uninitialize();
+#endif /* __ENABLE_MBEDTLS_API__ */
+
 errout_with_hal:
   (void)hal_uninitialize();
 
@@ -755,6 +770,13 @@ static CODE int32_t lte_destroy(void) {
     return ret;
   }
 
+#ifdef __ENABLE_MBEDTLS_API__
+  ret = ssl_iobuf_uninitialize();
+  if (ret < 0) {
+    return ret;
+  }
+#endif /* __ENABLE_MBEDTLS_API__ */
+
   ret = hal_uninitialize();
   if (ret < 0) {
     return ret;
@@ -790,6 +812,7 @@ static CODE int32_t lte_destroy(void) {
 
 #ifdef __ENABLE_LTE_API__
   lte_callback_init();
+  lte_cache_init();
 #endif
 
 #ifdef __ENABLE_GPS_API__
@@ -38,17 +38,46 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+/* Deliver only the latest pending value of the state reports which use
+ * apicmdhdlrbs_do_runjob_latest(). 0 queues a job per report.
+ */
+
+#ifndef ALTCOM_REPORT_COALESCE
+#  define ALTCOM_REPORT_COALESCE (1)
+#endif
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
 
 typedef void (*apicmdhdlrbs_cb_job)(FAR void *arg);
 
+/* Pending report of a type delivered with last value semantics. At most one
+ * job per slot is queued, a report received before it runs replaces the
+ * pending one.
+ */
+
+struct apicmdhdlrbs_latest_s {
+  FAR uint8_t *evt;
+  FAR apicmdhdlrbs_cb_job job;
+};
+
+#define APICMDHDLRBS_LATEST_INITIALIZER(job) \
+  { NULL, job }
+
+struct apicmdhdlrbs_stats_s {
+  uint32_t coalesced; /* Reports replaced by a newer one before delivery */
+  uint32_t dropped;   /* Reports lost as the worker could not take them */
+};
+
 /****************************************************************************
  * Inline functions
  ****************************************************************************/
 
 enum evthdlrc_e apicmdhdlrbs_do_runjob(FAR uint8_t *evt, uint16_t cmdid,
                                        FAR apicmdhdlrbs_cb_job job);
+enum evthdlrc_e apicmdhdlrbs_do_runjob_latest(FAR uint8_t *evt, uint16_t cmdid,
+                                              FAR struct apicmdhdlrbs_latest_s *latest);
+void apicmdhdlrbs_get_stats(FAR struct apicmdhdlrbs_stats_s *stats);
 
 #endif /* __MODULES_ALTCOM_INCLUDE_API_COMMON_APICMDHDLRBS_H */
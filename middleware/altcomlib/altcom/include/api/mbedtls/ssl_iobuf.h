@@ -0,0 +1,80 @@
+/*  ---------------------------------------------------------------------------
+
+    (c) copyright 2021 Altair Semiconductor, Ltd. All rights reserved.
+
+    This software, in source or object form (the "Software"), is the
+    property of Altair Semiconductor Ltd. (the "Company") and/or its
+    licensors, which have all right, title and interest therein, You
+    may use the Software only in  accordance with the terms of written
+    license agreement between you and the Company (the "License").
+    Except as expressly stated in the License, the Company grants no
+    licenses by implication, estoppel, or otherwise. If you are not
+    aware of or do not agree to the License terms, you may not use,
+    copy or modify the Software. You may use the source code of the
+    Software only for your internal purposes and may not distribute the
+    source code of the Software, any part thereof, or any derivative work
+    thereof, to any third party, except pursuant to the Company's prior
+    written consent.
+    The Software is the confidential information of the Company.
+
+   ------------------------------------------------------------------------- */
+
+#ifndef __MODULES_LTE_ALTCOM_API_MBEDTLS_SSL_IOBUF_H
+#define __MODULES_LTE_ALTCOM_API_MBEDTLS_SSL_IOBUF_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* SSL contexts which can have I/O buffers at the same time, the others
+ * fall back to one RPC per call.
+ */
+
+#ifndef ALTCOM_SSL_IOBUF_NUM
+#  define ALTCOM_SSL_IOBUF_NUM (2)
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/* The mutex of the slots, created and deleted with the ALTCOM library */
+
+int32_t ssl_iobuf_initialize(void);
+int32_t ssl_iobuf_uninitialize(void);
+
+/* Receive-ahead: mbedtls_ssl_read() asks the modem for a full RPC payload
+ * into the buffer of the context and serves small reads from it.
+ */
+
+unsigned char *ssl_iobuf_rx_space(uint32_t id, size_t *size);
+void ssl_iobuf_rx_commit(uint32_t id, size_t len);
+size_t ssl_iobuf_rx_take(uint32_t id, unsigned char *buf, size_t len);
+size_t ssl_iobuf_rx_avail(uint32_t id);
+
+/* Write coalescing, enabled per context by mbedtls_ssl_set_write_coalescing()
+ * and sent by mbedtls_ssl_flush_output().
+ */
+
+int ssl_iobuf_tx_enable(uint32_t id, bool enable);
+bool ssl_iobuf_tx_enabled(uint32_t id);
+size_t ssl_iobuf_tx_room(uint32_t id);
+size_t ssl_iobuf_tx_append(uint32_t id, const unsigned char *buf, size_t len);
+const unsigned char *ssl_iobuf_tx_data(uint32_t id, size_t *len);
+void ssl_iobuf_tx_consume(uint32_t id, size_t len);
+
+/* Drop the buffers of a context, from mbedtls_ssl_free() and
+ * mbedtls_ssl_session_reset().
+ */
+
+void ssl_iobuf_release(uint32_t id);
+
+#endif /* __MODULES_LTE_ALTCOM_API_MBEDTLS_SSL_IOBUF_H */
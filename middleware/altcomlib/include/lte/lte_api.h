@@ -1759,6 +1759,46 @@ typedef enum {
   PDN_EVT_NW_ACT        /**< PDN activated from network */
 } lte_pdn_event_t;
 
+/**
+ * @defgroup ltecache Cached State
+ * @{
+ */
+
+/**
+ * @brief
+ * Enumerations of the source of a cached value.
+ */
+
+typedef enum {
+  LTE_CACHE_SRC_QUERY = 0, /**< Response of a query to the modem */
+  LTE_CACHE_SRC_REPORT = 1 /**< Report event of the modem */
+} ltecachesrc_e;
+
+/**
+ * @brief
+ * Definition of the freshness of a value returned by the lte_get_*_cached() APIs.
+ */
+
+typedef struct lte_cache_info {
+  uint32_t age_ms;   /**< Time since the value was received, in milliseconds */
+  ltecachesrc_e src; /**< Where the value came from. See @ref ltecachesrc_e */
+} lte_cache_info_t;
+
+/** @} ltecache */
+
+/**
+ * @brief
+ * Definition of the report delivery counters. Registration state, PSM state, dynamic PSM/eDRX,
+ * connectivity phase, local time, quality and cell information reports are states: when a
+ * newer report of a type arrives before the callback of the previous one ran, only the newer
+ * one is delivered.
+ */
+
+typedef struct lte_report_stats {
+  uint32_t coalesced; /**< Reports replaced by a newer one of the same type before delivery */
+  uint32_t dropped;   /**< Reports lost as the callback worker could not take them */
+} lte_report_stats_t;
+
 /**
  * @defgroup ltecallback Callback Functions Definition
  * @{
@@ -2960,6 +3000,153 @@ int32_t lte_set_report_quality_2g(quality_2g_report_cb_t quality_callback, uint3
 
 lteresult_e lte_get_quality_2g(lte_quality_2g_t *quality);
 
+/**
+ * @brief lte_get_netstat_cached() get network state of the LTE like lte_get_netstat(), from the
+ * state cache when it holds a value no older than max_age_ms. The cache is updated by the
+ * network state report and by lte_get_netstat().
+ *
+ * @param [inout] state: The state of network state, and valid only if LTE_RESULT_OK returned.
+ * @param [in] max_age_ms: Oldest cached value accepted, in milliseconds. 0 always queries.
+ * @param [inout] info: Age and source of the value, or NULL. See @ref lte_cache_info_t
+ *
+ * @return On success, LTE_RESULT_OK is returned. On failure,
+ * LTE_RESULT_ERR is returned.
+ */
+
+lteresult_e lte_get_netstat_cached(ltenetstate_e *state, uint32_t max_age_ms,
+                                   lte_cache_info_t *info);
+
+/**
+ * @brief lte_get_psm_cached() get the requested/network provided PSM settings like
+ * lte_get_psm(), from the state cache when it holds a value no older than max_age_ms. The
+ * network provided settings are updated by the dynamic PSM report as well.
+ *
+ * @param [inout] settings: PSM settings, and it's valid only if LTE_RESULT_OK returned;
+ * See @ref lte_psm_setting_t
+ * @param [in] cfgType: Get setting from Requested/Network-Provided configuration
+ * See @ref ltecfgtype_e
+ * @param [in] max_age_ms: Oldest cached value accepted, in milliseconds. 0 always queries.
+ * @param [inout] info: Age and source of the value, or NULL. See @ref lte_cache_info_t
+ *
+ * @return On success, LTE_RESULT_OK is returned. On failure,
+ * LTE_RESULT_ERR is returned.
+ */
+
+lteresult_e lte_get_psm_cached(lte_psm_setting_t *settings, ltecfgtype_e cfgType,
+                               uint32_t max_age_ms, lte_cache_info_t *info);
+
+/**
+ * @brief lte_get_edrx_cached() get the requested/network provided eDRX settings like
+ * lte_get_edrx(), from the state cache when it holds a value no older than max_age_ms. The
+ * network provided settings are updated by the dynamic eDRX report as well.
+ *
+ * @param [inout] settings: eDRX settings, and it's valid only if LTE_RESULT_OK returned;
+ * See @ref lte_edrx_setting_t
+ * @param [in] cfgType: Get setting from Requested/Network-Provided configuration
+ * See @ref ltecfgtype_e
+ * @param [in] max_age_ms: Oldest cached value accepted, in milliseconds. 0 always queries.
+ * @param [inout] info: Age and source of the value, or NULL. See @ref lte_cache_info_t
+ *
+ * @return On success, LTE_RESULT_OK is returned. On failure,
+ * LTE_RESULT_ERR is returned.
+ */
+
+lteresult_e lte_get_edrx_cached(lte_edrx_setting_t *settings, ltecfgtype_e cfgType,
+                                uint32_t max_age_ms, lte_cache_info_t *info);
+
+/**
+ * @brief lte_get_localtime_cached() get local time like lte_get_localtime(), from the state
+ * cache when it holds a value no older than max_age_ms. The cached time is the one received,
+ * it is not advanced by info->age_ms.
+ *
+ * @param [inout] localtime: Local time, and it's valid only if LTE_RESULT_OK returned;
+ * See @ref lte_localtime_t
+ * @param [in] max_age_ms: Oldest cached value accepted, in milliseconds. 0 always queries.
+ * @param [inout] info: Age and source of the value, or NULL. See @ref lte_cache_info_t
+ *
+ * @return On success, LTE_RESULT_OK is returned. On failure,
+ * LTE_RESULT_ERR is returned.
+ */
+
+lteresult_e lte_get_localtime_cached(lte_localtime_t *localtime, uint32_t max_age_ms,
+                                     lte_cache_info_t *info);
+
+/**
+ * @brief lte_get_quality_cached() get the current cell quality information like
+ * lte_get_quality(), from the state cache when it holds a value no older than max_age_ms.
+ *
+ * @param [inout] quality: Quality information, and it's valid only if LTE_RESULT_OK returned;
+ * See @ref lte_quality_t
+ * @param [in] max_age_ms: Oldest cached value accepted, in milliseconds. 0 always queries.
+ * @param [inout] info: Age and source of the value, or NULL. See @ref lte_cache_info_t
+ *
+ * @return On success, LTE_RESULT_OK is returned. On failure,
+ * LTE_RESULT_ERR is returned.
+ */
+
+lteresult_e lte_get_quality_cached(lte_quality_t *quality, uint32_t max_age_ms,
+                                   lte_cache_info_t *info);
+
+/**
+ * @brief lte_get_regstate_cached() get the last reported network registration state. The
+ * modem sends it only while reporting is enabled by lte_set_report_regstate().
+ *
+ * @param [inout] regstate: Registration state, and it's valid only if LTE_RESULT_OK returned;
+ * See @ref lteregstate_e
+ * @param [in] max_age_ms: Oldest reported value accepted, in milliseconds.
+ * @param [inout] info: Age and source of the value, or NULL. See @ref lte_cache_info_t
+ *
+ * @return On success, LTE_RESULT_OK is returned. If no report no older than max_age_ms was
+ * received, LTE_RESULT_ERR is returned.
+ */
+
+lteresult_e lte_get_regstate_cached(lteregstate_e *regstate, uint32_t max_age_ms,
+                                    lte_cache_info_t *info);
+
+/**
+ * @brief lte_get_simstate_cached() get the last reported SIM state. The modem sends it only
+ * while reporting is enabled by lte_set_report_simstate().
+ *
+ * @param [inout] simstate: SIM state, and it's valid only if LTE_RESULT_OK returned;
+ * See @ref ltesimstate_e
+ * @param [in] max_age_ms: Oldest reported value accepted, in milliseconds.
+ * @param [inout] info: Age and source of the value, or NULL. See @ref lte_cache_info_t
+ *
+ * @return On success, LTE_RESULT_OK is returned. If no report no older than max_age_ms was
+ * received, LTE_RESULT_ERR is returned.
+ */
+
+lteresult_e lte_get_simstate_cached(ltesimstate_e *simstate, uint32_t max_age_ms,
+                                    lte_cache_info_t *info);
+
+/**
+ * @brief lte_get_psmstate_cached() get the last reported PSM state. The modem sends it only
+ * while reporting is enabled by lte_set_report_active_psm().
+ *
+ * @param [inout] psmstate: PSM state, and it's valid only if LTE_RESULT_OK returned;
+ * See @ref ltepsmstate_e
+ * @param [in] max_age_ms: Oldest reported value accepted, in milliseconds.
+ * @param [inout] info: Age and source of the value, or NULL. See @ref lte_cache_info_t
+ *
+ * @return On success, LTE_RESULT_OK is returned. If no report no older than max_age_ms was
+ * received, LTE_RESULT_ERR is returned.
+ */
+
+lteresult_e lte_get_psmstate_cached(ltepsmstate_e *psmstate, uint32_t max_age_ms,
+                                    lte_cache_info_t *info);
+
+/**
+ * @brief lte_get_report_stats() get the report delivery counters since the library was
+ * started.
+ *
+ * @param [inout] stats: Report delivery counters. See @ref lte_report_stats_t
+ *
+ * @return On success, LTE_RESULT_OK is returned. On failure,
+ * LTE_RESULT_ERR is returned.
+ */
+
+lteresult_e lte_get_report_stats(lte_report_stats_t *stats);
+
 /** @} lte_funcs */
 
 #undef EXTERN
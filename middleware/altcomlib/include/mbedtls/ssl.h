@@ -2519,6 +2519,35 @@ int mbedtls_ssl_read( mbedtls_ssl_context *ssl, unsigned char *buf, size_t len )
  */
 int mbedtls_ssl_write( mbedtls_ssl_context *ssl, const unsigned char *buf, size_t len );
 
+#if defined(CONFIG_LTE_NET_MBEDTLS)
+/**
+ * \brief          Queue small writes and send them in one request to the
+ *                 modem, instead of one request per mbedtls_ssl_write().
+ *
+ * \note           Queued data is sent when the queue is full, by
+ *                 \c mbedtls_ssl_flush_output(), and before
+ *                 \c mbedtls_ssl_read() and \c mbedtls_ssl_close_notify().
+ *                 A write that does not fit the queue is sent directly.
+ *
+ * \param ssl      SSL context
+ * \param enable   1 to queue writes, 0 to flush the queue and stop
+ *
+ * \return         0 if successful, MBEDTLS_ERR_SSL_ALLOC_FAILED when no
+ *                 queue is available, or the error of the flush.
+ */
+int mbedtls_ssl_set_write_coalescing( mbedtls_ssl_context *ssl, int enable );
+
+/**
+ * \brief          Send the writes queued by mbedtls_ssl_set_write_coalescing()
+ *
+ * \param ssl      SSL context
+ *
+ * \return         0 once the queue is empty, MBEDTLS_ERR_SSL_WANT_WRITE when
+ *                 the modem took nothing, or another negative error code.
+ */
+int mbedtls_ssl_flush_output( mbedtls_ssl_context *ssl );
+#endif /* CONFIG_LTE_NET_MBEDTLS */
+
 /**
  * \brief           Send an alert message
  *
@@ -0,0 +1,5 @@
+flashsvc_SRC_DIR = $(flashsvc_ROOT)
+
+INC_DIRS += $(flashsvc_SRC_DIR)
+
+$(eval $(call component_compile_rules,flashsvc))
@@ -0,0 +1,412 @@
+/*  ---------------------------------------------------------------------------
+
+    (c) copyright 2021 Altair Semiconductor, Ltd. All rights reserved.
+
+    This software, in source or object form (the "Software"), is the
+    property of Altair Semiconductor Ltd. (the "Company") and/or its
+    licensors, which have all right, title and interest therein, You
+    may use the Software only in  accordance with the terms of written
+    license agreement between you and the Company (the "License").
+    Except as expressly stated in the License, the Company grants no
+    licenses by implication, estoppel, or otherwise. If you are not
+    aware of or do not agree to the License terms, you may not use,
+    copy or modify the Software. You may use the source code of the
+    Software only for your internal purposes and may not distribute the
+    source code of the Software, any part thereof, or any derivative work
+    thereof, to any third party, except pursuant to the Company's prior
+    written consent.
+    The Software is the confidential information of the Company.
+
+   ------------------------------------------------------------------------- */
+
+#include <string.h>
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "flash_svc.h"
+
+#define EVT_FLAG_KICK (1 << 0) /* to the service task */
+/* to a task in flash_svc_wait, apart from the flags serial waits on */
+#define EVT_FLAG_DONE (1 << 2)
+
+#define FLASH_SVC_PAGE_SIZE (256)          /* controller's program page */
+#define FLASH_SVC_64K_SIZE (64 * 1024UL)   /* large erase sector */
+#define FLASH_SVC_MERGE_MAX (8)            /* requests programmed in one page */
+
+typedef struct {
+  flash_svc_request *head[FLASH_SVC_PRIO_MAX]; /* head is the one in progress */
+  flash_svc_request *tail[FLASH_SVC_PRIO_MAX];
+  uint32_t depth;
+  eFlashSvcPrio last_prio; /* priority of the previous step */
+  alt_osal_task_handle task;
+  alt_osal_mutex_handle lock; /* held while a flash command runs */
+  volatile uint32_t readers;  /* reads waiting for the lock */
+  sFlashSvcCounters counters;
+  uint8_t page[FLASH_SVC_PAGE_SIZE];
+} Flash_Svc;
+
+static Flash_Svc svc;
+
+/* Whoever cannot block on the service task goes to the driver directly, like hibernation
+ * running with the scheduler stopped */
+static int Flash_Svc_Direct(void) {
+  return svc.task == NULL || xTaskGetSchedulerState() != taskSCHEDULER_RUNNING ||
+         alt_osal_irq_context() || alt_osal_get_current_task_handle() == svc.task;
+}
+
+static uint32_t Flash_Svc_Elapsed(uint32_t since) {
+  return (alt_osal_get_tick_count() - since) * portTICK_PERIOD_MS;
+}
+
+/* req is always the head of its queue here */
+static void Flash_Svc_Finish(flash_svc_request *req, Flash_Err_Code result) {
+  sFlashSvcCounters *counters = &svc.counters;
+  flash_svc_callback callback = req->callback;
+  eFlashSvcPrio prio = req->prio;
+  uint32_t latency = Flash_Svc_Elapsed(req->submitted);
+  alt_osal_task_handle waiter;
+  uint32_t irq;
+
+  counters->requests[prio]++;
+  if (latency > counters->latency_max[prio]) {
+    counters->latency_max[prio] = latency;
+  }
+  if (result != FLASH_ERROR_NONE) {
+    counters->errors++;
+  }
+
+  irq = alt_osal_enter_critical();
+  svc.head[prio] = req->next;
+  if (svc.head[prio] == NULL) {
+    svc.tail[prio] = NULL;
+  }
+  req->next = NULL;
+  svc.depth--;
+  req->result = result;
+  req->status = (result == FLASH_ERROR_NONE) ? FLASH_SVC_REQ_COMPLETE : FLASH_SVC_REQ_ERROR;
+  waiter = (alt_osal_task_handle)req->waiter;
+  req->waiter = NULL;
+  alt_osal_exit_critical(irq);
+
+  if (callback) {
+    callback(req);
+  }
+  if (waiter) {
+    alt_osal_set_taskflag(waiter, EVT_FLAG_DONE);
+  }
+}
+
+/*
+  Program one page. When the request ends inside the page and the next queued request goes on
+  right after it, the page is filled from that one too.
+*/
+static void Flash_Svc_Program(flash_svc_request *req) {
+  flash_svc_request *part[FLASH_SVC_MERGE_MAX];
+  size_t take[FLASH_SVC_MERGE_MAX];
+  flash_svc_request *cur = req;
+  flash_svc_request *next;
+  uint32_t dst = (uint32_t)req->addr + req->done;
+  uint32_t page_end = (dst & ~(FLASH_SVC_PAGE_SIZE - 1)) + FLASH_SVC_PAGE_SIZE;
+  uint32_t pos = dst;
+  uint32_t num = 0, i, irq;
+  size_t size;
+  Flash_Err_Code ret;
+
+  while (num < FLASH_SVC_MERGE_MAX) {
+    size = page_end - pos;
+    if (size > cur->len - cur->done) {
+      size = cur->len - cur->done;
+    }
+    memcpy(&svc.page[pos - dst], (const uint8_t *)cur->src + cur->done, size);
+    part[num] = cur;
+    take[num++] = size;
+    pos += size;
+    if (pos == page_end) {
+      break;
+    }
+
+    irq = alt_osal_enter_critical();
+    next = cur->next;
+    alt_osal_exit_critical(irq);
+    if (!next || next->op != FLASH_SVC_OP_WRITE || (uint32_t)next->addr != pos ||
+        next->verify != req->verify) {
+      break;
+    }
+    cur = next;
+  }
+
+  alt_osal_lock_mutex(&svc.lock, ALT_OSAL_TIMEO_FEVR);
+  ret = DRV_FLASH_Write(svc.page, (void *)dst, pos - dst, req->verify);
+  alt_osal_unlock_mutex(&svc.lock);
+  svc.counters.programs++;
+
+  if (ret != FLASH_ERROR_NONE) {
+    // the ones merged in are programmed again on their own
+    Flash_Svc_Finish(req, ret);
+    return;
+  }
+  for (i = 0; i < num; i++) {
+    if (i > 0 && part[i]->done == 0) {
+      svc.counters.merged++;
+    }
+    part[i]->done += take[i];
+    if (part[i]->done == part[i]->len) {
+      Flash_Svc_Finish(part[i], FLASH_ERROR_NONE);
+    }
+  }
+}
+
+/* Erase one sector and sleep until the flash is done with it */
+static void Flash_Svc_Erase(flash_svc_request *req) {
+  uint32_t addr = ((uint32_t)req->addr + req->done) & SFLASH_4K_MASK;
+  uint32_t end = (uint32_t)req->addr + req->len;
+  uint32_t size = SFLASH_4K_ERASE_SECTOR_SIZE;
+  uint32_t start;
+  Flash_Err_Code ret;
+
+  // a 64KB erase is quicker per byte, but nothing else can run while it is going on
+  if (req->prio == FLASH_SVC_PRIO_URGENT && (addr % FLASH_SVC_64K_SIZE) == 0 &&
+      end - addr >= FLASH_SVC_64K_SIZE) {
+    size = FLASH_SVC_64K_SIZE;
+  }
+
+  alt_osal_lock_mutex(&svc.lock, ALT_OSAL_TIMEO_FEVR);
+  ret = DRV_FLASH_Erase_Sector((void *)addr, size == FLASH_SVC_64K_SIZE, 0);
+  start = alt_osal_get_tick_count();
+  while (ret == FLASH_ERROR_NONE && DRV_FLASH_Is_Busy()) {
+    if (Flash_Svc_Elapsed(start) > FLASH_SVC_ERASE_TIMEOUT_MS) {
+      ret = FLASH_ERROR_TIMEOUT;
+      break;
+    }
+    alt_osal_sleep_task(FLASH_SVC_POLL_MS);
+  }
+  alt_osal_unlock_mutex(&svc.lock);
+  svc.counters.erases++;
+
+  if (ret != FLASH_ERROR_NONE) {
+    Flash_Svc_Finish(req, ret);
+    return;
+  }
+  req->done = (addr + size >= end) ? req->len : addr + size - (uint32_t)req->addr;
+  if (req->done == req->len) {
+    Flash_Svc_Finish(req, FLASH_ERROR_NONE);
+  }
+}
+
+/*
+  One page or one sector per round, then the queues are looked at again. So an urgent request
+  waits for at most one step of a background one.
+*/
+static void Flash_Svc_Task(void *arg) {
+  flash_svc_request *req;
+  flash_svc_request *bg;
+  uint32_t irq;
+
+  (void)arg;
+  while (1) {
+    irq = alt_osal_enter_critical();
+    req = svc.head[FLASH_SVC_PRIO_URGENT];
+    bg = svc.head[FLASH_SVC_PRIO_BACKGROUND];
+    if (req == NULL) {
+      req = bg;
+    }
+    alt_osal_exit_critical(irq);
+
+    if (req == NULL) {
+      alt_osal_wait_taskflag(EVT_FLAG_KICK, ALT_OSAL_WMODE_TWF_ORW, ALT_OSAL_TIMEO_FEVR);
+      continue;
+    }
+    // the lock is not handed over on unlock, so the task would take it again before a reader
+    while (svc.readers) {
+      alt_osal_sleep_task(1);
+    }
+    if (req != bg && bg && bg->done && svc.last_prio == FLASH_SVC_PRIO_BACKGROUND) {
+      svc.counters.preemptions++;
+    }
+    svc.last_prio = req->prio;
+
+    if (req->op == FLASH_SVC_OP_WRITE) {
+      Flash_Svc_Program(req);
+    } else {
+      Flash_Svc_Erase(req);
+    }
+  }
+}
+
+int32_t flash_svc_init(void) {
+  alt_osal_task_attribute attr = {0};
+  alt_osal_mutex_attribute mutex_param = {0};
+
+  if (svc.task) {
+    return 0;
+  }
+
+  if (alt_osal_create_mutex(&svc.lock, &mutex_param) != 0) {
+    return -1;
+  }
+
+  attr.function = Flash_Svc_Task;
+  attr.name = "FLASH SVC";
+  attr.priority = FLASH_SVC_TASK_PRIORITY;
+  attr.stack_size = FLASH_SVC_TASK_STACK_SIZE;
+  if (alt_osal_create_task(&svc.task, &attr) != 0) {
+    alt_osal_delete_mutex(&svc.lock);
+    svc.lock = NULL;
+    svc.task = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+int32_t flash_svc_submit(flash_svc_request *req) {
+  uint32_t irq;
+
+  if (!svc.task || !req || req->len == 0 || req->prio >= FLASH_SVC_PRIO_MAX ||
+      req->status == FLASH_SVC_REQ_QUEUED || req->op > FLASH_SVC_OP_ERASE ||
+      (req->op == FLASH_SVC_OP_WRITE && !req->src)) {
+    return -1;
+  }
+
+  req->next = NULL;
+  req->waiter = NULL;
+  req->done = 0;
+  req->result = FLASH_ERROR_NONE;
+  req->submitted = alt_osal_get_tick_count();
+
+  irq = alt_osal_enter_critical();
+  req->status = FLASH_SVC_REQ_QUEUED;
+  if (svc.tail[req->prio]) {
+    svc.tail[req->prio]->next = req;
+  } else {
+    svc.head[req->prio] = req;
+  }
+  svc.tail[req->prio] = req;
+  svc.depth++;
+  if (svc.depth > svc.counters.queue_max) {
+    svc.counters.queue_max = svc.depth;
+  }
+  alt_osal_exit_critical(irq);
+
+  alt_osal_set_taskflag(svc.task, EVT_FLAG_KICK);
+  return 0;
+}
+
+eFlashSvcReqStatus flash_svc_wait(flash_svc_request *req, uint32_t timeout) {
+  uint32_t start = alt_osal_get_tick_count();
+  uint32_t wait, elapsed, irq;
+
+  alt_osal_clear_taskflag(EVT_FLAG_DONE);
+  irq = alt_osal_enter_critical();
+  if (req->status == FLASH_SVC_REQ_QUEUED) {
+    req->waiter = alt_osal_get_current_task_handle();
+  }
+  alt_osal_exit_critical(irq);
+
+  while (req->status == FLASH_SVC_REQ_QUEUED) {
+    wait = (uint32_t)ALT_OSAL_TIMEO_FEVR;
+    if (timeout != FLASH_SVC_WAIT_FOREVER) {
+      elapsed = Flash_Svc_Elapsed(start);
+      if (elapsed >= timeout) {
+        break;
+      }
+      wait = timeout - elapsed;
+    }
+    alt_osal_wait_taskflag(EVT_FLAG_DONE, ALT_OSAL_WMODE_TWF_ORW, wait);
+  }
+
+  irq = alt_osal_enter_critical();
+  if (req->status == FLASH_SVC_REQ_QUEUED) {
+    req->waiter = NULL;
+  }
+  alt_osal_exit_critical(irq);
+  return req->status;
+}
+
+int32_t flash_svc_flush(uint32_t timeout) {
+  uint32_t start = alt_osal_get_tick_count();
+
+  if (Flash_Svc_Direct()) {
+    return svc.depth ? -1 : 0;
+  }
+  while (svc.depth) {
+    if (timeout != FLASH_SVC_WAIT_FOREVER && Flash_Svc_Elapsed(start) >= timeout) {
+      return -1;
+    }
+    alt_osal_sleep_task(FLASH_SVC_POLL_MS);
+  }
+  return 0;
+}
+
+Flash_Err_Code flash_svc_write(void *src, void *dst, size_t len, int do_verify) {
+  flash_svc_request req;
+
+  if (Flash_Svc_Direct()) {
+    return DRV_FLASH_Write(src, dst, len, do_verify);
+  }
+
+  memset(&req, 0, sizeof(req));
+  req.op = FLASH_SVC_OP_WRITE;
+  req.prio = FLASH_SVC_PRIO_URGENT;
+  req.addr = dst;
+  req.src = src;
+  req.len = len;
+  req.verify = do_verify;
+  if (!dst || flash_svc_submit(&req) != 0) {
+    return DRV_FLASH_Write(src, dst, len, do_verify);
+  }
+  flash_svc_wait(&req, FLASH_SVC_WAIT_FOREVER);
+  return req.result;
+}
+
+Flash_Err_Code flash_svc_erase(void *addr, int is_64KB_sect, int wait_for_finish) {
+  uint32_t size = is_64KB_sect ? FLASH_SVC_64K_SIZE : SFLASH_4K_ERASE_SECTOR_SIZE;
+  flash_svc_request req;
+
+  if (Flash_Svc_Direct() || !addr) {
+    return DRV_FLASH_Erase_Sector(addr, is_64KB_sect, wait_for_finish);
+  }
+
+  memset(&req, 0, sizeof(req));
+  req.op = FLASH_SVC_OP_ERASE;
+  req.prio = FLASH_SVC_PRIO_URGENT;
+  req.addr = (void *)((uint32_t)addr & ~(size - 1));
+  req.len = size;
+  if (flash_svc_submit(&req) != 0) {
+    return DRV_FLASH_Erase_Sector(addr, is_64KB_sect, wait_for_finish);
+  }
+  flash_svc_wait(&req, FLASH_SVC_WAIT_FOREVER);
+  return req.result;
+}
+
+Flash_Err_Code flash_svc_read(void *src, void *dst, size_t size) {
+  Flash_Err_Code ret;
+  uint32_t irq;
+
+  if (Flash_Svc_Direct()) {
+    return DRV_FLASH_Read(src, dst, size);
+  }
+
+  irq = alt_osal_enter_critical();
+  svc.readers++;
+  alt_osal_exit_critical(irq);
+
+  alt_osal_lock_mutex(&svc.lock, ALT_OSAL_TIMEO_FEVR);
+  ret = DRV_FLASH_Read(src, dst, size);
+  alt_osal_unlock_mutex(&svc.lock);
+
+  irq = alt_osal_enter_critical();
+  svc.readers--;
+  alt_osal_exit_critical(irq);
+  return ret;
+}
+
+void flash_svc_get_counters(sFlashSvcCounters *counters) {
+  uint32_t irq;
+
+  if (!counters) {
+    return;
+  }
+  irq = alt_osal_enter_critical();
+  memcpy(counters, &svc.counters, sizeof(sFlashSvcCounters));
+  alt_osal_exit_critical(irq);
+}
@@ -0,0 +1,212 @@
+/*  ---------------------------------------------------------------------------
+
+    (c) copyright 2021 Altair Semiconductor, Ltd. All rights reserved.
+
+    This software, in source or object form (the "Software"), is the
+    property of Altair Semiconductor Ltd. (the "Company") and/or its
+    licensors, which have all right, title and interest therein, You
+    may use the Software only in  accordance with the terms of written
+    license agreement between you and the Company (the "License").
+    Except as expressly stated in the License, the Company grants no
+    licenses by implication, estoppel, or otherwise. If you are not
+    aware of or do not agree to the License terms, you may not use,
+    copy or modify the Software. You may use the source code of the
+    Software only for your internal purposes and may not distribute the
+    source code of the Software, any part thereof, or any derivative work
+    thereof, to any third party, except pursuant to the Company's prior
+    written consent.
+    The Software is the confidential information of the Company.
+
+   ------------------------------------------------------------------------- */
+
+/**
+ * @file flash_svc.h
+ */
+
+#ifndef _FLASH_SVC_H_
+#define _FLASH_SVC_H_
+#include <stdint.h>
+#include <stddef.h>
+#include "DRV_FLASH.h"
+#include "alt_osal.h"
+
+/**
+ * @defgroup flash_svc Flash Service
+ * A task that runs flash program and erase requests in the background. Callers no longer
+ * busy-wait for the flash: they queue a request and either block on it, get a callback, or go on.
+ * @{
+ */
+
+/**
+ * @defgroup flash_svc_const Flash Service Constants
+ * @{
+ */
+#define FLASH_SVC_WAIT_FOREVER (0xFFFFFFFFUL) /*!< Wait that never expires */
+#ifndef FLASH_SVC_TASK_PRIORITY
+#define FLASH_SVC_TASK_PRIORITY ALT_OSAL_TASK_PRIO_ABOVE_NORMAL /*!< Priority of the service task */
+#endif
+#ifndef FLASH_SVC_TASK_STACK_SIZE
+#define FLASH_SVC_TASK_STACK_SIZE (2048) /*!< Stack of the service task in bytes */
+#endif
+#ifndef FLASH_SVC_POLL_MS
+#define FLASH_SVC_POLL_MS (2) /*!< Sleep between busy checks of a running erase */
+#endif
+#ifndef FLASH_SVC_ERASE_TIMEOUT_MS
+#define FLASH_SVC_ERASE_TIMEOUT_MS (3000) /*!< Longest 64KB sector erase */
+#endif
+/** @} flash_svc_const */
+
+/**
+ * @defgroup flash_svc_types Flash Service Types
+ * @{
+ */
+
+/**
+ * @brief Operation of a flash request
+ *
+ */
+typedef enum {
+  FLASH_SVC_OP_WRITE = 0, /*!< Program data, bits only go from 1 to 0 */
+  FLASH_SVC_OP_ERASE,     /*!< Erase the 4KB sectors covering the range */
+} eFlashSvcOp;
+
+/**
+ * @brief Priority of a flash request. Urgent requests run first and hold back a background request
+ * between two of its sectors or pages.
+ *
+ */
+typedef enum {
+  FLASH_SVC_PRIO_URGENT = 0,  /*!< Like hibernation data or a caller blocked on the result */
+  FLASH_SVC_PRIO_BACKGROUND,  /*!< Like logging */
+  FLASH_SVC_PRIO_MAX,
+} eFlashSvcPrio;
+
+/**
+ * @brief State of a flash request
+ *
+ */
+typedef enum {
+  FLASH_SVC_REQ_IDLE = 0, /*!< Not submitted yet */
+  FLASH_SVC_REQ_QUEUED,   /*!< Waiting or partly done */
+  FLASH_SVC_REQ_COMPLETE, /*!< Done, result is FLASH_ERROR_NONE */
+  FLASH_SVC_REQ_ERROR,    /*!< Stopped on the error in result */
+} eFlashSvcReqStatus;
+
+typedef struct flash_svc_request flash_svc_request;
+
+/** @brief Completion callback of a request. Called in the service task, the request is handed back
+ * to the caller when it returns. */
+typedef void (*flash_svc_callback)(flash_svc_request *req);
+
+/**
+ * @brief Definition of a flash request. The storage and the data belong to the caller and must stay
+ * valid while the request is QUEUED.
+ */
+struct flash_svc_request {
+  eFlashSvcOp op;               /*!< [in] Operation */
+  eFlashSvcPrio prio;           /*!< [in] Priority */
+  void *addr;                   /*!< [in] Flash address */
+  const void *src;              /*!< [in] Data to program, unused for an erase */
+  size_t len;                   /*!< [in] Bytes to program or erase */
+  int verify;                   /*!< [in] Verify the programmed data, as DRV_FLASH_Write does */
+  flash_svc_callback callback;  /*!< [in] Completion callback, or NULL */
+  void *user_data;              /*!< [in] Free for the caller */
+  volatile size_t done;         /*!< [out] Bytes programmed or erased so far */
+  volatile Flash_Err_Code result;      /*!< [out] Driver error that stopped the request */
+  volatile eFlashSvcReqStatus status;  /*!< [out] Request state */
+
+  /* private */
+  flash_svc_request *next; /*!< Next request of the same priority */
+  void *waiter;            /*!< Task blocked in flash_svc_wait */
+  uint32_t submitted;      /*!< Tick count of the submission */
+};
+
+/** @brief Definition of the flash service counters */
+typedef struct {
+  uint32_t requests[FLASH_SVC_PRIO_MAX]; /*!< Requests finished per priority */
+  uint32_t latency_max[FLASH_SVC_PRIO_MAX]; /*!< Longest submission to completion in ms */
+  uint32_t programs;    /*!< Page program commands */
+  uint32_t merged;      /*!< Requests programmed together with the one before them */
+  uint32_t erases;      /*!< Sector erase commands, 4KB or 64KB */
+  uint32_t preemptions; /*!< Times a background request was held back for an urgent one */
+  uint32_t errors;      /*!< Requests finished in error */
+  uint32_t queue_max;   /*!< Deepest queue seen */
+} sFlashSvcCounters;
+
+/** @} flash_svc_types */
+
+/**
+ * @defgroup flash_svc_api Flash Service APIs
+ * @{
+ */
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* _cplusplus */
+
+/**
+ * @brief To start the flash service task. Until it runs, the calls below go to the flash driver
+ * directly.
+ *
+ * @return int32_t 0 on success. others, negative value are returned.
+ */
+int32_t flash_svc_init(void);
+
+/**
+ * @brief To queue a request without blocking. A write request that continues the one queued before
+ * it is programmed together with it, page by page.
+ *
+ * @param [in] req: The request. op, prio, addr, src, len, verify, callback and user_data must be
+ * set
+ * @return int32_t 0 on success. others, negative value are returned.
+ */
+int32_t flash_svc_submit(flash_svc_request *req);
+
+/**
+ * @brief To wait for a request to finish
+ *
+ * @param [in] req: The request
+ * @param [in] timeout: Timeout in ms, or FLASH_SVC_WAIT_FOREVER
+ * @return The state of req. FLASH_SVC_REQ_QUEUED if the timeout expired first
+ */
+eFlashSvcReqStatus flash_svc_wait(flash_svc_request *req, uint32_t timeout);
+
+/**
+ * @brief To wait until every queued request has finished
+ *
+ * @param [in] timeout: Timeout in ms, or FLASH_SVC_WAIT_FOREVER
+ * @return int32_t 0 when the queue is empty. others, negative value are returned.
+ */
+int32_t flash_svc_flush(uint32_t timeout);
+
+/**
+ * @brief Drop-in for DRV_FLASH_Write. Programs through the service as an urgent request and
+ * blocks the caller on it instead of busy-waiting.
+ */
+Flash_Err_Code flash_svc_write(void *src, void *dst, size_t len, int do_verify);
+
+/**
+ * @brief Drop-in for DRV_FLASH_Erase_Sector. Erases through the service as an urgent request. It
+ * always returns after the erase is done.
+ */
+Flash_Err_Code flash_svc_erase(void *addr, int is_64KB_sect, int wait_for_finish);
+
+/**
+ * @brief Drop-in for DRV_FLASH_Read. The service starts no new command while the read runs, so it
+ * waits for at most one page program or sector erase.
+ */
+Flash_Err_Code flash_svc_read(void *src, void *dst, size_t size);
+
+/**
+ * @brief To get the flash service counters
+ *
+ * @param [out] counters: The counters
+ */
+void flash_svc_get_counters(sFlashSvcCounters *counters);
+
+#if defined(__cplusplus)
+}
+#endif
+/** @} flash_svc_api */
+/** @} flash_svc */
+#endif /* _FLASH_SVC_H_ */
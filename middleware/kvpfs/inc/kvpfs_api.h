@@ -38,6 +38,9 @@ void kvpfs_init(void);
  * 1. CRC_KEYNAME in kvpfs_config.h is a reserved word which can't be the name of the key.
  * 2. ENV_MAGIC in kvpfs_config.h is a reserved word which can't be the name of the key.
  * 3. Key and/or value can't include \x00 and \xff
+ * 4. Value can't start with \x01, \x02 or \x03, which mark the typed values below. With
+ * KVPFS_LOG_STORE, value can't start with \x1b either, such a value is refused with
+ * KVPFS_RESERVE_VALUE.
  *
  * @param key [in]: The name of the key.
  * @param value [in]: the content of the value.
@@ -56,6 +59,108 @@ int32_t set_env(const char *key, const char *value);
  */
 int32_t get_env(const char *key, char **value);
 
+/**
+ * @brief Value types of the typed accessors.
+ */
+typedef enum {
+  KVPFS_TYPE_STR = 0, /*!< '\0' terminated string, as set_env() stores it */
+  KVPFS_TYPE_U32,     /*!< uint32_t */
+  KVPFS_TYPE_I64,     /*!< int64_t */
+  KVPFS_TYPE_BLOB,    /*!< binary data up to 65535 bytes, may hold \x00 and \xff */
+} kvpfs_type_t;
+
+/**
+ * @brief One key of get_env_batch().
+ */
+typedef struct {
+  const char *key;   /*!< [in] The name of the key */
+  kvpfs_type_t type; /*!< [in] The type to read the value as */
+  void *buf;         /*!< [in] Where to put the value: a string buffer, a uint32_t, an int64_t or a
+                        blob buffer */
+  uint32_t size;     /*!< [in] The size of buf in bytes */
+  uint32_t len;      /*!< [out] The length of a string or blob value, without '\0' */
+  int32_t status;    /*!< [out] 0 on success or a negative error like the single key getters */
+} kvpfs_get_item_t;
+
+/**
+ * @brief Store a uint32_t in a fixed-width binary form. A value written as decimal text by
+ * set_env() reads back through get_env_u32() as well.
+ *
+ * @param key [in]: The name of the key.
+ * @param value [in]: The value.
+ * @return Return 0 on success. Return negtive for errors. Refer to kvpfs_err.h for error reasons.
+ */
+int32_t set_env_u32(const char *key, uint32_t value);
+
+/**
+ * @brief Store an int64_t in a fixed-width binary form.
+ *
+ * @param key [in]: The name of the key.
+ * @param value [in]: The value.
+ * @return Return 0 on success. Return negtive for errors. Refer to kvpfs_err.h for error reasons.
+ */
+int32_t set_env_i64(const char *key, int64_t value);
+
+/**
+ * @brief Store binary data with a length prefix. The data may hold any byte.
+ *
+ * @param key [in]: The name of the key.
+ * @param data [in]: The data.
+ * @param len [in]: The data length, up to 65535.
+ * @return Return 0 on success. Return negtive for errors. Refer to kvpfs_err.h for error reasons.
+ */
+int32_t set_env_blob(const char *key, const void *data, uint32_t len);
+
+/**
+ * @brief Get a string value into a caller buffer, no memory is allocated.
+ *
+ * @param key [in]: The name of the key.
+ * @param buf [out]: The buffer, '\0' terminated on success.
+ * @param size [in]: The size of buf. It has to take the value and its '\0'.
+ * @return Return 0 on success. Return negtive for errors. Refer to kvpfs_err.h for error reasons.
+ */
+int32_t get_env_buf(const char *key, char *buf, uint32_t size);
+
+/**
+ * @brief Get a uint32_t value, no memory is allocated.
+ *
+ * @param key [in]: The name of the key.
+ * @param value [out]: The value.
+ * @return Return 0 on success. Return negtive for errors. Refer to kvpfs_err.h for error reasons.
+ */
+int32_t get_env_u32(const char *key, uint32_t *value);
+
+/**
+ * @brief Get an int64_t value, no memory is allocated.
+ *
+ * @param key [in]: The name of the key.
+ * @param value [out]: The value.
+ * @return Return 0 on success. Return negtive for errors. Refer to kvpfs_err.h for error reasons.
+ */
+int32_t get_env_i64(const char *key, int64_t *value);
+
+/**
+ * @brief Get binary data into a caller buffer, no memory is allocated.
+ *
+ * @param key [in]: The name of the key.
+ * @param buf [out]: The buffer.
+ * @param size [in]: The size of buf.
+ * @param len [out]: The data length. Set on -KVPFS_BUFFER_TOO_SMALL as well.
+ * @return Return 0 on success. Return negtive for errors. Refer to kvpfs_err.h for error reasons.
+ */
+int32_t get_env_blob(const char *key, void *buf, uint32_t size, uint32_t *len);
+
+/**
+ * @brief Get several values in one go under a single lock, no memory is allocated. Each item
+ * reports its own status.
+ *
+ * @param items [in/out]: The keys to get.
+ * @param num [in]: The number of items.
+ * @return Return the number of items found. Return negtive for errors. Refer to kvpfs_err.h for
+ * error reasons.
+ */
+int32_t get_env_batch(kvpfs_get_item_t *items, uint32_t num);
+
 /**
  * @brief Write data in RAM to flash.
  *
@@ -72,6 +177,51 @@ int32_t save_env(void);
  */
 int32_t save_env_to_gpm(void);
 
+/**
+ * @brief A batch of changes applied as a whole by kvpfs_txn_commit().
+ */
+typedef struct kvpfs_txn kvpfs_txn_t;
+
+/**
+ * @brief Start a transaction. Changes added to it stay private to the caller until
+ * kvpfs_txn_commit(), get_env() doesn't see them.
+ *
+ * @param txn [out]: The transaction.
+ * @return Return 0 on success. Return negtive for errors. Refer to kvpfs_err.h for error reasons.
+ */
+int32_t kvpfs_txn_begin(kvpfs_txn_t **txn);
+
+/**
+ * @brief Add a change to a transaction, like set_env() does: leave value as NULL to delete the key.
+ * A later change of the same key in the transaction wins. The same limitations as set_env() apply.
+ *
+ * @param txn [in]: The transaction.
+ * @param key [in]: The name of the key.
+ * @param value [in]: The content of the value, or NULL.
+ * @return Return 0 on success. Return negtive for errors. Refer to kvpfs_err.h for error reasons.
+ */
+int32_t kvpfs_txn_set(kvpfs_txn_t *txn, const char *key, const char *value);
+
+/**
+ * @brief Apply all changes of a transaction and save them to flash with a single flash update,
+ * together with the data set_env() left in RAM. Other tasks see either none or all of the changes,
+ * and so does the next boot after a power cut in the middle of the update. If the changes don't fit
+ * in the flash mirror or memory runs out, nothing is applied. If the flash update itself fails, the
+ * changes stay applied in RAM and the next save_env() retries it. The transaction is freed in any
+ * case.
+ *
+ * @param txn [in]: The transaction.
+ * @return Return 0 on success. Return negtive for errors. Refer to kvpfs_err.h for error reasons.
+ */
+int32_t kvpfs_txn_commit(kvpfs_txn_t *txn);
+
+/**
+ * @brief Drop a transaction without applying any of its changes and free it.
+ *
+ * @param txn [in]: The transaction.
+ */
+void kvpfs_txn_abort(kvpfs_txn_t *txn);
+
 /**
  * @brief Prints file system information
  *
@@ -33,4 +33,29 @@
 #define CRC_LEN (sizeof(CRC_KEYNAME) + 1 + 4)  // +1(=) +4(16 byte crc)
 #define ENV_MIGIC_LEN sizeof(ENV_MAGIC)
 
+#ifndef KVPFS_LOG_STORE
+#define KVPFS_LOG_STORE (0)  // 1: keep the store as an append-only record log instead of two banks
+#endif
+
+// The log ring grows down from the end of the MCU partition, keep it clear of the image.
+#ifndef KVPFS_LOG_SECTORS
+#define KVPFS_LOG_SECTORS (4)  // 4 KB sectors in the log ring, at least the two banks
+#endif
+#ifndef KVPFS_LOG_BASE_ADDR
+#define KVPFS_LOG_BASE_ADDR \
+  (MCU_BASE_ADDR + MCU_PART_SIZE - KVPFS_LOG_SECTORS * SFLASH_4K_ERASE_SECTOR_SIZE)
+#endif
+
+#ifndef KVPFS_LOG_INLINE_MAX
+#define KVPFS_LOG_INLINE_MAX (64)  // longer values stay in flash and are read on demand
+#endif
+
+// 1: program and erase through the flash service task, add middleware/flashsvc to the build
+#ifndef KVPFS_FLASH_SVC
+#define KVPFS_FLASH_SVC (0)
+#endif
+
+#define KEYDIR_SLOTS (256)                    // key directory size, power of 2
+#define KEYDIR_MAX_LOAD (KEYDIR_SLOTS * 3 / 4)  // entries plus deleted slots before a rebuild
+
 #endif
\ No newline at end of file
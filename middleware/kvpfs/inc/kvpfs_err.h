@@ -8,4 +8,9 @@
 #define KVPFS_OUT_OF_MEM (1003)             /*!< Fail to allocate memory */
 #define KVPFS_FLASH_SPACE_NOT_ENOUGH (1004) /*!< Can't save data to flash due to out of space */
 #define KVPFS_UNINITIALIZED (1005)          /*!< Calling functions with initialization */
+#define KVPFS_FLASH_ACCESS_FAIL (1006)      /*!< Fail to read a value kept in flash */
+#define KVPFS_TYPE_MISMATCH (1007)          /*!< The value is not of the requested type */
+#define KVPFS_BUFFER_TOO_SMALL (1008)       /*!< The value doesn't fit in the caller buffer */
+#define KVPFS_VALUE_TOO_LARGE (1009)        /*!< The value is longer than the store takes */
+#define KVPFS_RESERVE_VALUE (1010)          /*!< The value starts with a char the store reserves */
 #endif
\ No newline at end of file
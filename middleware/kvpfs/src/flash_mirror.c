@@ -25,7 +25,11 @@
 #include "alt_osal.h"
 #include "flash_mirror.h"
 #include "kvpfs_config.h"
+#include "kvpfs_log.h"
 #include "checksum.h"
+#if (KVPFS_FLASH_SVC == 1)
+#include "flash_svc.h"
+#endif
 
 #define ENV_MAGIC MAGIC_KEYNAME "=" MAGIC_VALUE
 
@@ -33,6 +37,26 @@ static char flash_mirror[ENV_SIZE] __attribute__((section("GPMdata")));
 static struct flash_mirror_info flm_info __attribute__((section("GPMdata")));
 static alt_osal_mutex_handle mirror_data_mtx = NULL;
 
+/*
+ * Key directory: open-addressing hash table of key hash -> offset of "key=value" in flash_mirror.
+ * It is rebuilt from the mirror whenever the mirror is replaced as a whole (load, compact, clear,
+ * stateful boot) or fails a check, and updated on every append and delete. find_value_mirror falls
+ * back to the linear scan whenever the directory is not usable.
+ */
+#define KEYDIR_EMPTY (0)
+#define KEYDIR_DELETED (0xFFFF)
+
+struct keydir_slot {
+  uint16_t pos;  // offset in flash_mirror plus 1, or KEYDIR_EMPTY/KEYDIR_DELETED
+  uint16_t tag;  // upper half of the key hash
+};
+
+static struct keydir_slot keydir[KEYDIR_SLOTS];
+static uint32_t keydir_entries;
+static uint32_t keydir_deleted;
+static uint8_t keydir_valid;  // 0: rebuild before the next lookup
+static uint8_t keydir_full;   // more keys than the table takes, scan until the mirror is rebuilt
+
 #define LOCK() alt_osal_assert(alt_osal_lock_mutex(&mirror_data_mtx, ALT_OSAL_TIMEO_FEVR) == 0);
 
 #define UNLOCK() alt_osal_assert(alt_osal_unlock_mutex(&mirror_data_mtx) == 0);
@@ -72,6 +96,127 @@ static uint32_t get_key_len(char *str) {
   return key_len;
 }
 
+static uint32_t keydir_hash(const char *key, uint32_t *key_len) {
+  uint32_t hash = 2166136261UL;  // FNV-1a
+  uint32_t len = 0;
+
+  while (key[len] != '\0' && key[len] != '=') {
+    hash ^= (uint8_t)key[len++];
+    hash *= 16777619UL;
+  }
+  *key_len = len;
+  return hash;
+}
+
+static void keydir_clear(void) {
+  memset(keydir, 0, sizeof(keydir));
+  keydir_entries = 0;
+  keydir_deleted = 0;
+}
+
+static int32_t keydir_put(uint32_t offset) {
+  uint32_t key_len;
+  uint32_t hash = keydir_hash(flash_mirror + offset, &key_len);
+  uint32_t idx = hash & (KEYDIR_SLOTS - 1);
+
+  if (keydir_entries + keydir_deleted >= KEYDIR_MAX_LOAD) return -1;
+
+  while (keydir[idx].pos != KEYDIR_EMPTY && keydir[idx].pos != KEYDIR_DELETED)
+    idx = (idx + 1) & (KEYDIR_SLOTS - 1);
+
+  if (keydir[idx].pos == KEYDIR_DELETED) keydir_deleted--;
+  keydir[idx].pos = (uint16_t)(offset + 1);
+  keydir[idx].tag = (uint16_t)(hash >> 16);
+  keydir_entries++;
+  return 0;
+}
+
+static void keydir_rebuild(void) {
+  char *str = flash_mirror;
+
+  keydir_clear();
+  keydir_valid = 1;
+  keydir_full = 0;
+  while ((uint32_t)(str - flash_mirror) < flm_info.env_size) {
+    if (*str == '\0')
+      str++;
+    else if (*str != (char)0xFF) {
+      if (keydir_put(str - flash_mirror)) {
+        keydir_valid = 0;
+        keydir_full = 1;
+        return;
+      }
+      str += strlen(str) + 1;
+    } else
+      break;
+  }
+}
+
+static void keydir_add(uint32_t offset) {
+  if (!keydir_valid) return;
+  if (keydir_put(offset)) keydir_rebuild();  // drops the deleted slots
+}
+
+static void keydir_remove(uint32_t offset) {
+  uint32_t key_len;
+  uint32_t idx = keydir_hash(flash_mirror + offset, &key_len) & (KEYDIR_SLOTS - 1);
+
+  if (!keydir_valid) return;
+
+  while (keydir[idx].pos != KEYDIR_EMPTY) {
+    if (keydir[idx].pos == offset + 1) {
+      keydir[idx].pos = KEYDIR_DELETED;
+      keydir_entries--;
+      keydir_deleted++;
+      return;
+    }
+    idx = (idx + 1) & (KEYDIR_SLOTS - 1);
+  }
+  keydir_valid = 0;  // the directory missed this data
+}
+
+/**
+ * @brief look up the key directory
+ *
+ * @return 1 found, 0 not found, -1 the directory can't be trusted
+ */
+static int32_t keydir_find(const char *search_key, char **found) {
+  uint32_t key_len, search_len;
+  uint32_t hash = keydir_hash(search_key, &search_len);
+  uint32_t idx = hash & (KEYDIR_SLOTS - 1);
+  uint32_t probes;
+  char *str;
+
+  if (search_key[search_len] != '\0') return 0;  // a key never contains '='
+
+  for (probes = 0; probes < KEYDIR_SLOTS && keydir[idx].pos != KEYDIR_EMPTY; probes++) {
+    if (keydir[idx].pos != KEYDIR_DELETED && keydir[idx].tag == (uint16_t)(hash >> 16)) {
+      // the entry has to be the start of live data in the used area
+      if (keydir[idx].pos > flm_info.used_byte) return -1;
+      str = flash_mirror + keydir[idx].pos - 1;
+      if ((str != flash_mirror && str[-1] != '\0') || *str == '\0' || *str == (char)0xFF)
+        return -1;
+
+      if (keydir_hash(str, &key_len) == hash && key_len == search_len && str[key_len] == '=' &&
+          strncmp(str, search_key, key_len) == 0) {
+        *found = str;
+        return 1;
+      }
+    }
+    idx = (idx + 1) & (KEYDIR_SLOTS - 1);
+  }
+  return (probes < KEYDIR_SLOTS) ? 0 : -1;
+}
+
+void print_keydir_info(void) {
+  LOCK();
+  printf("key directory\n\t");
+  printf("%s, entries:%ld, deleted:%ld, slots:%d\n",
+         keydir_full ? "full" : (keydir_valid ? "valid" : "stale"), keydir_entries, keydir_deleted,
+         KEYDIR_SLOTS);
+  UNLOCK();
+}
+
 static uint32_t validate_magic() { return strncmp(flash_mirror, ENV_MAGIC, ENV_MIGIC_LEN); }
 
 static int32_t load_flash_mirror_info(void) {
@@ -106,6 +251,7 @@ static int32_t validate_env(env_bank select_bank) {
   char *pos = NULL;
   const char *value = NULL;
 
+  keydir_valid = 0;  // mirror content changes under the directory
   if (select_bank == BACKUP)
     memcpy(flash_mirror, flm_info.env_backup, ENV_SIZE);
   else
@@ -136,6 +282,7 @@ static inline int32_t has_room_to_write(uint32_t request_len) {
 
 int32_t compact_flash(void) {
   int32_t dst_idx = 0;
+  int32_t flushed_idx = -1;
   int8_t is_eof = 1;
   uint8_t *mirror = (uint8_t*)flm_info.mirror;
   uint32_t env_size = flm_info.env_size;
@@ -144,6 +291,10 @@ int32_t compact_flash(void) {
   LOCK();
   for (size_t src_idx = 0; src_idx < env_size; src_idx++)
   {
+      if(src_idx == flm_info.flushed_byte)
+      {
+          flushed_idx = dst_idx;  // the log store watermark moves with the data
+      }
       if(mirror[src_idx] == 0xff)
       {
           // reached 0xff means reached last byte
@@ -165,8 +316,10 @@ int32_t compact_flash(void) {
   }
   flm_info.num_of_zero = 0; // this function should eliminate every zero.
   flm_info.used_byte = dst_idx;
+  flm_info.flushed_byte = flushed_idx < 0 ? dst_idx : flushed_idx;
   memset((void *)(mirror+dst_idx), 0xff, env_size-dst_idx);
   flm_info.do_erase = 1;
+  keydir_rebuild();  // every offset moved
   UNLOCK();
   return 0;
 }
@@ -184,6 +337,7 @@ int32_t append_data_mirror(char *str) {
   memcpy(free_pos, str, write_len);
   flm_info.used_byte += write_len;
   flm_info.num_of_data++;
+  keydir_add(free_pos - flash_mirror);
   UNLOCK();
   return 0;
 }
@@ -194,6 +348,7 @@ int32_t delete_value_mirror(const char *searched_key) {
 
   if ((pos = find_value_mirror(searched_key, &value)) != NULL) {
     LOCK();
+    keydir_remove(pos - flash_mirror);
     flm_info.num_of_data--;
     flm_info.num_of_zero += strlen(pos) + 1;  // plus original \0
     memset(pos, '\0', strlen(pos));
@@ -203,6 +358,53 @@ int32_t delete_value_mirror(const char *searched_key) {
   return -1;
 }
 
+/**
+ * @brief replace the value of the data at pos in place, the new value can't be longer
+ *
+ * @param pos start position of the env data
+ * @param value new value
+ * @return 0 on success, -1 if the value doesn't fit
+ */
+int32_t replace_value_mirror(char *pos, const char *value) {
+  char *old_value = strchr(pos, '=');
+  uint32_t old_len, new_len = strlen(value);
+
+  if (old_value == NULL) return -1;
+  old_value++;
+  old_len = strlen(old_value);
+  if (new_len > old_len) return -1;
+
+  LOCK();
+  memcpy(old_value, value, new_len);
+  memset(old_value + new_len, '\0', old_len - new_len);
+  flm_info.num_of_zero += old_len - new_len;
+  UNLOCK();
+  return 0;
+}
+
+uint32_t value_len_mirror(const char *value) {
+#if (KVPFS_LOG_STORE == 1)
+  return kvlog_value_len(value);
+#else
+  return strlen(value);
+#endif
+}
+
+/**
+ * @brief copy part of a value found by find_value_mirror, the value may be left in flash
+ *
+ * @return 0 on success, -1 if the range is out of the value or the read fails
+ */
+int32_t read_value_mirror(const char *value, uint32_t offset, char *dst, uint32_t size) {
+#if (KVPFS_LOG_STORE == 1)
+  return kvlog_read_value(value, offset, dst, size);
+#else
+  if (offset + size > strlen(value)) return -1;
+  memcpy(dst, value + offset, size);
+  return 0;
+#endif
+}
+
 /**
  * @brief return the pointer of occurence
  *
@@ -217,6 +419,23 @@ char *find_value_mirror(const char *search_key, const char **value) {
   char *ret = NULL;
 
   LOCK();
+  if (!keydir_valid && !keydir_full) keydir_rebuild();
+  if (keydir_valid && keydir_entries == flm_info.num_of_data) {
+    switch (keydir_find(search_key, &ret)) {
+      case 1:
+        *value = ret + strlen(search_key) + 1;
+        UNLOCK();
+        return ret;
+      case 0:
+        UNLOCK();
+        return NULL;
+      default:
+        ret = NULL;
+        keydir_valid = 0;  // failed the check, scan this time and rebuild on the next lookup
+        break;
+    }
+  }
+
   while ((uint32_t)(str - flash_mirror) < flm_info.env_size) {
     // printf("str pos %d\n", str - flash_mirror);
     if (*str == '\0')
@@ -246,13 +465,39 @@ void clear_flash_mirror(void) {
   flm_info.num_of_data = 0;
   flm_info.num_of_zero = 0;
   flm_info.used_byte = 0;
+  keydir_clear();
+  keydir_valid = 1;
+  keydir_full = 0;
+  UNLOCK();
+}
+
+/* bytes get_all_data_mirror puts out */
+uint32_t get_all_data_size_mirror(void) {
+  char *str = flash_mirror;
+  uint32_t size = 0;
+  uint32_t key_len;
+
+  LOCK();
+  while ((uint32_t)(str - flash_mirror) < flm_info.env_size) {
+    if (*str == '\0')
+      str++;
+    else if (*str != (char)0xFF) {
+      key_len = get_key_len(str);
+      size += key_len + 1 + value_len_mirror(str + key_len + 1) + 1;
+      str += strlen(str) + 1;
+    } else
+      break;
+  }
   UNLOCK();
+  return size;
 }
 
 uint32_t get_all_data_mirror(char *resp, int del) {
   char *str = flash_mirror;
   uint32_t resp_index = 0;
   uint32_t str_len;
+  uint32_t key_len;
+  uint32_t value_len;
   char delim;
 
   if (del == 1)
@@ -272,8 +517,11 @@ uint32_t get_all_data_mirror(char *resp, int del) {
     else if (*str != (char)0xFF) {
       // printf("%s %s\n", str);
       str_len = strlen(str);
-      strncpy(resp + resp_index, str, str_len);
-      resp_index += str_len;
+      key_len = get_key_len(str) + 1;
+      value_len = value_len_mirror(str + key_len);
+      strncpy(resp + resp_index, str, key_len);
+      read_value_mirror(str + key_len, 0, resp + resp_index + key_len, value_len);
+      resp_index += key_len + value_len;
       resp[resp_index++] = delim;
       str += str_len + 1;
     } else
@@ -307,6 +555,25 @@ int32_t load_default_setting() {
 
 int32_t load_flash_content(void) {
   int32_t backup_ret, primary_ret;
+
+#if (KVPFS_LOG_STORE == 1)
+  // a valid primary bank means the store has not been moved to the log yet
+  if (memcmp(flm_info.env_primary, ENV_MAGIC, ENV_MIGIC_LEN) || validate_env(PRIMARY)) {
+    clear_flash_mirror();
+    append_data_mirror(ENV_MAGIC);
+    switch (kvlog_mount(&flm_info)) {
+      case 0:
+        flm_info.flushed_byte = flm_info.used_byte;
+        return 0;
+      case -1:
+        break;  // no log, fall back to the banks
+      default:
+        printf("Log store can't be read or replayed\n");
+        alt_osal_assert(0);  // never format over a log that is there
+        break;
+    }
+  }
+#endif
   backup_ret = validate_env(BACKUP);
   primary_ret = validate_env(PRIMARY);
 
@@ -330,7 +597,15 @@ int32_t load_flash_content(void) {
     load_default_setting();
   }
   load_flash_mirror_info();
+  keydir_rebuild();
 
+#if (KVPFS_LOG_STORE == 1)
+  delete_value_mirror(CRC_KEYNAME);
+  if (kvlog_format(&flm_info)) {
+    printf("Can't move env to the log store\n");
+    return -1;
+  }
+#endif
   return 0;
 }
 int32_t erase_flash(env_bank erase_bank) {
@@ -349,14 +624,11 @@ int32_t erase_flash(env_bank erase_bank) {
   return 0;
 }
 
-int32_t write_to_flash(void) {
-  uint16_t crc_calc;
+#if (KVPFS_LOG_STORE == 0)
+/* put the mirror with its crc entry to both banks, primary first so one bank is always valid */
+static int32_t write_banks(uint16_t crc_calc) {
   char crc[CRC_LEN];
 
-  delete_value_mirror(CRC_KEYNAME);
-
-  crc_calc = crc_16((unsigned char *)flash_mirror, flm_info.used_byte);
-
   snprintf(crc, CRC_LEN, "%s=%x", CRC_KEYNAME, crc_calc);
 
   append_data_mirror(crc);
@@ -370,6 +642,173 @@ int32_t write_to_flash(void) {
   flm_info.do_erase = 0;
   return 0;
 }
+#endif
+
+int32_t write_to_flash(void) {
+#if (KVPFS_LOG_STORE == 1)
+  return kvlog_save();
+#else
+  delete_value_mirror(CRC_KEYNAME);
+
+  return write_banks(crc_16((unsigned char *)flash_mirror, flm_info.used_byte));
+#endif
+}
+
+/* open-addressing index of the batch keys, a slot holds the op index plus 1 */
+static uint16_t *batch_index(const struct mirror_op *ops, uint32_t num, uint32_t *slots) {
+  uint16_t *index;
+  uint32_t i, idx, key_len;
+
+  for (*slots = 8; *slots < 2 * num; *slots <<= 1)
+    ;
+  index = pvPortMalloc(*slots * sizeof(*index));
+  if (index == NULL) return NULL;
+  memset(index, 0, *slots * sizeof(*index));
+
+  for (i = 0; i < num; i++) {
+    idx = keydir_hash(ops[i].key, &key_len) & (*slots - 1);
+    while (index[idx] && strcmp(ops[index[idx] - 1].key, ops[i].key))
+      idx = (idx + 1) & (*slots - 1);
+    index[idx] = (uint16_t)(i + 1);  // a later op on the same key wins
+  }
+  return index;
+}
+
+/* the op of the batch deciding the key of str ("key" or "key=value"), -1 if none */
+static int32_t batch_find(const uint16_t *index, uint32_t slots, const struct mirror_op *ops,
+                          const char *str) {
+  uint32_t key_len;
+  uint32_t idx = keydir_hash(str, &key_len) & (slots - 1);
+  const char *key;
+
+  while (index[idx]) {
+    key = ops[index[idx] - 1].key;
+    if (strncmp(key, str, key_len) == 0 && key[key_len] == '\0') return index[idx] - 1;
+    idx = (idx + 1) & (slots - 1);
+  }
+  return -1;
+}
+
+static uint16_t batch_crc(uint16_t crc, const char *data, uint32_t len) {
+  while (len--) crc = update_crc_16(crc, (unsigned char)*data++);
+  return crc;
+}
+
+/**
+ * @brief apply a batch of changes to the mirror in one pass and optionally write it to flash once
+ *
+ * The mirror is walked once: entries the batch replaces or deletes are dropped, then the new
+ * entries are appended, and the crc of the banks is computed on the way. Entries are dropped in
+ * place like delete_value_mirror() does while the result fits behind the used area, so the banks
+ * can be programmed without an erase, otherwise the walk compacts. Nothing changes when the batch
+ * doesn't fit.
+ *
+ * @param ops changes, the last op on a key wins
+ * @param num number of ops, up to 65535
+ * @param to_flash 1 to write the mirror to flash after applying
+ * @return 0 on success, MIRROR_NO_SPACE, MIRROR_NO_MEM or MIRROR_FLASH_FAIL
+ */
+int32_t commit_batch_mirror(const struct mirror_op *ops, uint32_t num, int32_t to_flash) {
+  uint16_t *index;
+  uint16_t crc = CRC_START_16;
+  uint32_t slots, i, len, key_len, removed = 0, added = 0, live = 0;
+  int32_t compact, flushed = -1;
+  char *src = flash_mirror;
+  char *dst = flash_mirror;
+  char *end;
+
+  if (num > 0xFFFF) return MIRROR_NO_MEM;
+  index = batch_index(ops, num, &slots);
+  if (index == NULL) return MIRROR_NO_MEM;
+
+  for (i = 0; i < num; i++) {
+    if (ops[i].value && batch_find(index, slots, ops, ops[i].key) == (int32_t)i)
+      added += strlen(ops[i].key) + 1 + strlen(ops[i].value) + 1;
+  }
+
+  LOCK();
+  end = flash_mirror + flm_info.used_byte;
+  while (src < end) {
+    if (*src == '\0') {
+      src++;
+      continue;
+    }
+    len = strlen(src) + 1;
+    if (strncmp(src, CRC_KEYNAME "=", sizeof(CRC_KEYNAME)) == 0 ||
+        batch_find(index, slots, ops, src) >= 0)
+      removed += len;
+    src += len;
+  }
+
+  compact = (flm_info.used_byte + added + CRC_LEN > flm_info.env_size);
+  if (compact &&
+      flm_info.used_byte - flm_info.num_of_zero - removed + added + CRC_LEN > flm_info.env_size) {
+    UNLOCK();
+    vPortFree(index);
+    return MIRROR_NO_SPACE;
+  }
+
+  src = flash_mirror;
+  while (src < end) {
+    if (*src == '\0') {
+      if (!compact) {
+        crc = update_crc_16(crc, 0);
+        dst++;
+      }
+      src++;
+      continue;
+    }
+    len = strlen(src) + 1;
+    if (compact && flushed < 0 && (uint32_t)(src - flash_mirror) >= flm_info.flushed_byte)
+      flushed = dst - flash_mirror;  // the log store watermark moves with the data
+    if (strncmp(src, CRC_KEYNAME "=", sizeof(CRC_KEYNAME)) == 0 ||
+        batch_find(index, slots, ops, src) >= 0) {
+      if (!compact) {
+        memset(dst, '\0', len);
+        crc = batch_crc(crc, dst, len);
+        dst += len;
+      }
+    } else {
+      if (compact) memmove(dst, src, len);
+      crc = batch_crc(crc, dst, len);
+      dst += len;
+      live++;
+    }
+    src += len;
+  }
+  if (compact) {
+    flm_info.flushed_byte = flushed < 0 ? (uint32_t)(dst - flash_mirror) : (uint32_t)flushed;
+    flm_info.num_of_zero = 0;
+    flm_info.do_erase = 1;
+  } else
+    flm_info.num_of_zero += removed;
+
+  for (i = 0; i < num; i++) {
+    if (!ops[i].value || batch_find(index, slots, ops, ops[i].key) != (int32_t)i) continue;
+    key_len = strlen(ops[i].key);
+    len = strlen(ops[i].value) + 1;
+    memcpy(dst, ops[i].key, key_len);
+    dst[key_len] = '=';
+    memcpy(dst + key_len + 1, ops[i].value, len);
+    crc = batch_crc(crc, dst, key_len + 1 + len);
+    dst += key_len + 1 + len;
+    live++;
+  }
+  if (compact) memset(dst, 0xFF, flash_mirror + flm_info.env_size - dst);
+  flm_info.used_byte = dst - flash_mirror;
+  flm_info.num_of_data = live;
+  keydir_rebuild();
+  UNLOCK();
+  vPortFree(index);
+
+  if (!to_flash) return 0;
+#if (KVPFS_LOG_STORE == 1)
+  (void)crc;
+  return kvlog_save() ? MIRROR_FLASH_FAIL : 0;
+#else
+  return write_banks(crc) ? MIRROR_FLASH_FAIL : 0;
+#endif
+}
 
 static void determin_kvpfs_secter(struct flash_mirror_info *mirro_info) {
   int8_t *backup_addr;
@@ -396,8 +835,18 @@ void init_flash_mirror(struct flash_mirror_info **mirror_info) {
   flm_info.mirror = flash_mirror;
   flm_info.env_size = ENV_SIZE;
   determin_kvpfs_secter(&flm_info);
+#if (KVPFS_FLASH_SVC == 1)
+  if (flash_svc_init() == 0) {
+    flm_info.flash_write = flash_svc_write;
+    flm_info.flash_erase = flash_svc_erase;
+    flm_info.flash_read = flash_svc_read;
+    *mirror_info = &flm_info;
+    return;
+  }
+#endif
   flm_info.flash_write = DRV_FLASH_Write;
   flm_info.flash_erase = DRV_FLASH_Erase_Sector;
+  flm_info.flash_read = DRV_FLASH_Read;
   *mirror_info = &flm_info;
 }
 
@@ -406,4 +855,7 @@ void init_flash_mirror_from_stateful(void) {
   mirror_data_mtx = xSemaphoreCreateMutex();
   if (mirror_data_mtx == NULL) alt_osal_assert(0);
   DRV_FLASH_Initialize();
+  LOCK();
+  keydir_rebuild();  // the mirror was retained in GPM, the directory was not
+  UNLOCK();
 }
@@ -26,6 +26,7 @@
 
 typedef Flash_Err_Code (*flash_write_fp)(void *, void *, size_t, int);
 typedef Flash_Err_Code (*flash_erase_fp)(void *, int, int);
+typedef Flash_Err_Code (*flash_read_fp)(void *, void *, size_t);
 
 struct flash_mirror_info {
   uint32_t env_size;
@@ -35,15 +36,27 @@ struct flash_mirror_info {
   int8_t *env_primary;
   int8_t *env_backup;
   uint8_t do_erase;
-  char *mirror;  // flash_mirror
+  uint32_t flushed_byte;  // data from here on is not in the log store yet
+  char *mirror;           // flash_mirror
   flash_write_fp flash_write;
   flash_erase_fp flash_erase;
+  flash_read_fp flash_read;
 };
 #define DEL_FF (0)
 #define DEL_LF (1)
 
 typedef enum { PRIMARY = 0, BACKUP } env_bank;
 
+/* one change of a batch, a NULL value deletes the key */
+struct mirror_op {
+  const char *key;
+  const char *value;
+};
+
+#define MIRROR_NO_SPACE (-1)
+#define MIRROR_NO_MEM (-2)
+#define MIRROR_FLASH_FAIL (-3)
+
 void init_flash_mirror(struct flash_mirror_info **mirror_info);
 void init_flash_mirror_from_stateful(void);
 int32_t load_flash_content();
@@ -56,4 +69,10 @@ int32_t erase_flash(env_bank erase_bank);
 int32_t append_data_mirror(char *str);
 int32_t write_to_flash(void);
 int32_t compact_flash(void);
+int32_t replace_value_mirror(char *pos, const char *value);
+uint32_t value_len_mirror(const char *value);
+int32_t read_value_mirror(const char *value, uint32_t offset, char *dst, uint32_t size);
+uint32_t get_all_data_size_mirror(void);
+void print_keydir_info(void);
+int32_t commit_batch_mirror(const struct mirror_op *ops, uint32_t num, int32_t to_flash);
 #endif
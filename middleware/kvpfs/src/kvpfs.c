@@ -27,13 +27,46 @@
 #include "checksum.h"
 #include "flash_mirror.h"
 #include "list_data.h"
+#include "kvpfs_log.h"
 #include "kvpfs_err.h"
+#include "kvpfs_api.h"
 #include "alt_osal.h"
-typedef enum {
-  flash_space_enough = 0,
-  flash_need_compact = 1,
-  flash_space_not_enough = 2,
-} flash_space_status_t;
+
+/*
+ * Typed values are kept as strings like any other value: a tag char, then
+ * u32:  8 hex digits
+ * i64:  16 hex digits, two's complement
+ * blob: 4 hex digits of length, then the data with \x00, \xff and the escape char escaped
+ */
+#define TAG_U32 ('\x01')
+#define TAG_I64 ('\x02')
+#define TAG_BLOB ('\x03')
+#define BLOB_ESC ('\x10')
+#define BLOB_HDR_LEN (1 + 4)
+#define BLOB_MAX_LEN (0xFFFF)
+#define READ_CHUNK (32)
+
+struct kvpfs_value {
+  const char *str;
+  uint8_t in_mirror;  // the mirror may keep the value in flash
+};
+
+/* a transaction buffers its ops back to back: TXN_SET key '\0' value '\0' or TXN_DEL key '\0' */
+#define TXN_SET ('S')
+#define TXN_DEL ('D')
+#define TXN_BUF_INIT (256)
+
+struct kvpfs_txn {
+  char *buf;
+  uint32_t used;
+  uint32_t size;
+  uint32_t num;
+};
+
+struct batch_ops {
+  struct mirror_op *ops;
+  uint32_t num;
+};
 
 struct KVPFS {
   uint8_t initialized;
@@ -43,6 +76,16 @@ struct KVPFS {
 
 static alt_osal_mutex_handle kvpfs_mtx = NULL;
 
+/* a value the mirror would take for one of its flash references */
+static int32_t is_reserved_value(const char *value) {
+#if (KVPFS_LOG_STORE == 1)
+  return value && value[0] == KVLOG_REF_MARK;
+#else
+  (void)value;
+  return 0;
+#endif
+}
+
 #define LOCK() alt_osal_assert(alt_osal_lock_mutex(&kvpfs_mtx, ALT_OSAL_TIMEO_FEVR) == 0);
 
 #define UNLOCK() alt_osal_assert(alt_osal_unlock_mutex(&kvpfs_mtx) == 0);
@@ -57,74 +100,71 @@ void kvpfs_fss(void) {
   printf("list data\n\t");
   printf("used: %ld, num data:%ld\n", kvpfs_info.ldt_info->used_byte,
          kvpfs_info.ldt_info->num_of_ele);
+  print_keydir_info();
+#if (KVPFS_LOG_STORE == 1)
+  kvlog_print_info();
+#endif
   // print_content();
 }
-static flash_space_status_t check_flash_space(void) {
-  uint32_t expected_flash_size =
-      kvpfs_info.flm_info->used_byte + kvpfs_info.ldt_info->used_byte + CRC_LEN;
+static void add_list_op(const char *key, const char *value, void *arg) {
+  struct batch_ops *batch = arg;
 
-  if (expected_flash_size < kvpfs_info.flm_info->env_size)
-    return flash_space_enough;  // OK
-  else if (expected_flash_size - kvpfs_info.flm_info->num_of_zero <= kvpfs_info.flm_info->env_size)
-    return flash_need_compact;  // space is enough if compact flash
-  else
-    return flash_space_not_enough;  // space is not enough even if compact flash
+  batch->ops[batch->num].key = key;
+  batch->ops[batch->num++].value = value;
 }
 
-static int32_t save_list_to_flash(void) {
-  char *pch = NULL;
-  char *savep = NULL;
-  char *list_data = NULL;
-  char *eqp = NULL;  // equal pointer
-
-  if (kvpfs_info.ldt_info->num_of_ele == 0) return KVPFS_OK;
-
-  list_data = pvPortMalloc(kvpfs_info.ldt_info->used_byte + 1);
-
-  if (list_data == NULL) return -KVPFS_OUT_OF_MEM;
-
-  memset(list_data + kvpfs_info.ldt_info->used_byte, '\0', 1);
-  get_all_data_list(list_data, DEL_FF);
-
-  pch = strtok_r(list_data, "\xff", &savep);
-  while (pch != NULL) {
-    if (append_data_mirror(pch)) {
-      alt_osal_assert(0);  // had checked flash space. this suppose not to happen
-    }
+/**
+ * @brief put the staged list and the ops of txn to the mirror in one batch
+ *
+ * The kvpfs lock is held, so readers see either none or all of the batch.
+ */
+static int32_t commit_ops(const struct kvpfs_txn *txn, int32_t to_flash) {
+  struct batch_ops batch;
+  const char *pos, *key;
+  uint32_t num = kvpfs_info.ldt_info->num_of_ele + (txn ? txn->num : 0);
+  int32_t ret;
 
-    eqp = strchr(pch, '=');
-    if (eqp) {
-      *eqp = '\0';
-      delete_value_list(pch);
+  if (num == 0 && !to_flash) return KVPFS_OK;
+
+  batch.ops = pvPortMalloc((num ? num : 1) * sizeof(struct mirror_op));
+  if (batch.ops == NULL) return -KVPFS_OUT_OF_MEM;
+  batch.num = 0;
+  walk_data_list(add_list_op, &batch);
+  for (pos = txn ? txn->buf : NULL; txn && pos < txn->buf + txn->used;) {
+    key = pos + 1;
+    batch.ops[batch.num].key = key;
+    batch.ops[batch.num].value = NULL;
+    pos = key + strlen(key) + 1;
+    if (key[-1] == TXN_SET) {
+      batch.ops[batch.num].value = pos;
+      pos += strlen(pos) + 1;
     }
-    pch = strtok_r(NULL, "\xff", &savep);
+    batch.num++;
   }
 
-  vPortFree(list_data);
-  return KVPFS_OK;
-}
-
-static int32_t flush_list_to_mirror() {
-  flash_space_status_t flash_space;
+  ret = commit_batch_mirror(batch.ops, batch.num, to_flash);
+  vPortFree(batch.ops);
 
-  flash_space = check_flash_space();
-
-  if (flash_space == flash_need_compact) {
-    if (compact_flash()) {
+  switch (ret) {
+    case 0:
+      clear_data_list();  // the list is in the mirror now
+      return KVPFS_OK;
+    case MIRROR_NO_MEM:
       return -KVPFS_OUT_OF_MEM;
-    }
-  } else if (flash_space == flash_space_not_enough) {
-    return -KVPFS_FLASH_SPACE_NOT_ENOUGH;
+    case MIRROR_FLASH_FAIL:
+      clear_data_list();
+      return -KVPFS_FLASH_SPACE_NOT_ENOUGH;
+    default:
+      return -KVPFS_FLASH_SPACE_NOT_ENOUGH;
   }
-
-  return save_list_to_flash();
 }
+
 int32_t save_env_to_gpm(void) {
   int32_t ret;
   if (kvpfs_info.initialized == 0) return -KVPFS_UNINITIALIZED;
 
   LOCK();
-  ret = flush_list_to_mirror();
+  ret = commit_ops(NULL, 0);
   UNLOCK();
   return ret;
 }
@@ -134,14 +174,76 @@ int32_t save_env(void) {
 
   if (kvpfs_info.initialized == 0) return -KVPFS_UNINITIALIZED;
   LOCK();
-  ret = flush_list_to_mirror();
-  if (ret) goto fail;
-  write_to_flash();
-fail:
+  ret = commit_ops(NULL, 1);
+  UNLOCK();
+  return ret;
+}
+
+int32_t kvpfs_txn_begin(kvpfs_txn_t **txn) {
+  if (kvpfs_info.initialized == 0) return -KVPFS_UNINITIALIZED;
+  if (!txn) return -KVPFS_NULL_POINTER;
+
+  *txn = pvPortMalloc(sizeof(struct kvpfs_txn));
+  if (*txn == NULL) return -KVPFS_OUT_OF_MEM;
+  memset(*txn, 0, sizeof(struct kvpfs_txn));
+  return KVPFS_OK;
+}
+
+int32_t kvpfs_txn_set(kvpfs_txn_t *txn, const char *key, const char *value) {
+  uint32_t key_len, need;
+  char *buf;
+
+  if (!txn || !key) return -KVPFS_NULL_POINTER;
+  if (strcmp(key, CRC_KEYNAME) == 0) return -KVPFS_RESERVE_KEYWD;
+  if (is_reserved_value(value)) return -KVPFS_RESERVE_VALUE;
+  if (txn->num >= 0xFFFF) return -KVPFS_OUT_OF_MEM;
+
+  key_len = strlen(key) + 1;
+  need = 1 + key_len + (value ? strlen(value) + 1 : 0);
+  if (txn->used + need > txn->size) {
+    // no realloc with the RTOS heap
+    txn->size = txn->size ? txn->size : TXN_BUF_INIT;
+    while (txn->size < txn->used + need) txn->size <<= 1;
+    buf = pvPortMalloc(txn->size);
+    if (buf == NULL) return -KVPFS_OUT_OF_MEM;
+    if (txn->buf) {
+      memcpy(buf, txn->buf, txn->used);
+      vPortFree(txn->buf);
+    }
+    txn->buf = buf;
+  }
+
+  buf = txn->buf + txn->used;
+  *buf++ = value ? TXN_SET : TXN_DEL;
+  memcpy(buf, key, key_len);
+  if (value) memcpy(buf + key_len, value, need - 1 - key_len);
+  txn->used += need;
+  txn->num++;
+  return KVPFS_OK;
+}
+
+int32_t kvpfs_txn_commit(kvpfs_txn_t *txn) {
+  int32_t ret;
+
+  if (!txn) return -KVPFS_NULL_POINTER;
+  if (kvpfs_info.initialized == 0) {
+    kvpfs_txn_abort(txn);
+    return -KVPFS_UNINITIALIZED;
+  }
+
+  LOCK();
+  ret = commit_ops(txn, 1);
   UNLOCK();
+  kvpfs_txn_abort(txn);
   return ret;
 }
 
+void kvpfs_txn_abort(kvpfs_txn_t *txn) {
+  if (!txn) return;
+  if (txn->buf) vPortFree(txn->buf);
+  vPortFree(txn);
+}
+
 int32_t get_env(const char *key, char **value) {
   if (kvpfs_info.initialized == 0) return -KVPFS_UNINITIALIZED;
 
@@ -155,10 +257,13 @@ int32_t get_env(const char *key, char **value) {
   LOCK();
   if (!key) {
     // list all data
-    chars_in_mirror = kvpfs_info.flm_info->used_byte - kvpfs_info.flm_info->num_of_zero;
+    chars_in_mirror = get_all_data_size_mirror();
     str_size = chars_in_mirror + kvpfs_info.ldt_info->used_byte + 1;  // preserve for \0
     env_data = *value = pvPortMalloc(str_size);
-    if (env_data == NULL) return -KVPFS_OUT_OF_MEM;
+    if (env_data == NULL) {
+      ret = -KVPFS_OUT_OF_MEM;
+      goto exit;
+    }
 
     get_all_data_mirror(env_data, DEL_LF);
 
@@ -172,9 +277,19 @@ int32_t get_env(const char *key, char **value) {
     // search flash mirror
     if (find_value_mirror(key, &ret_value) != NULL) {
       // strdup will fail on IAR build because malloc used different memory space than pvPortMalloc
-      str_size = strlen(ret_value) + 1;
-      *value = pvPortMalloc(str_size);
-      memcpy(*value, ret_value, str_size);
+      str_size = value_len_mirror(ret_value);
+      *value = pvPortMalloc(str_size + 1);
+      if (*value == NULL) {
+        ret = -KVPFS_OUT_OF_MEM;
+        goto exit;
+      }
+      if (read_value_mirror(ret_value, 0, *value, str_size)) {
+        vPortFree(*value);
+        *value = NULL;
+        ret = -KVPFS_FLASH_ACCESS_FAIL;
+        goto exit;
+      }
+      (*value)[str_size] = '\0';
       ret = KVPFS_OK;
       goto exit;
     }
@@ -183,6 +298,10 @@ int32_t get_env(const char *key, char **value) {
     if (find_value_list(key, &ret_value) == 0) {
       str_size = strlen(ret_value) + 1;
       *value = pvPortMalloc(str_size);
+      if (*value == NULL) {
+        ret = -KVPFS_OUT_OF_MEM;
+        goto exit;
+      }
       memcpy(*value, ret_value, str_size);
       ret = KVPFS_OK;
       goto exit;
@@ -196,6 +315,195 @@ exit:
   return ret;
 }
 
+/* the kvpfs lock is held */
+static int32_t lookup_value(const char *key, struct kvpfs_value *val) {
+  if (find_value_mirror(key, &val->str) != NULL) {
+    val->in_mirror = 1;
+    return KVPFS_OK;
+  }
+  if (find_value_list(key, &val->str) == 0) {
+    val->in_mirror = 0;
+    return KVPFS_OK;
+  }
+  return -KVPFS_KEY_NOT_FOUND;
+}
+
+static uint32_t value_len(const struct kvpfs_value *val) {
+  return val->in_mirror ? value_len_mirror(val->str) : strlen(val->str);
+}
+
+static int32_t read_value(const struct kvpfs_value *val, uint32_t offset, char *dst, uint32_t size) {
+  if (val->in_mirror)
+    return read_value_mirror(val->str, offset, dst, size) ? -KVPFS_FLASH_ACCESS_FAIL : KVPFS_OK;
+  memcpy(dst, val->str + offset, size);
+  return KVPFS_OK;
+}
+
+static void to_hex(char *hex, uint64_t value, uint32_t digits) {
+  while (digits--) {
+    hex[digits] = "0123456789abcdef"[value & 0xF];
+    value >>= 4;
+  }
+}
+
+static int32_t from_hex(const char *hex, uint32_t digits, uint64_t *value) {
+  char c;
+
+  *value = 0;
+  while (digits--) {
+    c = *hex++;
+    if (c >= '0' && c <= '9')
+      c -= '0';
+    else if (c >= 'a' && c <= 'f')
+      c -= 'a' - 10;
+    else
+      return -1;
+    *value = (*value << 4) | (uint8_t)c;
+  }
+  return 0;
+}
+
+static int32_t get_int(const struct kvpfs_value *val, kvpfs_type_t type, void *buf, uint32_t size) {
+  char str[24];  // the longest decimal int64_t and '\0'
+  char *endp;
+  uint32_t len = value_len(val);
+  uint32_t digits = (type == KVPFS_TYPE_U32) ? 8 : 16;
+  uint64_t value;
+  int32_t ret;
+
+  if (size < ((type == KVPFS_TYPE_U32) ? sizeof(uint32_t) : sizeof(int64_t)))
+    return -KVPFS_BUFFER_TOO_SMALL;
+  if (len == 0 || len >= sizeof(str)) return -KVPFS_TYPE_MISMATCH;
+  if ((ret = read_value(val, 0, str, len))) return ret;
+  str[len] = '\0';
+
+  if (str[0] == ((type == KVPFS_TYPE_U32) ? TAG_U32 : TAG_I64)) {
+    if (len != 1 + digits || from_hex(str + 1, digits, &value)) return -KVPFS_TYPE_MISMATCH;
+  } else {
+    // decimal text stored by set_env
+    value = (type == KVPFS_TYPE_U32) ? strtoul(str, &endp, 10) : (uint64_t)strtoll(str, &endp, 10);
+    if (*endp != '\0') return -KVPFS_TYPE_MISMATCH;
+  }
+
+  if (type == KVPFS_TYPE_U32)
+    *(uint32_t *)buf = (uint32_t)value;
+  else
+    *(int64_t *)buf = (int64_t)value;
+  return KVPFS_OK;
+}
+
+static int32_t get_blob(const struct kvpfs_value *val, uint8_t *buf, uint32_t size, uint32_t *len) {
+  char chunk[READ_CHUNK];
+  uint32_t enc_len = value_len(val);
+  uint32_t pos, n, i, out = 0;
+  uint64_t blob_len;
+  uint8_t esc = 0;
+  int32_t ret;
+
+  if (enc_len < BLOB_HDR_LEN) return -KVPFS_TYPE_MISMATCH;
+  if ((ret = read_value(val, 0, chunk, BLOB_HDR_LEN))) return ret;
+  if (chunk[0] != TAG_BLOB || from_hex(chunk + 1, 4, &blob_len)) return -KVPFS_TYPE_MISMATCH;
+  *len = (uint32_t)blob_len;
+  if (size < *len) return -KVPFS_BUFFER_TOO_SMALL;
+
+  for (pos = BLOB_HDR_LEN; pos < enc_len; pos += n) {
+    n = enc_len - pos > READ_CHUNK ? READ_CHUNK : enc_len - pos;
+    if ((ret = read_value(val, pos, chunk, n))) return ret;
+    for (i = 0; i < n; i++) {
+      if (!esc && chunk[i] == BLOB_ESC) {
+        esc = 1;
+        continue;
+      }
+      if (out == *len) return -KVPFS_TYPE_MISMATCH;
+      buf[out++] = esc ? (chunk[i] == '0' ? 0x00 : (chunk[i] == '1' ? 0xFF : BLOB_ESC)) : chunk[i];
+      esc = 0;
+    }
+  }
+  return (out == *len && !esc) ? KVPFS_OK : -KVPFS_TYPE_MISMATCH;
+}
+
+/* the kvpfs lock is held */
+static int32_t get_typed(const char *key, kvpfs_type_t type, void *buf, uint32_t size,
+                         uint32_t *len) {
+  struct kvpfs_value val;
+  int32_t ret;
+
+  if (!key || !buf) return -KVPFS_NULL_POINTER;
+  if ((ret = lookup_value(key, &val))) return ret;
+
+  switch (type) {
+    case KVPFS_TYPE_STR:
+      *len = value_len(&val);
+      if (size <= *len) return -KVPFS_BUFFER_TOO_SMALL;
+      if ((ret = read_value(&val, 0, buf, *len))) return ret;
+      ((char *)buf)[*len] = '\0';
+      return KVPFS_OK;
+    case KVPFS_TYPE_U32:
+    case KVPFS_TYPE_I64:
+      return get_int(&val, type, buf, size);
+    case KVPFS_TYPE_BLOB:
+      return get_blob(&val, buf, size, len);
+    default:
+      return -KVPFS_TYPE_MISMATCH;
+  }
+}
+
+static int32_t get_one(const char *key, kvpfs_type_t type, void *buf, uint32_t size,
+                       uint32_t *len) {
+  int32_t ret;
+
+  if (kvpfs_info.initialized == 0) return -KVPFS_UNINITIALIZED;
+
+  LOCK();
+  ret = get_typed(key, type, buf, size, len);
+  UNLOCK();
+  return ret;
+}
+
+int32_t get_env_buf(const char *key, char *buf, uint32_t size) {
+  uint32_t len;
+
+  return get_one(key, KVPFS_TYPE_STR, buf, size, &len);
+}
+
+int32_t get_env_u32(const char *key, uint32_t *value) {
+  uint32_t len;
+
+  return get_one(key, KVPFS_TYPE_U32, value, sizeof(*value), &len);
+}
+
+int32_t get_env_i64(const char *key, int64_t *value) {
+  uint32_t len;
+
+  return get_one(key, KVPFS_TYPE_I64, value, sizeof(*value), &len);
+}
+
+int32_t get_env_blob(const char *key, void *buf, uint32_t size, uint32_t *len) {
+  uint32_t blob_len = 0;
+  int32_t ret = get_one(key, KVPFS_TYPE_BLOB, buf, size, &blob_len);
+
+  if (len) *len = blob_len;
+  return ret;
+}
+
+int32_t get_env_batch(kvpfs_get_item_t *items, uint32_t num) {
+  uint32_t i;
+  int32_t found = 0;
+
+  if (kvpfs_info.initialized == 0) return -KVPFS_UNINITIALIZED;
+  if (!items) return -KVPFS_NULL_POINTER;
+
+  LOCK();
+  for (i = 0; i < num; i++) {
+    items[i].len = 0;
+    items[i].status = get_typed(items[i].key, items[i].type, items[i].buf, items[i].size,
+                                &items[i].len);
+    if (items[i].status == KVPFS_OK) found++;
+  }
+  UNLOCK();
+  return found;
+}
+
 int32_t set_env(const char *key, const char *value) {
   int32_t ret = 0;
 
@@ -203,6 +511,7 @@ int32_t set_env(const char *key, const char *value) {
 
   if (!key) return -KVPFS_NULL_POINTER;
   if (strcmp(key, CRC_KEYNAME) == 0) return -KVPFS_RESERVE_KEYWD;  // CRC_KEYNAME is a reserved word
+  if (is_reserved_value(value)) return -KVPFS_RESERVE_VALUE;
 
   LOCK();
   if (value) {
@@ -219,6 +528,53 @@ int32_t set_env(const char *key, const char *value) {
   return ret;
 }
 
+int32_t set_env_u32(const char *key, uint32_t value) {
+  char str[1 + 8 + 1];
+
+  str[0] = TAG_U32;
+  to_hex(str + 1, value, 8);
+  str[9] = '\0';
+  return set_env(key, str);
+}
+
+int32_t set_env_i64(const char *key, int64_t value) {
+  char str[1 + 16 + 1];
+
+  str[0] = TAG_I64;
+  to_hex(str + 1, (uint64_t)value, 16);
+  str[17] = '\0';
+  return set_env(key, str);
+}
+
+int32_t set_env_blob(const char *key, const void *data, uint32_t len) {
+  const uint8_t *src = data;
+  char *str, *dst;
+  uint32_t i;
+  int32_t ret;
+
+  if (!data && len) return -KVPFS_NULL_POINTER;
+  if (len > BLOB_MAX_LEN) return -KVPFS_VALUE_TOO_LARGE;
+
+  str = pvPortMalloc(BLOB_HDR_LEN + 2 * len + 1);
+  if (str == NULL) return -KVPFS_OUT_OF_MEM;
+
+  str[0] = TAG_BLOB;
+  to_hex(str + 1, len, 4);
+  dst = str + BLOB_HDR_LEN;
+  for (i = 0; i < len; i++) {
+    if (src[i] == 0x00 || src[i] == 0xFF || src[i] == (uint8_t)BLOB_ESC) {
+      *dst++ = BLOB_ESC;
+      *dst++ = src[i] == 0x00 ? '0' : (src[i] == 0xFF ? '1' : '2');
+    } else
+      *dst++ = src[i];
+  }
+  *dst = '\0';
+
+  ret = set_env(key, str);
+  vPortFree(str);
+  return ret;
+}
+
 static void kvpfs_stateful_init(void) {
   /**
    * Called when returning from stateful boot.
@@ -0,0 +1,754 @@
+/*  ---------------------------------------------------------------------------
+
+    (c) copyright 2021 Altair Semiconductor, Ltd. All rights reserved.
+
+    This software, in source or object form (the "Software"), is the
+    property of Altair Semiconductor Ltd. (the "Company") and/or its
+    licensors, which have all right, title and interest therein, You
+    may use the Software only in  accordance with the terms of written
+    license agreement between you and the Company (the "License").
+    Except as expressly stated in the License, the Company grants no
+    licenses by implication, estoppel, or otherwise. If you are not
+    aware of or do not agree to the License terms, you may not use,
+    copy or modify the Software. You may use the source code of the
+    Software only for your internal purposes and may not distribute the
+    source code of the Software, any part thereof, or any derivative work
+    thereof, to any third party, except pursuant to the Company's prior
+    written consent.
+    The Software is the confidential information of the Company.
+
+   ------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "alt_osal.h"
+#include "flash_mirror.h"
+#include "kvpfs_config.h"
+#include "kvpfs_log.h"
+#include "checksum.h"
+
+#if (KVPFS_LOG_STORE == 1)
+
+/*
+ * Layout: the log is a ring of KVPFS_LOG_SECTORS erase sectors ending at the end of the MCU
+ * partition, so the legacy banks are its last sectors. An in-use sector starts with a sector header
+ * whose sequence number orders the sectors, followed by records packed at 4-byte alignment. A
+ * record is superseded by programming its live byte to 0x00, a collected sector by programming its
+ * state, neither needs an erase. A sector is erased only when it is taken again, the least worn free
+ * sector first, and its erase count travels in its header. One free sector is always kept back so
+ * the oldest sector can be collected into it.
+ *
+ * Values longer than KVPFS_LOG_INLINE_MAX are not kept in the mirror: the mirror holds a reference
+ * to the value in flash instead, so the store can outgrow the mirror.
+ *
+ * A save of more than one record is a transaction: its SET and DEL records carry KVLOG_REC_TXN and
+ * count only once a COMMIT record with a higher sequence number follows, so a cut anywhere in the
+ * save leaves the previous state. The latest COMMIT stays live to keep that number. A collection
+ * copies records with their sequence number, which keeps them on the same side of it.
+ */
+#define KVLOG_SECT_SIZE SFLASH_4K_ERASE_SECTOR_SIZE
+#define KVLOG_NSECT KVPFS_LOG_SECTORS
+#define KVLOG_SECT_MAGIC (0x474C564BUL)  // "KVLG"
+#define KVLOG_SECT_ACTIVE (0xFFFF)
+#define KVLOG_SECT_RETIRED (0x0000)
+#define KVLOG_REC_MAGIC (0x524B)  // "KR"
+#define KVLOG_REC_SET (0x01)     // "key=value"
+#define KVLOG_REC_DEL (0x02)     // "key"
+#define KVLOG_REC_COMMIT (0x03)  // no payload
+#define KVLOG_REC_TXN (0x80)     // part of the transaction the next COMMIT closes
+#define KVLOG_TYPE(hdr) ((hdr)->type & ~KVLOG_REC_TXN)
+#define KVLOG_LIVE (0xFF)
+#define KVLOG_SUPERSEDED (0x00)
+#define KVLOG_FREE_SECT (0xFFFFFFFFUL)
+#define KVLOG_PAGE (32)  // bytes per flash read when streaming a record
+#define KVLOG_REF_LEN (1 + 8 + 4)  // mark, address, length
+#define KVLOG_ALIGN(x) (((x) + 3) & ~3UL)
+
+#if (KVLOG_NSECT * KVLOG_SECT_SIZE < 2 * ENV_SIZE)
+#error "KVPFS_LOG_SECTORS has to cover both legacy banks"
+#endif
+#if (KVPFS_LOG_INLINE_MAX <= KVLOG_REF_LEN)
+#error "KVPFS_LOG_INLINE_MAX has to be longer than a flash reference"
+#endif
+
+struct kvlog_sect_hdr {
+  uint32_t magic;
+  uint32_t seq;
+  uint32_t gc_src;     // sequence of the sector being collected into this one, KVLOG_FREE_SECT if none
+  uint32_t erase_cnt;  // erases of this sector including the one before this header
+  uint16_t crc;        // over seq, gc_src and erase_cnt
+  uint16_t state;      // programmed to KVLOG_SECT_RETIRED in place, not covered by crc
+};
+
+struct kvlog_rec_hdr {
+  uint16_t magic;
+  uint8_t type;
+  uint8_t live;  // programmed to KVLOG_SUPERSEDED in place, not covered by crc
+  uint32_t seq;
+  uint16_t len;   // payload without '\0'
+  uint16_t klen;  // key length, len for a DEL
+  uint16_t crc;   // over type, seq, len, klen and payload
+  uint16_t rsv;
+};
+
+#define KVLOG_DATA_START (sizeof(struct kvlog_sect_hdr))
+#define KVLOG_DATA_SIZE (KVLOG_SECT_SIZE - KVLOG_DATA_START)
+#define KVLOG_REC_SIZE(len) KVLOG_ALIGN(sizeof(struct kvlog_rec_hdr) + (len))
+
+struct kvlog_plan {
+  uint32_t sect_left;
+  uint32_t free_left;
+  uint32_t recs;
+  int32_t fit;
+};
+
+struct kvlog_info {
+  struct flash_mirror_info *flm;
+  int8_t *base;
+  uint32_t sect_seq[KVLOG_NSECT];   // KVLOG_FREE_SECT if not part of the log
+  uint32_t erase_cnt[KVLOG_NSECT];  // 0 for a sector never taken by the log
+  uint32_t head;                    // sector being appended, KVLOG_NSECT if none
+  uint32_t head_off;                // next record offset in head
+  uint32_t next_sect_seq;
+  uint32_t next_rec_seq;
+  uint32_t mark_before;  // records older than this are candidates of the marking pass
+  uint32_t commit_seq;   // sequence number of the latest COMMIT
+  uint8_t txn;           // the save being appended is a transaction
+  struct kvlog_plan *plan;  // set while a save is sized
+  uint32_t gc_cnt;
+};
+
+static struct kvlog_info kvlog __attribute__((section("GPMdata")));
+
+/* a live record as the scan hands it out */
+struct kvlog_rec {
+  uint32_t sect;
+  uint32_t off;
+  struct kvlog_rec_hdr hdr;
+  char *key;    // '\0' terminated, "key=value" once key[klen] of a SET is set back to '='
+  char *value;  // '\0' terminated, NULL if the value is left in flash or the record is no SET
+};
+
+typedef int32_t (*kvlog_visit_fp)(struct kvlog_rec *rec);
+
+static int8_t *kvlog_addr(uint32_t sect, uint32_t off) {
+  return kvlog.base + sect * KVLOG_SECT_SIZE + off;
+}
+
+static int8_t *kvlog_value_addr(const struct kvlog_rec *rec) {
+  return kvlog_addr(rec->sect, rec->off + sizeof(rec->hdr) + rec->hdr.klen + 1);
+}
+
+static int32_t kvlog_read(uint32_t sect, uint32_t off, void *dst, size_t len) {
+  return kvlog.flm->flash_read(kvlog_addr(sect, off), dst, len) == FLASH_ERROR_NONE ? 0 : -1;
+}
+
+static int32_t kvlog_write(uint32_t sect, uint32_t off, const void *src, size_t len) {
+  return kvlog.flm->flash_write((void *)src, kvlog_addr(sect, off), len, 1) == FLASH_ERROR_NONE
+             ? 0
+             : -1;
+}
+
+static uint16_t kvlog_crc(uint16_t crc, const void *data, size_t len) {
+  const unsigned char *p = data;
+
+  while (len--) crc = update_crc_16(crc, *p++);
+  return crc;
+}
+
+static uint16_t kvlog_sect_crc(const struct kvlog_sect_hdr *sh) {
+  uint16_t crc = kvlog_crc(CRC_START_16, &sh->seq, sizeof(sh->seq));
+
+  crc = kvlog_crc(crc, &sh->gc_src, sizeof(sh->gc_src));
+  return kvlog_crc(crc, &sh->erase_cnt, sizeof(sh->erase_cnt));
+}
+
+/* crc of the header fields, the payload is added on top */
+static uint16_t kvlog_hdr_crc(const struct kvlog_rec_hdr *hdr) {
+  uint16_t crc = CRC_START_16;
+
+  crc = kvlog_crc(crc, &hdr->type, sizeof(hdr->type));
+  crc = kvlog_crc(crc, &hdr->seq, sizeof(hdr->seq));
+  crc = kvlog_crc(crc, &hdr->len, sizeof(hdr->len));
+  return kvlog_crc(crc, &hdr->klen, sizeof(hdr->klen));
+}
+
+static int32_t kvlog_parse_ref(const char *value, uint32_t *addr, uint32_t *len) {
+  char num[9];
+
+  if (value[0] != KVLOG_REF_MARK || strlen(value) != KVLOG_REF_LEN) return -1;
+  memcpy(num, value + 1, 8);
+  num[8] = '\0';
+  *addr = strtoul(num, NULL, 16);
+  *len = strtoul(value + 9, NULL, 16);
+  return 0;
+}
+
+static void kvlog_make_ref(char *ref, const int8_t *addr, uint32_t len) {
+  snprintf(ref, KVLOG_REF_LEN + 1, "%c%08lx%04lx", KVLOG_REF_MARK, (uint32_t)addr, len);
+}
+
+static uint32_t kvlog_free_sects(void) {
+  uint32_t i, cnt = 0;
+
+  for (i = 0; i < KVLOG_NSECT; i++)
+    if (kvlog.sect_seq[i] == KVLOG_FREE_SECT) cnt++;
+  return cnt;
+}
+
+/* in-use sector with the smallest sequence number above seq, KVLOG_NSECT if none */
+static uint32_t kvlog_next_sect(uint32_t seq) {
+  uint32_t i, found = KVLOG_NSECT;
+
+  for (i = 0; i < KVLOG_NSECT; i++) {
+    if (kvlog.sect_seq[i] == KVLOG_FREE_SECT || kvlog.sect_seq[i] <= seq) continue;
+    if (found == KVLOG_NSECT || kvlog.sect_seq[i] < kvlog.sect_seq[found]) found = i;
+  }
+  return found;
+}
+
+/* erase the least worn free sector, searching from 'from' on, and make it the new head */
+static int32_t kvlog_open_sect(uint32_t from, uint32_t gc_src) {
+  struct kvlog_sect_hdr sh;
+  uint32_t i, sect, found = KVLOG_NSECT;
+
+  for (i = 0; i < KVLOG_NSECT; i++) {
+    sect = (from + i) % KVLOG_NSECT;
+    if (kvlog.sect_seq[sect] != KVLOG_FREE_SECT) continue;
+    if (found == KVLOG_NSECT || kvlog.erase_cnt[sect] < kvlog.erase_cnt[found]) found = sect;
+  }
+  if (found == KVLOG_NSECT) return -1;
+
+  if (kvlog.flm->flash_erase(kvlog_addr(found, 0), 0, 1) != FLASH_ERROR_NONE) return -1;
+  kvlog.erase_cnt[found]++;
+
+  sh.magic = KVLOG_SECT_MAGIC;
+  sh.seq = kvlog.next_sect_seq++;
+  sh.gc_src = gc_src;
+  sh.erase_cnt = kvlog.erase_cnt[found];
+  sh.crc = kvlog_sect_crc(&sh);
+  sh.state = KVLOG_SECT_ACTIVE;
+  if (kvlog_write(found, 0, &sh, sizeof(sh))) return -1;
+
+  kvlog.sect_seq[found] = sh.seq;
+  kvlog.head = found;
+  kvlog.head_off = KVLOG_DATA_START;
+  return 0;
+}
+
+/* drop a sector from the log, it keeps its erase count until it is taken again */
+static int32_t kvlog_retire_sect(uint32_t sect) {
+  uint16_t state = KVLOG_SECT_RETIRED;
+
+  kvlog.sect_seq[sect] = KVLOG_FREE_SECT;
+  return kvlog_write(sect, offsetof(struct kvlog_sect_hdr, state), &state, sizeof(state));
+}
+
+/* reserve room for a record at the head */
+static int32_t kvlog_place(uint32_t len, uint32_t *sect, uint32_t *off) {
+  if (KVLOG_REC_SIZE(len) > KVLOG_DATA_SIZE) return -1;
+
+  if (kvlog.head >= KVLOG_NSECT || kvlog.head_off + KVLOG_REC_SIZE(len) > KVLOG_SECT_SIZE) {
+    if (kvlog_open_sect(kvlog.head + 1, KVLOG_FREE_SECT)) return -1;
+  }
+  *sect = kvlog.head;
+  *off = kvlog.head_off;
+  kvlog.head_off += KVLOG_REC_SIZE(len);
+  return 0;
+}
+
+static void kvlog_fill_hdr(struct kvlog_rec_hdr *hdr, uint8_t type, uint32_t len, uint32_t klen) {
+  hdr->magic = KVLOG_REC_MAGIC;
+  hdr->type = type;
+  hdr->live = KVLOG_LIVE;
+  hdr->seq = kvlog.next_rec_seq++;
+  hdr->len = (uint16_t)len;
+  hdr->klen = (uint16_t)klen;
+  hdr->rsv = 0xFFFF;
+}
+
+/* a cut between the header and the payload leaves a record failing its crc, which ends the sector */
+static int32_t kvlog_append(uint8_t type, const char *payload, uint32_t len, uint32_t klen,
+                            uint32_t *sect, uint32_t *off) {
+  struct kvlog_rec_hdr hdr;
+
+  if (kvlog_place(len, sect, off)) return -1;
+
+  kvlog_fill_hdr(&hdr, type, len, klen);
+  hdr.crc = kvlog_crc(kvlog_hdr_crc(&hdr), payload, len);
+  if (kvlog_write(*sect, *off, &hdr, sizeof(hdr))) return -1;
+  if (type == KVLOG_REC_COMMIT) kvlog.commit_seq = hdr.seq;
+  return len ? kvlog_write(*sect, *off + sizeof(hdr), payload, len) : 0;
+}
+
+/* append a copy of a record with its sequence number, streaming its payload flash to flash */
+static int32_t kvlog_move(const struct kvlog_rec *rec, uint32_t *sect, uint32_t *off) {
+  struct kvlog_rec_hdr hdr = rec->hdr;  // the payload was checked against its crc by the scan
+  char page[KVLOG_PAGE];
+  uint32_t pos, n, src = rec->off + sizeof(hdr);
+
+  if (kvlog_place(rec->hdr.len, sect, off)) return -1;
+
+  hdr.live = KVLOG_LIVE;
+  if (kvlog_write(*sect, *off, &hdr, sizeof(hdr))) return -1;
+
+  for (pos = 0; pos < hdr.len; pos += n) {
+    n = hdr.len - pos > KVLOG_PAGE ? KVLOG_PAGE : hdr.len - pos;
+    if (kvlog_read(rec->sect, src + pos, page, n) ||
+        kvlog_write(*sect, *off + sizeof(hdr) + pos, page, n))
+      return -1;
+  }
+  return 0;
+}
+
+static int32_t kvlog_mark(const struct kvlog_rec *rec) {
+  uint8_t live = KVLOG_SUPERSEDED;
+
+  return kvlog_write(rec->sect, rec->off + offsetof(struct kvlog_rec_hdr, live), &live,
+                     sizeof(live));
+}
+
+static int32_t kvlog_hdr_ok(const struct kvlog_rec_hdr *hdr) {
+  switch (KVLOG_TYPE(hdr)) {
+    case KVLOG_REC_SET:
+      return hdr->klen > 0 && hdr->klen < hdr->len;
+    case KVLOG_REC_DEL:
+      return hdr->klen > 0 && hdr->klen == hdr->len;
+    case KVLOG_REC_COMMIT:
+      return hdr->type == KVLOG_REC_COMMIT && hdr->len == 0 && hdr->klen == 0;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @brief read the record at rec->off, the key and a short value are copied out
+ *
+ * @return 1 live record with rec->key allocated, 2 superseded record, 0 end of sector, -1 torn or
+ * corrupted record, -2 out of memory
+ */
+static int32_t kvlog_read_rec(struct kvlog_rec *rec) {
+  struct kvlog_rec_hdr *hdr = &rec->hdr;
+  char page[KVLOG_PAGE];
+  uint32_t pos, n, keep, vlen = 0;
+  uint16_t crc;
+
+  rec->key = rec->value = NULL;
+  if (rec->off + sizeof(*hdr) > KVLOG_SECT_SIZE) return 0;
+  if (kvlog_read(rec->sect, rec->off, hdr, sizeof(*hdr))) return -1;
+  if (hdr->magic == 0xFFFF) return 0;
+  if (hdr->magic != KVLOG_REC_MAGIC || !kvlog_hdr_ok(hdr) ||
+      rec->off + KVLOG_REC_SIZE(hdr->len) > KVLOG_SECT_SIZE)
+    return -1;
+  if (hdr->live != KVLOG_LIVE) return 2;
+
+  keep = hdr->klen;
+  if (KVLOG_TYPE(hdr) == KVLOG_REC_SET) {
+    vlen = hdr->len - hdr->klen - 1;
+    keep += 1 + (vlen <= KVPFS_LOG_INLINE_MAX ? vlen : 0);
+  }
+  rec->key = pvPortMalloc(keep + 1);
+  if (rec->key == NULL) return -2;
+
+  crc = kvlog_hdr_crc(hdr);
+  for (pos = 0; pos < hdr->len; pos += n) {
+    n = hdr->len - pos > KVLOG_PAGE ? KVLOG_PAGE : hdr->len - pos;
+    if (kvlog_read(rec->sect, rec->off + sizeof(*hdr) + pos, page, n)) break;
+    crc = kvlog_crc(crc, page, n);
+    if (pos < keep) memcpy(rec->key + pos, page, keep - pos > n ? n : keep - pos);
+  }
+  if (pos < hdr->len || crc != hdr->crc ||
+      (KVLOG_TYPE(hdr) == KVLOG_REC_SET && rec->key[hdr->klen] != '=')) {
+    vPortFree(rec->key);
+    rec->key = NULL;
+    return -1;
+  }
+  rec->key[keep] = '\0';
+  rec->key[hdr->klen] = '\0';
+  if (KVLOG_TYPE(hdr) == KVLOG_REC_SET && vlen <= KVPFS_LOG_INLINE_MAX)
+    rec->value = rec->key + hdr->klen + 1;
+  return 1;
+}
+
+/* visit the live records of a sector, a torn record ends it */
+static int32_t kvlog_scan_sect(uint32_t sect, kvlog_visit_fp visit, uint32_t *end,
+                               uint32_t *max_seq) {
+  struct kvlog_rec rec;
+  int32_t ret;
+
+  rec.sect = sect;
+  rec.off = KVLOG_DATA_START;
+  while ((ret = kvlog_read_rec(&rec)) > 0) {
+    if (max_seq && rec.hdr.seq > *max_seq) *max_seq = rec.hdr.seq;
+    if (rec.hdr.type == KVLOG_REC_COMMIT && rec.hdr.seq > kvlog.commit_seq)
+      kvlog.commit_seq = rec.hdr.seq;
+    if (ret == 1) {
+      ret = visit ? visit(&rec) : 0;
+      vPortFree(rec.key);
+      if (ret) return ret;
+    }
+    rec.off += KVLOG_REC_SIZE(rec.hdr.len);
+  }
+  if (ret == -2) return -1;
+
+  if (end) *end = (ret == 0) ? rec.off : KVLOG_SECT_SIZE;
+  return 0;
+}
+
+/* visit the live records of the whole log, oldest first */
+static int32_t kvlog_scan(kvlog_visit_fp visit) {
+  uint32_t sect, seq = 0;
+
+  while ((sect = kvlog_next_sect(seq)) < KVLOG_NSECT) {
+    if (kvlog_scan_sect(sect, visit, NULL, NULL)) return -1;
+    seq = kvlog.sect_seq[sect];
+  }
+  return 0;
+}
+
+static void kvlog_plan_rec(struct kvlog_plan *plan, uint32_t len) {
+  uint32_t size = KVLOG_REC_SIZE(len);
+
+  plan->recs++;
+  if (size <= plan->sect_left) {
+    plan->sect_left -= size;
+  } else if (plan->free_left > 0 && size <= KVLOG_DATA_SIZE) {
+    plan->free_left--;
+    plan->sect_left = KVLOG_DATA_SIZE - size;
+  } else
+    plan->fit = 0;
+}
+
+static int32_t kvlog_is_reserved(const char *str) {
+  return (strncmp(str, MAGIC_KEYNAME "=", sizeof(MAGIC_KEYNAME)) == 0 ||
+          strncmp(str, CRC_KEYNAME "=", sizeof(CRC_KEYNAME)) == 0);
+}
+
+static int32_t kvlog_add_mirror(char *data) {
+  if (append_data_mirror(data) == 0) return 0;
+  compact_flash();
+  return append_data_mirror(data);
+}
+
+/* a record of a transaction without its COMMIT */
+static int32_t kvlog_is_uncommitted(const struct kvlog_rec *rec) {
+  return (rec->hdr.type & KVLOG_REC_TXN) && rec->hdr.seq > kvlog.commit_seq;
+}
+
+static int32_t kvlog_replay_rec(struct kvlog_rec *rec) {
+  char *data;
+  int32_t ret;
+
+  if (kvlog_is_uncommitted(rec) || rec->hdr.type == KVLOG_REC_COMMIT) return 0;
+
+  delete_value_mirror(rec->key);
+  if (KVLOG_TYPE(&rec->hdr) == KVLOG_REC_DEL) return 0;
+  if (rec->value) {
+    rec->key[rec->hdr.klen] = '=';
+    return kvlog_add_mirror(rec->key);
+  }
+
+  data = pvPortMalloc(rec->hdr.klen + 1 + KVLOG_REF_LEN + 1);
+  if (data == NULL) return -1;
+  memcpy(data, rec->key, rec->hdr.klen);
+  data[rec->hdr.klen] = '=';
+  kvlog_make_ref(data + rec->hdr.klen + 1, kvlog_value_addr(rec),
+                 rec->hdr.len - rec->hdr.klen - 1);
+  ret = kvlog_add_mirror(data);
+  vPortFree(data);
+  return ret;
+}
+
+/* does the mirror still point at this SET */
+static int32_t kvlog_is_current(const struct kvlog_rec *rec) {
+  const char *value;
+  uint32_t addr, len;
+
+  if (KVLOG_TYPE(&rec->hdr) != KVLOG_REC_SET || kvlog_is_uncommitted(rec)) return 0;
+  if (find_value_mirror(rec->key, &value) == NULL) return 0;
+  if (rec->value) return strcmp(value, rec->value) == 0;
+  return kvlog_parse_ref(value, &addr, &len) == 0 && addr == (uint32_t)kvlog_value_addr(rec);
+}
+
+/* after replay only the SET the mirror holds stays live for each key, and the latest COMMIT */
+static int32_t kvlog_fixup_rec(struct kvlog_rec *rec) {
+  if (rec->hdr.type == KVLOG_REC_COMMIT && rec->hdr.seq == kvlog.commit_seq) return 0;
+  return kvlog_is_current(rec) ? 0 : kvlog_mark(rec);
+}
+
+/* a DEL goes ahead of the new records for a key that left the mirror since the last save */
+static int32_t kvlog_del_rec(struct kvlog_rec *rec) {
+  const char *value;
+  uint32_t sect, off;
+
+  if (KVLOG_TYPE(&rec->hdr) != KVLOG_REC_SET || rec->hdr.seq >= kvlog.mark_before ||
+      find_value_mirror(rec->key, &value))
+    return 0;
+
+  if (kvlog.plan) {
+    kvlog_plan_rec(kvlog.plan, rec->hdr.klen);
+    return 0;
+  }
+  return kvlog_append(KVLOG_REC_DEL | (kvlog.txn ? KVLOG_REC_TXN : 0), rec->key, rec->hdr.klen,
+                      rec->hdr.klen, &sect, &off);
+}
+
+/* once the save is complete: the SETs it supersedes, the DELs and the older COMMITs */
+static int32_t kvlog_drop_superseded(struct kvlog_rec *rec) {
+  const char *value;
+  char *pos;
+
+  switch (KVLOG_TYPE(&rec->hdr)) {
+    case KVLOG_REC_DEL:
+      return kvlog_mark(rec);
+    case KVLOG_REC_COMMIT:
+      return rec->hdr.seq < kvlog.commit_seq ? kvlog_mark(rec) : 0;
+    default:
+      break;
+  }
+  if (rec->hdr.seq >= kvlog.mark_before) return 0;
+
+  pos = find_value_mirror(rec->key, &value);
+  if (pos && (uint32_t)(pos - kvlog.flm->mirror) < kvlog.flm->flushed_byte) return 0;
+  return kvlog_mark(rec);
+}
+
+static int32_t kvlog_move_rec(struct kvlog_rec *rec) {
+  struct kvlog_rec moved;
+  char ref[KVLOG_REF_LEN + 1];
+  const char *value;
+  char *pos;
+  int32_t current = (rec->value == NULL) && kvlog_is_current(rec);  // a spilled SET
+
+  if (kvlog_move(rec, &moved.sect, &moved.off)) return -1;
+  if (!current) return 0;
+
+  // the mirror refers to the value in flash, follow it to the copy
+  moved.hdr = rec->hdr;
+  kvlog_make_ref(ref, kvlog_value_addr(&moved), rec->hdr.len - rec->hdr.klen - 1);
+  pos = find_value_mirror(rec->key, &value);
+  return pos ? replace_value_mirror(pos, ref) : 0;
+}
+
+/* move the live records of the oldest sector to a fresh head and retire it */
+static int32_t kvlog_gc(void) {
+  uint32_t victim = kvlog_next_sect(0);
+
+  if (victim >= KVLOG_NSECT || kvlog_free_sects() == 0) return -1;
+  if (kvlog_open_sect(kvlog.head + 1, kvlog.sect_seq[victim])) return -1;
+  if (kvlog_scan_sect(victim, kvlog_move_rec, NULL, NULL)) return -1;
+  kvlog.gc_cnt++;
+  return kvlog_retire_sect(victim);
+}
+
+/* append one mirror entry, a long value then leaves the mirror for a reference */
+static int32_t kvlog_append_entry(char *str, uint32_t len, uint32_t klen) {
+  struct kvlog_rec rec;
+  char ref[KVLOG_REF_LEN + 1];
+  uint32_t vlen = len - klen - 1;
+
+  if (kvlog_append(KVLOG_REC_SET | (kvlog.txn ? KVLOG_REC_TXN : 0), str, len, klen, &rec.sect,
+                   &rec.off))
+    return -1;
+  if (vlen <= KVPFS_LOG_INLINE_MAX) return 0;
+
+  rec.hdr.klen = klen;
+  kvlog_make_ref(ref, kvlog_value_addr(&rec), vlen);
+  return replace_value_mirror(str, ref);
+}
+
+/* walk the mirror entries added since the last save */
+static int32_t kvlog_for_each_new(struct kvlog_plan *plan) {
+  struct flash_mirror_info *flm = kvlog.flm;
+  char *str = flm->mirror + flm->flushed_byte;
+  char *eqp;
+  uint32_t len;
+
+  while (str < flm->mirror + flm->used_byte) {
+    if (*str == '\0') {
+      str++;
+      continue;
+    }
+    len = strlen(str);
+    eqp = strchr(str, '=');
+    if (eqp && !kvlog_is_reserved(str)) {
+      if (plan)
+        kvlog_plan_rec(plan, len);
+      else if (kvlog_append_entry(str, len, eqp - str))
+        return -1;
+    }
+    str += len + 1;
+  }
+  return 0;
+}
+
+/* size the records of a save: DELs, new SETs and the COMMIT of a transaction */
+static int32_t kvlog_fits(struct kvlog_plan *plan) {
+  uint32_t free_sects = kvlog_free_sects();
+
+  plan->sect_left = kvlog.head < KVLOG_NSECT ? KVLOG_SECT_SIZE - kvlog.head_off : 0;
+  plan->free_left = free_sects > 0 ? free_sects - 1 : 0;  // keep one for the collection
+  plan->recs = 0;
+  plan->fit = 1;
+  kvlog.plan = plan;
+  if (kvlog_scan(kvlog_del_rec)) plan->fit = 0;
+  kvlog.plan = NULL;
+  kvlog_for_each_new(plan);
+  if (plan->recs > 1) {
+    kvlog_plan_rec(plan, 0);
+    plan->recs--;
+  }
+  return plan->fit;
+}
+
+static uint32_t kvlog_sect_of(const int8_t *addr) {
+  return (uint32_t)(addr - kvlog.base) / KVLOG_SECT_SIZE;
+}
+
+static void kvlog_reset(struct flash_mirror_info *info) {
+  uint32_t i;
+
+  memset(&kvlog, 0, sizeof(kvlog));
+  kvlog.flm = info;
+  kvlog.base = (int8_t *)(KVPFS_LOG_BASE_ADDR & SFLASH_4K_MASK);
+  for (i = 0; i < KVLOG_NSECT; i++) kvlog.sect_seq[i] = KVLOG_FREE_SECT;
+  kvlog.head = KVLOG_NSECT;
+  kvlog.next_sect_seq = 1;
+  kvlog.next_rec_seq = 1;
+}
+
+/**
+ * @brief rebuild the mirror from the log
+ *
+ * @return 0 mounted, -1 no log in flash, -2 the log can't be read or replayed
+ */
+int32_t kvlog_mount(struct flash_mirror_info *info) {
+  struct kvlog_sect_hdr sh;
+  uint32_t gc_src[KVLOG_NSECT];
+  uint32_t sect, src, seq = 0, end = KVLOG_SECT_SIZE, max_seq = 0, max_erase = 0;
+
+  kvlog_reset(info);
+  for (sect = 0; sect < KVLOG_NSECT; sect++) {
+    gc_src[sect] = KVLOG_FREE_SECT;
+    kvlog.erase_cnt[sect] = KVLOG_FREE_SECT;
+    if (kvlog_read(sect, 0, &sh, sizeof(sh))) return -2;  // -1 would get the log formatted
+    if (sh.magic != KVLOG_SECT_MAGIC || sh.seq == KVLOG_FREE_SECT || sh.crc != kvlog_sect_crc(&sh))
+      continue;
+    kvlog.erase_cnt[sect] = sh.erase_cnt;
+    if (sh.erase_cnt > max_erase) max_erase = sh.erase_cnt;
+    if (sh.seq >= kvlog.next_sect_seq) kvlog.next_sect_seq = sh.seq + 1;
+    if (sh.state != KVLOG_SECT_ACTIVE) continue;
+    kvlog.sect_seq[sect] = sh.seq;
+    gc_src[sect] = sh.gc_src;
+  }
+  if (kvlog_free_sects() == KVLOG_NSECT) return -1;  // no log yet
+
+  // a sector without a header lost its count to a cut erase, don't let it look fresh
+  for (sect = 0; sect < KVLOG_NSECT; sect++)
+    if (kvlog.erase_cnt[sect] == KVLOG_FREE_SECT) kvlog.erase_cnt[sect] = max_erase;
+
+  // a collection cut before its source was retired holds only copies, drop it to get the reserve
+  for (sect = 0; sect < KVLOG_NSECT; sect++) {
+    if (gc_src[sect] == KVLOG_FREE_SECT) continue;
+    for (src = 0; src < KVLOG_NSECT; src++)
+      if (kvlog.sect_seq[src] == gc_src[sect] && kvlog_retire_sect(sect)) return -2;
+  }
+
+  // the latest COMMIT decides which transaction records count
+  while ((sect = kvlog_next_sect(seq)) < KVLOG_NSECT) {
+    if (kvlog_scan_sect(sect, NULL, &end, &max_seq)) return -2;
+    seq = kvlog.sect_seq[sect];
+    kvlog.head = sect;
+  }
+  kvlog.head_off = end;  // a torn tail closes the head, the next append opens a new one
+  kvlog.next_rec_seq = max_seq + 1;
+
+  if (kvlog_scan(kvlog_replay_rec)) return -2;
+
+  // records a cut left behind between appending and marking, or of a transaction it cut
+  return kvlog_scan(kvlog_fixup_rec) ? -2 : 0;
+}
+
+int32_t kvlog_format(struct flash_mirror_info *info) {
+  uint32_t primary;
+
+  kvlog_reset(info);
+  info->flushed_byte = 0;
+
+  // start in the legacy backup bank so the primary bank stays valid until the log holds the store
+  if (kvlog_open_sect(kvlog_sect_of(info->env_backup), KVLOG_FREE_SECT) ||
+      kvlog_for_each_new(NULL))
+    return -1;
+
+  primary = kvlog_sect_of(info->env_primary);
+  if (kvlog.sect_seq[primary] == KVLOG_FREE_SECT &&
+      info->flash_erase(kvlog_addr(primary, 0), 0, 1) != FLASH_ERROR_NONE)
+    return -1;
+  info->flushed_byte = info->used_byte;
+  return 0;
+}
+
+int32_t kvlog_save(void) {
+  struct kvlog_plan plan;
+  uint32_t i, sect, off;
+  int32_t ret;
+
+  kvlog.mark_before = kvlog.next_rec_seq;
+  for (i = 0; !kvlog_fits(&plan); i++) {
+    if (i >= KVLOG_NSECT || kvlog_gc()) return -1;
+  }
+  if (plan.recs == 0) return 0;
+
+  // new records land before the old ones are marked, a cut in between is fixed at mount
+  kvlog.txn = (plan.recs > 1);
+  ret = kvlog_scan(kvlog_del_rec) || kvlog_for_each_new(NULL) ||
+        (kvlog.txn && kvlog_append(KVLOG_REC_COMMIT, NULL, 0, 0, &sect, &off));
+  kvlog.txn = 0;
+  if (ret) return -1;
+  if (kvlog_scan(kvlog_drop_superseded)) return -1;
+
+  kvlog.flm->flushed_byte = kvlog.flm->used_byte;
+  return 0;
+}
+
+uint32_t kvlog_value_len(const char *value) {
+  uint32_t addr, len;
+
+  return kvlog_parse_ref(value, &addr, &len) ? strlen(value) : len;
+}
+
+int32_t kvlog_read_value(const char *value, uint32_t offset, char *dst, uint32_t size) {
+  uint32_t addr, len;
+
+  if (kvlog_parse_ref(value, &addr, &len)) {
+    if (offset + size > strlen(value)) return -1;
+    memcpy(dst, value + offset, size);
+    return 0;
+  }
+  if (offset + size > len) return -1;
+  return kvlog.flm->flash_read((void *)(addr + offset), dst, size) == FLASH_ERROR_NONE ? 0 : -1;
+}
+
+void kvlog_print_info(void) {
+  uint32_t sect, min = 0xFFFFFFFFUL, max = 0;
+
+  for (sect = 0; sect < KVLOG_NSECT; sect++) {
+    if (kvlog.erase_cnt[sect] < min) min = kvlog.erase_cnt[sect];
+    if (kvlog.erase_cnt[sect] > max) max = kvlog.erase_cnt[sect];
+  }
+  printf("log store\n\t");
+  printf("sectors:%d, free:%ld, head:%ld@%ld, next seq:%ld, gc:%ld, erase min:%ld max:%ld\n\t",
+         KVLOG_NSECT, kvlog_free_sects(), kvlog.head, kvlog.head_off, kvlog.next_rec_seq,
+         kvlog.gc_cnt, min, max);
+  for (sect = 0; sect < KVLOG_NSECT; sect++) {
+    if (kvlog.sect_seq[sect] == KVLOG_FREE_SECT)
+      printf("[free/%ld] ", kvlog.erase_cnt[sect]);
+    else
+      printf("[%ld/%ld] ", kvlog.sect_seq[sect], kvlog.erase_cnt[sect]);
+  }
+  printf("\n");
+}
+
+#endif
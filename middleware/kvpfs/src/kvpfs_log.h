@@ -0,0 +1,46 @@
+/*  ---------------------------------------------------------------------------
+
+    (c) copyright 2021 Altair Semiconductor, Ltd. All rights reserved.
+
+    This software, in source or object form (the "Software"), is the
+    property of Altair Semiconductor Ltd. (the "Company") and/or its
+    licensors, which have all right, title and interest therein, You
+    may use the Software only in  accordance with the terms of written
+    license agreement between you and the Company (the "License").
+    Except as expressly stated in the License, the Company grants no
+    licenses by implication, estoppel, or otherwise. If you are not
+    aware of or do not agree to the License terms, you may not use,
+    copy or modify the Software. You may use the source code of the
+    Software only for your internal purposes and may not distribute the
+    source code of the Software, any part thereof, or any derivative work
+    thereof, to any third party, except pursuant to the Company's prior
+    written consent.
+    The Software is the confidential information of the Company.
+
+   ------------------------------------------------------------------------- */
+
+#ifndef __KVPFS_LOG_H__
+#define __KVPFS_LOG_H__
+
+#include "flash_mirror.h"
+
+/*
+ * Log store: the flash mirror is persisted as an append-only log of "key=value" records instead
+ * of the primary/backup bank images. A save only appends the entries that changed since the last
+ * save and marks the records they supersede; a sector is collected only when the log runs out of
+ * room. The mirror stays the in-RAM view, except that a long value is replaced by a reference into
+ * the log, read through kvlog_read_value().
+ *
+ * A mirror value starting with KVLOG_REF_MARK is such a reference, so set_env() refuses values
+ * starting with it.
+ */
+#define KVLOG_REF_MARK ('\x1b')
+
+int32_t kvlog_mount(struct flash_mirror_info *info);
+int32_t kvlog_format(struct flash_mirror_info *info);
+int32_t kvlog_save(void);
+uint32_t kvlog_value_len(const char *value);
+int32_t kvlog_read_value(const char *value, uint32_t offset, char *dst, uint32_t size);
+void kvlog_print_info(void);
+
+#endif
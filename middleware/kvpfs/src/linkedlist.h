@@ -21,4 +21,5 @@ env_list *search_ele(env_list *start, const char *key);
 
 int32_t modify_ele(env_list *list, const char *new_value);
 env_list *delete_ele(env_list *start, const char *key);
+void free_ele(env_list *node);
 #endif
\ No newline at end of file
@@ -126,6 +126,31 @@ int32_t delete_value_list(const char *key) {
   return -1;
 }
 
+/* visit every element in the order they were added */
+void walk_data_list(list_visit_fp visit, void *arg) {
+  env_list *traverse;
+
+  LOCK();
+  for (traverse = head; traverse != NULL; traverse = traverse->next)
+    visit(traverse->key, traverse->value, arg);
+  UNLOCK();
+}
+
+void clear_data_list(void) {
+  env_list *next;
+
+  LOCK();
+  while (head != NULL) {
+    next = head->next;
+    free_ele(head);
+    head = next;
+  }
+  cur = NULL;
+  ldt_info.used_byte = 0;
+  ldt_info.num_of_ele = 0;
+  UNLOCK();
+}
+
 void init_list_data(struct list_data_info **ldt) {
   if (list_data_mtx) {
     return;
@@ -9,9 +9,13 @@ struct list_data_info {
 #define DEL_FF (0)
 #define DEL_LF (1)
 
+typedef void (*list_visit_fp)(const char *key, const char *value, void *arg);
+
 void get_all_data_list(char *resp, int del );
 int32_t add_data_list(const char *key, const char *value);
 int32_t find_value_list(const char *key, const char **value);
 int32_t delete_value_list(const char *key);
+void walk_data_list(list_visit_fp visit, void *arg);
+void clear_data_list(void);
 void init_list_data(struct list_data_info **ldt);
 #endif
\ No newline at end of file
@@ -26,6 +26,7 @@
  * Included Files
  ****************************************************************************/
 #include <stdbool.h>
+#include <stdint.h>
 #include "pwr_mngr.h"
 
 /****************************************************************************
@@ -48,6 +49,79 @@ enum block_type {
   BLOCK_TCB,
 };
 
+/**
+ * Codecs of the hibernation image blocks.
+ */
+enum hibernate_codec_id {
+  HBN_CODEC_FASTLZ = 0,
+  HBN_CODEC_STORE,
+  HBN_CODEC_LZ4,
+  HBN_CODEC_FILL, /* block of a single byte value, no payload */
+  HBN_CODEC_NUM
+};
+
+/**
+ * Per codec counters of the last hibernation and the last restore.
+ */
+struct hibernate_codec_stats {
+  uint32_t blocks;
+  uint32_t raw_bytes;
+  uint32_t packed_bytes;
+  uint32_t compress_cycles; /* attempts which were not kept included */
+  uint32_t decompress_cycles;
+};
+
+/**
+ * Phases timed by the hibernation profiler.
+ */
+enum hibernate_phase {
+  HBN_PHASE_FREE_LIST = 0, /* collecting the free heap and stack blocks */
+  HBN_PHASE_HEAP_ZERO,     /* zeroing free heap */
+  HBN_PHASE_STACK_FILL,    /* filling free task stacks */
+  HBN_PHASE_COMPRESS,      /* compressing all regions */
+  HBN_PHASE_FLASH_PREPARE, /* erasing or planning the flash image, shutdown only */
+  HBN_PHASE_FLASH_WRITE,   /* hibernate_to_flash() up to the image header */
+  HBN_PHASE_FLASH_READ,    /* hibernate_from_flash() without decompression */
+  HBN_PHASE_RESTORE,       /* decompressing back into memory */
+  HBN_PHASE_NUM
+};
+
+/* Version of struct hibernate_profile, first word of the profile dump */
+#define HBN_PROFILE_VERSION 1
+/* Memory regions in the hibernation image: GPM heap, .data/.bss, SRAM heap */
+#define HBN_PROFILE_REGIONS 3
+
+/**
+ * What one memory region came to in the last hibernation and restore.
+ */
+struct hibernate_region_profile {
+  uint32_t raw_bytes;
+  uint32_t packed_bytes; /* records, payload and trailer */
+  uint32_t blocks;
+  uint32_t const_blocks;
+  uint32_t stored_blocks; /* blocks which did not compress */
+  uint32_t compress_cycles;
+  uint32_t restore_cycles;
+};
+
+/**
+ * Profile of the last hibernation and restore.  It is kept with the uncompressed GPM data, so it
+ * can be read after wake up.
+ */
+struct hibernate_profile {
+  uint32_t version;
+  uint32_t seq; /* hibernations since cold boot */
+  uint32_t core_clock_hz;
+  uint32_t phase_cycles[HBN_PHASE_NUM];
+  uint32_t free_blocks;
+  uint32_t free_heap_bytes;
+  uint32_t free_stack_bytes;
+  uint32_t image_bytes;    /* compressed stream */
+  uint32_t compress_space; /* room for it from __gpm_compress_start__ */
+  int32_t min_inplace_lead; /* smallest gap left between compressed output and unread GPM heap */
+  struct hibernate_region_profile regions[HBN_PROFILE_REGIONS];
+};
+
 /**
  * List of free blocks.
  */
@@ -138,4 +212,27 @@ void hibernate_zero_free_blocks(struct hibernate_free_block *freeListPtr);
  */
 void hibernate_restore_stacks(void);
 
+/**
+ * DEBUG API - Get the codec counters of the last hibernation and restore,
+ * HBN_CODEC_NUM entries
+ */
+void hibernate_get_codec_stats(struct hibernate_codec_stats *stats);
+
+/**
+ * DEBUG API - Print the codec counters of the last hibernation and restore
+ */
+void hibernate_dbg_codec_report(void);
+
+/**
+ * DEBUG API - Get the profile of the last hibernation and restore
+ */
+void hibernate_get_profile(struct hibernate_profile *profile);
+
+/**
+ * DEBUG API - Print the profile of the last hibernation and restore
+ *
+ * @param raw print the profile and codec counters as hex words for utils/hbnreport.py instead
+ */
+void hibernate_dbg_profile_report(bool raw);
+
 #endif /* SYSTEM_HIBERNATE_H */
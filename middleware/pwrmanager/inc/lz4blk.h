@@ -0,0 +1,42 @@
+/*  ---------------------------------------------------------------------------
+
+    (c) copyright 2021 Altair Semiconductor, Ltd. All rights reserved.
+
+    This software, in source or object form (the "Software"), is the
+    property of Altair Semiconductor Ltd. (the "Company") and/or its
+    licensors, which have all right, title and interest therein, You
+    may use the Software only in  accordance with the terms of written
+    license agreement between you and the Company (the "License").
+    Except as expressly stated in the License, the Company grants no
+    licenses by implication, estoppel, or otherwise. If you are not
+    aware of or do not agree to the License terms, you may not use,
+    copy or modify the Software. You may use the source code of the
+    Software only for your internal purposes and may not distribute the
+    source code of the Software, any part thereof, or any derivative work
+    thereof, to any third party, except pursuant to the Company's prior
+    written consent.
+    The Software is the confidential information of the Company.
+
+   ------------------------------------------------------------------------- */
+
+#ifndef LZ4BLK_H
+#define LZ4BLK_H
+
+/**
+ * Compress a buffer into the LZ4 block format (no frame header, no checksum).
+ *
+ * Input must be smaller than 64KB.  Output needs up to length + length / 255 + 16 bytes, it may
+ * trail the input in the same buffer as long as it never overtakes it.
+ *
+ * @return compressed size
+ */
+int lz4blk_compress(const void* input, int length, void* output);
+
+/**
+ * Decompress an LZ4 block.
+ *
+ * @return decompressed size, 0 if the block is corrupt or does not fit in maxout
+ */
+int lz4blk_decompress(const void* input, int length, void* output, int maxout);
+
+#endif /* LZ4BLK_H */
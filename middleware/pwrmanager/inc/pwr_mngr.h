@@ -46,9 +46,23 @@
 #define PWR_MNGR_MON_GPIO_MAX_ENTRY (4) /**< The maximum monitored GPIOs */
 
 #define PWR_MNGR_EN_HIBERNATE_SHUTDOWN  1  /* Enable the shutdown mode with hibernation. 0: disable; 1: enable */
+#define PWR_MNGR_EN_HIBERNATE_DELTA  0  /* Write only the blocks which changed since the last full flash image. 0: disable; 1: enable */
+#define PWR_MNGR_EN_HIBERNATE_PIPELINE  0  /* Program the flash image while it is being compressed, exclusive with PWR_MNGR_EN_HIBERNATE_DELTA. 0: disable; 1: enable */
 #define PWR_MNGR_SHUTDOWN_THRESHOLD (50*1000) /**< The threshold of sleep duration to enter shutdown sleep. \
 When the calculated sleep duration over the defined threshold value, it can send shutdown request; \
 otherwise, it sends standby request. This design is for SFlash wear-out protection.  */
+#define PWR_MNGR_EN_SLEEP_PLANNER  0  /* Pick the sleep mode from the predicted idle time and the learnt cost of each mode, up to the configured one. 0: disable; 1: enable */
+
+/* Energy model of the sleep planner. Currents are in uA, measure them on the board. */
+#define PWR_MNGR_PLAN_RUN_UA (4000)     /**< Current while entering or leaving a sleep mode */
+#define PWR_MNGR_PLAN_SLEEP_UA (1500)   /**< Current in OS sleep (WFI) */
+#define PWR_MNGR_PLAN_STOP_UA (150)     /**< Current in stop mode */
+#define PWR_MNGR_PLAN_STANDBY_UA (20)   /**< Current in standby mode */
+#define PWR_MNGR_PLAN_SHUTDOWN_UA (5)   /**< Current in shutdown mode */
+/* Enter plus wake up cost of each mode in ms until the first sleep of that mode measures it */
+#define PWR_MNGR_PLAN_STOP_COST_MS (5)
+#define PWR_MNGR_PLAN_STANDBY_COST_MS (60)
+#define PWR_MNGR_PLAN_SHUTDOWN_COST_MS (800)
 
 /** @} pwrmngr_constant */
 
@@ -92,6 +106,29 @@ typedef struct {
   int32_t sleep_manager_devices[SMNGR_RANGE]; /**< sleep manager clients (id). */
 } PWR_MNGR_PwrCounters;
 
+/** @brief Definition of the receive activity statistics of a UART port. */
+typedef struct {
+  unsigned long activity_cnt; /**< receive bursts reported by the UART driver */
+  uint32_t idle_time;         /**< time since the last burst in ms */
+  uint32_t max_idle_time;     /**< longest gap between two bursts in ms */
+} PWR_MNGR_UartActivity;
+
+/** @brief Sources of the activity hints of the sleep planner. */
+typedef enum {
+  PWR_MNGR_HINT_APP, /**< Application deadline */
+  PWR_MNGR_HINT_LTE, /**< Modem activity, e.g. eDRX paging cycle or PSM periodic TAU */
+  PWR_MNGR_HINT_MAX
+} PWR_MNGR_HintSrc;
+
+/** @brief Definition of the sleep planner statistics. */
+typedef struct {
+  uint32_t cost_ms[PWR_MNGR_MODE_SHUTDOWN + 1];      /**< learnt enter plus wake up cost */
+  unsigned long chosen[PWR_MNGR_MODE_SHUTDOWN + 1];  /**< sleeps planned in each mode */
+  unsigned long downgraded;  /**< sleeps planned shallower than the configured mode */
+  unsigned long hint_cut;    /**< sleeps whose idle window was shortened by a hint */
+  uint32_t last_idle_ms;     /**< last predicted idle window */
+} PWR_MNGR_SleepPlan;
+
 /** @brief Definition of power manager configuration. */
 typedef struct {
   uint32_t enable;          /**< sleep enable/disable.*/
@@ -269,6 +306,68 @@ int32_t pwr_mngr_set_debug_mode(int32_t en_debug);
  */
 void pwr_mngr_refresh_uart_inactive_time(void);
 
+/**
+ * @brief Record a burst of UART receive activity. The UART driver calls this once per interrupt
+ * or received batch, and only the DRV_UART_F0 record blocks sleep. Safe in interrupt context.
+ *
+ * @param [in] port: DRV_UART_Port of the UART.
+ *
+ * @return None.
+ */
+void pwr_mngr_refresh_uart_activity(uint32_t port);
+
+/**
+ * @brief Get the receive activity and idle-time statistics of a UART port.
+ *
+ * @param [in] port: DRV_UART_Port of the UART.
+ * @param [out] activity: pointer of PWR_MNGR_UartActivity.
+ *
+ * @return error code. 0-success; other-fail.
+ */
+int32_t pwr_mngr_get_uart_activity(uint32_t port, PWR_MNGR_UartActivity *activity);
+
+/**
+ * @brief Tell the sleep planner when a source expects activity next, so sleeps which would be cut
+ * short pick a shallower mode. A hint does not wake the MCU up.
+ *
+ * @param [in] src: source of the hint.
+ * @param [in] delay_ms: time to the next activity in ms, 0 to remove the hint.
+ * @param [in] period_ms: the activity repeats with this period, 0 for a single one.
+ *
+ * @return PWR_MNGR_Status is returned.
+ */
+PWR_MNGR_Status pwr_mngr_set_activity_hint(PWR_MNGR_HintSrc src, uint32_t delay_ms,
+                                           uint32_t period_ms);
+
+/**
+ * @brief Pick the sleep mode for an idle window. Called by the tickless idle hook.
+ *
+ * @param [in] max_mode: configured power mode, the deepest one allowed.
+ * @param [in] idle_ms: time to the next RTOS timer in ms.
+ *
+ * @return the mode with the least energy for the predicted idle window.
+ */
+PWR_MNGR_PwrMode pwr_mngr_plan_sleep(PWR_MNGR_PwrMode max_mode, uint32_t idle_ms);
+
+/**
+ * @brief Learn the cost of a sleep mode. Called by the tickless idle hook after wake up.
+ *
+ * @param [in] pwr_mode: power mode which was entered.
+ * @param [in] overhead_ms: measured enter and wake up processing in ms.
+ *
+ * @return None.
+ */
+void pwr_mngr_plan_learn(PWR_MNGR_PwrMode pwr_mode, uint32_t overhead_ms);
+
+/**
+ * @brief Get the sleep planner statistics.
+ *
+ * @param [out] plan: pointer of PWR_MNGR_SleepPlan.
+ *
+ * @return error code. 0-success; other-fail.
+ */
+int32_t pwr_mngr_get_sleep_plan(PWR_MNGR_SleepPlan *plan);
+
 /** @} pwrmngr_apis */
 /*! @cond Doxygen_Suppress */
 #undef EXTERN
@@ -23,8 +23,11 @@
  * Included Files
  ****************************************************************************/
 
+#include <stddef.h>
+#include DEVICE_HEADER
 #include "alt_osal.h"
 #include "fastlz.h"
+#include "lz4blk.h"
 #include "hibernate.h"
 #if (PWR_MNGR_EN_HIBERNATE_SHUTDOWN == 1)
 #include "DRV_COMMON.h"
@@ -48,17 +51,62 @@
 /* Size of decompressed blocks used for compression.  Must be a power of 2. */
 #define WORKING_BLOCK_SIZE 4096
 
+/* Every record ends with the checksum of the record, then its compressed and original size */
+#define RECORD_TRAILER_SIZE (sizeof(uint32_t) + sizeof(size_t) * 2)
+
 /* Maximum size of a compressed block.  This can be larger than a decompressed block in worst case
 where there's 0 compression and everything is stored as literals */
 #define MAX_COMPRESSED_BLOCK_SIZE \
-  (WORKING_BLOCK_SIZE + (WORKING_BLOCK_SIZE / 32) + (sizeof(size_t) * 2))
+  (WORKING_BLOCK_SIZE + (WORKING_BLOCK_SIZE / 32) + RECORD_TRAILER_SIZE)
 
 #define MAX_TASKS 16
 
+/* Blocks of a single repeated byte are stored as a record without payload.  The flag marks the
+compressed size word of such a record, the fill byte is in its low bits. */
+#define CONST_BLOCK_FLAG ((size_t)1 << (sizeof(size_t) * 8 - 1))
+#define CONST_BLOCK_FILL_MASK 0xFF
+
+/* Free ranges big enough to cover a whole block, looked up before scanning the block */
+#define MAX_FREE_RANGES 8
+
+/* The codec of a compressed block sits in the bits below CONST_BLOCK_FLAG of its compressed size
+word, FastLZ being 0 */
+#define BLOCK_CODEC_SHIFT (sizeof(size_t) * 8 - 4)
+#define BLOCK_CODEC_MASK ((size_t)7 << BLOCK_CODEC_SHIFT)
+#define BLOCK_SIZE_MASK (((size_t)1 << BLOCK_CODEC_SHIFT) - 1)
+
+/* Codec tried first on every block.  LZ4 decodes faster than FastLZ, and decoding is what wake-up
+waits on. */
+#define PRIMARY_CODEC HBN_CODEC_LZ4
+/* Blocks the primary codec leaves bigger than this are also tried with the secondary codec, which
+is kept if it saves at least SECONDARY_CODEC_MIN_GAIN bytes more */
+#define SECONDARY_CODEC HBN_CODEC_FASTLZ
+#define SECONDARY_CODEC_THRESHOLD (WORKING_BLOCK_SIZE / 2)
+#define SECONDARY_CODEC_MIN_GAIN (WORKING_BLOCK_SIZE / 16)
+
 #if (PWR_MNGR_EN_HIBERNATE_SHUTDOWN == 1)
 #define MCU_PARTITION_OFFSET MCU_BASE_ADDR
 #define MCU_PARTITION_SIZE MCU_PART_SIZE
 #define MCU_PART_IMAGE_SZ_OFFSET (MCU_BASE_ADDR + 0x4)
+#define RETAIN_FULL_MAGIC 0xdeadbeef
+#define RETAIN_DELTA_MAGIC 0xdeadd17a
+#define RETAIN_STREAM_MAGIC 0xdeadf10e
+#define IS_RETAIN_MAGIC(m) ((m) == RETAIN_FULL_MAGIC || (m) == RETAIN_STREAM_MAGIC)
+#define FLASH_SECTOR_SIZE 4096
+#define FLASH_BLOCK_SIZE (64 * 1024)
+#define FLASH_PAGE_SIZE 256
+#endif
+
+#if (PWR_MNGR_EN_HIBERNATE_PIPELINE == 1) && (PWR_MNGR_EN_HIBERNATE_DELTA == 1)
+#error "PWR_MNGR_EN_HIBERNATE_PIPELINE and PWR_MNGR_EN_HIBERNATE_DELTA can not be enabled together"
+#endif
+
+#if (PWR_MNGR_EN_HIBERNATE_SHUTDOWN == 1) && (PWR_MNGR_EN_HIBERNATE_DELTA == 1)
+/* Record taken from the full image instead of the delta payload */
+#define DELTA_FROM_BASE 0x80000000UL
+/* Share of the compressed image allowed to differ from the full image before a new full image is
+written instead of a delta */
+#define DELTA_MAX_CHANGED_PERCENT 50
 #endif
 /****************************************************************************
  * External Symbols
@@ -91,15 +139,101 @@ static const struct {
 /* End of compressed memory after compression is complete. */
 UNCOMPRESSED void *EndOfCompressedMem;
 
+/* Block codecs.  Compressors may write into memory trailing the input, like FastLZ does in GPM */
+struct hibernate_codec {
+  int (*compress)(const void *input, int length, void *output);
+  int (*decompress)(const void *input, int length, void *output, int maxout);
+};
+
+static int FastlzCompress(const void *input, int length, void *output) {
+  return fastlz_compress_level(1, input, length, output);
+}
+
+static int StoreCompress(const void *input, int length, void *output) {
+  memmove(output, input, length);
+  return length;
+}
+
+static int StoreDecompress(const void *input, int length, void *output, int maxout) {
+  if (length > maxout) {
+    return 0;
+  }
+  memmove(output, input, length);
+  return length;
+}
+
+static const struct hibernate_codec Codecs[] = {
+    [HBN_CODEC_FASTLZ] = {FastlzCompress, fastlz_decompress_internal},
+    [HBN_CODEC_STORE] = {StoreCompress, StoreDecompress},
+    [HBN_CODEC_LZ4] = {lz4blk_compress, lz4blk_decompress},
+};
+
+static const char *const CodecNames[HBN_CODEC_NUM] = {
+    [HBN_CODEC_FASTLZ] = "fastlz",
+    [HBN_CODEC_STORE] = "store",
+    [HBN_CODEC_LZ4] = "lz4",
+    [HBN_CODEC_FILL] = "fill",
+};
+
+/* Kept out of the image so the restore figures survive it */
+UNCOMPRESSED struct hibernate_codec_stats CodecStats[HBN_CODEC_NUM];
+UNCOMPRESSED struct hibernate_profile Profile;
+
+_Static_assert(HBN_PROFILE_REGIONS == sizeof(MemRegions) / sizeof(MemRegions[0]),
+               "HBN_PROFILE_REGIONS does not match MemRegions");
+
+/* Free memory known to hold a single fill byte once ZeroFreeMem() ran */
+struct free_range {
+  char *start;
+  char *end;
+  uint8_t fill;
+};
+
 #if (PWR_MNGR_EN_HIBERNATE_SHUTDOWN == 1)
 UNCOMPRESSED uint32_t retain_flash_offset;
 
 typedef struct {
   uint32_t magic_num;            
   uint32_t size;              
-  uint32_t reserved1;
-  uint32_t reserved2;
+  uint32_t reserved1;  /* generation of the full image, a delta names the one it applies to */
+  uint32_t reserved2;  /* delta: number of records */
+  uint32_t write_cycles; /* profile: hibernate_to_flash() up to this header */
 } retain_flash_hdr;
+
+/* Start of hibernate_to_flash(), for the write_cycles of the header */
+static uint32_t FlashWriteStart;
+#endif
+
+#if (PWR_MNGR_EN_HIBERNATE_SHUTDOWN == 1) && (PWR_MNGR_EN_HIBERNATE_DELTA == 1)
+/*
+  A delta image sits in the first sector after the full image and holds the GPM prefix, one entry
+  per compressed record in stream order, then the records which differ from the full image.
+  Restoring copies every record from where the entry points to, which gives back the same stream
+  a full image would.
+*/
+struct delta_entry {
+  uint32_t offset; /* in the delta payload, or in the full image stream with DELTA_FROM_BASE */
+  uint32_t len;
+};
+
+UNCOMPRESSED uint32_t deltaImageOffset;  /* flash offset of the delta to write, 0 for a full image */
+UNCOMPRESSED uint32_t deltaRecords;
+UNCOMPRESSED uint32_t deltaPayloadSize;
+UNCOMPRESSED uint32_t retainGeneration;
+#endif
+
+#if (PWR_MNGR_EN_HIBERNATE_SHUTDOWN == 1) && (PWR_MNGR_EN_HIBERNATE_PIPELINE == 1)
+/*
+  A streamed image is laid out like a full one, but its records are programmed while later blocks
+  are still being compressed: whole flash pages go out as soon as they are ready, and the flash is
+  erased just ahead of them.  The GPM prefix and the header follow in hibernate_to_flash(), the
+  header last, with a checksum of itself and the prefix.  Records carry their own checksums, so the
+  image is restored by decompressing straight from flash.
+*/
+UNCOMPRESSED char *streamFlash;       /* flash address of __gpm_compress_start__, NULL if off */
+UNCOMPRESSED char *streamProgrammed;  /* compressed stream below this is programmed */
+UNCOMPRESSED char *streamErased;      /* flash below this is erased */
+UNCOMPRESSED uint32_t streamRestored; /* hibernate_from_flash() restored memory already */
 #endif
 
 /****************************************************************************
@@ -193,8 +327,10 @@ static void GetFreeList(struct hibernate_free_block **freeListPtr) {
  * Some prototyping was done to avoid passing unused memory to the compressor at all, but this was
  * found to be slower in general.
  */
-static void ZeroFreeMem(struct hibernate_free_block *freeBlockList) {
+static void ZeroFreeMem(struct hibernate_free_block *freeBlockList,
+                        struct hibernate_profile *profile) {
   struct hibernate_free_block *nextFreeBlock;
+  uint32_t start;
 
   while (1) {
     if (!freeBlockList) {
@@ -204,12 +340,24 @@ static void ZeroFreeMem(struct hibernate_free_block *freeBlockList) {
     /* Store the next free block */
     nextFreeBlock = freeBlockList->next;
 
+    start = DWT->CYCCNT;
     if (freeBlockList->type == BLOCK_TCB) {
       /* Set 0xA5 TCB block(unused task stack) */
       memset(freeBlockList->start, 0xA5, freeBlockList->size);
+      if (profile != NULL) {
+        profile->phase_cycles[HBN_PHASE_STACK_FILL] += DWT->CYCCNT - start;
+        profile->free_stack_bytes += freeBlockList->size;
+      }
     } else {
       /* And zero the contents of this block */
       memset(freeBlockList->start, 0, freeBlockList->size);
+      if (profile != NULL) {
+        profile->phase_cycles[HBN_PHASE_HEAP_ZERO] += DWT->CYCCNT - start;
+        profile->free_heap_bytes += freeBlockList->size;
+      }
+    }
+    if (profile != NULL) {
+      profile->free_blocks++;
     }
 
     /* And move on to the next block */
@@ -217,6 +365,211 @@ static void ZeroFreeMem(struct hibernate_free_block *freeBlockList) {
   }
 }
 
+/**
+ * Start the core cycle counter, which times the codecs and the hibernation phases.
+ */
+static void CycleCounterStart(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * Compress one block with the given codec and account for it.
+ *
+ * @return compressed size
+ */
+static size_t CodecCompress(int codec, const char *srcAddr, size_t srcSize, char *dstAddr) {
+  uint32_t start = DWT->CYCCNT;
+  size_t dstSize = Codecs[codec].compress(srcAddr, srcSize, dstAddr);
+
+  CodecStats[codec].compress_cycles += DWT->CYCCNT - start;
+  return dstSize;
+}
+
+/**
+ * Store a block as it is.  memmove() copes with the in-place overlap of the GPM heap.
+ *
+ * @return compressed size word of the record
+ */
+static size_t StoreBlock(const char *srcAddr, size_t srcSize, char *dstAddr) {
+  size_t dstSize = CodecCompress(HBN_CODEC_STORE, srcAddr, srcSize, dstAddr);
+
+  CodecStats[HBN_CODEC_STORE].blocks++;
+  CodecStats[HBN_CODEC_STORE].raw_bytes += srcSize;
+  CodecStats[HBN_CODEC_STORE].packed_bytes += dstSize;
+  return dstSize | ((size_t)HBN_CODEC_STORE << BLOCK_CODEC_SHIFT);
+}
+
+/**
+ * Compress a block, choosing the codec by what it gains.  The primary codec decodes fastest, the
+ * secondary one is only kept when it compresses clearly better, and a block which does not shrink
+ * at all is stored.
+ *
+ * The codecs read back earlier input while they write, so a pass may not run into a dstAddr that
+ * trails srcAddr by less than MAX_COMPRESSED_BLOCK_SIZE.  Such a block is compressed in scratch and
+ * only the chosen payload is copied to dstAddr.
+ *
+ * @return compressed size word of the record: payload size and codec
+ */
+static size_t CompressBlock(const char *srcAddr, size_t srcSize, char *dstAddr, char *scratch) {
+  size_t dstSize, altSize;
+  int codec = PRIMARY_CODEC;
+  char *outAddr = scratch != NULL ? scratch : dstAddr;
+
+  dstSize = CodecCompress(codec, srcAddr, srcSize, outAddr);
+  if (dstSize > SECONDARY_CODEC_THRESHOLD && dstSize < srcSize) {
+    /* Both compress into outAddr, the primary runs again if it stays the better choice */
+    altSize = CodecCompress(SECONDARY_CODEC, srcAddr, srcSize, outAddr);
+    if (altSize + SECONDARY_CODEC_MIN_GAIN <= dstSize) {
+      codec = SECONDARY_CODEC;
+      dstSize = altSize;
+    } else {
+      CodecCompress(codec, srcAddr, srcSize, outAddr);
+    }
+  }
+  if (dstSize >= srcSize) {
+    return StoreBlock(srcAddr, srcSize, dstAddr);
+  }
+  if (scratch != NULL) {
+    memcpy(dstAddr, scratch, dstSize);
+  }
+
+  CodecStats[codec].blocks++;
+  CodecStats[codec].raw_bytes += srcSize;
+  CodecStats[codec].packed_bytes += dstSize;
+  return dstSize | ((size_t)codec << BLOCK_CODEC_SHIFT);
+}
+
+/**
+ * Keep the free blocks which may cover a whole working block.  The list itself lives partly in the
+ * free stacks which ZeroFreeMem() overwrites, so it has to be copied out first.
+ */
+static size_t GetFreeRanges(struct hibernate_free_block *freeBlockList,
+                            struct free_range *ranges) {
+  size_t num = 0;
+
+  for (; freeBlockList && num < MAX_FREE_RANGES; freeBlockList = freeBlockList->next) {
+    if (freeBlockList->size < WORKING_BLOCK_SIZE) {
+      continue;
+    }
+    ranges[num].start = freeBlockList->start;
+    ranges[num].end = (char *)freeBlockList->start + freeBlockList->size;
+    ranges[num].fill = freeBlockList->type == BLOCK_TCB ? 0xA5 : 0;
+    num++;
+  }
+  return num;
+}
+
+/**
+ * Check if a block holds a single repeated byte, either because it lies in free memory or by
+ * scanning it.  Most of the SRAM heap is free, and those blocks then skip the compressor.
+ *
+ * @return the fill byte, or -1 if the block has other content
+ */
+static int GetConstBlockFill(const char *srcAddr, size_t srcSize, const struct free_range *ranges,
+                             size_t numRanges) {
+  const uint32_t *word, *end;
+  uint32_t pattern;
+  size_t i;
+
+  for (i = 0; i < numRanges; ++i) {
+    if (srcAddr >= ranges[i].start && srcAddr + srcSize <= ranges[i].end) {
+      return ranges[i].fill;
+    }
+  }
+
+  /* Regions and blocks are word aligned except possibly the tail of a region */
+  if (((uintptr_t)srcAddr | srcSize) & (sizeof(uint32_t) - 1)) {
+    return -1;
+  }
+  word = (const uint32_t *)srcAddr;
+  end = (const uint32_t *)(srcAddr + srcSize);
+  pattern = (*word & 0xFF) * 0x01010101UL;
+  if (*word != pattern) {
+    return -1;
+  }
+  while (++word < end) {
+    if (*word != pattern) {
+      return -1;
+    }
+  }
+  return pattern & 0xFF;
+}
+
+/**
+ * Find free heap memory outside the GPM heap and the compression buffer to compress the GPM heap
+ * blocks through which the in-place output has caught up with.  Whatever is left in it is zeroed
+ * again afterwards, the restore fills it like any other free block.
+ *
+ * @return scratch of MAX_COMPRESSED_BLOCK_SIZE bytes, or NULL if there is none
+ */
+static char *GetScratch(const struct free_range *ranges, size_t numRanges) {
+  size_t i;
+
+  for (i = 0; i < numRanges; ++i) {
+    if (ranges[i].fill != 0 ||
+        (size_t)(ranges[i].end - ranges[i].start) < MAX_COMPRESSED_BLOCK_SIZE) {
+      continue;
+    }
+    if (ranges[i].start < MemRegions[0].end && ranges[i].end > MemRegions[0].start) {
+      continue;
+    }
+    if (ranges[i].start < __gpm_compress_end__ && ranges[i].end > __gpm_compress_start__) {
+      continue;
+    }
+    return ranges[i].start;
+  }
+  return NULL;
+}
+
+/**
+ * Running checksum, rotate and add over 32-bit words.
+ */
+static uint32_t Checksum(const void *data, size_t len, uint32_t sum) {
+  const char *src = data;
+  uint32_t word;
+
+  for (; len >= sizeof(word); len -= sizeof(word), src += sizeof(word)) {
+    memcpy(&word, src, sizeof(word));
+    sum = ((sum << 7) | (sum >> 25)) + word;
+  }
+  while (len--) {
+    sum = ((sum << 7) | (sum >> 25)) + (uint8_t)*src++;
+  }
+  return sum;
+}
+
+/**
+ * Checksum of a record, covering its size words and payload.
+ */
+static uint32_t RecordChecksum(const char *payload, size_t payloadSize, size_t packedSize,
+                               size_t rawSize) {
+  uint32_t sum = Checksum(&rawSize, sizeof(rawSize), 0);
+
+  sum = Checksum(&packedSize, sizeof(packedSize), sum);
+  return Checksum(payload, payloadSize, sum);
+}
+
+/**
+ * Close the record whose payload starts at dstAddr with its trailer.
+ *
+ * @return end of the record
+ */
+static char *WriteRecordTrailer(char *dstAddr, size_t payloadSize, size_t packedSize,
+                                size_t rawSize) {
+  uint32_t sum = RecordChecksum(dstAddr, payloadSize, packedSize, rawSize);
+
+  /* Memcpy to avoid alignment issues */
+  dstAddr += payloadSize;
+  memcpy(dstAddr, &sum, sizeof(sum));
+  dstAddr += sizeof(sum);
+  memcpy(dstAddr, &packedSize, sizeof(size_t));
+  dstAddr += sizeof(size_t);
+  memcpy(dstAddr, &rawSize, sizeof(size_t));
+  dstAddr += sizeof(size_t);
+  return dstAddr;
+}
+
 /**
  * Decompress a (potentially) partially compressed memory space back into its original location.
  *
@@ -227,25 +580,56 @@ static int DecompressPartial(int region,    /* Last region which was compressed
                              char *dstAddr, /* End of the region to decompress into */
                              char *srcAddr  /* End of the compressed region to decompress */
 ) {
+  int codec, i;
+  uint32_t start, phaseStart, regionStart;
+
+  CycleCounterStart();
+  for (codec = 0; codec < HBN_CODEC_NUM; ++codec) {
+    CodecStats[codec].decompress_cycles = 0;
+  }
+  for (i = 0; i < HBN_PROFILE_REGIONS; ++i) {
+    Profile.regions[i].restore_cycles = 0;
+  }
+  phaseStart = DWT->CYCCNT;
+
   do {
+    regionStart = DWT->CYCCNT;
     while (dstAddr > MemRegions[region].start) {
-      size_t srcSize, dstSize;
+      size_t srcSize, dstSize, payloadSize;
+      uint32_t sum;
 
       /* First read the size of the compressed region */
       srcAddr -= sizeof(size_t);
       memcpy(&dstSize, srcAddr, sizeof(size_t));
       srcAddr -= sizeof(size_t);
       memcpy(&srcSize, srcAddr, sizeof(size_t));
+      srcAddr -= sizeof(sum);
+      memcpy(&sum, srcAddr, sizeof(sum));
 
+      payloadSize = (srcSize & CONST_BLOCK_FLAG) ? 0 : (srcSize & BLOCK_SIZE_MASK);
+      srcAddr -= payloadSize;
       dstAddr -= dstSize;
-      srcAddr -= srcSize;
 
       /* Should always be able to reconstruct original memory.  If we can't, only
       choice is to reset, as memory currently resembles a toddler's art project */
-      if (fastlz_decompress_internal(srcAddr, srcSize, dstAddr, dstSize) == 0) {
+      if (RecordChecksum(srcAddr, payloadSize, srcSize, dstSize) != sum) {
         return -1;
       }
+
+      start = DWT->CYCCNT;
+      if (srcSize & CONST_BLOCK_FLAG) {
+        memset(dstAddr, srcSize & CONST_BLOCK_FILL_MASK, dstSize);
+        CodecStats[HBN_CODEC_FILL].decompress_cycles += DWT->CYCCNT - start;
+        continue;
+      }
+      codec = (srcSize & BLOCK_CODEC_MASK) >> BLOCK_CODEC_SHIFT;
+      if (codec >= (int)(sizeof(Codecs) / sizeof(Codecs[0])) ||
+          Codecs[codec].decompress(srcAddr, payloadSize, dstAddr, dstSize) == 0) {
+        return -1;
+      }
+      CodecStats[codec].decompress_cycles += DWT->CYCCNT - start;
     }
+    Profile.regions[region].restore_cycles = DWT->CYCCNT - regionStart;
 
     /* Front of the region -- go to the next (previous?) region */
     if (region--) {
@@ -255,8 +639,453 @@ static int DecompressPartial(int region,    /* Last region which was compressed
       break;
     }
   } while (1);
+  Profile.phase_cycles[HBN_PHASE_RESTORE] = DWT->CYCCNT - phaseStart;
+  return 0;
+}
+
+#if (PWR_MNGR_EN_HIBERNATE_SHUTDOWN == 1)
+/**
+ * Choose where the image goes in flash, after the MCU image, and erase the header of an image
+ * left at the other place.
+ *
+ * @return flash space left for the image at retain_flash_offset, 0 if retained_size does not fit
+ */
+static uint32_t SelectFlashOffset(size_t retained_size) {
+  uint32_t *probeAddr, flash_offset_64KB, flash_offset_4KB;
+  uint32_t mcu_image_sz_offset = MCU_PART_IMAGE_SZ_OFFSET, *mcu_image_sz = 0, available_sz = 0;
+
+  mcu_image_sz = (uint32_t *)mcu_image_sz_offset;
+  retain_flash_offset = 0;
+
+  // check remaining flash size is enough for rentention
+  available_sz = MCU_PARTITION_SIZE - *mcu_image_sz - retained_size - 0x1000;
+  if(available_sz < retained_size) {
+    HBN_LOG(1, "flash size is not enough");
+    return 0;
+  }
+
+  if(*mcu_image_sz == 0) 
+    return 0;
+
+  flash_offset_64KB = ((*mcu_image_sz/65536) + 1)*65536 + MCU_PARTITION_OFFSET; //64KB alignment for 64KB erase
+  flash_offset_4KB = ((*mcu_image_sz/4096) + 1)*4096 + MCU_PARTITION_OFFSET; //4KB alignment for 4KB erase
+
+  if(available_sz >= 0x20000) {
+    retain_flash_offset = flash_offset_64KB;
+    available_sz -= ((*mcu_image_sz/65536) + 1)*65536 - *mcu_image_sz;
+
+    //erase previous header if necessary
+    probeAddr = (uint32_t *)flash_offset_4KB;
+    if(IS_RETAIN_MAGIC(*probeAddr)) { DRV_FLASH_Erase_Sector(probeAddr, 0, 1); }
+  } else {
+    retain_flash_offset = flash_offset_4KB; 
+    available_sz -= ((*mcu_image_sz/4096) + 1)*4096 - *mcu_image_sz;
+
+    //erase previous header if necessary
+    probeAddr = (uint32_t *)flash_offset_64KB;
+    if(IS_RETAIN_MAGIC(*probeAddr)) { DRV_FLASH_Erase_Sector(probeAddr, 0, 1); }    
+  }
+
+  return available_sz;
+}
+
+/**
+ * Cycles hibernate_to_flash() took so far.  They go in the image header, as the profile in the
+ * image is written before it.
+ */
+static uint32_t FlashWriteCycles(void) {
+  Profile.phase_cycles[HBN_PHASE_FLASH_WRITE] = DWT->CYCCNT - FlashWriteStart;
+  return Profile.phase_cycles[HBN_PHASE_FLASH_WRITE];
+}
+
+/**
+ * Account for the flash side of the restore in the profile, which came back with the image.
+ */
+static void ProfileFlashRestore(const retain_flash_hdr *hdr, uint32_t readStart) {
+  Profile.phase_cycles[HBN_PHASE_FLASH_WRITE] = hdr->write_cycles;
+  Profile.phase_cycles[HBN_PHASE_FLASH_READ] = DWT->CYCCNT - readStart;
+}
+
+#endif
+
+#if (PWR_MNGR_EN_HIBERNATE_SHUTDOWN == 1) && (PWR_MNGR_EN_HIBERNATE_DELTA == 1)
+/**
+ * Step back over the record which ends at end.
+ *
+ * @return length of the record, payload and trailer
+ */
+static size_t PrevRecord(const char *end, size_t *rawSize) {
+  size_t packedSize;
+
+  memcpy(rawSize, end - sizeof(size_t), sizeof(size_t));
+  memcpy(&packedSize, end - 2 * sizeof(size_t), sizeof(size_t));
+  if (packedSize & CONST_BLOCK_FLAG) {
+    packedSize = 0;
+  }
+  return (packedSize & BLOCK_SIZE_MASK) + RECORD_TRAILER_SIZE;
+}
+
+/**
+ * Erase the 4KB sectors covering [addr, addr + size).  addr must be sector aligned.
+ */
+static int32_t EraseFlashRange(char *addr, size_t size) {
+  char *end = addr + size;
+
+  for (; addr < end; addr += FLASH_SECTOR_SIZE) {
+    if (DRV_FLASH_Erase_Sector(addr, 0, 1) != FLASH_ERROR_NONE) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Flash offset of the delta header which goes with the full image of size retainedSize at start.
+ */
+static uint32_t DeltaHeaderOffset(uint32_t start, size_t retainedSize) {
+  return (start + sizeof(retain_flash_hdr) + retainedSize + FLASH_SECTOR_SIZE - 1) &
+         ~(uint32_t)(FLASH_SECTOR_SIZE - 1);
+}
+
+/**
+ * A full image written without a readable one before it starts over at generation 1, so a delta
+ * left behind by an older image may name its generation.  Erase the sector of its delta header
+ * unless it is blank, before the header of the full image makes it current.
+ */
+static int32_t EraseStaleDelta(uint32_t start, size_t retainedSize) {
+  uint32_t deltaOffset = DeltaHeaderOffset(start, retainedSize);
+
+  if (deltaOffset >= MCU_PARTITION_OFFSET + MCU_PARTITION_SIZE ||
+      ((const retain_flash_hdr *)deltaOffset)->magic_num == 0xFFFFFFFF) {
+    return 0;
+  }
+  return EraseFlashRange((char *)deltaOffset, FLASH_SECTOR_SIZE);
+}
+
+/**
+ * Compare the compressed stream with the one of the full image in flash, which is valid as long
+ * as the same firmware runs.  Both streams hold one record per block in the same order, and FastLZ
+ * gives the same record for the same block, so equal records mean unchanged memory.
+ *
+ * On success the delta entries are left after the end of compressed memory and the delta space is
+ * erased.
+ *
+ * @return 0 if a delta is to be written, -1 to write a full image
+ */
+static int32_t PlanDeltaImage(char *streamEnd) {
+  const retain_flash_hdr *baseHdr;
+  const char *baseStart, *baseEnd, *oldEnd;
+  char *streamStart = __gpm_compress_start__, *newEnd;
+  size_t prefixSize = (size_t)(__gpm_compress_start__ - __bss_gpm_start__);
+  size_t numRecords = 0, changed = 0, i, newLen, oldLen, rawSize, oldRawSize;
+  uint32_t offset, imageEnd;
+  struct delta_entry *entries;
+
+  deltaImageOffset = 0;
+  retainGeneration = 1;
+
+  probe_flash_offset();
+  if (retain_flash_offset == 0) {
+    return -1;
+  }
+  baseHdr = (const retain_flash_hdr *)retain_flash_offset;
+  if (baseHdr->magic_num != RETAIN_FULL_MAGIC) {
+    return -1;
+  }
+  retainGeneration = baseHdr->reserved1 + 1;
+  if (baseHdr->size < prefixSize || baseHdr->size > MCU_PARTITION_SIZE) {
+    return -1;
+  }
+  baseStart = (const char *)retain_flash_offset + sizeof(retain_flash_hdr) + prefixSize;
+  baseEnd = (const char *)retain_flash_offset + sizeof(retain_flash_hdr) + baseHdr->size;
+
+  for (newEnd = streamEnd; newEnd > streamStart; newEnd -= PrevRecord(newEnd, &rawSize)) {
+    numRecords++;
+  }
+  entries = (struct delta_entry *)(((uintptr_t)streamEnd + 3) & ~(uintptr_t)3);
+  if ((char *)(entries + numRecords) > __gpm_compress_end__) {
+    return -1;
+  }
+
+  /* Walk both streams backwards, records are only delimited by the size words at their ends */
+  newEnd = streamEnd;
+  oldEnd = baseEnd;
+  for (i = numRecords; i-- > 0;) {
+    if (oldEnd <= baseStart) {
+      return -1;
+    }
+    newLen = PrevRecord(newEnd, &rawSize);
+    oldLen = PrevRecord(oldEnd, &oldRawSize);
+    if (rawSize != oldRawSize) {
+      return -1;
+    }
+    newEnd -= newLen;
+    oldEnd -= oldLen;
+
+    entries[i].len = newLen;
+    if (newLen == oldLen && memcmp(newEnd, oldEnd, newLen) == 0) {
+      entries[i].offset = (uint32_t)(oldEnd - baseStart) | DELTA_FROM_BASE;
+    } else {
+      entries[i].offset = 0;
+      changed += newLen;
+    }
+  }
+  if (oldEnd != baseStart) {
+    return -1;
+  }
+
+  if (changed * 100 > (size_t)(streamEnd - streamStart) * DELTA_MAX_CHANGED_PERCENT) {
+    HBN_LOG(2, "Delta %zu of %zu bytes, writing a full image\n", changed,
+            (size_t)(streamEnd - streamStart));
+    return -1;
+  }
+
+  for (i = 0, offset = 0; i < numRecords; ++i) {
+    if (!(entries[i].offset & DELTA_FROM_BASE)) {
+      entries[i].offset = offset;
+      offset += entries[i].len;
+    }
+  }
+
+  deltaRecords = numRecords;
+  deltaPayloadSize = prefixSize + numRecords * sizeof(struct delta_entry) + changed;
+  deltaImageOffset = DeltaHeaderOffset(retain_flash_offset, baseHdr->size);
+  imageEnd = deltaImageOffset + sizeof(retain_flash_hdr) + deltaPayloadSize;
+  if (imageEnd > MCU_PARTITION_OFFSET + MCU_PARTITION_SIZE ||
+      EraseFlashRange((char *)deltaImageOffset, imageEnd - deltaImageOffset) != 0) {
+    deltaImageOffset = 0;
+    return -1;
+  }
+
+  retainGeneration = baseHdr->reserved1;
+  HBN_LOG(2, "Delta %zu of %zu bytes in %zu records\n", changed,
+          (size_t)(streamEnd - streamStart), numRecords);
+  return 0;
+}
+
+/**
+ * Write the delta planned by PlanDeltaImage().  The header goes last, so a delta cut short by a
+ * reset is never used.
+ */
+static int32_t WriteDeltaImage(void) {
+  char *dst = (char *)deltaImageOffset + sizeof(retain_flash_hdr);
+  char *payload, *src = __gpm_compress_start__;
+  size_t prefixSize = (size_t)(__gpm_compress_start__ - __bss_gpm_start__);
+  struct delta_entry *entries;
+  retain_flash_hdr retain_hdr;
+  uint32_t i;
+
+  entries = (struct delta_entry *)(((uintptr_t)EndOfCompressedMem + 3) & ~(uintptr_t)3);
+
+  if (DRV_FLASH_Write(__bss_gpm_start__, dst, prefixSize, 0) != FLASH_ERROR_NONE) {
+    return -1;
+  }
+  dst += prefixSize;
+  if (DRV_FLASH_Write(entries, dst, deltaRecords * sizeof(struct delta_entry), 0) !=
+      FLASH_ERROR_NONE) {
+    return -1;
+  }
+  payload = dst + deltaRecords * sizeof(struct delta_entry);
+
+  for (i = 0; i < deltaRecords; ++i) {
+    if (!(entries[i].offset & DELTA_FROM_BASE) &&
+        DRV_FLASH_Write(src, payload + entries[i].offset, entries[i].len, 0) != FLASH_ERROR_NONE) {
+      return -1;
+    }
+    src += entries[i].len;
+  }
+
+  memset(&retain_hdr, 0x0, sizeof(retain_flash_hdr));
+  retain_hdr.magic_num = RETAIN_DELTA_MAGIC;
+  retain_hdr.size = deltaPayloadSize;
+  retain_hdr.reserved1 = retainGeneration;
+  retain_hdr.reserved2 = deltaRecords;
+  retain_hdr.write_cycles = FlashWriteCycles();
+  if (DRV_FLASH_Write(&retain_hdr, (void *)deltaImageOffset, sizeof(retain_flash_hdr), 0) !=
+      FLASH_ERROR_NONE) {
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Rebuild the compressed stream in GPM from a delta and the full image it applies to.
+ */
+static int32_t RestoreDeltaImage(const retain_flash_hdr *baseHdr,
+                                 const retain_flash_hdr *deltaHdr) {
+  size_t prefixSize = (size_t)(__gpm_compress_start__ - __bss_gpm_start__);
+  const char *baseStream = (const char *)(baseHdr + 1) + prefixSize;
+  const struct delta_entry *entries;
+  const char *payload, *src;
+  char *dst = __gpm_compress_start__;
+  uint32_t i;
+
+  if (deltaHdr->size < prefixSize + deltaHdr->reserved2 * sizeof(struct delta_entry)) {
+    return -1;
+  }
+  if (DRV_FLASH_Read((void *)(deltaHdr + 1), __bss_gpm_start__, prefixSize) != FLASH_ERROR_NONE) {
+    return -1;
+  }
+  entries = (const struct delta_entry *)((const char *)(deltaHdr + 1) + prefixSize);
+  payload = (const char *)(entries + deltaHdr->reserved2);
+
+  for (i = 0; i < deltaHdr->reserved2; ++i) {
+    if (dst + entries[i].len > __gpm_compress_end__) {
+      return -1;
+    }
+    if (entries[i].offset & DELTA_FROM_BASE) {
+      src = baseStream + (entries[i].offset & ~DELTA_FROM_BASE);
+    } else {
+      src = payload + entries[i].offset;
+    }
+    if (DRV_FLASH_Read((void *)src, dst, entries[i].len) != FLASH_ERROR_NONE) {
+      return -1;
+    }
+    dst += entries[i].len;
+  }
+  return 0;
+}
+#endif
+
+#if (PWR_MNGR_EN_HIBERNATE_SHUTDOWN == 1) && (PWR_MNGR_EN_HIBERNATE_PIPELINE == 1)
+/**
+ * Pick the flash space for a streamed image, big enough for the worst case as its size is not
+ * known yet, and start erasing it.  Nothing is streamed if the worst case does not fit; the image
+ * is written the usual way then.
+ */
+static void StreamBegin(void) {
+  size_t prefixSize = (size_t)(__gpm_compress_start__ - __bss_gpm_start__);
+
+  streamFlash = NULL;
+  if (SelectFlashOffset((size_t)(__gpm_compress_end__ - __bss_gpm_start__)) == 0) {
+    return;
+  }
+  streamFlash = (char *)retain_flash_offset + sizeof(retain_flash_hdr) + prefixSize;
+  streamProgrammed = __gpm_compress_start__;
+  streamErased = (char *)retain_flash_offset;
+}
+
+/**
+ * Hand the flash its next command for the streamed image, unless it is still busy with the last
+ * one.  The sector the stream reaches next is erased first, 64KB at a time where aligned, then the
+ * compressed stream is programmed one flash page at a time.  The last partial page only goes out
+ * when flushing.
+ *
+ * The flash works through the command on its own, so compression carries on in the meantime.
+ *
+ * @return 1 while more is left up to end, 0 when done, -1 on flash errors
+ */
+static int32_t StreamPump(const char *end, bool flush) {
+  char *dst = streamFlash + (streamProgrammed - __gpm_compress_start__);
+  char *dstEnd = streamFlash + (end - __gpm_compress_start__);
+  size_t len;
+  int is64K;
+
+  if (DRV_FLASH_Is_Busy()) {
+    return 1;
+  }
+
+  if (streamErased < dstEnd) {
+    is64K = ((uint32_t)streamErased % FLASH_BLOCK_SIZE) == 0 &&
+            (uint32_t)streamErased + FLASH_BLOCK_SIZE <= MCU_PARTITION_OFFSET + MCU_PARTITION_SIZE;
+    if (DRV_FLASH_Erase_Sector(streamErased, is64K, 0) != FLASH_ERROR_NONE) {
+      return -1;
+    }
+    streamErased += is64K ? FLASH_BLOCK_SIZE : FLASH_SECTOR_SIZE;
+    return 1;
+  }
+
+  len = FLASH_PAGE_SIZE - ((uint32_t)dst % FLASH_PAGE_SIZE);
+  if (len > (size_t)(dstEnd - dst)) {
+    if (!flush || dst == dstEnd) {
+      return dst == dstEnd ? 0 : 1;
+    }
+    len = (size_t)(dstEnd - dst);
+  }
+  if (DRV_FLASH_Write(streamProgrammed, dst, len, 0) != FLASH_ERROR_NONE) {
+    return -1;
+  }
+  streamProgrammed += len;
+  return streamProgrammed < end ? 1 : 0;
+}
+
+/**
+ * Checksum of a streamed image header, covering the header and the GPM prefix.
+ */
+static uint32_t StreamHeaderChecksum(const retain_flash_hdr *hdr, const char *prefix) {
+  uint32_t sum = Checksum(hdr, offsetof(retain_flash_hdr, reserved2), 0);
+
+  return Checksum(prefix, hdr->reserved1, sum);
+}
+
+/**
+ * Finish a streamed image: program what compression left, then the GPM prefix, then the header.
+ * The header goes last, so an image cut short by a reset is never used.
+ */
+static int32_t WriteStreamImage(void) {
+  size_t prefixSize = (size_t)(__gpm_compress_start__ - __bss_gpm_start__);
+  retain_flash_hdr retain_hdr;
+  uint32_t magic;
+  int32_t ret;
+
+  while ((ret = StreamPump(EndOfCompressedMem, true)) > 0) {
+  }
+  if (ret < 0) {
+    return -1;
+  }
+
+  if (DRV_FLASH_Write(__bss_gpm_start__, (char *)retain_flash_offset + sizeof(retain_flash_hdr),
+                      prefixSize, 0) != FLASH_ERROR_NONE) {
+    return -1;
+  }
+
+  memset(&retain_hdr, 0x0, sizeof(retain_flash_hdr));
+  retain_hdr.magic_num = RETAIN_STREAM_MAGIC;
+  retain_hdr.size = prefixSize + (size_t)((char *)EndOfCompressedMem - __gpm_compress_start__);
+  retain_hdr.reserved1 = prefixSize;
+  retain_hdr.reserved2 = StreamHeaderChecksum(&retain_hdr, __bss_gpm_start__);
+  retain_hdr.write_cycles = FlashWriteCycles();
+  if (DRV_FLASH_Write(&retain_hdr, (void *)retain_flash_offset, sizeof(retain_flash_hdr), 0) !=
+      FLASH_ERROR_NONE) {
+    return -1;
+  }
+
+  /* Reading back waits for the header to be programmed before going to sleep */
+  if (DRV_FLASH_Read((void *)retain_flash_offset, &magic, sizeof(magic)) != FLASH_ERROR_NONE ||
+      magic != RETAIN_STREAM_MAGIC) {
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Restore memory from a streamed image.  Only the GPM prefix is copied, the records are checked
+ * and decompressed straight from flash, which hibernate_from_gpm() then skips.
+ */
+static int32_t RestoreStreamImage(const retain_flash_hdr *hdr) {
+  static const size_t lastRegion = sizeof(MemRegions) / sizeof(MemRegions[0]) - 1;
+  size_t prefixSize = (size_t)(__gpm_compress_start__ - __bss_gpm_start__);
+  const char *prefix = (const char *)(hdr + 1);
+
+  if (hdr->reserved1 != prefixSize || hdr->size < prefixSize ||
+      hdr->size > MCU_PARTITION_SIZE || StreamHeaderChecksum(hdr, prefix) != hdr->reserved2) {
+    return -1;
+  }
+  if (DRV_FLASH_Read((void *)prefix, __bss_gpm_start__, prefixSize) != FLASH_ERROR_NONE) {
+    return -1;
+  }
+  /* The prefix brought back where the stream ended in GPM */
+  if ((size_t)((char *)EndOfCompressedMem - __gpm_compress_start__) != hdr->size - prefixSize) {
+    return -1;
+  }
+
+  if (DecompressPartial(lastRegion, MemRegions[lastRegion].end, (char *)prefix + hdr->size) != 0) {
+    return -1;
+  }
+  streamRestored = 1;
   return 0;
 }
+#endif
 
 /****************************************************************************
  * Public Functions
@@ -274,25 +1103,48 @@ int32_t hibernate_to_flash(void) {
     printf("\n\r wrong mcu flash offset");
     return (-1);
   }
+  FlashWriteStart = DWT->CYCCNT;
 
-  dstFlashAddr = (uint32_t *)start;
-  retainedSize = (size_t)(dstAddr - dstGpmAddr);
+#if (PWR_MNGR_EN_HIBERNATE_DELTA == 1)
+  if (deltaImageOffset != 0) {
+    return WriteDeltaImage();
+  }
+#endif
+#if (PWR_MNGR_EN_HIBERNATE_PIPELINE == 1)
+  if (streamFlash != NULL) {
+    return WriteStreamImage();
+  }
+#endif
 
-  //write header
-  retain_flash_hdr retain_hdr;
-  memset(&retain_hdr, 0x0, sizeof(retain_flash_hdr));
-  retain_hdr.magic_num = 0xdeadbeef;
-  retain_hdr.size = retainedSize;
+  retainedSize = (size_t)(dstAddr - dstGpmAddr);
 
-  ret_val = DRV_FLASH_Write(&retain_hdr, dstFlashAddr, sizeof(retain_flash_hdr), 0);
+  //write data
+  dstFlashAddr = (uint32_t *)(start+sizeof(retain_flash_hdr));
+  ret_val = DRV_FLASH_Write(dstGpmAddr, dstFlashAddr, retainedSize, 0);
   if(ret_val != FLASH_ERROR_NONE) {// not verify
     printf("\n\r failed to write flash - %d", ret_val);
     return (ret_val);  
   }
 
-  //write data
-  dstFlashAddr = (uint32_t *)(start+sizeof(retain_flash_hdr));
-  ret_val = DRV_FLASH_Write(dstGpmAddr, dstFlashAddr, retainedSize, 0);
+#if (PWR_MNGR_EN_HIBERNATE_DELTA == 1)
+  if (EraseStaleDelta(start, retainedSize) != 0) {
+    printf("\n\r failed to erase the delta header");
+    return (-1);
+  }
+#endif
+
+  //write header last, it carries the time the data took
+  dstFlashAddr = (uint32_t *)start;
+  retain_flash_hdr retain_hdr;
+  memset(&retain_hdr, 0x0, sizeof(retain_flash_hdr));
+  retain_hdr.magic_num = RETAIN_FULL_MAGIC;
+  retain_hdr.size = retainedSize;
+#if (PWR_MNGR_EN_HIBERNATE_DELTA == 1)
+  retain_hdr.reserved1 = retainGeneration;
+#endif
+  retain_hdr.write_cycles = FlashWriteCycles();
+
+  ret_val = DRV_FLASH_Write(&retain_hdr, dstFlashAddr, sizeof(retain_flash_hdr), 0);
   if(ret_val != FLASH_ERROR_NONE) {// not verify
     printf("\n\r failed to write flash - %d", ret_val);
     return (ret_val);  
@@ -307,22 +1159,54 @@ int32_t hibernate_to_flash(void) {
 }
 
 int32_t hibernate_from_flash(void) {
-  uint32_t start = retain_flash_offset, *dstFlashAddr;
+  uint32_t start = retain_flash_offset, *dstFlashAddr, readStart;
   size_t retainedSize = 0;
   char *dstGpmAddr = __bss_gpm_start__;
 
+  CycleCounterStart();
+  readStart = DWT->CYCCNT;
+
   //read the header
   dstFlashAddr = (uint32_t *)start;
-  if (dstFlashAddr[0] != 0xdeadbeef) return (-2);
+#if (PWR_MNGR_EN_HIBERNATE_PIPELINE == 1)
+  if (dstFlashAddr[0] == RETAIN_STREAM_MAGIC) {
+    if (RestoreStreamImage((const retain_flash_hdr *)start) != 0) {
+      return (-3);
+    }
+    ProfileFlashRestore((const retain_flash_hdr *)start, readStart);
+    /* Decompression happened on the way, it has a phase of its own */
+    Profile.phase_cycles[HBN_PHASE_FLASH_READ] -= Profile.phase_cycles[HBN_PHASE_RESTORE];
+    return 0;
+  }
+#endif
+  if (dstFlashAddr[0] != RETAIN_FULL_MAGIC) return (-2);
 
   retainedSize = (size_t)dstFlashAddr[1];
 
+#if (PWR_MNGR_EN_HIBERNATE_DELTA == 1)
+  {
+    const retain_flash_hdr *baseHdr = (const retain_flash_hdr *)start;
+    const retain_flash_hdr *deltaHdr =
+        (const retain_flash_hdr *)DeltaHeaderOffset(start, retainedSize);
+
+    /* A delta of an older full image is left over, only one naming this generation is current */
+    if (deltaHdr->magic_num == RETAIN_DELTA_MAGIC && deltaHdr->reserved1 == baseHdr->reserved1) {
+      if (RestoreDeltaImage(baseHdr, deltaHdr) != 0) {
+        return (-3);
+      }
+      ProfileFlashRestore(deltaHdr, readStart);
+      return 0;
+    }
+  }
+#endif
+
   dstFlashAddr = (uint32_t *)(start+sizeof(retain_flash_hdr));
 
   if (DRV_FLASH_Read(dstFlashAddr, dstGpmAddr, retainedSize) != FLASH_ERROR_NONE) {
     printf("\n\rFailed to Read flash!!");
     return (-3);
   }
+  ProfileFlashRestore((const retain_flash_hdr *)start, readStart);
 
   return 0;
 }
@@ -338,44 +1222,16 @@ void hibernate_dbg_dump(void) {
 }
 
 int32_t hibernate_prepare_flash_space(size_t retained_size) {
-  uint32_t *dstFlashAddr, *probeAddr, asked_sz = retained_size, flash_offset_64KB, flash_offset_4KB, dbg_offset = 0; 
-  uint32_t mcu_image_sz_offset = MCU_PART_IMAGE_SZ_OFFSET, *mcu_image_sz = 0, available_sz = 0;
-
-  mcu_image_sz = (uint32_t *)mcu_image_sz_offset;
-  retain_flash_offset = 0;
-
-  // check remaining flash size is enough for rentention
-  available_sz = MCU_PARTITION_SIZE - *mcu_image_sz - retained_size - 0x1000;
-  if(available_sz < retained_size) {
-    HBN_LOG(1, "flash size is not enough");
-    return (-1);  
-  }
-
-  if(*mcu_image_sz == 0) 
-    return (-2);
-
-  flash_offset_64KB = ((*mcu_image_sz/65536) + 1)*65536 + MCU_PARTITION_OFFSET; //64KB alignment for 64KB erase
-  flash_offset_4KB = ((*mcu_image_sz/4096) + 1)*4096 + MCU_PARTITION_OFFSET; //4KB alignment for 4KB erase
-
-  if(available_sz >= 0x20000) {
-    retain_flash_offset = flash_offset_64KB;
-    dstFlashAddr = (uint32_t *)retain_flash_offset;
-    available_sz -= ((*mcu_image_sz/65536) + 1)*65536 - *mcu_image_sz;
+  char *dstFlashAddr;
+  uint32_t asked_sz = retained_size, available_sz = 0, dbg_offset = 0;
 
-    //erase previous header if necessary
-    probeAddr = (uint32_t *)flash_offset_4KB;
-    if(*probeAddr == 0xdeadbeef) { DRV_FLASH_Erase_Sector(probeAddr, 0, 1); }
-  } else {
-    retain_flash_offset = flash_offset_4KB; 
-    dstFlashAddr = (uint32_t *)retain_flash_offset;
-    available_sz -= ((*mcu_image_sz/4096) + 1)*4096 - *mcu_image_sz;
-
-    //erase previous header if necessary
-    probeAddr = (uint32_t *)flash_offset_64KB;
-    if(*probeAddr == 0xdeadbeef) { DRV_FLASH_Erase_Sector(probeAddr, 0, 1); }    
+  available_sz = SelectFlashOffset(retained_size);
+  if (available_sz == 0) {
+    return (-1);
   }
+  dstFlashAddr = (char *)retain_flash_offset;
 
-  //printf("\n\r offset[%lx] size[%lx] available_sz[%lx] retend_offset[%lx]", mcu_image_sz_offset, *mcu_image_sz, available_sz, retain_flash_offset);
+  //printf("\n\r size[%lx] available_sz[%lx] retend_offset[%lx]", asked_sz, available_sz, retain_flash_offset);
   dbg_offset = retain_flash_offset;
 
   while(asked_sz > 0) {
@@ -414,13 +1270,13 @@ void probe_flash_offset(void) {
   flash_offset_4KB = ((*mcu_image_sz/4096) + 1)*4096 + MCU_PARTITION_OFFSET; //4KB alignment for 4KB erase
 
   probeAddr = (uint32_t *)flash_offset_4KB;
-  if(*probeAddr == 0xdeadbeef) { 
+  if(IS_RETAIN_MAGIC(*probeAddr)) { 
     retain_flash_offset = flash_offset_4KB; 
     return;
   } 
 
   probeAddr = (uint32_t *)flash_offset_64KB;
-  if(*probeAddr == 0xdeadbeef) { 
+  if(IS_RETAIN_MAGIC(*probeAddr)) { 
     retain_flash_offset = flash_offset_64KB; 
     return;
   } 
@@ -428,6 +1284,31 @@ void probe_flash_offset(void) {
 
 #endif
 
+#if (PWR_MNGR_EN_HIBERNATE_SHUTDOWN == 1)
+/**
+ * Get the flash ready for the image compressed up to streamEnd.
+ *
+ * @return 0 on success, -2 to fall back to standby
+ */
+static int32_t PrepareFlashImage(char *streamEnd) {
+  size_t retainedSize = (size_t)(streamEnd - __bss_gpm_start__);
+
+#if (PWR_MNGR_EN_HIBERNATE_DELTA == 1)
+  if (PlanDeltaImage(streamEnd) == 0) {
+    return 0;
+  }
+#endif
+#if (PWR_MNGR_EN_HIBERNATE_PIPELINE == 1)
+  if (streamFlash != NULL) {
+    return 0;
+  }
+#endif
+  if((hibernate_prepare_flash_space(retainedSize) != 0) || (retain_flash_offset == 0))
+    return (-2);
+  return 0;
+}
+#endif
+
 /**
  * Perform any actions needed to prepare for hibernation.
  *
@@ -437,22 +1318,53 @@ void probe_flash_offset(void) {
  */
 int32_t hibernate_to_gpm(PWR_MNGR_PwrMode pwr_mode) {
   struct hibernate_free_block *freeList;
-  size_t region, srcSize, dstSize, accSrcLen = 0, accDstLen = 0;
+  struct free_range freeRanges[MAX_FREE_RANGES];
+  size_t region, srcSize, dstSize, accSrcLen = 0, accDstLen = 0, numFreeRanges, constBlocks = 0;
+  int fill;
   char *dstAddr = __gpm_compress_start__, *srcAddr;
+  struct hibernate_region_profile *regionProfile;
+  uint32_t phaseStart, regionStart, seq = Profile.seq;
+  char *recordStart, *scratch, *inplaceScratch;
+  ptrdiff_t lead;
+  bool storeOnly;
 #if (PWR_MNGR_EN_HIBERNATE_SHUTDOWN == 1)
-  size_t retainedSize = 0;
-  char *dstGpmAddr = __bss_gpm_start__;
+  int32_t ret;
+#endif
+
+  CycleCounterStart();
+  memset(CodecStats, 0, sizeof(CodecStats));
+  memset(&Profile, 0, sizeof(Profile));
+  Profile.version = HBN_PROFILE_VERSION;
+  Profile.seq = seq + 1;
+  Profile.core_clock_hz = SystemCoreClock;
+  Profile.min_inplace_lead = INT32_MAX;
+  Profile.compress_space = (uint32_t)(__gpm_compress_end__ - __gpm_compress_start__);
+
+#if (PWR_MNGR_EN_HIBERNATE_SHUTDOWN == 1) && (PWR_MNGR_EN_HIBERNATE_PIPELINE == 1)
+  streamFlash = NULL;
+  if (pwr_mode == PWR_MNGR_MODE_SHUTDOWN) {
+    phaseStart = DWT->CYCCNT;
+    StreamBegin();
+    Profile.phase_cycles[HBN_PHASE_FLASH_PREPARE] = DWT->CYCCNT - phaseStart;
+  }
 #endif
   /* Get all unused memory and zero it so it compresses well.
    * Other methods were examined, such adding special code to
    * handle free memory without zeroing it; however this was
    * found to have minimal effect on compression times. */
+  phaseStart = DWT->CYCCNT;
   GetFreeList(&freeList);
-  ZeroFreeMem(freeList);
+  numFreeRanges = GetFreeRanges(freeList, freeRanges);
+  scratch = GetScratch(freeRanges, numFreeRanges);
+  Profile.phase_cycles[HBN_PHASE_FREE_LIST] = DWT->CYCCNT - phaseStart;
+  ZeroFreeMem(freeList, &Profile);
 
+  phaseStart = DWT->CYCCNT;
   for (region = 0; region < sizeof(MemRegions) / sizeof(MemRegions[0]); ++region) {
     HBN_LOG(3, "Region%zu, start:%p, end:%p, len:%zu\n", region, MemRegions[region].start,
             MemRegions[region].end, (size_t)(MemRegions[region].end - MemRegions[region].start));
+    regionProfile = &Profile.regions[region];
+    regionStart = DWT->CYCCNT;
     for (srcAddr = MemRegions[region].start; srcAddr < MemRegions[region].end;
          srcAddr += WORKING_BLOCK_SIZE) {
       srcSize = MemRegions[region].end - srcAddr;
@@ -460,41 +1372,95 @@ int32_t hibernate_to_gpm(PWR_MNGR_PwrMode pwr_mode) {
         srcSize = WORKING_BLOCK_SIZE;
       }
 
+      /* The GPM heap is compressed in place, output must stay behind the input */
+      inplaceScratch = NULL;
+      storeOnly = false;
+      if (region == 0) {
+        lead = srcAddr - dstAddr;
+        if (lead < Profile.min_inplace_lead) {
+          Profile.min_inplace_lead = lead;
+        }
+        if (lead < (ptrdiff_t)MAX_COMPRESSED_BLOCK_SIZE) {
+          if (scratch == NULL && lead < (ptrdiff_t)RECORD_TRAILER_SIZE) {
+            HBN_LOG(1, "In-place compression caught up with its input, src:%p, dst:%p\n", srcAddr,
+                    dstAddr);
+            DecompressPartial(region, srcAddr, dstAddr);
+            return (-1);
+          }
+          inplaceScratch = scratch;
+          storeOnly = scratch == NULL;
+        }
+      }
+
       /* Here we check if reamin compression buffer large enough for next source block */
       if ((size_t)(__gpm_compress_end__ - dstAddr) < MAX_COMPRESSED_BLOCK_SIZE) {
         HBN_LOG(1, "Remain compressing buffer insufficient, srcSize:%zu, remain: %zu\n", srcSize,
                 (size_t)(__gpm_compress_end__ - dstAddr));
-        DecompressPartial(region, srcAddr - WORKING_BLOCK_SIZE, dstAddr);
+        DecompressPartial(region, srcAddr, dstAddr);
         return (-1);
       }
 
-      dstSize = fastlz_compress_level(1, srcAddr, srcSize, dstAddr);
-
-      HBN_LOG(3, "Compress src:%p, srcSize:%zu, dst:%p, dstSize:%zu, ratio: %f\n", srcAddr, srcSize,
-              dstAddr, dstSize, (float)srcSize / dstSize);
-      dstAddr += dstSize;
+      recordStart = dstAddr;
+      fill = GetConstBlockFill(srcAddr, srcSize, freeRanges, numFreeRanges);
+      if (fill >= 0) {
+        /* Only the trailer is stored, the fill byte takes the place of the payload size */
+        constBlocks++;
+        regionProfile->const_blocks++;
+        CodecStats[HBN_CODEC_FILL].blocks++;
+        CodecStats[HBN_CODEC_FILL].raw_bytes += srcSize;
+        dstAddr = WriteRecordTrailer(dstAddr, 0, CONST_BLOCK_FLAG | (size_t)fill, srcSize);
+      } else if (storeOnly) {
+        /* No scratch to compress in, a stored block shortens the lead by its trailer only */
+        dstSize = StoreBlock(srcAddr, srcSize, dstAddr);
+        accDstLen += dstSize & BLOCK_SIZE_MASK;
+        regionProfile->stored_blocks++;
+        dstAddr = WriteRecordTrailer(dstAddr, dstSize & BLOCK_SIZE_MASK, dstSize, srcSize);
+      } else {
+        dstSize = CompressBlock(srcAddr, srcSize, dstAddr, inplaceScratch);
+
+        HBN_LOG(3, "Compress src:%p, srcSize:%zu, dst:%p, dstSize:%zu, ratio: %f\n", srcAddr,
+                srcSize, dstAddr, dstSize & BLOCK_SIZE_MASK,
+                (float)srcSize / (dstSize & BLOCK_SIZE_MASK));
+        accDstLen += dstSize & BLOCK_SIZE_MASK;
+        if ((dstSize & BLOCK_CODEC_MASK) == ((size_t)HBN_CODEC_STORE << BLOCK_CODEC_SHIFT)) {
+          regionProfile->stored_blocks++;
+        }
+
+        /* Then place the checksum and the compressed/original size of each block at the end of
+        the block */
+        dstAddr = WriteRecordTrailer(dstAddr, dstSize & BLOCK_SIZE_MASK, dstSize, srcSize);
+      }
       accSrcLen += srcSize;
-      accDstLen += dstSize;
-
-      /* Then place the compressed/original size of each block at the end of the block.
-      Memcpy to avoid alignment issues */
-      memcpy(dstAddr, &dstSize, sizeof(size_t));
-      dstAddr += sizeof(size_t);
-      memcpy(dstAddr, &srcSize, sizeof(size_t));
-      dstAddr += sizeof(size_t);
+      regionProfile->blocks++;
+      regionProfile->raw_bytes += srcSize;
+      regionProfile->packed_bytes += dstAddr - recordStart;
+
+#if (PWR_MNGR_EN_HIBERNATE_SHUTDOWN == 1) && (PWR_MNGR_EN_HIBERNATE_PIPELINE == 1)
+      /* Keep the flash busy with what is ready while the next block compresses */
+      if (streamFlash != NULL && StreamPump(dstAddr, false) < 0) {
+        streamFlash = NULL;
+      }
+#endif
+    }
+    if (region == 0 && scratch != NULL) {
+      memset(scratch, 0, MAX_COMPRESSED_BLOCK_SIZE);
     }
+    regionProfile->compress_cycles = DWT->CYCCNT - regionStart;
   }
+  Profile.phase_cycles[HBN_PHASE_COMPRESS] = DWT->CYCCNT - phaseStart;
 
-  HBN_LOG(3, "accSrcLen:%zu, accDstLen:%zu, ratio: %f, remain: %zu\n", accSrcLen, accDstLen,
-          (float)accSrcLen / accDstLen, (size_t)(__gpm_compress_end__ - dstAddr));
+  HBN_LOG(3, "accSrcLen:%zu, accDstLen:%zu, ratio: %f, remain: %zu, constant blocks: %zu\n",
+          accSrcLen, accDstLen, (float)accSrcLen / accDstLen,
+          (size_t)(__gpm_compress_end__ - dstAddr), constBlocks);
   EndOfCompressedMem = dstAddr;
+  Profile.image_bytes = (uint32_t)(dstAddr - __gpm_compress_start__);
 
-  //hexDump("hibernate_to_gpm", dstGpmAddr, retainedSize+4);
 #if (PWR_MNGR_EN_HIBERNATE_SHUTDOWN == 1)
   if(pwr_mode == PWR_MNGR_MODE_SHUTDOWN) {
-    retainedSize = (size_t)(dstAddr - dstGpmAddr);
-    if((hibernate_prepare_flash_space(retainedSize) != 0) || (retain_flash_offset == 0))
-      return (-2);
+    phaseStart = DWT->CYCCNT;
+    ret = PrepareFlashImage(dstAddr);
+    Profile.phase_cycles[HBN_PHASE_FLASH_PREPARE] += DWT->CYCCNT - phaseStart;
+    return ret;
   }
 #endif
   return 0;
@@ -509,6 +1475,14 @@ int32_t hibernate_to_gpm(PWR_MNGR_PwrMode pwr_mode) {
 int32_t hibernate_from_gpm(void) {
   static const size_t lastRegion = sizeof(MemRegions) / sizeof(MemRegions[0]) - 1;
 
+#if (PWR_MNGR_EN_HIBERNATE_SHUTDOWN == 1) && (PWR_MNGR_EN_HIBERNATE_PIPELINE == 1)
+  if (streamRestored) {
+    /* Decompressed straight from flash by hibernate_from_flash() */
+    streamRestored = 0;
+    return 0;
+  }
+#endif
+
   return DecompressPartial(lastRegion, MemRegions[lastRegion].end, EndOfCompressedMem);
 }
 
@@ -527,7 +1501,7 @@ void hibernate_get_free_blocks(struct hibernate_free_block **freeListPtr) {
  * DEBUG API - Zero all free blocks in the system
  */
 void hibernate_zero_free_blocks(struct hibernate_free_block *freeListPtr) {
-  ZeroFreeMem(freeListPtr);
+  ZeroFreeMem(freeListPtr, NULL);
 }
 
 /**
@@ -535,3 +1509,93 @@ void hibernate_zero_free_blocks(struct hibernate_free_block *freeListPtr) {
  * unused memory
  */
 void hibernate_restore_stacks(void) { RestoreFreeStack(); }
+
+/**
+ * DEBUG API - Get the codec counters of the last hibernation and restore
+ */
+void hibernate_get_codec_stats(struct hibernate_codec_stats *stats) {
+  memcpy(stats, CodecStats, sizeof(CodecStats));
+}
+
+/**
+ * DEBUG API - Print the codec counters of the last hibernation and restore
+ */
+void hibernate_dbg_codec_report(void) {
+  int codec;
+
+  printf("codec   blocks      raw   packed  compress(cyc) decompress(cyc)\r\n");
+  for (codec = 0; codec < HBN_CODEC_NUM; ++codec) {
+    printf("%-7s %6lu %8lu %8lu %14lu %15lu\r\n", CodecNames[codec],
+           (unsigned long)CodecStats[codec].blocks, (unsigned long)CodecStats[codec].raw_bytes,
+           (unsigned long)CodecStats[codec].packed_bytes,
+           (unsigned long)CodecStats[codec].compress_cycles,
+           (unsigned long)CodecStats[codec].decompress_cycles);
+  }
+}
+
+/**
+ * DEBUG API - Get the profile of the last hibernation and restore
+ */
+void hibernate_get_profile(struct hibernate_profile *profile) {
+  memcpy(profile, &Profile, sizeof(Profile));
+}
+
+/**
+ * DEBUG API - Print the profile of the last hibernation and restore
+ */
+void hibernate_dbg_profile_report(bool raw) {
+  static const char *const phaseNames[HBN_PHASE_NUM] = {
+      "free list", "heap zero", "stack fill", "compress",
+      "flash prep", "flash write", "flash read", "restore"};
+  const uint32_t *words;
+  uint32_t cyclesPerUs = Profile.core_clock_hz / 1000000;
+  size_t i;
+  int codec;
+
+  if (raw) {
+    /* One line per structure, parsed by utils/hbnreport.py */
+    words = (const uint32_t *)&Profile;
+    printf("HBNPROF");
+    for (i = 0; i < sizeof(Profile) / sizeof(uint32_t); ++i) {
+      printf(" %08lx", (unsigned long)words[i]);
+    }
+    printf("\r\n");
+    for (codec = 0; codec < HBN_CODEC_NUM; ++codec) {
+      words = (const uint32_t *)&CodecStats[codec];
+      printf("HBNCODEC %d", codec);
+      for (i = 0; i < sizeof(CodecStats[0]) / sizeof(uint32_t); ++i) {
+        printf(" %08lx", (unsigned long)words[i]);
+      }
+      printf("\r\n");
+    }
+    return;
+  }
+
+  if (Profile.version != HBN_PROFILE_VERSION || cyclesPerUs == 0) {
+    printf("No hibernation profiled\r\n");
+    return;
+  }
+  printf("hibernation #%lu, %lu Hz\r\n", (unsigned long)Profile.seq,
+         (unsigned long)Profile.core_clock_hz);
+  printf("phase           cycles         us\r\n");
+  for (i = 0; i < HBN_PHASE_NUM; ++i) {
+    printf("%-11s %10lu %10lu\r\n", phaseNames[i], (unsigned long)Profile.phase_cycles[i],
+           (unsigned long)(Profile.phase_cycles[i] / cyclesPerUs));
+  }
+  printf("region      raw   packed blocks const stored  compress(cyc)  restore(cyc)\r\n");
+  for (i = 0; i < HBN_PROFILE_REGIONS; ++i) {
+    printf("%-6u %8lu %8lu %6lu %5lu %6lu %14lu %13lu\r\n", (unsigned)i,
+           (unsigned long)Profile.regions[i].raw_bytes,
+           (unsigned long)Profile.regions[i].packed_bytes, (unsigned long)Profile.regions[i].blocks,
+           (unsigned long)Profile.regions[i].const_blocks,
+           (unsigned long)Profile.regions[i].stored_blocks,
+           (unsigned long)Profile.regions[i].compress_cycles,
+           (unsigned long)Profile.regions[i].restore_cycles);
+  }
+  printf("free: %lu blocks, heap %lu bytes, stacks %lu bytes\r\n",
+         (unsigned long)Profile.free_blocks, (unsigned long)Profile.free_heap_bytes,
+         (unsigned long)Profile.free_stack_bytes);
+  printf("image: %lu of %lu bytes, min in-place lead %ld (block bound %lu)\r\n",
+         (unsigned long)Profile.image_bytes, (unsigned long)Profile.compress_space,
+         (long)Profile.min_inplace_lead, (unsigned long)MAX_COMPRESSED_BLOCK_SIZE);
+}
@@ -0,0 +1,209 @@
+/*  ---------------------------------------------------------------------------
+
+    (c) copyright 2021 Altair Semiconductor, Ltd. All rights reserved.
+
+    This software, in source or object form (the "Software"), is the
+    property of Altair Semiconductor Ltd. (the "Company") and/or its
+    licensors, which have all right, title and interest therein, You
+    may use the Software only in  accordance with the terms of written
+    license agreement between you and the Company (the "License").
+    Except as expressly stated in the License, the Company grants no
+    licenses by implication, estoppel, or otherwise. If you are not
+    aware of or do not agree to the License terms, you may not use,
+    copy or modify the Software. You may use the source code of the
+    Software only for your internal purposes and may not distribute the
+    source code of the Software, any part thereof, or any derivative work
+    thereof, to any third party, except pursuant to the Company's prior
+    written consent.
+    The Software is the confidential information of the Company.
+
+   ------------------------------------------------------------------------- */
+
+/*
+  LZ4 block format: a sequence is a token (literal length in the high nibble, match length - 4 in
+  the low nibble, 15 meaning more length bytes follow), the literals, and a 16-bit little endian
+  match offset.  The last sequence has literals only.  Decoding is a pair of copies per sequence
+  with no bit parsing, which is what makes it cheaper than FastLZ on the way back from sleep.
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include "lz4blk.h"
+
+#define MIN_MATCH 4
+#define LAST_LITERALS 5 /* the format requires the last 5 bytes to be literals */
+#define MF_LIMIT 12     /* and no match to start in the last 12 bytes */
+#define RUN_MASK 15
+#define HASH_LOG 10
+#define HASH_SIZE (1 << HASH_LOG)
+
+static inline uint32_t Read32(const uint8_t* p) {
+  uint32_t v;
+
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint32_t Hash(uint32_t v) { return (v * 2654435761U) >> (32 - HASH_LOG); }
+
+static uint8_t* WriteLength(uint8_t* op, size_t len) {
+  for (; len >= 255; len -= 255) {
+    *op++ = 255;
+  }
+  *op++ = (uint8_t)len;
+  return op;
+}
+
+int lz4blk_compress(const void* input, int length, void* output) {
+  const uint8_t* base = (const uint8_t*)input;
+  const uint8_t* ip = base;
+  const uint8_t* anchor = base;
+  const uint8_t* iend = base + length;
+  const uint8_t* mflimit = iend - MF_LIMIT;
+  const uint8_t* matchlimit = iend - LAST_LITERALS;
+  uint8_t* op = (uint8_t*)output;
+  uint8_t* token;
+  uint16_t htab[HASH_SIZE]; /* positions, blocks are below 64KB */
+  size_t litLen;
+
+  if (length > MF_LIMIT) {
+    memset(htab, 0, sizeof(htab));
+    ip++;
+
+    while (ip < mflimit) {
+      const uint8_t *ref, *matchStart;
+      uint32_t seq = Read32(ip);
+      uint32_t h = Hash(seq);
+      size_t matchLen;
+
+      ref = base + htab[h];
+      htab[h] = (uint16_t)(ip - base);
+      if (Read32(ref) != seq || ref >= ip) {
+        ip++;
+        continue;
+      }
+
+      /* Catch up on bytes the hash missed */
+      while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+        ip--;
+        ref--;
+      }
+
+      litLen = ip - anchor;
+      token = op++;
+      if (litLen >= RUN_MASK) {
+        *token = RUN_MASK << 4;
+        op = WriteLength(op, litLen - RUN_MASK);
+      } else {
+        *token = (uint8_t)(litLen << 4);
+      }
+      memmove(op, anchor, litLen);
+      op += litLen;
+
+      *op++ = (uint8_t)(ip - ref);
+      *op++ = (uint8_t)((ip - ref) >> 8);
+
+      matchStart = ip;
+      ip += MIN_MATCH;
+      ref += MIN_MATCH;
+      while (ip < matchlimit && *ip == *ref) {
+        ip++;
+        ref++;
+      }
+      matchLen = ip - matchStart - MIN_MATCH;
+      if (matchLen >= RUN_MASK) {
+        *token |= RUN_MASK;
+        op = WriteLength(op, matchLen - RUN_MASK);
+      } else {
+        *token |= (uint8_t)matchLen;
+      }
+      anchor = ip;
+
+      if (ip < mflimit) {
+        htab[Hash(Read32(ip - 2))] = (uint16_t)(ip - 2 - base);
+      }
+    }
+  }
+
+  litLen = iend - anchor;
+  token = op++;
+  if (litLen >= RUN_MASK) {
+    *token = RUN_MASK << 4;
+    op = WriteLength(op, litLen - RUN_MASK);
+  } else {
+    *token = (uint8_t)(litLen << 4);
+  }
+  memmove(op, anchor, litLen);
+  op += litLen;
+
+  return (int)(op - (uint8_t*)output);
+}
+
+static inline int ReadLength(const uint8_t** ip, const uint8_t* iend, size_t* len) {
+  uint8_t s;
+
+  do {
+    if (*ip >= iend) {
+      return -1;
+    }
+    s = *(*ip)++;
+    *len += s;
+  } while (s == 255);
+  return 0;
+}
+
+int lz4blk_decompress(const void* input, int length, void* output, int maxout) {
+  const uint8_t* ip = (const uint8_t*)input;
+  const uint8_t* iend = ip + length;
+  uint8_t* op = (uint8_t*)output;
+  uint8_t* oend = op + maxout;
+
+  while (ip < iend) {
+    uint8_t token = *ip++;
+    size_t litLen = token >> 4, matchLen = token & RUN_MASK, offset;
+    const uint8_t* ref;
+
+    if (litLen == RUN_MASK && ReadLength(&ip, iend, &litLen) != 0) {
+      return 0;
+    }
+    if (litLen > (size_t)(iend - ip) || litLen > (size_t)(oend - op)) {
+      return 0;
+    }
+    memmove(op, ip, litLen);
+    op += litLen;
+    ip += litLen;
+
+    if (ip >= iend) {
+      break; /* the last sequence has no match */
+    }
+
+    if (iend - ip < 2) {
+      return 0;
+    }
+    offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > (size_t)(op - (uint8_t*)output)) {
+      return 0;
+    }
+    if (matchLen == RUN_MASK && ReadLength(&ip, iend, &matchLen) != 0) {
+      return 0;
+    }
+    matchLen += MIN_MATCH;
+    if (matchLen > (size_t)(oend - op)) {
+      return 0;
+    }
+
+    ref = op - offset;
+    if (offset >= matchLen) {
+      memcpy(op, ref, matchLen);
+      op += matchLen;
+    } else {
+      /* overlapping match, repeats the last offset bytes */
+      while (matchLen--) {
+        *op++ = *ref++;
+      }
+    }
+  }
+
+  return (int)(op - (uint8_t*)output);
+}
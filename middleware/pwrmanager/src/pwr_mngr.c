@@ -27,6 +27,7 @@
 
 /* Kernel includes. */
 #include "DRV_GPIO.h"
+#include "DRV_UART.h"
 #include "pwr_mngr.h"
 #include "DRV_PM.h"
 #include "DRV_IF_CFG.h"
@@ -63,6 +64,10 @@
     alt_osal_unlock_mutex(handle); \
   } while (0)
 
+/* Learnt costs are kept in 1/16 ms and move 1/8 of the way to each new sample */
+#define PWR_MNGR_PLAN_COST_SHIFT 4
+#define PWR_MNGR_PLAN_LEARN_SHIFT 3
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -89,7 +94,15 @@ static PWR_MNGR_MonGpioList mon_gpio_list = {0};
 
 /* UART inactive time */
 static uint32_t uart_inactivity_time = 5; /* in units of second */
-static volatile uint32_t last_uart_interupt;
+
+/* UART receive activity, recorded once per burst in tick count. Time is only derived when read. */
+typedef struct {
+  volatile uint32_t last_tick;
+  volatile uint32_t activity_cnt;
+  volatile uint32_t max_idle_tick;
+} PWR_MNGR_UartActivityRecord;
+
+static PWR_MNGR_UartActivityRecord uart_activity[DRV_UART_MAX];
 
 static int32_t allow_to_sleep = 0;
 static uint32_t sleep_cnt;
@@ -97,6 +110,27 @@ static uint32_t enter_sleep;
 static bool is_initialized = false;
 
 static alt_osal_mutex_handle pwr_mngr_mtx = NULL;
+
+/* Sleep planner. The idle hook reads the hints unlocked, it runs below every task that sets them */
+typedef struct {
+  uint32_t tick;   /* next activity */
+  uint32_t period; /* in ticks, 0 for a single activity */
+  bool valid;
+} PWR_MNGR_ActivityHint;
+
+static PWR_MNGR_ActivityHint activity_hint[PWR_MNGR_HINT_MAX];
+static PWR_MNGR_SleepPlan sleep_plan;
+static uint32_t plan_cost[PWR_MNGR_MODE_SHUTDOWN + 1] = {
+    [PWR_MNGR_MODE_STOP] = PWR_MNGR_PLAN_STOP_COST_MS << PWR_MNGR_PLAN_COST_SHIFT,
+    [PWR_MNGR_MODE_STANDBY] = PWR_MNGR_PLAN_STANDBY_COST_MS << PWR_MNGR_PLAN_COST_SHIFT,
+    [PWR_MNGR_MODE_SHUTDOWN] = PWR_MNGR_PLAN_SHUTDOWN_COST_MS << PWR_MNGR_PLAN_COST_SHIFT};
+static uint32_t plan_learnt; /* bit per mode, the first sample replaces the default cost */
+static const uint32_t plan_current_ua[PWR_MNGR_MODE_SHUTDOWN + 1] = {
+    [PWR_MNGR_MODE_RUN] = PWR_MNGR_PLAN_RUN_UA,
+    [PWR_MNGR_MODE_SLEEP] = PWR_MNGR_PLAN_SLEEP_UA,
+    [PWR_MNGR_MODE_STOP] = PWR_MNGR_PLAN_STOP_UA,
+    [PWR_MNGR_MODE_STANDBY] = PWR_MNGR_PLAN_STANDBY_UA,
+    [PWR_MNGR_MODE_SHUTDOWN] = PWR_MNGR_PLAN_SHUTDOWN_UA};
 /****************************************************************************
  * Private Function Prototypes
  ****************************************************************************/
@@ -108,6 +142,7 @@ static void pm_sleep_disable(void);
 static void update_sleep_manager_counter(unsigned long sync_mask, unsigned long async_mask);
 static int32_t pwr_check_uart_inactive_time(void);
 static int32_t pwr_mngr_check_mon_gpio_busy(void);
+static uint32_t pwr_mngr_plan_idle_time(uint32_t idle_ms);
 
 /****************************************************************************
  * Private Functions
@@ -152,6 +187,7 @@ static void pm_conf_init(void) {
  */
 static int32_t pwr_check_uart_inactive_time(void) {
   uint32_t now = alt_osal_get_tick_count() / portTICK_PERIOD_MS;
+  uint32_t last_uart_interupt = uart_activity[DRV_UART_F0].last_tick / portTICK_PERIOD_MS;
   uint32_t uart_interupt_delta = 0;
   int32_t ret_val = 0;
 
@@ -160,7 +196,7 @@ static int32_t pwr_check_uart_inactive_time(void) {
   } else {
     /* calculate UART inactivity time */
     if (last_uart_interupt == 0) {
-      last_uart_interupt = now;
+      uart_activity[DRV_UART_F0].last_tick = alt_osal_get_tick_count();
       uart_interupt_delta = 0;
     } else {
       uart_interupt_delta = ((now / 1000) - (last_uart_interupt / 1000));
@@ -256,6 +292,49 @@ static int32_t pwr_mngr_check_mon_gpio_busy(void) {
   return 0;
 }
 
+/*-----------------------------------------------------------------------------
+ * static uint32_t pwr_mngr_plan_idle_time(uint32_t idle_ms)
+ * PURPOSE: This function would predict the idle window from the next RTOS timer
+ *          and the activity hints.
+ * PARAMs:
+ *      INPUT:  uint32_t idle_ms - time to the next RTOS timer
+ *      OUTPUT: None
+ * RETURN:  predicted idle time in ms.
+ *-----------------------------------------------------------------------------
+ */
+static uint32_t pwr_mngr_plan_idle_time(uint32_t idle_ms) {
+  PWR_MNGR_ActivityHint *hint;
+  uint32_t now = alt_osal_get_tick_count(), left, missed;
+  int32_t src;
+  bool cut = false;
+
+  if (sleep_conf.duration != 0 && idle_ms > sleep_conf.duration) idle_ms = sleep_conf.duration;
+
+  for (src = 0; src < PWR_MNGR_HINT_MAX; src++) {
+    hint = &activity_hint[src];
+    if (!hint->valid) continue;
+
+    if ((int32_t)(hint->tick - now) <= 0) {
+      if (hint->period == 0) {
+        hint->valid = false;
+        continue;
+      }
+      /* Move a repeating hint to its next occurrence */
+      missed = (now - hint->tick) / hint->period + 1;
+      hint->tick += missed * hint->period;
+    }
+
+    left = (hint->tick - now) * portTICK_PERIOD_MS;
+    if (left < idle_ms) {
+      idle_ms = left;
+      cut = true;
+    }
+  }
+  if (cut) sleep_plan.hint_cut++;
+
+  return idle_ms;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -452,6 +531,31 @@ void pwr_mngr_post_sleep_process(uint32_t idle_time, PWR_MNGR_PwrMode pwr_mode)
   return;
 }
 
+/*-----------------------------------------------------------------------------
+ * void pwr_mngr_refresh_uart_activity(uint32_t port)
+ * PURPOSE: This function would record a burst of UART receive activity.
+ *          Safe to call from interrupt context.
+ * PARAMs:
+ *      INPUT:  uint32_t port (DRV_UART_Port)
+ *      OUTPUT: None
+ * RETURN:  None
+ *-----------------------------------------------------------------------------
+ */
+void pwr_mngr_refresh_uart_activity(uint32_t port) {
+  PWR_MNGR_UartActivityRecord *rec;
+  uint32_t now, idle;
+
+  if (port >= DRV_UART_MAX) return;
+
+  rec = &uart_activity[port];
+  now = alt_osal_get_tick_count();
+  idle = now - rec->last_tick;
+  if (rec->activity_cnt != 0 && idle > rec->max_idle_tick) rec->max_idle_tick = idle;
+
+  rec->last_tick = now;
+  rec->activity_cnt++;
+}
+
 /*-----------------------------------------------------------------------------
  * void pwr_mngr_refresh_uart_inactive_time(void)
  * PURPOSE: This function would refresh last UART interrupt time.
@@ -461,10 +565,32 @@ void pwr_mngr_post_sleep_process(uint32_t idle_time, PWR_MNGR_PwrMode pwr_mode)
  * RETURN:  None
  *-----------------------------------------------------------------------------
  */
-void pwr_mngr_refresh_uart_inactive_time(void) {
-  volatile uint32_t now = alt_osal_get_tick_count() / portTICK_PERIOD_MS;
+void pwr_mngr_refresh_uart_inactive_time(void) { pwr_mngr_refresh_uart_activity(DRV_UART_F0); }
+
+/*-----------------------------------------------------------------------------
+ * int32_t pwr_mngr_get_uart_activity(uint32_t port, PWR_MNGR_UartActivity *activity)
+ * PURPOSE: This function would get the receive activity statistics of a UART port.
+ * PARAMs:
+ *      INPUT:  uint32_t port (DRV_UART_Port)
+ *      OUTPUT: pointer of PWR_MNGR_UartActivity
+ * RETURN:  error code. 0-success; other-fail
+ *-----------------------------------------------------------------------------
+ */
+int32_t pwr_mngr_get_uart_activity(uint32_t port, PWR_MNGR_UartActivity *activity) {
+  PWR_MNGR_UartActivityRecord *rec;
+  uint32_t last_tick;
+
+  if (port >= DRV_UART_MAX || activity == NULL) return (-1);
 
-  last_uart_interupt = now;
+  rec = &uart_activity[port];
+  last_tick = rec->last_tick;
+
+  activity->activity_cnt = rec->activity_cnt;
+  activity->idle_time =
+      (rec->activity_cnt == 0) ? 0 : (alt_osal_get_tick_count() - last_tick) * portTICK_PERIOD_MS;
+  activity->max_idle_time = rec->max_idle_tick * portTICK_PERIOD_MS;
+
+  return 0;
 }
 
 /*-----------------------------------------------------------------------------
@@ -699,3 +825,138 @@ PWR_MNGR_Status pwr_mngr_del_monitor_io(GPIO_Id gpio_id) { /* Not allow duplicat
 
   return ret_val;
 }
+
+/*-----------------------------------------------------------------------------
+ * PWR_MNGR_Status pwr_mngr_set_activity_hint(PWR_MNGR_HintSrc src, uint32_t delay_ms,
+ *                                            uint32_t period_ms)
+ * PURPOSE: This function would set when a source expects activity next.
+ * PARAMs:
+ *      INPUT:  src - source of the hint
+ *              delay_ms - time to the next activity, 0 to remove the hint
+ *              period_ms - period of the activity, 0 for a single one
+ *      OUTPUT: None
+ * RETURN:  PWR_MNGR_Status.
+ *-----------------------------------------------------------------------------
+ */
+PWR_MNGR_Status pwr_mngr_set_activity_hint(PWR_MNGR_HintSrc src, uint32_t delay_ms,
+                                           uint32_t period_ms) {
+  PWR_MNGR_ActivityHint *hint;
+
+  if (!is_initialized) return (PWR_MNGR_NOT_INIT);
+
+  if (src >= PWR_MNGR_HINT_MAX) return (PWR_MNGR_GEN_ERROR);
+
+  hint = &activity_hint[src];
+  PWR_MNGR_LOCK(&pwr_mngr_mtx);
+  hint->valid = false;
+  if (delay_ms != 0) {
+    hint->tick = alt_osal_get_tick_count() + delay_ms / portTICK_PERIOD_MS;
+    hint->period = period_ms / portTICK_PERIOD_MS;
+    hint->valid = true;
+  }
+  PWR_MNGR_UNLOCK(&pwr_mngr_mtx);
+
+  return PWR_MNGR_OK;
+}
+
+/*-----------------------------------------------------------------------------
+ * PWR_MNGR_PwrMode pwr_mngr_plan_sleep(PWR_MNGR_PwrMode max_mode, uint32_t idle_ms)
+ * PURPOSE: This function would pick the mode which spends the least energy over
+ *          the predicted idle window. A mode costs its learnt enter and wake up
+ *          time at run current, then sleeps the rest of the window, so deeper
+ *          modes only win once the window is past their break-even time.
+ * PARAMs:
+ *      INPUT:  max_mode - configured power mode
+ *              idle_ms - time to the next RTOS timer
+ *      OUTPUT: None
+ * RETURN:  PWR_MNGR_PwrMode.
+ *-----------------------------------------------------------------------------
+ */
+PWR_MNGR_PwrMode pwr_mngr_plan_sleep(PWR_MNGR_PwrMode max_mode, uint32_t idle_ms) {
+  PWR_MNGR_PwrMode mode, best = PWR_MNGR_MODE_SLEEP;
+  uint64_t energy, best_energy;
+  uint32_t cost;
+
+  if (max_mode <= PWR_MNGR_MODE_SLEEP || max_mode > PWR_MNGR_MODE_SHUTDOWN) return max_mode;
+
+  /* Energy in uA x 1/16 ms */
+  idle_ms = pwr_mngr_plan_idle_time(idle_ms);
+  best_energy = ((uint64_t)idle_ms << PWR_MNGR_PLAN_COST_SHIFT) * plan_current_ua[best];
+  for (mode = PWR_MNGR_MODE_STOP; mode <= max_mode; mode++) {
+    cost = plan_cost[mode];
+    if (cost >= ((uint64_t)idle_ms << PWR_MNGR_PLAN_COST_SHIFT)) break;
+
+    energy = (uint64_t)cost * plan_current_ua[PWR_MNGR_MODE_RUN] +
+             (((uint64_t)idle_ms << PWR_MNGR_PLAN_COST_SHIFT) - cost) * plan_current_ua[mode];
+    if (energy < best_energy) {
+      best_energy = energy;
+      best = mode;
+    }
+  }
+
+  sleep_plan.last_idle_ms = idle_ms;
+  sleep_plan.chosen[best]++;
+  if (best != max_mode) sleep_plan.downgraded++;
+
+  return best;
+}
+
+/*-----------------------------------------------------------------------------
+ * void pwr_mngr_plan_learn(PWR_MNGR_PwrMode pwr_mode, uint32_t overhead_ms)
+ * PURPOSE: This function would update the learnt cost of a sleep mode. The
+ *          flash write and the restore of a hibernation run outside of the
+ *          measured overhead, so they are taken from the hibernation profile.
+ * PARAMs:
+ *      INPUT:  pwr_mode - power mode which was entered
+ *              overhead_ms - measured enter and wake up processing
+ *      OUTPUT: None
+ * RETURN:  None
+ *-----------------------------------------------------------------------------
+ */
+void pwr_mngr_plan_learn(PWR_MNGR_PwrMode pwr_mode, uint32_t overhead_ms) {
+  struct hibernate_profile profile;
+  uint32_t sample;
+
+  if (pwr_mode < PWR_MNGR_MODE_STOP || pwr_mode > PWR_MNGR_MODE_SHUTDOWN) return;
+
+  if (pwr_mode != PWR_MNGR_MODE_STOP) {
+    hibernate_get_profile(&profile);
+    if (profile.core_clock_hz >= 1000) {
+      overhead_ms += (profile.phase_cycles[HBN_PHASE_FLASH_WRITE] +
+                      profile.phase_cycles[HBN_PHASE_FLASH_READ] +
+                      profile.phase_cycles[HBN_PHASE_RESTORE]) /
+                     (profile.core_clock_hz / 1000);
+    }
+  }
+
+  sample = overhead_ms << PWR_MNGR_PLAN_COST_SHIFT;
+  if (plan_learnt & (1UL << pwr_mode)) {
+    plan_cost[pwr_mode] =
+        plan_cost[pwr_mode] + ((int32_t)(sample - plan_cost[pwr_mode]) >> PWR_MNGR_PLAN_LEARN_SHIFT);
+  } else {
+    plan_cost[pwr_mode] = sample;
+    plan_learnt |= 1UL << pwr_mode;
+  }
+}
+
+/*-----------------------------------------------------------------------------
+ * int32_t pwr_mngr_get_sleep_plan(PWR_MNGR_SleepPlan *plan)
+ * PURPOSE: This function would get the sleep planner statistics.
+ * PARAMs:
+ *      INPUT:  None
+ *      OUTPUT: pointer of PWR_MNGR_SleepPlan
+ * RETURN:  error code. 0-success; other-fail
+ *-----------------------------------------------------------------------------
+ */
+int32_t pwr_mngr_get_sleep_plan(PWR_MNGR_SleepPlan *plan) {
+  int32_t mode;
+
+  if (plan == NULL) return (-1);
+
+  memcpy(plan, &sleep_plan, sizeof(PWR_MNGR_SleepPlan));
+  for (mode = 0; mode <= PWR_MNGR_MODE_SHUTDOWN; mode++) {
+    plan->cost_ms[mode] = plan_cost[mode] >> PWR_MNGR_PLAN_COST_SHIFT;
+  }
+
+  return 0;
+}
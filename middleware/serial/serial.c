@@ -33,19 +33,35 @@ extern uint32_t SystemCoreClock;
 static uint32_t Get_System_Clock(void);
 static uint32_t Get_Ref_Clock(void);
 
-#define CONTAINER_ASSERT(x) \
-  if ((x) == 0) {           \
-    for (;;)                \
-      ;                     \
-  } /**< Assertion check */
-
 #define EVT_FLAG_COMPLETE (1 << 0)
-#define EVT_FLAG_ABORT (1 << 1)
+#define EVT_FLAG_KICK (1 << 1)
+
+/* Period to pick up GDMA received data which did not end with an idle-line interrupt, and to
+ * check the timeouts of asynchronous requests */
+#define SERIAL_POLL_PERIOD (10)
+/* Delay of the timer that moves asynchronous requests forward out of interrupt context */
+#define SERIAL_PUMP_DELAY (1)
 
 #define RINGBUFFER_SIZE_UART_F0 (512)
 #define RINGBUFFER_SIZE_UART_F1 (512)
 #define RINGBUFFER_SIZE_UART_I0 (512)
 
+typedef enum {
+  SERIAL_DIR_RX,
+  SERIAL_DIR_TX,
+  SERIAL_DIR_MAX,
+} Serial_Dir;
+
+/* Requests of one direction. Only the pump hands requests to the driver and finishes them. */
+typedef struct {
+  serial_request *head;       /* queued, not handed to the driver yet */
+  serial_request *tail;
+  serial_request *active;     /* handed to the driver */
+  uint32_t depth;             /* queued and active requests */
+  volatile uint8_t completed; /* the driver reported completion of the active request */
+  volatile uint8_t abort;     /* abort every request of this direction */
+} Serial_Queue;
+
 typedef struct {
   UART_Type *base;
   UARTF_CFG_Type *cfg_base;
@@ -57,13 +73,16 @@ typedef struct {
   int8_t *ringbuffer;
   size_t ringbuffer_size;
 
-  size_t received_length;
-  size_t sent_length;
   uint8_t is_initialized;
   serial_callback callback;
+
+  /* request queues */
+  Serial_Queue queue[SERIAL_DIR_MAX];
+  volatile uint8_t pump_busy;
+  volatile uint8_t pump_again;
+  sSerialCounters counters;
   /* OS component*/
-  alt_osal_task_handle tx_task_handle;
-  alt_osal_task_handle rx_task_handle;
+  alt_osal_timer_handle pump_timer;
 } UART_Resource;
 
 static DRV_UART_Handle handle_uartf0;
@@ -81,8 +100,6 @@ static UART_Resource uartf0_resource = {
     .ringbuffer = uartf0_ringbuffer,
     .ringbuffer_size = RINGBUFFER_SIZE_UART_F0,
     .is_initialized = 0,
-    .tx_task_handle = NULL,
-    .rx_task_handle = NULL,
     .callback = NULL,
 };
 static UART_Resource uarti0_resource = {
@@ -95,8 +112,6 @@ static UART_Resource uarti0_resource = {
     .ringbuffer = uarti0_ringbuffer,
     .ringbuffer_size = RINGBUFFER_SIZE_UART_I0,
     .is_initialized = 0,
-    .tx_task_handle = NULL,
-    .rx_task_handle = NULL,
     .callback = NULL,
 };
 
@@ -113,8 +128,6 @@ static UART_Resource uartf1_resource = {
     .ringbuffer = uartf1_ringbuffer,
     .ringbuffer_size = RINGBUFFER_SIZE_UART_F1,
     .is_initialized = 0,
-    .tx_task_handle = NULL,
-    .rx_task_handle = NULL,
     .callback = NULL,
 };
 #endif
@@ -140,17 +153,367 @@ static UART_Resource *Get_Resource(eUartInstance index) {
 static uint32_t Get_System_Clock(void) { return SystemCoreClock; }
 
 static uint32_t Get_Ref_Clock(void) { return REF_CLK; }
+static uint8_t Serial_Req_Pending(serial_request *req) {
+  return req->status == SERIAL_REQ_QUEUED || req->status == SERIAL_REQ_ACTIVE;
+}
+
+static uint8_t Serial_Req_Expired(serial_request *req, uint32_t now) {
+  return req->timeout != SERIAL_TIMEOUT_FOREVER && (int32_t)(now - req->deadline) >= 0;
+}
+
+/*
+  Called from the driver callback, possibly in interrupt context. The next request cannot be handed
+  to the driver from here, so wake whoever moves the queue forward.
+*/
+static void Serial_Kick(UART_Resource *resource, Serial_Dir dir) {
+  Serial_Queue *q = &resource->queue[dir];
+
+  q->completed = 1;
+  if (q->active && q->active->waiter) {
+    alt_osal_set_taskflag(q->active->waiter, EVT_FLAG_KICK);
+  } else {
+    alt_osal_start_timer(&resource->pump_timer, SERIAL_PUMP_DELAY);
+  }
+}
+
+static void Serial_Finish(UART_Resource *resource, Serial_Dir dir, serial_request *req,
+                          eSerialReqStatus status) {
+  sSerialCounters *counters = &resource->counters;
+  alt_osal_task_handle waiter = (alt_osal_task_handle)req->waiter;
+  serial_req_callback callback = req->callback;
+  uint32_t irq;
+
+  irq = alt_osal_enter_critical();
+  resource->queue[dir].depth--;
+  alt_osal_exit_critical(irq);
+
+  if (dir == SERIAL_DIR_RX) {
+    counters->rx_bytes += req->done;
+    counters->rx_requests++;
+  } else {
+    counters->tx_bytes += req->done;
+    counters->tx_requests++;
+  }
+  if (status == SERIAL_REQ_TIMEOUT) {
+    counters->timeouts++;
+  } else if (status == SERIAL_REQ_ABORTED) {
+    counters->aborts++;
+  }
+
+  // the owner may reuse req as soon as the state leaves ACTIVE
+  req->status = status;
+  if (waiter) {
+    alt_osal_set_taskflag(waiter, EVT_FLAG_COMPLETE);
+  } else if (callback) {
+    callback((serial_handle)resource, req);
+  }
+}
+
+static void Serial_Start(UART_Resource *resource, Serial_Dir dir) {
+  Serial_Queue *q = &resource->queue[dir];
+  DRV_UART_Handle *drv_handle = resource->drv_handle;
+  serial_request *req;
+  DRV_UART_Status ret;
+  uint32_t irq;
+
+  while (q->active == NULL && q->head != NULL) {
+    irq = alt_osal_enter_critical();
+    req = q->head;
+    q->head = req->next;
+    if (q->head == NULL) {
+      q->tail = NULL;
+    }
+    req->next = NULL;
+    req->status = SERIAL_REQ_ACTIVE;
+    q->completed = 0;
+    q->active = req;
+    alt_osal_exit_critical(irq);
+
+    if (dir == SERIAL_DIR_RX) {
+      ret = DRV_UART_Receive_Nonblock(drv_handle, req->buf, req->len);
+    } else {
+      ret = DRV_UART_Send_Nonblock(drv_handle, req->buf, req->len);
+    }
+
+    if (ret == DRV_UART_WAIT_CB) {
+      return;  // completion comes through UART_EventCallback
+    }
+
+    q->active = NULL;
+    if (ret == DRV_UART_ERROR_NONE) {
+      req->done = req->len;
+      Serial_Finish(resource, dir, req, SERIAL_REQ_COMPLETE);
+    } else if (ret == DRV_UART_ERROR_HIFC_TIMEOUT || ret == DRV_UART_ERROR_BUSY) {
+      // keep the order and retry shortly, the interface is resuming or an aborted GDMA transfer
+      // is still draining
+      irq = alt_osal_enter_critical();
+      req->status = SERIAL_REQ_QUEUED;
+      req->next = q->head;
+      q->head = req;
+      if (q->tail == NULL) {
+        q->tail = req;
+      }
+      alt_osal_exit_critical(irq);
+      alt_osal_start_timer(&resource->pump_timer, SERIAL_PUMP_DELAY);
+      return;
+    } else {
+      req->done = 0;
+      Serial_Finish(resource, dir, req, SERIAL_REQ_ERROR);
+    }
+  }
+}
+
+static void Serial_Service(UART_Resource *resource, Serial_Dir dir, uint32_t now) {
+  Serial_Queue *q = &resource->queue[dir];
+  DRV_UART_Handle *drv_handle = resource->drv_handle;
+  serial_request *req = q->active;
+  serial_request *prev, *next, *finished = NULL;
+  eSerialReqStatus status;
+  int32_t partial = 0;
+  uint32_t irq;
+
+  if (req) {
+    if (dir == SERIAL_DIR_RX && !q->completed && drv_handle->rx_dma_enabled) {
+      DRV_UART_DMA_Poll(drv_handle);
+    }
+
+    status = SERIAL_REQ_ACTIVE;
+    if (q->completed) {
+      status = SERIAL_REQ_COMPLETE;
+    } else if (q->abort || req->cancel) {
+      status = SERIAL_REQ_ABORTED;
+    } else if (Serial_Req_Expired(req, now)) {
+      status = SERIAL_REQ_TIMEOUT;
+    }
+
+    if (status == SERIAL_REQ_ABORTED || status == SERIAL_REQ_TIMEOUT) {
+      if (dir == SERIAL_DIR_RX) {
+        partial = DRV_UART_Abort_Receive(drv_handle);
+      } else {
+        partial = DRV_UART_Abort_Send(drv_handle);
+      }
+      if (partial == DRV_UART_ABORT_COUNT_UNKNOWN) {
+        status = SERIAL_REQ_ERROR;  // a stopped GDMA send that can't tell how far it got
+        partial = 0;
+      } else if (partial < 0) {
+        status = SERIAL_REQ_COMPLETE;  // completed before the driver was stopped
+      }
+    }
+
+    if (status != SERIAL_REQ_ACTIVE) {
+      req->done = (status == SERIAL_REQ_COMPLETE) ? req->len : (size_t)partial;
+      q->active = NULL;
+      q->completed = 0;
+      Serial_Finish(resource, dir, req, status);
+    }
+  }
+
+  // pick the queued requests that will not be started
+  irq = alt_osal_enter_critical();
+  prev = NULL;
+  for (req = q->head; req != NULL; req = next) {
+    next = req->next;
+    if (q->abort || req->cancel || Serial_Req_Expired(req, now)) {
+      if (prev) {
+        prev->next = next;
+      } else {
+        q->head = next;
+      }
+      if (q->tail == req) {
+        q->tail = prev;
+      }
+      req->next = finished;
+      finished = req;
+    } else {
+      prev = req;
+    }
+  }
+  q->abort = 0;
+  alt_osal_exit_critical(irq);
+
+  for (req = finished; req != NULL; req = next) {
+    next = req->next;
+    req->next = NULL;
+    req->done = 0;
+    Serial_Finish(resource, dir, req, req->cancel || !Serial_Req_Expired(req, now)
+                                          ? SERIAL_REQ_ABORTED
+                                          : SERIAL_REQ_TIMEOUT);
+  }
+
+  Serial_Start(resource, dir);
+}
+
+/*
+  Keep the pump timer running while an asynchronous request has to be watched for its timeout or
+  for GDMA data without an idle-line interrupt. Blocking callers watch their own requests.
+*/
+static void Serial_Arm_Timer(UART_Resource *resource) {
+  Serial_Queue *q;
+  serial_request *req;
+  uint32_t irq;
+  uint8_t dir, dma, watch = 0;
+
+  irq = alt_osal_enter_critical();
+  for (dir = 0; dir < SERIAL_DIR_MAX && !watch; dir++) {
+    q = &resource->queue[dir];
+    dma = (dir == SERIAL_DIR_RX && resource->drv_handle->rx_dma_enabled);
+    for (req = q->active ? q->active : q->head; req != NULL && !watch;
+         req = (req == q->active) ? q->head : req->next) {
+      watch = req->waiter == NULL && (req->timeout != SERIAL_TIMEOUT_FOREVER || dma);
+    }
+  }
+  alt_osal_exit_critical(irq);
+
+  if (watch) {
+    alt_osal_start_timer(&resource->pump_timer, SERIAL_POLL_PERIOD);
+  }
+}
+
+/*
+  Finish the requests that are done, timed out or aborted and hand the next ones to the driver.
+  Any task may run it; a caller that finds it running leaves the work to the current runner.
+*/
+static void Serial_Pump(UART_Resource *resource) {
+  uint32_t irq;
+  uint8_t again;
+
+  irq = alt_osal_enter_critical();
+  if (resource->pump_busy) {
+    resource->pump_again = 1;
+    alt_osal_exit_critical(irq);
+    return;
+  }
+  resource->pump_busy = 1;
+  alt_osal_exit_critical(irq);
+
+  do {
+    resource->pump_again = 0;
+    Serial_Service(resource, SERIAL_DIR_RX, alt_osal_get_tick_count());
+    Serial_Service(resource, SERIAL_DIR_TX, alt_osal_get_tick_count());
+
+    irq = alt_osal_enter_critical();
+    again = resource->pump_again;
+    if (!again) {
+      resource->pump_busy = 0;
+    }
+    alt_osal_exit_critical(irq);
+  } while (again);
+
+  Serial_Arm_Timer(resource);
+}
+
+static void Serial_Pump_Timer(void *argument) { Serial_Pump((UART_Resource *)argument); }
+
+static int32_t Serial_Submit(UART_Resource *resource, Serial_Dir dir, serial_request *req) {
+  Serial_Queue *q = &resource->queue[dir];
+  uint32_t *queue_max;
+  uint32_t irq;
+
+  if (!req || !req->buf || req->len == 0 || Serial_Req_Pending(req)) {
+    return -1;
+  }
+
+  req->next = NULL;
+  req->done = 0;
+  req->cancel = 0;
+  if (req->timeout != SERIAL_TIMEOUT_FOREVER) {
+    req->deadline = alt_osal_get_tick_count() + req->timeout / portTICK_PERIOD_MS;
+  }
+  queue_max =
+      (dir == SERIAL_DIR_RX) ? &resource->counters.rx_queue_max : &resource->counters.tx_queue_max;
+
+  // checked with the request going in, so serial_close either refuses it or finds it queued
+  irq = alt_osal_enter_critical();
+  if (!resource->is_initialized) {
+    alt_osal_exit_critical(irq);
+    return -1;
+  }
+  req->status = SERIAL_REQ_QUEUED;
+  if (q->tail) {
+    q->tail->next = req;
+  } else {
+    q->head = req;
+  }
+  q->tail = req;
+  q->depth++;
+  if (q->depth > *queue_max) {
+    *queue_max = q->depth;
+  }
+  alt_osal_exit_critical(irq);
+
+  Serial_Pump(resource);
+  return 0;
+}
+
+static uint32_t Serial_Wait_Time(UART_Resource *resource, Serial_Dir dir, serial_request *req) {
+  uint32_t wait = (uint32_t)ALT_OSAL_TIMEO_FEVR;
+  int32_t left;
+
+  if (dir == SERIAL_DIR_RX && resource->drv_handle->rx_dma_enabled) {
+    wait = SERIAL_POLL_PERIOD;
+  }
+  if (req->timeout != SERIAL_TIMEOUT_FOREVER) {
+    left = (int32_t)(req->deadline - alt_osal_get_tick_count());
+    if (left < 0) {
+      left = 0;
+    }
+    if ((uint32_t)left < wait) {
+      wait = (uint32_t)left;
+    }
+  }
+  return wait;
+}
+
+static size_t Serial_Transfer(UART_Resource *resource, Serial_Dir dir, void *buf, size_t len,
+                              uint32_t timeout) {
+  serial_request req;
+
+  memset(&req, 0, sizeof(req));
+  req.buf = buf;
+  req.len = len;
+  req.timeout = timeout;
+  req.waiter = alt_osal_get_current_task_handle();
+
+  alt_osal_clear_taskflag(EVT_FLAG_COMPLETE | EVT_FLAG_KICK);
+  if (Serial_Submit(resource, dir, &req) != 0) {
+    return 0;
+  }
+
+  while (Serial_Req_Pending(&req)) {
+    alt_osal_wait_taskflag(EVT_FLAG_COMPLETE | EVT_FLAG_KICK, ALT_OSAL_WMODE_TWF_ORW,
+                           Serial_Wait_Time(resource, dir, &req));
+    Serial_Pump(resource);
+  }
+  return req.done;
+}
+
+static int32_t Serial_Abort(UART_Resource *resource, Serial_Dir dir) {
+  Serial_Queue *q = &resource->queue[dir];
+  int32_t ret = -1;
+  uint32_t irq;
+
+  irq = alt_osal_enter_critical();
+  if (q->active || q->head) {
+    q->abort = 1;
+    ret = 0;
+  }
+  alt_osal_exit_critical(irq);
+
+  if (ret == 0) {
+    Serial_Pump(resource);
+  }
+  return ret;
+}
+
 static void UART_EventCallback(DRV_UART_Handle *handle, uint32_t status, void *user_data) {
   UART_Resource *resource = (UART_Resource *)user_data;
 
   switch (status) {
     case CB_RX_COMPLETE:
-      // send rx complete signal
-      alt_osal_set_taskflag(resource->rx_task_handle, EVT_FLAG_COMPLETE);
+      Serial_Kick(resource, SERIAL_DIR_RX);
       break;
     case CB_TX_COMPLETE:
-      // send tx complete signal
-      alt_osal_set_taskflag(resource->tx_task_handle, EVT_FLAG_COMPLETE);
+      Serial_Kick(resource, SERIAL_DIR_TX);
       break;
     case CB_BREAK_ERROR:
       if( resource->callback )
@@ -182,6 +545,12 @@ serial_handle serial_open(eUartInstance instance) {
     resource->cfg_base->EN_FLOW_INT_b.UARTINT = 1;  // enable interrupt
   }
 
+  if (resource->pump_timer == NULL &&
+      alt_osal_create_timer(&resource->pump_timer, false, Serial_Pump_Timer, (void *)resource,
+                            NULL)) {
+    return NULL;
+  }
+
   DRV_IF_CFG_SetIO(resource->interface_id);
 
   if (resource->base == UARTI0) {
@@ -205,93 +574,107 @@ serial_handle serial_open(eUartInstance instance) {
   resource->is_initialized = 1;
   return (serial_handle)resource;
 }
+/*
+  True once no task runs the pump and both directions are empty. Requests are refused while
+  closing, so it stays true.
+*/
+static uint8_t Serial_Idle(UART_Resource *resource) {
+  uint8_t idle = 1;
+  uint32_t irq;
+  uint8_t dir;
+
+  irq = alt_osal_enter_critical();
+  if (resource->pump_busy) {
+    idle = 0;
+  }
+  for (dir = 0; dir < SERIAL_DIR_MAX; dir++) {
+    if (resource->queue[dir].active || resource->queue[dir].head) {
+      idle = 0;
+    }
+  }
+  alt_osal_exit_critical(irq);
+  return idle;
+}
+
 int32_t serial_close(serial_handle handle) {
   UART_Resource *resource = (UART_Resource *)handle;
+  uint32_t irq;
+
+  irq = alt_osal_enter_critical();
   resource->is_initialized = 0;
+  alt_osal_exit_critical(irq);
+  alt_osal_stop_timer(&resource->pump_timer);
+
+  // the remaining requests finish as aborted. A pump running in another task takes the abort on
+  // its next pass, the driver goes only once it is done.
+  while (!Serial_Idle(resource)) {
+    Serial_Abort(resource, SERIAL_DIR_RX);
+    Serial_Abort(resource, SERIAL_DIR_TX);
+    if (!Serial_Idle(resource)) {
+      alt_osal_sleep_task(1);
+    }
+  }
 
   NVIC_DisableIRQ(resource->irq_base);
-  resource->tx_task_handle = NULL;
-  resource->rx_task_handle = NULL;
   DRV_UART_Uninitialize(resource->drv_handle);
+  // a completion kicked during the wait may have restarted it
+  alt_osal_stop_timer(&resource->pump_timer);
   return 0;
 }
 size_t serial_read(serial_handle handle, void *buf, size_t len) {
-  UART_Resource *resource = (UART_Resource *)handle;
-  DRV_UART_Handle *drv_handle = resource->drv_handle;
-  size_t read_size = 0;
-  uint32_t flag = 0;
-  DRV_UART_Status ret;
+  return Serial_Transfer((UART_Resource *)handle, SERIAL_DIR_RX, buf, len, SERIAL_TIMEOUT_FOREVER);
+}
 
-  if (resource->rx_task_handle) {
-    // this function doesn't allow to be called from mutiple task.
-    CONTAINER_ASSERT(0);
+size_t serial_read_timeout(serial_handle handle, void *buf, size_t len, uint32_t timeout) {
+  return Serial_Transfer((UART_Resource *)handle, SERIAL_DIR_RX, buf, len, timeout);
+}
+
+int32_t serial_read_async(serial_handle handle, serial_request *req) {
+  if (!req) {
+    return -1;
   }
+  req->waiter = NULL;
+  return Serial_Submit((UART_Resource *)handle, SERIAL_DIR_RX, req);
+}
 
-  resource->rx_task_handle = alt_osal_get_current_task_handle();
+size_t serial_write(serial_handle handle, void *buf, size_t len) {
+  return Serial_Transfer((UART_Resource *)handle, SERIAL_DIR_TX, buf, len, SERIAL_TIMEOUT_FOREVER);
+}
 
-  ret = DRV_UART_Receive_Nonblock(drv_handle, buf, len);
-  if (ret == DRV_UART_ERROR_NONE) {
-    // all requested data are copied to user buffer
-    read_size = len;
-  } else if (ret == DRV_UART_WAIT_CB) {
-    flag = alt_osal_wait_taskflag(EVT_FLAG_COMPLETE | EVT_FLAG_ABORT, ALT_OSAL_WMODE_TWF_ORW,
-                                  ALT_OSAL_TIMEO_FEVR);
+size_t serial_write_timeout(serial_handle handle, void *buf, size_t len, uint32_t timeout) {
+  return Serial_Transfer((UART_Resource *)handle, SERIAL_DIR_TX, buf, len, timeout);
+}
 
-    if (flag & EVT_FLAG_ABORT) {
-      read_size = resource->received_length;  // the information is stored in abort_read
-    }
-    if (flag & EVT_FLAG_COMPLETE) {
-      read_size = DRV_UART_Get_Received_Rx_Count(drv_handle);
-      CONTAINER_ASSERT(read_size == len);
-      alt_osal_clear_taskflag(EVT_FLAG_ABORT);
-    }
-  } else {
-    read_size = 0;
+int32_t serial_write_async(serial_handle handle, serial_request *req) {
+  if (!req) {
+    return -1;
   }
-  resource->rx_task_handle = NULL;
-  return read_size;
+  req->waiter = NULL;
+  return Serial_Submit((UART_Resource *)handle, SERIAL_DIR_TX, req);
 }
 
-size_t serial_write(serial_handle handle, void *buf, size_t len) {
-  UART_Resource *resource = (UART_Resource *)handle;
-  DRV_UART_Handle *drv_handle = resource->drv_handle;
-  uint32_t flag;
-  size_t wrote_size = 0;
-  DRV_UART_Status ret;
+eSerialReqStatus serial_poll(serial_handle handle, serial_request *req) {
+  Serial_Pump((UART_Resource *)handle);
+  return req ? req->status : SERIAL_REQ_IDLE;
+}
 
-  if (resource->tx_task_handle) {
-    // this function doesn't allow to be called from mutiple task.
-    CONTAINER_ASSERT(0);
+int32_t serial_cancel(serial_handle handle, serial_request *req) {
+  if (!req || !Serial_Req_Pending(req)) {
+    return -1;
   }
+  req->cancel = 1;
+  Serial_Pump((UART_Resource *)handle);
+  return 0;
+}
 
-  resource->tx_task_handle = alt_osal_get_current_task_handle();
-
-  do {
-    alt_osal_clear_taskflag(EVT_FLAG_COMPLETE | EVT_FLAG_ABORT);
-    ret = DRV_UART_Send_Nonblock(drv_handle, buf, len);
-    if (ret == DRV_UART_ERROR_NONE) {
-      // wrote_size = len;
-      wrote_size = DRV_UART_Get_Transmitted_Tx_Count(drv_handle);
-      CONTAINER_ASSERT(wrote_size == len);  // for testing. remove it when stable
-    } else if (ret == DRV_UART_WAIT_CB) {
-      flag = alt_osal_wait_taskflag(EVT_FLAG_COMPLETE | EVT_FLAG_ABORT, ALT_OSAL_WMODE_TWF_ORW,
-                                    ALT_OSAL_TIMEO_FEVR);
-
-      if (flag & EVT_FLAG_ABORT) {
-        wrote_size = resource->sent_length;
-      }
-      if (flag & EVT_FLAG_COMPLETE) {
-        wrote_size = DRV_UART_Get_Transmitted_Tx_Count(drv_handle);
-        CONTAINER_ASSERT(wrote_size == len);  // for testing. remove it when stable
-        alt_osal_clear_taskflag(EVT_FLAG_ABORT);
-      }
-    } else {
-      wrote_size = 0;
-    }
-  } while (ret == DRV_UART_ERROR_HIFC_TIMEOUT);  // retry if got hifc timeout error
+int32_t serial_get_counters(serial_handle handle, sSerialCounters *counters) {
+  UART_Resource *resource = (UART_Resource *)handle;
 
-  resource->tx_task_handle = NULL;
-  return wrote_size;
+  if (!resource || !counters) {
+    return -1;
+  }
+  memcpy(counters, &resource->counters, sizeof(sSerialCounters));
+  return 0;
 }
 
 int32_t serial_ioctl(serial_handle handle, eIoctl request, void *arg )
@@ -312,36 +695,25 @@ int32_t serial_ioctl(serial_handle handle, eIoctl request, void *arg )
     case SERIAL_DISABLE_BREAK_ERROR:
       DRV_UART_Disable_Break_Interrupt(resource->base);
       break;
+    case SERIAL_ENABLE_DMA:
+      if (!arg) {
+        return -1;
+      }
+      if (DRV_UART_Enable_DMA(resource->drv_handle, (const DRV_UART_DMA_Config *)arg) !=
+          DRV_UART_ERROR_NONE) {
+        return -1;
+      }
+      break;
   }
 
   return 0;
 }
 
 int32_t abort_write(serial_handle handle) {
-  UART_Resource *resource = (UART_Resource *)handle;
-  int32_t sent_length = DRV_UART_Abort_Send(resource->drv_handle);
-  uint32_t ret = -1;
-
-  if (sent_length >= 0) {
-    resource->sent_length = sent_length;
-    alt_osal_set_taskflag(resource->tx_task_handle, EVT_FLAG_ABORT);
-    ret = 0;
-  }
-
-  return ret;
+  return Serial_Abort((UART_Resource *)handle, SERIAL_DIR_TX);
 }
 int32_t abort_read(serial_handle handle) {
-  UART_Resource *resource = (UART_Resource *)handle;
-  int32_t received_length = DRV_UART_Abort_Receive(resource->drv_handle);
-  uint32_t ret = -1;
-
-  if (received_length >= 0) {
-    resource->received_length = received_length;
-    alt_osal_set_taskflag(resource->rx_task_handle, EVT_FLAG_ABORT);
-    ret = 0;
-  }
-
-  return ret;
+  return Serial_Abort((UART_Resource *)handle, SERIAL_DIR_RX);
 }
 
 void dump_statistics(eUartInstance ins)
@@ -360,8 +732,18 @@ void dump_statistics(eUartInstance ins)
   printf("Tx cnt isr: %d\n", stat.tx_cnt_isr);
   printf("Rx cnt: %d\n", stat.rx_cnt);
   printf("Rx cnt isr: %d\n", stat.rx_cnt_isr);
+  printf("Tx cnt dma: %d\n", stat.tx_cnt_dma);
+  printf("Rx cnt dma: %d\n", stat.rx_cnt_dma);
+  printf("Rx drop: %d\n", stat.rx_drop_cnt);
+  printf("Tx bursts: %d\n", stat.tx_burst_cnt);
+  printf("Rx bursts: %d\n", stat.rx_burst_cnt);
   printf("Break Error: %d\n", stat.be_cnt);
   printf("Frame Error: %d\n", stat.fe_cnt);
   printf("Parity Error: %d\n", stat.pe_cnt);
   printf("Overrun Error: %d\n", stat.oe_cnt);
+  printf("Rx bytes: %lu, requests: %lu, queue max: %lu\n", resource->counters.rx_bytes,
+         resource->counters.rx_requests, resource->counters.rx_queue_max);
+  printf("Tx bytes: %lu, requests: %lu, queue max: %lu\n", resource->counters.tx_bytes,
+         resource->counters.tx_requests, resource->counters.tx_queue_max);
+  printf("Timeouts: %lu, aborts: %lu\n", resource->counters.timeouts, resource->counters.aborts);
 }
@@ -26,6 +26,7 @@
 #ifndef _serial_H_
 #define _serial_H_
 #include <stdio.h>
+#include <stdint.h>
 /**
  * @defgroup serial_uart UART Driver
  * @{
@@ -43,6 +44,7 @@
 #define UARTI0_WORDLENGTH_DEFAULT                          \
   DRV_UART_WORD_LENGTH_8B /*!<  Default internal UART word \
                              lendth*/
+#define SERIAL_TIMEOUT_FOREVER (0xFFFFFFFFUL) /*!< Request timeout that never expires */
 /** @} UART_const */
 
 /**
@@ -132,6 +134,8 @@ typedef enum{
   SERIAL_REGISTER_CALLBACK = 0,   /*!< Register callback function. Expected arg: callback function pointer with serial_callback prototype */
   SERIAL_ENABLE_BREAK_ERROR = 1,  /*!< Enable break error interrupt. Expected arg: NULL */
   SERIAL_DISABLE_BREAK_ERROR = 2, /*!< Disable break error interrupt. Expected arg: NULL */
+  SERIAL_ENABLE_DMA = 3,          /*!< Move data by GDMA. Expected arg: pointer to DRV_UART_DMA_Config.
+                                       Fails if any requested direction stays in IRQ mode */
 } eIoctl;
 
 typedef enum{
@@ -160,6 +164,58 @@ typedef void *serial_handle;
 
 typedef void (*serial_callback)(serial_handle handle, eCallbackStatus status);
 
+/**
+ * @brief State of a queued serial request
+ *
+ */
+typedef enum {
+  SERIAL_REQ_IDLE = 0, /*!< Not submitted yet */
+  SERIAL_REQ_QUEUED,   /*!< Waiting behind earlier requests in the same direction */
+  SERIAL_REQ_ACTIVE,   /*!< Handed to the UART driver */
+  SERIAL_REQ_COMPLETE, /*!< All requested bytes were transferred */
+  SERIAL_REQ_TIMEOUT,  /*!< Timeout expired. done holds the bytes transferred before it */
+  SERIAL_REQ_ABORTED,  /*!< Aborted or cancelled. done holds the bytes transferred before it */
+  SERIAL_REQ_ERROR,    /*!< Rejected by the UART driver, or a write stopped by a timeout or an
+                            abort after an unknown number of bytes */
+} eSerialReqStatus;
+
+typedef struct serial_request serial_request;
+
+/** @brief Completion callback of an asynchronous request. Called in task context. */
+typedef void (*serial_req_callback)(serial_handle handle, serial_request *req);
+
+/**
+ * @brief Definition of a queued read or write request. The storage belongs to the caller and
+ * must stay valid until the request leaves the QUEUED and ACTIVE states.
+ */
+struct serial_request {
+  void *buf;                    /*!< [in] Data to send, or space for the received data */
+  size_t len;                   /*!< [in] Number of bytes requested */
+  uint32_t timeout;             /*!< [in] Timeout in ms from submission, or SERIAL_TIMEOUT_FOREVER */
+  serial_req_callback callback; /*!< [in] Completion callback. NULL to use serial_poll only */
+  void *user_data;              /*!< [in] Free for the caller */
+  volatile size_t done;         /*!< [out] Number of bytes transferred */
+  volatile eSerialReqStatus status; /*!< [out] Request state */
+
+  /* private */
+  serial_request *next; /*!< Next request in the queue */
+  void *waiter;         /*!< Task blocked on the request, NULL for asynchronous requests */
+  uint32_t deadline;    /*!< Tick count at which the request times out */
+  volatile uint8_t cancel; /*!< Cancellation requested by serial_cancel */
+};
+
+/** @brief Definition of the per-port serial counters */
+typedef struct {
+  uint32_t rx_bytes;     /*!< Bytes handed to read requests */
+  uint32_t tx_bytes;     /*!< Bytes taken from write requests */
+  uint32_t rx_requests;  /*!< Read requests finished in any state */
+  uint32_t tx_requests;  /*!< Write requests finished in any state */
+  uint32_t timeouts;     /*!< Requests finished by their timeout */
+  uint32_t aborts;       /*!< Requests finished by abort or cancel */
+  uint32_t rx_queue_max; /*!< Deepest read queue seen, including the active request */
+  uint32_t tx_queue_max; /*!< Deepest write queue seen, including the active request */
+} sSerialCounters;
+
 /** @} UART_types */
 
 /**
@@ -182,7 +238,8 @@ extern "C" {
 int32_t serial_ioctl(serial_handle handle, eIoctl request, void *arg );
 
 /**
- * @brief To write data to uart port
+ * @brief To write data to uart port. Any number of tasks may write to the same port; the
+ * requests are served in order.
  *
  * @param [in] handle: The uart handle
  * @param [in] buf: The data to be sent
@@ -191,6 +248,28 @@ int32_t serial_ioctl(serial_handle handle, eIoctl request, void *arg );
  * @return The data length which successfully sent
  */
 size_t serial_write(serial_handle handle, void *buf, size_t len);
+
+/**
+ * @brief To write data to uart port with a timeout
+ *
+ * @param [in] handle: The uart handle
+ * @param [in] buf: The data to be sent
+ * @param [in] len: The data length to be sent
+ * @param [in] timeout: Timeout in ms including the time queued, or SERIAL_TIMEOUT_FOREVER
+ *
+ * @return The data length which successfully sent before the timeout
+ */
+size_t serial_write_timeout(serial_handle handle, void *buf, size_t len, uint32_t timeout);
+
+/**
+ * @brief To queue a write request without blocking
+ *
+ * @param [in] handle: The uart handle
+ * @param [in] req: The request. buf, len, timeout, callback and user_data must be set
+ *
+ * @return int32_t 0 on success. others, negative value are returned.
+ */
+int32_t serial_write_async(serial_handle handle, serial_request *req);
 /**
  * @brief To read data from uart port
  *
@@ -203,6 +282,57 @@ size_t serial_write(serial_handle handle, void *buf, size_t len);
  */
 size_t serial_read(serial_handle handle, void *buf, size_t len);
 
+/**
+ * @brief To read data from uart port with a timeout
+ *
+ * @param [in] handle: The uart handle
+ * @param [in] buf: The buffer for the read data
+ * @param [in] len: The data length to be reveived
+ * @param [in] timeout: Timeout in ms including the time queued, or SERIAL_TIMEOUT_FOREVER
+ *
+ * @return The data length which successfully read before the timeout
+ */
+size_t serial_read_timeout(serial_handle handle, void *buf, size_t len, uint32_t timeout);
+
+/**
+ * @brief To queue a read request without blocking
+ *
+ * @param [in] handle: The uart handle
+ * @param [in] req: The request. buf, len, timeout, callback and user_data must be set
+ *
+ * @return int32_t 0 on success. others, negative value are returned.
+ */
+int32_t serial_read_async(serial_handle handle, serial_request *req);
+
+/**
+ * @brief To move the queued requests of a port forward and get the state of a request
+ *
+ * @param [in] handle: The uart handle
+ * @param [in] req: The request to check, or NULL to only move the queues forward
+ *
+ * @return The state of req. SERIAL_REQ_IDLE if req is NULL
+ */
+eSerialReqStatus serial_poll(serial_handle handle, serial_request *req);
+
+/**
+ * @brief To cancel a queued or active request. It finishes as SERIAL_REQ_ABORTED unless it
+ * completed first
+ *
+ * @param [in] handle: The uart handle
+ * @param [in] req: The request to cancel
+ * @return int32_t 0 on success. others, negative value are returned.
+ */
+int32_t serial_cancel(serial_handle handle, serial_request *req);
+
+/**
+ * @brief To get the per-port serial counters
+ *
+ * @param [in] handle: The uart handle
+ * @param [out] counters: The counters
+ * @return int32_t 0 on success. others, negative value are returned.
+ */
+int32_t serial_get_counters(serial_handle handle, sSerialCounters *counters);
+
 /**
  * @brief To open a serial port
  *
@@ -221,7 +351,7 @@ serial_handle serial_open(eUartInstance instance);
 int32_t serial_close(serial_handle handle);
 
 /**
- * @brief To abort a write requset
+ * @brief To abort all write requests of the port. The active one returns the bytes already sent
  *
  * @param [in] handle: The handle of the uart port
  * @return int32_t 0 on success. others, negative value are returned.
@@ -229,7 +359,7 @@ int32_t serial_close(serial_handle handle);
 int32_t abort_write(serial_handle handle);
 
 /**
- * @brief To abort a read request
+ * @brief To abort all read requests of the port. The active one returns the bytes already read
  *
  * @param [in] handle: The handle of the uart port
  * @return int32_t 0 on success. others, negative value are returned.
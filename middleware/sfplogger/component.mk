@@ -4,4 +4,11 @@ INC_DIRS += $(sfplogger_ROOT)/include
 sfplogger_INC_DIR =  # all in INC_DIRS, needed for normal operation
 sfplogger_SRC_DIR = $(sfplogger_ROOT)
 
+# Hash every C file name at build time so the SFP_LOG macros do not hash __FILE__ per call. The
+# hashes go to $(PROGRAM).sfpmap next to the elf. Set SFP_FILE_HASH = 0 to hash at run time.
+SFP_FILE_HASH ?= 1
+ifeq ($(SFP_FILE_HASH),1)
+SFP_HASH_CFLAGS = -DSFP_FILE_HASH=$(shell python $(SFPHASH) --map $(@:.o=.sfph) $<)
+endif
+
 $(eval $(call component_compile_rules,sfplogger))
@@ -78,6 +78,12 @@
 #define SFP_MSB_STRING_TYPE            0xC0
 #define SFP_MSB_COMPLEX_STRING_MASK    0xF0
 #define SFP_MSB_COMPLEX_STRING_TYPE    0xF0
+// Deferred format entry, sized like a complex string: [0] type | severity, [1] argument bytes,
+// [2] module id, [3] argument count, [4..7] time, [8..11] format string address, then arguments
+#define SFP_MSB_FMT_MASK               0xF8
+#define SFP_MSB_FMT_TYPE               0xF8
+#define SFPLOG_FMT_MAX_ARGS            6
+#define SFPLOG_FMT_ENTRY_MAX_SIZE      (SFPLOG_COMPLEX_STRING_ENTRYHEADER_SIZE_PLUS_NULL_TERM + 4 * SFPLOG_FMT_MAX_ARGS)
 
 #define SFP_MSB_EMPTY_FILLER_TYPE_MASK 0xF0
 #define SFP_MSB_EMPTY_FILLER_TYPE      0xE0
@@ -88,6 +94,31 @@
 #define SFPLOGGER_MASK_SLEEP_ALT_READ  3
 #define SFPLOGGER_MARK_SLEEP_FLAG      2
 #define SFPLOGGER_MARK_ALTER_READ      1
+
+// 1: binary entries go to a ring per task (one for interrupts) without masking interrupts, and a
+// low priority task merges them into the databases in log order. Set it for the whole build, the
+// ring of a deleted task is released through traceTASK_DELETE in FreeRTOSConfig.h.
+#ifndef SFPLOG_TASK_RINGS
+#define SFPLOG_TASK_RINGS              0
+#endif
+#define SFPLOG_RING_MAX                8    // rings, the first one is for interrupt context
+#define SFPLOG_RING_SLOTS              32   // entries per ring
+#define SFPLOG_RING_MERGE_PERIOD       50   // ms between merges of a quiet logger
+#define SFPLOG_RING_TASK_STACK_SIZE    1024
+
+// 1: sfpexport streams the entries logged since the last export to a sink in segments
+#ifndef SFPLOG_EXPORT
+#define SFPLOG_EXPORT                  0
+#endif
+// 1: segments to sinks which take a header are compressed with FastLZ (needs pwrmanager)
+#ifndef SFPLOG_EXPORT_COMPRESS
+#define SFPLOG_EXPORT_COMPRESS         0
+#endif
+#define SFPLOG_EXPORT_SEGMENT_SIZE     512  // whole entries per segment, before compression
+#define SFPLOG_EXPORT_HEADER_SIZE      16
+#define SFPLOG_EXPORT_TASK_STACK_SIZE  1024
+#define SFPLOG_EXPORT_FLAG_COMPRESSED  (1 << 0)
+#define SFPLOG_EXPORT_FLAG_LOST        (1 << 1)  // entries were overwritten before export
 // clang-format on
 
 typedef struct {
@@ -95,6 +126,9 @@ typedef struct {
   unsigned int next_entry_delta;  // delta pointer from sfpdbp to the next free entry in the buffer
   unsigned int buffer_size;       // in Bytes
   char lock;
+  unsigned int written;  // bytes handed out by sfpdb_get_next_entry, wrap slack included
+  unsigned int epoch;    // changes when the buffer is cleared, resized or replaced
+  unsigned int epoch_written;  // written at the last epoch change
 } spflogdbentry_t;
 
 typedef struct {
@@ -128,6 +162,8 @@ typedef enum {
 
 int sfp_log(int param1, int param2, int param3, unsigned int severitymoduleid,
             unsigned int line_num, void *pfilename);
+int sfp_log_hash(int param1, int param2, int param3, unsigned int severitymoduleid,
+                 unsigned int line_num, unsigned int file_hash);
 int sfp_log_complex_str(const char *storestr, unsigned int severitymoduleid, unsigned int line_num,
                         void *pfilename);
 int sfp_log_str(SFP_log_module_id_t moduleid, char severity, char *logstring);
@@ -157,10 +193,70 @@ int sfplogger_save_buffer_in_db(unsigned int dbid, char *binaryBuff, unsigned in
 int sfplogger_register_moduletodb(SFP_log_module_id_t moduleid, char dbid, char *modulename);
 int sfp_log_string(const char *format, ...);
 int sfp_log_formatted(SFP_log_module_id_t moduleid, char severity, const char *format, ...);
+int sfp_log_fmt(SFP_log_module_id_t moduleid, char severity, const char *format, unsigned int nargs,
+                ...);
 int sfp_log_init();
 int sfp_log_init_after_fs();
 char *sfpdb_get_next_entry(spflogdbentry_t *sfpdbp, unsigned int entry_size);
 char *sfpdb_get_earliest_entry(spflogdbentry_t *sfpdbp);
+int sfpdb_store_entry(int dbid, const char *entry, unsigned int entry_size);
+unsigned int sfpdb_entry_size(const char *entry);
+int sfpring_init(void);
+int sfpring_put(int dbid, const char *entry, unsigned int entry_size);
+int sfpring_merge(void);
+unsigned int sfpring_merged_count(void);
+unsigned int sfpring_overflow_count(void);
+void sfpring_task_deleted(void *task);
+
+/**
+ * @brief Export sink, gets one segment of whole log entries.
+ *
+ * @param [in] header: SFPLOG_EXPORT_HEADER_SIZE bytes, little endian: 'S' 'X', dbid, flags,
+ * sequence (4), entry bytes (2), payload bytes (2), bytes lost before this segment (4).
+ * @param [in] payload: entries, FastLZ compressed when SFPLOG_EXPORT_FLAG_COMPRESSED is set.
+ * @param [in] len: payload length.
+ * @param [in] arg: argument given to sfpexport_start.
+ *
+ * @return 0 when the segment was delivered. The segment is sent again on the next export
+ * otherwise.
+ */
+typedef int (*sfpexport_sink_t)(const char *header, const char *payload, unsigned int len,
+                                void *arg);
+
+/**
+ * @brief Start exporting the log databases. Only the entries logged since the previous
+ * delivered segment are sent, the read position follows the logger through wraps.
+ *
+ * @param [in] sink: segment sink.
+ * @param [in] arg: sink argument.
+ * @param [in] compress: 1 to compress the segments, needs SFPLOG_EXPORT_COMPRESS. Refused for
+ * sfpexport_altcom_sink.
+ * @param [in] period_ms: export period of the export task, 0 to export on sfpexport_run only.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int sfpexport_start(sfpexport_sink_t sink, void *arg, int compress, unsigned int period_ms);
+
+/**
+ * @brief Export everything pending now.
+ *
+ * @return number of segments delivered, -1 if the export is not started or the sink failed.
+ */
+int sfpexport_run(void);
+
+/**
+ * @brief Sink sending the raw entries to the MAP side with altcom_SendAppLog. The header is not
+ * sent, so sfpexport_start refuses it with compression.
+ */
+int sfpexport_altcom_sink(const char *header, const char *payload, unsigned int len, void *arg);
+
+/**
+ * @brief Sink writing header and payload to a UART, arg is the serial_handle. utils/sfpsink.py
+ * reads this stream on the host.
+ */
+int sfpexport_serial_sink(const char *header, const char *payload, unsigned int len, void *arg);
+
+void sfpexport_get_counters(unsigned int *segments, unsigned int *bytes, unsigned int *lost);
 int sfplogger_save_buffers_to_file(char *filename);
 int sfplogger_get_default_db_id();
 int sfplogger_get_at_db_id();
@@ -177,23 +273,33 @@ int sfplogger_get_severity_by_name(char **mduleName, char **severity);
 int sfplogger_set_severity_by_name(char **mduleName, char severity);
 int sfplogger_send_AppLog();
 
+// The build passes SFP_FILE_HASH, the file name hash sfp_log computes from __FILE__ (see
+// utils/sfphash.py), so a log call does not walk the file name at run time.
+#ifdef SFP_FILE_HASH
+#define SFP_LOG_CALL(param1, param2, param3, severitymoduleid) \
+  sfp_log_hash(param1, param2, param3, severitymoduleid, __LINE__, SFP_FILE_HASH)
+#else
+#define SFP_LOG_CALL(param1, param2, param3, severitymoduleid) \
+  sfp_log(param1, param2, param3, severitymoduleid, __LINE__, __FILE__)
+#endif
+
 // clang-format off
-#define SFP_LOG_VERBOSE(moduleid, str)  sfp_log(0, 0, 0, (SFPLOG_VERBOSE << 28)  | (moduleid & 0XFFFFFFF), __LINE__, __FILE__)
-#define SFP_LOG_DEBUG(moduleid, str)    sfp_log(0, 0, 0, (SFPLOG_DEBUG << 28)    | (moduleid & 0XFFFFFFF), __LINE__, __FILE__)
-#define SFP_LOG_INFO(moduleid, str)     sfp_log(0, 0, 0, (SFPLOG_INFO << 28)     | (moduleid & 0XFFFFFFF), __LINE__, __FILE__)
-#define SFP_LOG_NORMAL(moduleid, str)   sfp_log(0, 0, 0, (SFPLOG_NORMAL << 28)   | (moduleid & 0XFFFFFFF), __LINE__, __FILE__)
-#define SFP_LOG_WARNING(moduleid, str)  sfp_log(0, 0, 0, (SFPLOG_WARNING << 28)  | (moduleid & 0XFFFFFFF), __LINE__, __FILE__)
-#define SFP_LOG_ERROR(moduleid, str)    sfp_log(0, 0, 0, (SFPLOG_ERROR << 28)    | (moduleid & 0XFFFFFFF), __LINE__, __FILE__)
-#define SFP_LOG_CRITICAL(moduleid, str) sfp_log(0, 0, 0, (SFPLOG_CRITICAL << 28) | (moduleid & 0XFFFFFFF), __LINE__, __FILE__)
-
-#define SFP_LOG_3_VERBOSE(moduleid, str, param1, param2, param3)   sfp_log(param1, param2, param3, (SFPLOG_VERBOSE << 28)  | (moduleid & 0XFFFFFFF), __LINE__, __FILE__)
-#define SFP_LOG_3_DEBUG(moduleid, str, param1, param2, param3)     sfp_log(param1, param2, param3, (SFPLOG_DEBUG << 28)    | (moduleid & 0XFFFFFFF), __LINE__, __FILE__)
-#define SFP_LOG_3_INFO(moduleid, str, param1, param2, param3)      sfp_log(param1, param2, param3, (SFPLOG_INFO << 28)     | (moduleid & 0XFFFFFFF), __LINE__, __FILE__)
-#define SFP_LOG_3_NORMAL(moduleid, str, param1, param2, param3)    sfp_log(param1, param2, param3, (SFPLOG_NORMAL << 28)   | (moduleid & 0XFFFFFFF), __LINE__, __FILE__)
-#define SFP_LOG_3_WARNING(moduleid, str, param1, param2, param3)   sfp_log(param1, param2, param3, (SFPLOG_WARNING << 28)  | (moduleid & 0XFFFFFFF), __LINE__, __FILE__)
-#define SFP_LOG_3_ERROR(moduleid, str, param1, param2, param3)     sfp_log(param1, param2, param3, (SFPLOG_ERROR << 28)    | (moduleid & 0XFFFFFFF), __LINE__, __FILE__)
-#define SFP_LOG_3_CRITICAL(moduleid, str, param1, param2, param3)  sfp_log(param1, param2, param3, (SFPLOG_CRITICAL << 28) | (moduleid & 0XFFFFFFF), __LINE__, __FILE__)
-#define SFP_LOG_3(moduleid, severity, str, param1, param2, param3) sfp_log(param1, param2, param3, (severity << 28)        | (moduleid & 0XFFFFFFF), __LINE__, __FILE__)
+#define SFP_LOG_VERBOSE(moduleid, str)  SFP_LOG_CALL(0, 0, 0, (SFPLOG_VERBOSE << 28)  | (moduleid & 0XFFFFFFF))
+#define SFP_LOG_DEBUG(moduleid, str)    SFP_LOG_CALL(0, 0, 0, (SFPLOG_DEBUG << 28)    | (moduleid & 0XFFFFFFF))
+#define SFP_LOG_INFO(moduleid, str)     SFP_LOG_CALL(0, 0, 0, (SFPLOG_INFO << 28)     | (moduleid & 0XFFFFFFF))
+#define SFP_LOG_NORMAL(moduleid, str)   SFP_LOG_CALL(0, 0, 0, (SFPLOG_NORMAL << 28)   | (moduleid & 0XFFFFFFF))
+#define SFP_LOG_WARNING(moduleid, str)  SFP_LOG_CALL(0, 0, 0, (SFPLOG_WARNING << 28)  | (moduleid & 0XFFFFFFF))
+#define SFP_LOG_ERROR(moduleid, str)    SFP_LOG_CALL(0, 0, 0, (SFPLOG_ERROR << 28)    | (moduleid & 0XFFFFFFF))
+#define SFP_LOG_CRITICAL(moduleid, str) SFP_LOG_CALL(0, 0, 0, (SFPLOG_CRITICAL << 28) | (moduleid & 0XFFFFFFF))
+
+#define SFP_LOG_3_VERBOSE(moduleid, str, param1, param2, param3)   SFP_LOG_CALL(param1, param2, param3, (SFPLOG_VERBOSE << 28)  | (moduleid & 0XFFFFFFF))
+#define SFP_LOG_3_DEBUG(moduleid, str, param1, param2, param3)     SFP_LOG_CALL(param1, param2, param3, (SFPLOG_DEBUG << 28)    | (moduleid & 0XFFFFFFF))
+#define SFP_LOG_3_INFO(moduleid, str, param1, param2, param3)      SFP_LOG_CALL(param1, param2, param3, (SFPLOG_INFO << 28)     | (moduleid & 0XFFFFFFF))
+#define SFP_LOG_3_NORMAL(moduleid, str, param1, param2, param3)    SFP_LOG_CALL(param1, param2, param3, (SFPLOG_NORMAL << 28)   | (moduleid & 0XFFFFFFF))
+#define SFP_LOG_3_WARNING(moduleid, str, param1, param2, param3)   SFP_LOG_CALL(param1, param2, param3, (SFPLOG_WARNING << 28)  | (moduleid & 0XFFFFFFF))
+#define SFP_LOG_3_ERROR(moduleid, str, param1, param2, param3)     SFP_LOG_CALL(param1, param2, param3, (SFPLOG_ERROR << 28)    | (moduleid & 0XFFFFFFF))
+#define SFP_LOG_3_CRITICAL(moduleid, str, param1, param2, param3)  SFP_LOG_CALL(param1, param2, param3, (SFPLOG_CRITICAL << 28) | (moduleid & 0XFFFFFFF))
+#define SFP_LOG_3(moduleid, severity, str, param1, param2, param3) SFP_LOG_CALL(param1, param2, param3, (severity << 28)        | (moduleid & 0XFFFFFFF))
 // clang-format on
 
 #define CONFIG_SFP_TIMESTAMP
@@ -213,6 +319,15 @@ int sfplogger_send_AppLog();
 #define SFP_STR_LOG_CRITICAL(moduleid, str)  sfp_log_str(moduleid, SFPLOG_CRITICAL, str)
 // clang-format on
 
+// Deferred format logging. Only the format string address and up to SFPLOG_FMT_MAX_ARGS 32-bit
+// arguments are stored, the text is built when the log is printed or decoded on the host
+// (utils/sfpdecode.py). format and any %s argument must stay valid, like string literals.
+// 64-bit and floating point arguments are not supported.
+#define SFP_FMT_NARGS(...) SFP_FMT_NARGS_(0, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define SFP_FMT_NARGS_(_0, _1, _2, _3, _4, _5, _6, n, ...) n
+#define SFP_LOG_FMT(moduleid, severity, format, ...) \
+  sfp_log_fmt(moduleid, severity, format, SFP_FMT_NARGS(__VA_ARGS__), ##__VA_ARGS__)
+
 #define SFP_LOG_STR_COMPLEX(moduleid, severity, str, storestr) \
   sfp_log_complex_str(storestr, (severity << 28) | (moduleid & 0XFFFFFFF), __LINE__, __FILE__)
 
@@ -42,11 +42,13 @@ char* sfpdb_get_next_entry(spflogdbentry_t* sfpdbp, unsigned int entry_size) {
                         (~SFP_MSB_EMPTY_FILLER_TYPE_MASK)));
       *(entryp + 1) = (char)((sfpdbp->buffer_size - sfpdbp->next_entry_delta));
     }
+    sfpdbp->written += sfpdbp->buffer_size - sfpdbp->next_entry_delta;
     entryp = sfpdbp->sfpdbp;
     sfpdbp->next_entry_delta = 0;
   }
 
   sfpdbp->next_entry_delta += entry_size;
+  sfpdbp->written += entry_size;
 
   // Check if entry is exactly the size of the one it is replacing.
   // In the case when entry with 2 bytes for empty filler is bigger, fill remaining with empty
@@ -115,3 +117,19 @@ char* sfpdb_get_earliest_entry(spflogdbentry_t* sfpdbp) {
     }
   }
 }
+
+// Size of a log entry, 0 for an empty filler or an unknown type
+unsigned int sfpdb_entry_size(const char* entry) {
+  if (((*entry) & SFP_MSB_EMPTY_FILLER_TYPE_MASK) == SFP_MSB_EMPTY_FILLER_TYPE) {
+    return 0;
+  } else if (((*entry) & SFP_MSB_SFP_TYPE_MASK) == SFP_MSB_SFP_TYPE) {
+    return SFPLOG_ENTRY_SIZE;
+  } else if (((*entry) & SFP_MSB_EXTENDED_SFP_TYPE_MASK) == SFP_MSB_EXTENDED_SFP_TYPE) {
+    return SFPLOG_EXTENDED_ENTRY_SIZE;
+  } else if (((*entry) & SFP_MSB_STRING_MASK) == SFP_MSB_STRING_TYPE) {
+    return (unsigned char)entry[1] + SFPLOG_STRING_ENTRYHEADER_SIZE;
+  } else if (((*entry) & SFP_MSB_COMPLEX_STRING_MASK) == SFP_MSB_COMPLEX_STRING_TYPE) {
+    return (unsigned char)entry[1] + SFPLOG_COMPLEX_STRING_ENTRYHEADER_SIZE_PLUS_NULL_TERM;
+  }
+  return 0;
+}
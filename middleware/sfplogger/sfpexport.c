@@ -0,0 +1,341 @@
+
+/*  ---------------------------------------------------------------------------
+
+    (c) copyright 2021 Altair Semiconductor, Ltd. All rights reserved.
+
+    This software, in source or object form (the "Software"), is the
+    property of Altair Semiconductor Ltd. (the "Company") and/or its
+    licensors, which have all right, title and interest therein, You
+    may use the Software only in  accordance with the terms of written
+    license agreement between you and the Company (the "License").
+    Except as expressly stated in the License, the Company grants no
+    licenses by implication, estoppel, or otherwise. If you are not
+    aware of or do not agree to the License terms, you may not use,
+    copy or modify the Software. You may use the source code of the
+    Software only for your internal purposes and may not distribute the
+    source code of the Software, any part thereof, or any derivative work
+    thereof, to any third party, except pursuant to the Company's prior
+    written consent.
+    The Software is the confidential information of the Company.
+
+   ------------------------------------------------------------------------- */
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdint.h>
+#include <string.h>
+#include "alt_osal.h"
+#include "sfplogger.h"
+#include "altcom_misc.h"
+#include "serial.h"
+#if (SFPLOG_EXPORT_COMPRESS == 1)
+#include <stdio.h>
+#include "fastlz.h"
+#endif
+
+#if (SFPLOG_EXPORT == 1)
+
+#define SFP_EXPORT_MAGIC0 'S'
+#define SFP_EXPORT_MAGIC1 'X'
+// FastLZ needs 5% headroom and at least 66 bytes of output
+#define SFP_EXPORT_ZBUF_SIZE (SFPLOG_EXPORT_SEGMENT_SIZE + SFPLOG_EXPORT_SEGMENT_SIZE / 16 + 66)
+
+/*
+  Read position of one database. exported is in the units of spflogdbentry_t.written, so
+  written - exported is what is left to send and more than buffer_size means the logger went
+  over entries which were not sent yet. The cursor lives in RAM next to the databases, so it
+  follows them through hibernation.
+*/
+typedef struct {
+  unsigned int offset;
+  unsigned int exported;
+  unsigned int epoch;
+  unsigned int lost;  // bytes overwritten since the last delivered segment
+  char valid;
+} sfpexportcursor_t;
+
+extern spflogdbentry_t sfpdbasearr[SFPLOGGER_MAX_NUM_DBS];
+extern int sfpnumregistereddbs;
+
+static sfpexportcursor_t sfpexport_cursor[SFPLOGGER_MAX_NUM_DBS];
+static sfpexport_sink_t sfpexport_sink = NULL;
+static void *sfpexport_sink_arg = NULL;
+static int sfpexport_compress = 0;
+static unsigned int sfpexport_period = 0;
+static alt_osal_task_handle sfpexport_task = NULL;
+static alt_osal_mutex_handle sfpexport_lock = NULL;
+static uint32_t sfpexport_seq = 0;
+static unsigned int sfpexport_segments = 0;
+static unsigned int sfpexport_bytes = 0;
+static unsigned int sfpexport_lost = 0;
+static char sfpexport_seg[SFPLOG_EXPORT_SEGMENT_SIZE];
+#if (SFPLOG_EXPORT_COMPRESS == 1)
+static char sfpexport_zbuf[SFP_EXPORT_ZBUF_SIZE];
+#endif
+
+// Bytes from offset up to the write position, going around the end of the buffer
+static unsigned int sfpexport_distance(unsigned int offset, unsigned int next, unsigned int size) {
+  return offset <= next ? next - offset : size - offset + next;
+}
+
+// Start over from the earliest entry still in the buffer
+static void sfpexport_resync(sfpexportcursor_t *cur, spflogdbentry_t *db) {
+  unsigned int pending = db->written - cur->exported;
+  unsigned int offset = sfpdb_get_earliest_entry(db) - db->sfpdbp;
+  unsigned int next = db->next_entry_delta;
+  unsigned int left;
+
+  if (db->written <= next || (next < db->buffer_size && db->sfpdbp[next] == 0)) {
+    // still on the first lap, the buffer starts at its base
+    left = next - offset;
+  } else if (offset == next) {
+    left = db->buffer_size;
+  } else {
+    left = sfpexport_distance(offset, next, db->buffer_size);
+  }
+
+  if (cur->valid && pending > left) {
+    cur->lost += pending - left;
+  }
+  cur->offset = offset;
+  cur->exported = db->written - left;
+}
+
+static void sfpexport_put_u16(char *p, unsigned int v) {
+  p[0] = (char)v;
+  p[1] = (char)(v >> 8);
+}
+
+static void sfpexport_put_u32(char *p, uint32_t v) {
+  sfpexport_put_u16(p, v);
+  sfpexport_put_u16(p + 2, v >> 16);
+}
+
+static int sfpexport_send(int dbid, unsigned int len, unsigned int lost) {
+  char header[SFPLOG_EXPORT_HEADER_SIZE];
+  const char *payload = sfpexport_seg;
+  unsigned int payload_len = len;
+  char flags = lost ? SFPLOG_EXPORT_FLAG_LOST : 0;
+
+#if (SFPLOG_EXPORT_COMPRESS == 1)
+  if (sfpexport_compress) {
+    int zlen = fastlz_compress_level(1, sfpexport_seg, len, sfpexport_zbuf);
+
+    // log entries with little repetition may not shrink, send those as they are
+    if (zlen > 0 && (unsigned int)zlen < len) {
+      payload = sfpexport_zbuf;
+      payload_len = zlen;
+      flags |= SFPLOG_EXPORT_FLAG_COMPRESSED;
+    }
+  }
+#endif
+
+  header[0] = SFP_EXPORT_MAGIC0;
+  header[1] = SFP_EXPORT_MAGIC1;
+  header[2] = (char)dbid;
+  header[3] = flags;
+  sfpexport_put_u32(&header[4], sfpexport_seq);
+  sfpexport_put_u16(&header[8], len);
+  sfpexport_put_u16(&header[10], payload_len);
+  sfpexport_put_u32(&header[12], lost);
+
+  if (sfpexport_sink(header, payload, payload_len, sfpexport_sink_arg) != 0) {
+    return -1;
+  }
+  sfpexport_seq++;
+  sfpexport_segments++;
+  sfpexport_bytes += payload_len;
+  return 0;
+}
+
+/*
+  Copy whole entries from the cursor into one segment. The copy runs without masking interrupts,
+  so it is only kept if the logger did not come around to the copied bytes in the meantime.
+  Returns the number of segments sent (0 or 1), -1 when the sink failed.
+*/
+static int sfpexport_segment(int dbid) {
+  spflogdbentry_t *db = &sfpdbasearr[dbid];
+  sfpexportcursor_t *cur = &sfpexport_cursor[dbid];
+  unsigned int written, epoch, size, offset, exported, len = 0;
+  char *base;
+
+  portENTER_CRITICAL();
+  if (db->lock || db->sfpdbp == 0) {
+    // an entry is being written, take it on the next round
+    portEXIT_CRITICAL();
+    return 0;
+  }
+  if (!cur->valid) {
+    sfpexport_resync(cur, db);
+    cur->epoch = db->epoch;
+    cur->valid = 1;
+  } else if (cur->epoch != db->epoch) {
+    // cleared, resized or loaded: what was not sent is gone, pick up at the write position of
+    // the change, the logger moved on by written - epoch_written bytes since
+    cur->lost += db->epoch_written - cur->exported;
+    cur->exported = db->epoch_written;
+    cur->offset = (db->next_entry_delta + db->buffer_size -
+                   (db->written - cur->exported) % db->buffer_size) % db->buffer_size;
+    cur->epoch = db->epoch;
+  }
+  if (db->written - cur->exported > db->buffer_size) {
+    sfpexport_resync(cur, db);
+  }
+  written = db->written;
+  epoch = db->epoch;
+  base = db->sfpdbp;
+  size = db->buffer_size;
+  offset = cur->offset;
+  exported = cur->exported;
+  portEXIT_CRITICAL();
+
+  while (exported != written) {
+    unsigned int entry_size;
+
+    if (size - offset < SFPLOG_EMPTY_FILLER_MIN_SIZE ||
+        (base[offset] & SFP_MSB_EMPTY_FILLER_TYPE_MASK) == SFP_MSB_EMPTY_FILLER_TYPE) {
+      // the rest of the buffer is the slack left by a wrap
+      exported += size - offset;
+      offset = 0;
+      continue;
+    }
+    entry_size = sfpdb_entry_size(&base[offset]);
+    if (entry_size == 0 || entry_size > written - exported || offset + entry_size > size) {
+      break;
+    }
+    if (len + entry_size > SFPLOG_EXPORT_SEGMENT_SIZE) {
+      break;
+    }
+    memcpy(&sfpexport_seg[len], &base[offset], entry_size);
+    len += entry_size;
+    exported += entry_size;
+    offset += entry_size;
+    if (offset == size) {
+      offset = 0;
+    }
+  }
+
+  portENTER_CRITICAL();
+  if (db->epoch != epoch || db->written - cur->exported > size) {
+    // overwritten while copying, the next round starts over
+    portEXIT_CRITICAL();
+    return 0;
+  }
+  portEXIT_CRITICAL();
+
+  if (len == 0) {
+    if (exported != written) {
+      // not an entry where one is expected, the cursor got lost
+      portENTER_CRITICAL();
+      sfpexport_resync(cur, db);
+      portEXIT_CRITICAL();
+    } else {
+      cur->offset = offset;
+      cur->exported = exported;
+    }
+    return 0;
+  }
+
+  if (sfpexport_send(dbid, len, cur->lost) != 0) {
+    return -1;
+  }
+  sfpexport_lost += cur->lost;
+  cur->lost = 0;
+  cur->offset = offset;
+  cur->exported = exported;
+  return 1;
+}
+
+int sfpexport_run(void) {
+  int dbid, ret, sent = 0;
+
+  if (sfpexport_lock == NULL) {
+    return -1;
+  }
+  alt_osal_lock_mutex(&sfpexport_lock, ALT_OSAL_TIMEO_FEVR);
+#if (SFPLOG_TASK_RINGS == 1)
+  sfpring_merge();
+#endif
+  for (dbid = 0; dbid < sfpnumregistereddbs; dbid++) {
+    while ((ret = sfpexport_segment(dbid)) > 0) {
+      sent += ret;
+    }
+    if (ret < 0) {
+      sent = -1;
+      break;
+    }
+  }
+  alt_osal_unlock_mutex(&sfpexport_lock);
+  return sent;
+}
+
+static void sfpexport_task_main(void *arg) {
+  (void)arg;
+
+  for (;;) {
+    alt_osal_sleep_task(sfpexport_period);
+    sfpexport_run();
+  }
+}
+
+int sfpexport_start(sfpexport_sink_t sink, void *arg, int compress, unsigned int period_ms) {
+  alt_osal_mutex_attribute mutex_param = {0};
+  alt_osal_task_attribute attr = {0};
+
+  if (sink == NULL || sfpexport_lock != NULL) {
+    return -1;
+  }
+#if (SFPLOG_EXPORT_COMPRESS != 1)
+  if (compress) {
+    return -1;
+  }
+#endif
+  if (compress && sink == sfpexport_altcom_sink) {
+    // the MAP side gets no header to tell a compressed segment by
+    return -1;
+  }
+  if (alt_osal_create_mutex(&sfpexport_lock, &mutex_param) != 0) {
+    return -1;
+  }
+  sfpexport_sink = sink;
+  sfpexport_sink_arg = arg;
+  sfpexport_compress = compress;
+  sfpexport_period = period_ms;
+
+  if (period_ms) {
+    attr.function = sfpexport_task_main;
+    attr.name = "SFP EXPORT";
+    attr.priority = ALT_OSAL_TASK_PRIO_LOW;
+    attr.stack_size = SFPLOG_EXPORT_TASK_STACK_SIZE;
+    if (alt_osal_create_task(&sfpexport_task, &attr) != 0) {
+      alt_osal_delete_mutex(&sfpexport_lock);
+      sfpexport_lock = NULL;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int sfpexport_altcom_sink(const char *header, const char *payload, unsigned int len, void *arg) {
+  (void)arg;
+
+  if (header[3] & SFPLOG_EXPORT_FLAG_COMPRESSED) {
+    return -1;
+  }
+  return altcom_SendAppLog(len, (char *)payload) == MISC_SUCCESS ? 0 : -1;
+}
+
+int sfpexport_serial_sink(const char *header, const char *payload, unsigned int len, void *arg) {
+  if (serial_write((serial_handle)arg, (void *)header, SFPLOG_EXPORT_HEADER_SIZE) !=
+      SFPLOG_EXPORT_HEADER_SIZE) {
+    return -1;
+  }
+  return serial_write((serial_handle)arg, (void *)payload, len) == len ? 0 : -1;
+}
+
+void sfpexport_get_counters(unsigned int *segments, unsigned int *bytes, unsigned int *lost) {
+  if (segments) *segments = sfpexport_segments;
+  if (bytes) *bytes = sfpexport_bytes;
+  if (lost) *lost = sfpexport_lost;
+}
+
+#endif /* SFPLOG_EXPORT == 1 */
@@ -94,6 +94,13 @@ unsigned char str[SFPLOG_STRING_INPUT_MAX_SIZE] = {0};
 static int sfplogger_printf_entry(char *pcWriteBuffer, size_t xWriteBufferLen, void *flush_func,
                                   void *flush_arg, char *pentry, char *optstring);
 
+// Move what the task rings hold into the databases before they are read
+static void sfp_flush_rings(void) {
+#if (SFPLOG_TASK_RINGS == 1)
+  sfpring_merge();
+#endif
+}
+
 static int sfp_add_db_id() {
   sfpnumregistereddbs++;
 
@@ -130,7 +137,32 @@ static int sfplogger_printf_entry(char *pcWriteBuffer, size_t xWriteBufferLen, v
   char timestr[20];
   unsigned int seconds;
 
-  if (((*pentry) & SFP_MSB_STRING_MASK) == SFP_MSB_STRING_TYPE) {
+  if (((*pentry) & SFP_MSB_FMT_MASK) == SFP_MSB_FMT_TYPE) {
+    unsigned int arg[SFPLOG_FMT_MAX_ARGS] = {0};
+    char text[SFPLOG_STRING_DATA_MAX_SIZE];
+    const char *format;
+    int i, nargs = pentry[3] > SFPLOG_FMT_MAX_ARGS ? SFPLOG_FMT_MAX_ARGS : pentry[3];
+
+    memcpy(&timetag, pentry + 4, 4);
+    memcpy(&format, pentry + 8, 4);
+    for (i = 0; i < nargs; i++) {
+      memcpy(&arg[i], pentry + SFPLOG_COMPLEX_STRING_ENTRYHEADER_SIZE_PLUS_NULL_TERM + 4 * i, 4);
+    }
+    if (gLtimeValid) {
+      seconds = (unsigned int)gLtime + ((timetag - gLtimeMsec) / 1000);
+    } else {
+      seconds = timetag / 1000;
+    }
+    sfplogger_osal_convert_time(seconds, timestr, 20);
+
+    // unused trailing arguments are ignored by the format
+    snprintf(text, sizeof(text), format, arg[0], arg[1], arg[2], arg[3], arg[4], arg[5]);
+    if (pcWriteBuffer == 0) {
+      printf("%s.%03d %s %s\r\n", timestr, timetag % 1000, spfprintseverarr[*pentry & 0x7], text);
+    } else {
+      CLI_PF("%s.%03d %s %s\r\n", timestr, timetag % 1000, spfprintseverarr[*pentry & 0x7], text);
+    }
+  } else if (((*pentry) & SFP_MSB_STRING_MASK) == SFP_MSB_STRING_TYPE) {
     memcpy(&timetag, pentry + 2, 4);
     timetag = htonl(timetag);
     char lengthofstrin;
@@ -188,8 +220,19 @@ unsigned int sfp_calc_hash_from_filename(void *filename) {
 
 int sfp_log(int param1, int param2, int param3, unsigned int severitymoduleid,
             unsigned int line_num, void *pfilename) {
+  unsigned int severity = (severitymoduleid & 0xF0000000) >> 28;
+
+  // skip the file name hash when the entry is filtered anyway
+  if (severity > (unsigned int)sfplogmodarr[severitymoduleid & 0xFFFFFFF].severity) return 0;
+
+  return sfp_log_hash(param1, param2, param3, severitymoduleid, line_num,
+                      sfp_calc_hash_from_filename(pfilename));
+}
+
+int sfp_log_hash(int param1, int param2, int param3, unsigned int severitymoduleid,
+                 unsigned int line_num, unsigned int file_hash) {
   unsigned int moduleid, data, entry_size = SFPLOG_ENTRY_SIZE;
-  char *entryp, severity, sfplogproto[SFPLOG_EXTENDED_ENTRY_SIZE];
+  char severity, sfplogproto[SFPLOG_EXTENDED_ENTRY_SIZE];
   int dbid = SFPLOG_ENTRY_SIZE;
 
   moduleid = severitymoduleid & 0xFFFFFFF;
@@ -209,8 +252,7 @@ int sfp_log(int param1, int param2, int param3, unsigned int severitymoduleid,
 
   // Bits 20-30 - 11 bits of line number, bits 0-19 - filename pointer
   data = ((line_num & 0xFFF) << 20) |
-         (sfp_calc_hash_from_filename(pfilename) &
-          0xFFFFF);  // line number: upper 12 bits. hashed filename : lower 20 bits
+         (file_hash & 0xFFFFF);  // line number: upper 12 bits. hashed filename : lower 20 bits
   memcpy(sfplogproto, &data, 4);
   // MSB '0' bit indicates type of entry is SFP.
   *(sfplogproto) &= ~SFP_MSB_SFP_TYPE_MASK;
@@ -243,6 +285,22 @@ int sfp_log(int param1, int param2, int param3, unsigned int severitymoduleid,
     return -1;
   }
 
+#if (SFPLOG_TASK_RINGS == 1)
+  if (0 == sfpPreventEntries && sfpring_put(dbid, sfplogproto, entry_size) == 0) {
+    return 0;
+  }
+#endif
+
+  return sfpdb_store_entry(dbid, sfplogproto, entry_size);
+}
+
+int sfpdb_store_entry(int dbid, const char *entry, unsigned int entry_size) {
+  char *entryp;
+
+  if (sfpdbasearr[dbid].sfpdbp == 0 || entry_size > sfpdbasearr[dbid].buffer_size) {
+    return -1;
+  }
+
   /* clearing not allowed if new entry to log is taking place*/
   sfpdbasearr[dbid].lock = 1;  // signal to clearing/resizing that log is currently written
 
@@ -252,7 +310,7 @@ int sfp_log(int param1, int param2, int param3, unsigned int severitymoduleid,
     entryp = (char *)sfpdb_get_next_entry(&(sfpdbasearr[dbid]), entry_size);
     SFP_EXIT_CRITICAL(dbid)
 
-    memcpy(entryp, sfplogproto, entry_size);
+    memcpy(entryp, entry, entry_size);
   }
 
   sfpdbasearr[dbid].lock = 0;  // signal to clearing/resizing that log write completed
@@ -273,6 +331,7 @@ int sfp_log_string(const char *format, ...) {
   }
 
   sfp_log_str(SFPLOG_DBG_PRINT, SFPLOG_INFO, (char *)str);
+  sfp_flush_rings();
 
   return (altcom_SendAppLog(sfpdbasearr->buffer_size, (char *)sfpdbasearr->sfpdbp));
   ;
@@ -295,6 +354,52 @@ int sfp_log_formatted(SFP_log_module_id_t moduleid, char severity, const char *f
   return 0;
 }
 
+int sfp_log_fmt(SFP_log_module_id_t moduleid, char severity, const char *format, unsigned int nargs,
+                ...) {
+  char entry[SFPLOG_FMT_ENTRY_MAX_SIZE];
+  unsigned int i, data, entry_size;
+  va_list argp;
+  int dbid;
+
+  if (moduleid >= SFPLOG_MAX_MODULE_ID || nargs > SFPLOG_FMT_MAX_ARGS) return -1;
+  if (severity > sfplogmodarr[moduleid].severity) return 0;
+
+  dbid = sfplogmodarr[moduleid].dbid;
+  if (dbid >= SFPLOGGER_MAX_NUM_DBS) {
+    printf("Incorrect database id [%d]. %s failed\r\n", dbid, __func__);
+    return -1;
+  }
+
+  // everything lives on the stack, so callers of any context can log at the same time
+  entry_size = SFPLOG_COMPLEX_STRING_ENTRYHEADER_SIZE_PLUS_NULL_TERM + 4 * nargs;
+  entry[0] = SFP_MSB_FMT_TYPE | (severity & 0x7);
+  entry[1] = (char)(4 * nargs);
+  entry[2] = (char)moduleid;
+  entry[3] = (char)nargs;
+  data = alt_osal_get_tick_count();  // time in msec - will wrap around every 49.7 days
+  memcpy(entry + 4, &data, 4);
+  memcpy(entry + 8, &format, 4);
+
+  va_start(argp, nargs);
+  for (i = 0; i < nargs; i++) {
+    data = va_arg(argp, unsigned int);
+    memcpy(entry + SFPLOG_COMPLEX_STRING_ENTRYHEADER_SIZE_PLUS_NULL_TERM + 4 * i, &data, 4);
+  }
+  va_end(argp);
+
+  if (sfplogmodarr[moduleid].printtostd != 0) {
+    sfplogger_printf_entry(0, 0, 0, 0, entry, NULL);
+  }
+
+#if (SFPLOG_TASK_RINGS == 1)
+  if (0 == sfpPreventEntries && sfpring_put(dbid, entry, entry_size) == 0) {
+    return 0;
+  }
+#endif
+
+  return sfpdb_store_entry(dbid, entry, entry_size);
+}
+
 int sfp_log_str(SFP_log_module_id_t moduleid, char severity, char *logstring) {
   char clength, *entryp;
   unsigned int timedata;
@@ -492,6 +597,7 @@ void sfplogger_print_buffer_locked(char *pcWriteBuffer, size_t xWriteBufferLen,
                                    void *flush_arg, void *psbufferid) {
   SFP_LOG_WARNING(SFPLOG_DBG_PRINT, "SFP user print start - Locking internal database");
 
+  sfp_flush_rings();
   sfpPreventEntries = 1;
 
   if (*(char *)psbufferid == 'h') {
@@ -511,6 +617,8 @@ void sfplogger_print_buffer(char *pcWriteBuffer, size_t xWriteBufferLen, void *f
                             void *flush_arg, void *psbufferid) {
   unsigned int j, bufferid, lastprintid = 0;
   unsigned char i;
+
+  sfp_flush_rings();
   if (*(char *)psbufferid == 'a') {
     if (pcWriteBuffer != 0) {
       if (1 == sfpDatabaseEnabled) {
@@ -584,6 +692,18 @@ void sfplogger_print_registered_modules(char *pcWriteBuffer, size_t xWriteBuffer
   CLI_PF("\r\nTotal allocated buffers size: %d Bytes\r\n", totalbufferssize);
   CLI_PF("\r\nInternal database [%s]\r\n", sfpDatabaseEnabled == 1 ? "Enabled" : "Disabled");
 
+#if (SFPLOG_TASK_RINGS == 1)
+  CLI_PF("\r\nTask rings: merged [%u], direct on overflow [%u]\r\n", sfpring_merged_count(),
+         sfpring_overflow_count());
+#endif
+#if (SFPLOG_EXPORT == 1)
+  {
+    unsigned int segments, bytes, lost;
+
+    sfpexport_get_counters(&segments, &bytes, &lost);
+    CLI_PF("\r\nExport: segments [%u], bytes [%u], lost [%u]\r\n", segments, bytes, lost);
+  }
+#endif
   CLI_PF("\r\nPrint to stream [%s]\r\n", sfpEnableOutputToStream == 0 ? "Disabled" : "Enabled");
   if (sfpEnableOutputToStream != 0) {
     CLI_PF("\r\nNumber of lost stream logs [%d]\r\n", streambufferfull);
@@ -605,6 +725,8 @@ void sfplogger_clear_buffers(char *buffer_to_clear, char *pcWriteBuffer, size_t
     portENTER_CRITICAL();
     memset(sfpdbasearr[i].sfpdbp, 0, sfpdbasearr[i].buffer_size);
     sfpdbasearr[i].next_entry_delta = 0;
+    sfpdbasearr[i].epoch++;
+    sfpdbasearr[i].epoch_written = sfpdbasearr[i].written;
     portEXIT_CRITICAL();
   }
 }
@@ -794,6 +916,8 @@ int sfplogger_resize_db(int moduleid, unsigned int size, int write_conf_to_file)
     char *placeholder = sfpdbasearr[dbid].sfpdbp;
     sfpdbasearr[dbid].sfpdbp = 0;
     sfpdbasearr[dbid].buffer_size = 0;
+    sfpdbasearr[dbid].epoch++;
+    sfpdbasearr[dbid].epoch_written = sfpdbasearr[dbid].written;
 
     ALT_OSAL_FREE(placeholder);
     return 0;
@@ -819,6 +943,8 @@ int sfplogger_resize_db(int moduleid, unsigned int size, int write_conf_to_file)
 
     ALT_OSAL_FREE(sfpdbasearr[dbid].sfpdbp);
     sfpdbasearr[dbid].sfpdbp = new_db_buffer;
+    sfpdbasearr[dbid].epoch++;
+    sfpdbasearr[dbid].epoch_written = sfpdbasearr[dbid].written;
     portEXIT_CRITICAL();
   }
 
@@ -833,6 +959,8 @@ int sfplogger_save_buffer_in_db(unsigned int dbid, char *binaryBuff, unsigned in
   if (sfpdbasearr[dbid].buffer_size >= size) {
     memset(sfpdbasearr[dbid].sfpdbp, 0, sfpdbasearr[dbid].buffer_size);
     memcpy(sfpdbasearr[dbid].sfpdbp, binaryBuff, size);
+    sfpdbasearr[dbid].epoch++;
+    sfpdbasearr[dbid].epoch_written = sfpdbasearr[dbid].written;
   } else {
     return -1;
   }
@@ -847,6 +975,9 @@ int sfp_log_init() {
     sfpdbasearr[i].next_entry_delta = 0;
     sfpdbasearr[i].sfpdbp = 0;
     sfpdbasearr[i].lock = 0;
+    sfpdbasearr[i].written = 0;
+    sfpdbasearr[i].epoch = 0;
+    sfpdbasearr[i].epoch_written = 0;
   }
 
   for (i = 0; i < SFPLOG_MAX_MODULE_ID; i++) {
@@ -884,10 +1015,17 @@ int sfp_log_init() {
   sfplogger_set_module_severity(SFPLOG_ALTCOM, SFPLOG_NORMAL, 0);
   sfplogger_set_module_print_state(SFPLOG_ALTCOM, 1, 0);
 
+#if (SFPLOG_TASK_RINGS == 1)
+  if (sfpring_init() != 0) {
+    printf("%s failed to create the task rings, logging directly\r\n", __func__);
+  }
+#endif
+
   return 0;
 }
 
 int sfplogger_send_AppLog() {
+  sfp_flush_rings();
   return (altcom_SendAppLog(sfpdbasearr->buffer_size, (char *)sfpdbasearr->sfpdbp));
 }
 
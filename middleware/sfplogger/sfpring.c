@@ -0,0 +1,285 @@
+
+/*  ---------------------------------------------------------------------------
+
+    (c) copyright 2021 Altair Semiconductor, Ltd. All rights reserved.
+
+    This software, in source or object form (the "Software"), is the
+    property of Altair Semiconductor Ltd. (the "Company") and/or its
+    licensors, which have all right, title and interest therein, You
+    may use the Software only in  accordance with the terms of written
+    license agreement between you and the Company (the "License").
+    Except as expressly stated in the License, the Company grants no
+    licenses by implication, estoppel, or otherwise. If you are not
+    aware of or do not agree to the License terms, you may not use,
+    copy or modify the Software. You may use the source code of the
+    Software only for your internal purposes and may not distribute the
+    source code of the Software, any part thereof, or any derivative work
+    thereof, to any third party, except pursuant to the Company's prior
+    written consent.
+    The Software is the confidential information of the Company.
+
+   ------------------------------------------------------------------------- */
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdint.h>
+#include <string.h>
+#include "alt_osal.h"
+#include "sfplogger.h"
+
+#if (SFPLOG_TASK_RINGS == 1)
+
+#define SFP_RING_ISR 0           // ring of interrupt context, producers claim slots with a CAS
+#define SFP_RING_EVT_MERGE (1 << 0)
+#define SFP_RING_DROPPED ((char)-1)  // dbid of a slot its task was deleted while writing
+
+/*
+  Each ring has one producer, so a task logs without locking anything. The producer moves head,
+  the merger moves tail. A slot is published by writing its sequence number last, 0 means it is
+  still being written.
+*/
+typedef struct {
+  volatile uint32_t seq;  // global log order
+  char dbid;
+  char entry[SFPLOG_FMT_ENTRY_MAX_SIZE];
+} sfpringslot_t;
+
+typedef struct {
+  void *volatile owner;   // task writing this ring
+  volatile uint32_t head;
+  volatile uint32_t tail;
+  sfpringslot_t slot[SFPLOG_RING_SLOTS];
+} sfpring_t;
+
+static sfpring_t *sfprings = NULL;
+static alt_osal_task_handle sfpring_task = NULL;
+static alt_osal_mutex_handle sfpring_merge_lock = NULL;
+static volatile uint32_t sfpring_seq = 0;
+static uint32_t sfpring_last_tick = 0;  // time stamp of the last merged entry
+static unsigned int sfpring_merged = 0;
+static volatile unsigned int sfpring_overflows = 0;
+
+extern char sfpPreventEntries;
+
+static sfpring_t* sfpring_get_own(void) {
+  void *self, *expected;
+  int i;
+
+  if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
+    return NULL;
+  }
+  self = xTaskGetCurrentTaskHandle();
+
+  for (i = SFP_RING_ISR + 1; i < SFPLOG_RING_MAX; i++) {
+    if (sfprings[i].owner == self) {
+      return &sfprings[i];
+    }
+  }
+  // first entry of this task, rings stay with their task
+  for (i = SFP_RING_ISR + 1; i < SFPLOG_RING_MAX; i++) {
+    expected = NULL;
+    if (sfprings[i].owner == NULL &&
+        __atomic_compare_exchange_n(&sfprings[i].owner, &expected, self, 0, __ATOMIC_ACQ_REL,
+                                    __ATOMIC_RELAXED)) {
+      return &sfprings[i];
+    }
+  }
+  return NULL;
+}
+
+static uint32_t sfpring_next_seq(void) {
+  uint32_t seq;
+
+  do {
+    seq = __atomic_add_fetch(&sfpring_seq, 1, __ATOMIC_RELAXED);
+  } while (seq == 0);
+  return seq;
+}
+
+/* Called by vTaskDelete() in a critical section, see traceTASK_DELETE in FreeRTOSConfig.h */
+void sfpring_task_deleted(void* task) {
+  sfpring_t* ring;
+  uint32_t pos;
+  int i;
+
+  if (sfprings == NULL) {
+    return;
+  }
+  for (i = SFP_RING_ISR + 1; i < SFPLOG_RING_MAX; i++) {
+    ring = &sfprings[i];
+    if (ring->owner != task) {
+      continue;
+    }
+    // a slot the task was cut in is never published by it, let the merger step over it
+    for (pos = ring->tail; pos != ring->head; pos++) {
+      if (ring->slot[pos % SFPLOG_RING_SLOTS].seq == 0) {
+        ring->slot[pos % SFPLOG_RING_SLOTS].dbid = SFP_RING_DROPPED;
+        __atomic_store_n(&ring->slot[pos % SFPLOG_RING_SLOTS].seq, sfpring_next_seq(),
+                         __ATOMIC_RELEASE);
+      }
+    }
+    // what is left in the ring is still merged, the next task to log appends behind it
+    __atomic_store_n(&ring->owner, NULL, __ATOMIC_RELEASE);
+  }
+}
+
+int sfpring_put(int dbid, const char* entry, unsigned int entry_size) {
+  sfpring_t* ring;
+  sfpringslot_t* slot;
+  uint32_t pos, seq, used, tick;
+
+  if (sfprings == NULL) {
+    return -1;
+  }
+
+  if (alt_osal_irq_context()) {
+    ring = &sfprings[SFP_RING_ISR];
+    pos = ring->head;
+    // the order is taken inside the claim, a nested interrupt claiming in between fails the CAS and
+    // both are taken again, so the slots of this ring stay in log order
+    do {
+      used = pos - ring->tail;
+      if (used >= SFPLOG_RING_SLOTS) {
+        sfpring_overflows++;
+        return -1;
+      }
+      seq = sfpring_next_seq();
+    } while (!__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, 1, __ATOMIC_ACQ_REL,
+                                          __ATOMIC_RELAXED));
+  } else {
+    ring = sfpring_get_own();
+    if (ring == NULL) {
+      return -1;
+    }
+    pos = ring->head;
+    used = pos - ring->tail;
+    if (used >= SFPLOG_RING_SLOTS) {
+      sfpring_overflows++;
+      return -1;
+    }
+    ring->head = pos + 1;
+    seq = sfpring_next_seq();
+  }
+
+  tick = alt_osal_get_tick_count();
+
+  slot = &ring->slot[pos % SFPLOG_RING_SLOTS];
+  slot->dbid = (char)dbid;
+  memcpy(slot->entry, entry, entry_size);
+  memcpy(slot->entry + 4, &tick, 4);
+  __atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+
+  if (used + 1 == SFPLOG_RING_SLOTS / 2 && sfpring_task) {
+    alt_osal_set_taskflag(sfpring_task, SFP_RING_EVT_MERGE);
+  }
+  return 0;
+}
+
+/*
+  Take the lowest sequence number across the ring tails until the rings are empty. A ring whose
+  tail is claimed but not published yet sits out the round, so a preempted task holds back only its
+  own entries. That entry may then land after newer ones of other rings, its time stamp is still
+  kept in order.
+*/
+int sfpring_merge(void) {
+  sfpring_t *ring, *next;
+  sfpringslot_t* slot;
+  uint32_t seq, tick, best_seq = 0;
+  int i, merged = 0;
+
+  if (sfprings == NULL || alt_osal_irq_context() || sfpPreventEntries) {
+    return 0;
+  }
+  if (alt_osal_lock_mutex(&sfpring_merge_lock, ALT_OSAL_TIMEO_FEVR) != 0) {
+    return 0;
+  }
+
+  while (1) {
+    next = NULL;
+    for (i = 0; i < SFPLOG_RING_MAX; i++) {
+      ring = &sfprings[i];
+      if (ring->tail == ring->head) {
+        continue;
+      }
+      seq = __atomic_load_n(&ring->slot[ring->tail % SFPLOG_RING_SLOTS].seq, __ATOMIC_ACQUIRE);
+      if (seq == 0) {
+        continue;
+      }
+      if (next == NULL || (int32_t)(seq - best_seq) < 0) {
+        next = ring;
+        best_seq = seq;
+      }
+    }
+    if (next == NULL) {
+      break;
+    }
+
+    // a producer preempted between taking its number and the tick may carry an older tick
+    slot = &next->slot[next->tail % SFPLOG_RING_SLOTS];
+    if (slot->dbid != SFP_RING_DROPPED) {
+      memcpy(&tick, slot->entry + 4, 4);
+      if ((int32_t)(tick - sfpring_last_tick) < 0) {
+        memcpy(slot->entry + 4, &sfpring_last_tick, 4);
+      } else {
+        sfpring_last_tick = tick;
+      }
+      sfpdb_store_entry(slot->dbid, slot->entry, sfpdb_entry_size(slot->entry));
+      merged++;
+    }
+    slot->seq = 0;
+    __atomic_store_n(&next->tail, next->tail + 1, __ATOMIC_RELEASE);
+  }
+
+  sfpring_merged += merged;
+  alt_osal_unlock_mutex(&sfpring_merge_lock);
+  return merged;
+}
+
+static void sfpring_merger(void* arg) {
+  (void)arg;
+
+  while (1) {
+    alt_osal_wait_taskflag(SFP_RING_EVT_MERGE, ALT_OSAL_WMODE_TWF_ORW, SFPLOG_RING_MERGE_PERIOD);
+    sfpring_merge();
+  }
+}
+
+int sfpring_init(void) {
+  alt_osal_task_attribute attr = {0};
+  alt_osal_mutex_attribute mutex_param = {0};
+  sfpring_t* rings;
+
+  if (sfprings) {
+    return 0;
+  }
+
+  rings = ALT_OSAL_MALLOC(sizeof(sfpring_t) * SFPLOG_RING_MAX);
+  if (rings == NULL) {
+    return -1;
+  }
+  memset(rings, 0, sizeof(sfpring_t) * SFPLOG_RING_MAX);
+
+  if (alt_osal_create_mutex(&sfpring_merge_lock, &mutex_param) != 0) {
+    ALT_OSAL_FREE(rings);
+    return -1;
+  }
+
+  attr.function = sfpring_merger;
+  attr.name = "SFP MERGE";
+  attr.priority = ALT_OSAL_TASK_PRIO_LOW;
+  attr.stack_size = SFPLOG_RING_TASK_STACK_SIZE;
+  if (alt_osal_create_task(&sfpring_task, &attr) != 0) {
+    alt_osal_delete_mutex(&sfpring_merge_lock);
+    ALT_OSAL_FREE(rings);
+    sfpring_task = NULL;
+    return -1;
+  }
+
+  sfprings = rings;
+  return 0;
+}
+
+unsigned int sfpring_merged_count(void) { return sfpring_merged; }
+
+unsigned int sfpring_overflow_count(void) { return sfpring_overflows; }
+
+#endif
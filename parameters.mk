@@ -20,6 +20,7 @@ FLASHMCU ?= $(ROOT)utils/flashmcu.py
 ERASEMCU ?= $(ROOT)utils/erasemcu.py
 JTAGMCU ?= $(ROOT)utils/jtagmcu.py
 GENVER ?= $(ROOT)utils/genver.py
+SFPHASH ?= $(ROOT)utils/sfphash.py
 # serial port settings for flashmcu.py
 FLASHPORT ?= /dev/ttyACM1
 FLASHBAUD ?= 115200
@@ -0,0 +1,127 @@
+#!/usr/bin/env python
+
+'''
+Report where the time of a hibernation went.
+
+Input is a console log holding the output of "hbnProf dump" (hibernate_dbg_profile_report with
+raw set): one HBNPROF line with the words of struct hibernate_profile and one HBNCODEC line per
+codec. When the log holds several dumps, each is reported.
+'''
+
+from __future__ import print_function
+import sys
+import argparse
+
+PROFILE_VERSION = 1
+
+PHASES = ["free list", "heap zero", "stack fill", "compress", "flash prep", "flash write",
+          "flash read", "restore"]
+REGIONS = ["gpm heap", "data/bss", "sram heap"]
+REGION_FIELDS = ["raw", "packed", "blocks", "const", "stored", "compress", "restore"]
+CODECS = ["fastlz", "store", "lz4", "fill"]
+
+# size of the record trailer and worst case expansion of a 4KB block on the target
+WORKING_BLOCK_SIZE = 4096
+MAX_COMPRESSED_BLOCK_SIZE = WORKING_BLOCK_SIZE + WORKING_BLOCK_SIZE // 32 + 12
+
+
+class Profile(object):
+    '''struct hibernate_profile from its dump words'''
+
+    def __init__(self, words):
+        self.version, self.seq, self.clock = words[0:3]
+        pos = 3
+        self.phases = words[pos:pos + len(PHASES)]
+        pos += len(PHASES)
+        (self.free_blocks, self.free_heap, self.free_stack, self.image,
+         self.space, lead) = words[pos:pos + 6]
+        pos += 6
+        self.lead = lead - (1 << 32) if lead & 0x80000000 else lead
+        self.regions = []
+        for _ in REGIONS:
+            self.regions.append(dict(zip(REGION_FIELDS, words[pos:pos + len(REGION_FIELDS)])))
+            pos += len(REGION_FIELDS)
+        self.codecs = {}
+
+
+def read_dump(filename):
+    profiles = []
+    with open(filename, 'r') as f:
+        for text in f:
+            fields = text.split()
+            if 'HBNPROF' in fields:
+                fields = fields[fields.index('HBNPROF') + 1:]
+                profiles.append(Profile([int(w, 16) for w in fields]))
+            elif 'HBNCODEC' in fields and profiles:
+                fields = fields[fields.index('HBNCODEC') + 1:]
+                profiles[-1].codecs[int(fields[0])] = [int(w, 16) for w in fields[1:]]
+    return profiles
+
+
+def msec(cycles, clock):
+    return cycles * 1000.0 / clock
+
+
+def report(prof, clock, out):
+    if prof.version != PROFILE_VERSION:
+        out.write("profile version {:d} is not supported\n".format(prof.version))
+        return
+    clock = clock or prof.clock
+    total = sum(prof.phases)
+    out.write("hibernation #{:d}, {:.1f} MHz\n".format(prof.seq, clock / 1e6))
+    out.write("{:<12s} {:>10s} {:>6s}\n".format("phase", "ms", "%"))
+    for name, cycles in zip(PHASES, prof.phases):
+        out.write("{:<12s} {:10.2f} {:6.1f}\n".format(name, msec(cycles, clock),
+                                                       100.0 * cycles / total if total else 0))
+    out.write("{:<12s} {:10.2f}\n\n".format("total", msec(total, clock)))
+
+    out.write("{:<10s} {:>8s} {:>8s} {:>6s} {:>6s} {:>6s} {:>6s} {:>10s} {:>10s}\n".format(
+        "region", "raw", "packed", "ratio", "blocks", "const", "stored", "comp ms", "rest ms"))
+    for name, r in zip(REGIONS, prof.regions):
+        out.write("{:<10s} {:8d} {:8d} {:6.2f} {:6d} {:6d} {:6d} {:10.2f} {:10.2f}\n".format(
+            name, r["raw"], r["packed"], float(r["raw"]) / r["packed"] if r["packed"] else 0,
+            r["blocks"], r["const"], r["stored"], msec(r["compress"], clock),
+            msec(r["restore"], clock)))
+
+    if prof.codecs:
+        out.write("\n{:<10s} {:>6s} {:>8s} {:>8s} {:>10s} {:>10s}\n".format(
+            "codec", "blocks", "raw", "packed", "comp ms", "decomp ms"))
+        for codec in sorted(prof.codecs):
+            blocks, raw, packed, comp, decomp = prof.codecs[codec][:5]
+            name = CODECS[codec] if codec < len(CODECS) else str(codec)
+            out.write("{:<10s} {:6d} {:8d} {:8d} {:10.2f} {:10.2f}\n".format(
+                name, blocks, raw, packed, msec(comp, clock), msec(decomp, clock)))
+
+    out.write("\nfree: {:d} blocks, heap {:d} bytes, stacks {:d} bytes\n".format(
+        prof.free_blocks, prof.free_heap, prof.free_stack))
+    out.write("image: {:d} of {:d} bytes ({:.0f}%)\n".format(
+        prof.image, prof.space, 100.0 * prof.image / prof.space if prof.space else 0))
+
+    # sizing hints for GPM and the in place compression of the GPM heap
+    if prof.space and prof.image * 10 > prof.space * 9:
+        out.write("warning: image uses over 90% of the compress space\n")
+    if prof.lead < MAX_COMPRESSED_BLOCK_SIZE:
+        out.write("warning: in-place lead {:d} is below the block bound {:d}\n".format(
+            prof.lead, MAX_COMPRESSED_BLOCK_SIZE))
+    stored = sum(r["stored"] for r in prof.regions)
+    blocks = sum(r["blocks"] for r in prof.regions)
+    if blocks and stored * 4 > blocks:
+        out.write("note: {:d} of {:d} blocks did not compress\n".format(stored, blocks))
+
+
+def main(opts):
+    profiles = read_dump(opts.dump)
+    if not profiles:
+        sys.exit("no HBNPROF line in {:s}".format(opts.dump))
+    for i, prof in enumerate(profiles):
+        if i:
+            sys.stdout.write("\n")
+        report(prof, opts.clock, sys.stdout)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description="Hibernation profile report.")
+    parser.add_argument('dump', help='console log with the output of "hbnProf dump"')
+    parser.add_argument('--clock', type=int, default=0,
+                        help='core clock in Hz, overrides the one recorded in the profile')
+    main(parser.parse_args())
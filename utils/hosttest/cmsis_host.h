@@ -0,0 +1,65 @@
+/*
+  Host stand-in for cmsis_gcc.h, for the checks that run driver code calling the core intrinsics.
+
+  Force-include it (-include cmsis_host.h in CFLAGS_<name>): it takes the include guard of
+  cmsis_gcc.h, so core_cm4.h gets the compiler macros and the intrinsics below instead of the
+  Cortex-M inline assembly. PRIMASK and BASEPRI are plain variables that the check defines, sets
+  and reads, exclusive accesses always succeed, barriers are compiler barriers.
+*/
+#ifndef CMSIS_HOST_H
+#define CMSIS_HOST_H
+
+#define __CMSIS_GCC_H
+
+#include <stdint.h>
+
+#define __ASM __asm
+#define __INLINE inline
+#define __STATIC_INLINE static inline
+#define __STATIC_FORCEINLINE __attribute__((always_inline)) static inline
+#define __NO_RETURN __attribute__((__noreturn__))
+#define __USED __attribute__((used))
+#define __WEAK __attribute__((weak))
+#define __PACKED __attribute__((packed, aligned(1)))
+#define __PACKED_STRUCT struct __attribute__((packed, aligned(1)))
+#define __PACKED_UNION union __attribute__((packed, aligned(1)))
+#define __ALIGNED(x) __attribute__((aligned(x)))
+#define __RESTRICT __restrict
+#define __COMPILER_BARRIER() __ASM volatile("" ::: "memory")
+
+extern uint32_t hostPrimask, hostBasepri;
+
+__STATIC_FORCEINLINE void __enable_irq(void) {
+  __COMPILER_BARRIER();
+  hostPrimask = 0;
+}
+
+__STATIC_FORCEINLINE void __disable_irq(void) {
+  hostPrimask = 1;
+  __COMPILER_BARRIER();
+}
+
+__STATIC_FORCEINLINE uint32_t __get_PRIMASK(void) { return hostPrimask; }
+
+__STATIC_FORCEINLINE void __set_PRIMASK(uint32_t priMask) { hostPrimask = priMask; }
+
+__STATIC_FORCEINLINE uint32_t __get_BASEPRI(void) { return hostBasepri; }
+
+__STATIC_FORCEINLINE void __set_BASEPRI(uint32_t basePri) { hostBasepri = basePri; }
+
+__STATIC_FORCEINLINE void __NOP(void) { __COMPILER_BARRIER(); }
+
+__STATIC_FORCEINLINE void __ISB(void) { __COMPILER_BARRIER(); }
+
+__STATIC_FORCEINLINE void __DSB(void) { __COMPILER_BARRIER(); }
+
+__STATIC_FORCEINLINE void __DMB(void) { __COMPILER_BARRIER(); }
+
+__STATIC_FORCEINLINE uint32_t __LDREXW(volatile uint32_t *addr) { return *addr; }
+
+__STATIC_FORCEINLINE uint32_t __STREXW(uint32_t value, volatile uint32_t *addr) {
+  *addr = value;
+  return 0;
+}
+
+#endif
@@ -0,0 +1,266 @@
+/*
+  Host model of the memory hibernate.c works on, for the hibernate checks.
+
+  The linker places the regions (see LDFLAGS_hibernate in the Makefile):
+  - GPM at 0x20000000: the "uncompressed" section first, as in ALT125x_flash.ld, so the GPM prefix
+    saved with a flash image holds the state of hibernate.c itself, then the compression space,
+    with the GPM heap (region 0) in its second half;
+  - .data/.bss (region 1) and the SRAM heap (region 2) at 0x10000000;
+  - the MCU flash partition at 0x30000000, NOR flash: an erase sets 0xFF, a program only clears
+    bits, and it stays busy for a few polls after each command;
+  - the DWT and CoreDebug registers, as plain memory.
+  A shutdown wipes GPM and RAM, only the flash is left for the restore.
+
+  Include it in place of hibernate.c, after pwr_mngr.h has set the hibernate options.
+*/
+#ifndef HIBERNATE_SIM_H
+#define HIBERNATE_SIM_H
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "../../middleware/pwrmanager/src/hibernate.c"
+#include "hosttest.h"
+
+#define SIM_GPM_START (0x20000000UL)
+#define SIM_GPM_END (0x20020000UL)
+#define SIM_RAM_START (0x10000000UL)
+#define SIM_RAM_END (0x10030000UL)
+#define SIM_FLASH_START (0x30000000UL)
+#define SIM_FLASH_SIZE (0x80000UL)
+#define SIM_MCU_IMAGE_SIZE (0x9000UL)  // firmware at the start of the partition
+#define SIM_CORE_REGS (0xE0000000UL)
+
+#define SIM_NUM_REGIONS (sizeof(MemRegions) / sizeof(MemRegions[0]))
+#define SIM_MAX_FREE (6)
+
+extern char __start_uncompressed[], __stop_uncompressed[];
+
+uint32_t SystemCoreClock = 160000000;
+
+static uint8_t *const simFlash = (uint8_t *)SIM_FLASH_START;
+static uint32_t simFlashBusy;
+static uint32_t simFlashPolls;  // polls that found the flash busy, the overlap the pipeline got
+static struct hibernate_free_block simFree[SIM_MAX_FREE];
+static size_t simNumFree;
+static char *simExpected[SIM_NUM_REGIONS];
+
+uint32_t alt_osal_get_tasks_status(alt_osal_task_status *const task_array, size_t array_size) {
+  (void)task_array;
+  (void)array_size;
+  return 0;  // no task stacks, free memory comes from the heaps only
+}
+
+void get_unused_heap_mem(struct hibernate_free_block **freeListPtr) {
+  size_t i;
+
+  for (i = 0; i < simNumFree; i++) {
+    simFree[i].next = *freeListPtr;
+    *freeListPtr = &simFree[i];
+  }
+}
+
+static int32_t sim_in_flash(const void *addr, size_t len) {
+  return (uintptr_t)addr >= SIM_FLASH_START &&
+         (uintptr_t)addr + len <= SIM_FLASH_START + SIM_FLASH_SIZE;
+}
+
+int DRV_FLASH_Is_Busy(void) {
+  if (simFlashBusy == 0) return 0;
+  simFlashBusy--;
+  simFlashPolls++;
+  return 1;
+}
+
+Flash_Err_Code DRV_FLASH_Read(void *src, void *dst, size_t size) {
+  if (!sim_in_flash(src, size)) return FLASH_ERROR_ADDRESS_RANGE;
+  memcpy(dst, src, size);
+  return FLASH_ERROR_NONE;
+}
+
+Flash_Err_Code DRV_FLASH_Write(void *src, void *dst, size_t len, int do_verify) {
+  const uint8_t *s = src;
+  uint8_t *d = dst;
+  size_t i;
+
+  (void)do_verify;
+  if (!sim_in_flash(dst, len)) return FLASH_ERROR_ADDRESS_RANGE;
+  for (i = 0; i < len; i++) d[i] &= s[i];
+  simFlashBusy = 2 + len / FLASH_PAGE_SIZE;
+  return FLASH_ERROR_NONE;
+}
+
+Flash_Err_Code DRV_FLASH_Erase_Sector(void *addr, int is_64KB_sect, int wait_for_finish) {
+  size_t size = is_64KB_sect ? FLASH_BLOCK_SIZE : FLASH_SECTOR_SIZE;
+  uint8_t *sect = (uint8_t *)((uintptr_t)addr & ~(uintptr_t)(size - 1));
+
+  if (!sim_in_flash(sect, size)) return FLASH_ERROR_ADDRESS_RANGE;
+  memset(sect, 0xFF, size);
+  simFlashBusy = wait_for_finish ? 0 : (is_64KB_sect ? 40 : 8);
+  return FLASH_ERROR_NONE;
+}
+
+static void *sim_map(uintptr_t start, uintptr_t end) {
+  return mmap((void *)start, end - start, PROT_READ | PROT_WRITE,
+              MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+}
+
+/* program a firmware of size bytes, the images go after it */
+static void sim_firmware(uint32_t size) {
+  memset(simFlash, 0xFF, SIM_FLASH_SIZE);
+  memcpy(simFlash + 4, &size, sizeof(size));
+  memset(simFlash + 8, 0x5A, size - 8);
+}
+
+static void sim_init(void) {
+  uintptr_t gpm = ((uintptr_t)__stop_uncompressed + FLASH_SECTOR_SIZE - 1) &
+                  ~(uintptr_t)(FLASH_SECTOR_SIZE - 1);
+  size_t region;
+
+  CHECK((uintptr_t)__start_uncompressed == SIM_GPM_START);
+  CHECK((uintptr_t)__stop_uncompressed <= (uintptr_t)__gpm_compress_start__);
+  CHECK(sim_map(gpm, SIM_GPM_END) == (void *)gpm);
+  CHECK(sim_map(SIM_RAM_START, SIM_RAM_END) == (void *)SIM_RAM_START);
+  CHECK(sim_map(SIM_FLASH_START, SIM_FLASH_START + SIM_FLASH_SIZE) == (void *)SIM_FLASH_START);
+  CHECK(sim_map(SIM_CORE_REGS, SIM_CORE_REGS + 0x10000) == (void *)SIM_CORE_REGS);
+
+  sim_firmware(SIM_MCU_IMAGE_SIZE);
+
+  for (region = 0; region < SIM_NUM_REGIONS; region++) {
+    simExpected[region] = malloc(MemRegions[region].end - MemRegions[region].start);
+    CHECK(simExpected[region] != NULL);
+  }
+}
+
+/* fill [p, p + len) with data compressing like firmware state: zeros, tables, counters, noise */
+static void sim_fill(char *p, size_t len) {
+  size_t n, i;
+  uint32_t v;
+
+  while (len > 0) {
+    n = ht_range(16, 1024);
+    if (n > len) n = len;
+    switch (ht_rand() % 8) {
+      case 0:
+      case 1:
+      case 2:
+        memset(p, 0, n);
+        break;
+      case 3:
+      case 4:
+        v = ht_rand();
+        for (i = 0; i < n; i++) p[i] = (char)(v >> (8 * (i % 4)));
+        break;
+      case 5:
+      case 6:
+        v = ht_rand() % 1000;
+        for (i = 0; i < n; i++) p[i] = (char)(v + i / 4);
+        break;
+      default:
+        n = n > 256 ? 256 : n;
+        for (i = 0; i < n; i++) p[i] = (char)ht_rand();
+        break;
+    }
+    p += n;
+    len -= n;
+  }
+}
+
+/* change a few bytes in each of a few blocks */
+static void sim_mutate(uint32_t blocks, uint32_t spots) {
+  size_t region, size;
+  char *p;
+
+  while (blocks--) {
+    region = ht_rand() % SIM_NUM_REGIONS;
+    size = MemRegions[region].end - MemRegions[region].start;
+    p = MemRegions[region].start + (ht_rand() % (size / WORKING_BLOCK_SIZE)) * WORKING_BLOCK_SIZE;
+    for (size = spots; size > 0; size--) p[ht_rand() % WORKING_BLOCK_SIZE] = (char)ht_rand();
+  }
+}
+
+static void sim_fill_all(void) {
+  size_t region;
+
+  for (region = 0; region < SIM_NUM_REGIONS; region++)
+    sim_fill(MemRegions[region].start, MemRegions[region].end - MemRegions[region].start);
+}
+
+/*
+  Free heap blocks for the next hibernation, which zeroes them. Large ones in the SRAM heap give
+  in-place compression of the GPM heap a scratch block, without them it stores the blocks it has
+  no room to compress.
+*/
+static void sim_free_blocks(int32_t withScratch) {
+  struct hibernate_free_block *blk;
+  size_t i, region, size;
+
+  simNumFree = 0;
+  if (withScratch) {
+    simFree[0].type = BLOCK_HEAP;
+    simFree[0].start = MemRegions[2].start + 0x8000;
+    simFree[0].size = 3 * WORKING_BLOCK_SIZE;
+    simNumFree = 1;
+  }
+  for (i = 0; simNumFree < SIM_MAX_FREE; i++) {
+    blk = &simFree[simNumFree];
+    region = (i % 2) ? 0 : 2;
+    size = MemRegions[region].end - MemRegions[region].start;
+    blk->type = BLOCK_HEAP;
+    blk->size = ht_range(64, WORKING_BLOCK_SIZE);  // too small to be a scratch block
+    blk->start = MemRegions[region].start + ht_rand() % (size - blk->size);
+    simNumFree++;
+  }
+}
+
+/* what the restore has to bring back: memory now, with the free blocks zeroed */
+static void sim_expect(void) {
+  size_t region, i;
+  char *start;
+
+  for (region = 0; region < SIM_NUM_REGIONS; region++) {
+    start = MemRegions[region].start;
+    memcpy(simExpected[region], start, MemRegions[region].end - start);
+    for (i = 0; i < simNumFree; i++) {
+      if ((char *)simFree[i].start >= start && (char *)simFree[i].start < MemRegions[region].end)
+        memset(simExpected[region] + ((char *)simFree[i].start - start), 0, simFree[i].size);
+    }
+  }
+}
+
+/* power is off in shutdown: GPM and RAM lose their content, the uncompressed state included */
+static void sim_shutdown(void) {
+  memset((void *)SIM_GPM_START, 0xA5, SIM_GPM_END - SIM_GPM_START);
+  memset((void *)SIM_RAM_START, 0xA5, SIM_RAM_END - SIM_RAM_START);
+}
+
+/* warm boot as Reset_Handler() and DRV_PM_EarlyBootTypeProbe() run it, 0 when memory is back */
+static int32_t sim_warm_boot(void) {
+  probe_flash_offset();
+  if (retain_flash_offset == 0) return -2;
+  if (hibernate_from_flash() != 0) return -3;
+  return hibernate_from_gpm() == 0 ? 0 : -1;
+}
+
+static int32_t sim_restored(void) {
+  size_t region;
+
+  for (region = 0; region < SIM_NUM_REGIONS; region++) {
+    if (memcmp(MemRegions[region].start, simExpected[region],
+               MemRegions[region].end - MemRegions[region].start) != 0)
+      return 0;
+  }
+  return 1;
+}
+
+/* one hibernation to flash and back, 0 if memory came back byte for byte */
+static int32_t sim_cycle(void) {
+  sim_expect();
+  if (hibernate_to_gpm(PWR_MNGR_MODE_SHUTDOWN) != 0 || hibernate_to_flash() != 0) return -1;
+  sim_shutdown();
+  if (sim_warm_boot() != 0) return -2;
+  return sim_restored() ? 0 : -3;
+}
+
+#endif
@@ -0,0 +1,19 @@
+/* Target services the checks link against. Unused sections are dropped by --gc-sections. */
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+struct _reent;
+struct _reent *_impure_ptr;
+
+void portASSERT(const char *file, int line, const char *func, const char *expr) {
+  (void)func;
+  fprintf(stderr, "%s:%d: assert: %s\n", file, line, expr);
+  abort();
+}
+
+void DbgIf_Log(uint32_t lv, const char *fmt, ...) {
+  (void)lv;
+  (void)fmt;
+}
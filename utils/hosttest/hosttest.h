@@ -0,0 +1,36 @@
+/* Helpers shared by the host checks. configASSERT() stays live and aborts through portASSERT(). */
+#ifndef HOSTTEST_H
+#define HOSTTEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define CHECK(x)                                                             \
+  do {                                                                       \
+    if (!(x)) {                                                              \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #x); \
+      exit(1);                                                               \
+    }                                                                        \
+  } while (0)
+
+/* Deterministic generator, every run replays the same sequence */
+static inline uint32_t ht_rand(void) {
+  static uint32_t seed = 0x2545F491;
+
+  seed = seed * 1103515245u + 12345u;
+  return seed >> 8;
+}
+
+static inline uint32_t ht_range(uint32_t lo, uint32_t hi) { return lo + ht_rand() % (hi - lo + 1); }
+
+/* Monotonic time for the benchmarks, in ns */
+static inline uint64_t ht_now_ns(void) {
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000000000u + t.tv_nsec;
+}
+
+#endif
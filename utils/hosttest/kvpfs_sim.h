@@ -0,0 +1,129 @@
+/*
+  Host model of the flash and services KVPFS works on, for the KVPFS checks.
+
+  - the MCU flash partition at SIM_FLASH_BASE, where __MCU_MTD_PARTITION_BASE__ points (see
+    LDFLAGS_kvpfs in the Makefile), NOR flash: an erase sets 0xFF, a program only clears bits. The
+    mapping is shared, so a forked child boots from the flash its parent left and the parent sees
+    what the child wrote;
+  - with simCutAt set, the power goes during that program or erase, counted from 0, after part of
+    it is done: the process exits with SIM_EXIT_CUT;
+  - simFlashOps counts the operations, simErases the erases of each 4 KB sector, simProgrammed the
+    bytes programmed;
+  - the mutex and heap services of one task, simAllocs counting the allocations, and a cold boot.
+*/
+#ifndef KVPFS_SIM_H
+#define KVPFS_SIM_H
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "DRV_FLASH.h"
+#include "DRV_PM.h"
+#include "alt_osal.h"
+#include "hosttest.h"
+
+#define SIM_FLASH_BASE (0x30000000UL)  // __MCU_MTD_PARTITION_BASE__
+#define SIM_FLASH_SIZE (0x10000UL)     // __MCU_MTD_PARTITION_SIZE__
+#define SIM_SECT_SIZE SFLASH_4K_ERASE_SECTOR_SIZE
+#define SIM_NUM_SECTS (SIM_FLASH_SIZE / SIM_SECT_SIZE)
+#define SIM_EXIT_CUT (3)
+
+static uint8_t *const simFlash = (uint8_t *)SIM_FLASH_BASE;
+static int32_t simCutAt = -1;
+static uint32_t simFlashOps;
+static uint32_t simErases[SIM_NUM_SECTS];
+static uint64_t simProgrammed;
+static uint32_t simAllocs;
+
+static void sim_flash_map(void) {
+  CHECK(mmap(simFlash, SIM_FLASH_SIZE, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == simFlash);
+  memset(simFlash, 0xFF, SIM_FLASH_SIZE);
+}
+
+static int32_t sim_in_flash(const void *addr, size_t len) {
+  return (uintptr_t)addr >= SIM_FLASH_BASE &&
+         (uintptr_t)addr + len <= SIM_FLASH_BASE + SIM_FLASH_SIZE;
+}
+
+/* the power goes at the cut operation, after part of it is done */
+static size_t sim_flash_op(size_t len) {
+  if ((int32_t)simFlashOps++ != simCutAt) return len;
+  return len > 1 ? ht_range(0, len - 1) : 0;
+}
+
+Flash_Err_Code DRV_FLASH_Initialize(void) { return FLASH_ERROR_NONE; }
+
+Flash_Err_Code DRV_FLASH_Read(void *src, void *dst, size_t size) {
+  if (!sim_in_flash(src, size)) return FLASH_ERROR_ADDRESS_RANGE;
+  memcpy(dst, src, size);
+  return FLASH_ERROR_NONE;
+}
+
+Flash_Err_Code DRV_FLASH_Write(void *src, void *dst, size_t len, int do_verify) {
+  const uint8_t *s = src;
+  uint8_t *d = dst;
+  size_t i, done;
+
+  (void)do_verify;
+  if (!sim_in_flash(dst, len)) return FLASH_ERROR_ADDRESS_RANGE;
+  done = sim_flash_op(len);
+  for (i = 0; i < done; i++) d[i] &= s[i];
+  simProgrammed += done;
+  if (done < len) _exit(SIM_EXIT_CUT);
+  return FLASH_ERROR_NONE;
+}
+
+Flash_Err_Code DRV_FLASH_Erase_Sector(void *addr, int is_64KB_sect, int wait_for_finish) {
+  uint8_t *sect = (uint8_t *)((uintptr_t)addr & SFLASH_4K_MASK);
+  size_t done;
+
+  (void)is_64KB_sect;
+  (void)wait_for_finish;
+  if (!sim_in_flash(sect, SIM_SECT_SIZE)) return FLASH_ERROR_ADDRESS_RANGE;
+  done = sim_flash_op(SIM_SECT_SIZE);
+  memset(sect, 0xFF, done);
+  simErases[(sect - simFlash) / SIM_SECT_SIZE]++;
+  if (done < SIM_SECT_SIZE) _exit(SIM_EXIT_CUT);
+  return FLASH_ERROR_NONE;
+}
+
+int32_t DRV_PM_GetStatistics(DRV_PM_Statistics *pwr_stat) {
+  (void)pwr_stat;
+  return -1;  // cold boot
+}
+
+int32_t alt_osal_create_mutex(alt_osal_mutex_handle *mutex, const alt_osal_mutex_attribute *attr) {
+  (void)attr;
+  *mutex = (alt_osal_mutex_handle)1;
+  return 0;
+}
+
+int32_t alt_osal_lock_mutex(alt_osal_mutex_handle *mutex, int32_t timeout_ms) {
+  (void)mutex;
+  (void)timeout_ms;
+  return 0;
+}
+
+int32_t alt_osal_unlock_mutex(alt_osal_mutex_handle *mutex) {
+  (void)mutex;
+  return 0;
+}
+
+QueueHandle_t xQueueCreateMutex(const uint8_t ucQueueType) {
+  (void)ucQueueType;
+  return NULL;  // stateful boot only
+}
+
+void *pvPortMalloc(size_t size) {
+  simAllocs++;
+  return malloc(size);
+}
+
+void vPortFree(void *p) { free(p); }
+
+#endif
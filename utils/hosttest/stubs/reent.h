@@ -0,0 +1,13 @@
+/* newlib's reent.h, reduced to what the FreeRTOS and OSAL headers use on the host. */
+#ifndef HOSTTEST_REENT_H
+#define HOSTTEST_REENT_H
+
+struct _reent {
+  int _errno;
+};
+
+#define _REENT_INIT_PTR(p)
+#define _reclaim_reent(p)
+extern struct _reent *_impure_ptr;
+
+#endif
@@ -0,0 +1,590 @@
+/*
+  Flash service: flash_svc.c with its task on a host thread, over a flash timing model.
+
+  The model keeps the flash in a file mapped where the MCU flash would be, so what the service
+  wrote is on disk at the end. It takes one command at a time and charges the time of the part:
+  PROGRAM_US per page program, ERASE_4K_MS and ERASE_64K_MS per sector erase, and it skips the
+  erase of a blank sector as DRV_FLASH.c does. A command that finds an erase running waits for it,
+  and the model counts those waits. Then:
+  - background writes that follow each other, queued while the service erases, are programmed
+    page by page together, and writes with gaps between them are not; the callbacks come in
+    submission order;
+  - an urgent write or erase, and a read, queued during a long background erase wait for the
+    sector in progress and not for the rest of it, and the background erase still completes;
+  - an urgent erase takes 64 KB sectors where the range is aligned and long enough, 4 KB sectors
+    elsewhere, a background erase always 4 KB sectors;
+  - through the service no command ever waits for the flash, reads included.
+  The benchmark runs a logger appending records and erasing its next sector, and a hibernation-like
+  task writing 1 KB blocks, first on the driver directly and then through the service. It reports
+  how long each caller is held up and how many page programs the records took.
+*/
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../middleware/flashsvc/flash_svc.c"
+#include "hosttest.h"
+
+#define FLASH_BASE (0x30000000UL)
+#define FLASH_SIZE (0x40000UL)
+#define BLOCK(n) (FLASH_BASE + (n) * FLASH_SVC_64K_SIZE)  // 0: logger, 1 and 2: checks, 3: urgent
+#define SECT_SIZE SFLASH_4K_ERASE_SECTOR_SIZE
+#define PROGRAM_US (200)
+#define ERASE_4K_MS (20)
+#define ERASE_64K_MS (100)
+
+#define NUM_MERGE (64)
+#define MERGE_LEN (32)
+#define NUM_SLOTS (64)
+#define RECORD_LEN (48)
+#define RECORD_US (500)
+#define URGENT_LEN (1024)
+#define URGENT_MS (25)
+#define WORK_MS (800)
+
+static struct timespec t0;
+static pthread_mutex_t critical = PTHREAD_MUTEX_INITIALIZER;
+
+/* OSAL on pthreads, the critical section one lock */
+struct task {
+  pthread_mutex_t mtx;
+  pthread_cond_t cond;
+  uint32_t flags;
+  void (*function)(void *arg);
+  void *arg;
+};
+
+static __thread struct task *curTask;
+
+static struct task *task_new(void (*function)(void *arg), void *arg) {
+  struct task *t = calloc(1, sizeof(*t));
+
+  pthread_mutex_init(&t->mtx, NULL);
+  pthread_cond_init(&t->cond, NULL);
+  t->function = function;
+  t->arg = arg;
+  return t;
+}
+
+uint32_t alt_osal_get_tick_count(void) {
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint32_t)((t.tv_sec - t0.tv_sec) * 1000 + (t.tv_nsec - t0.tv_nsec) / 1000000);
+}
+
+uint32_t alt_osal_enter_critical(void) {
+  pthread_mutex_lock(&critical);
+  return 0;
+}
+
+int32_t alt_osal_exit_critical(uint32_t status) {
+  (void)status;
+  pthread_mutex_unlock(&critical);
+  return 0;
+}
+
+uint32_t alt_osal_irq_context(void) { return 0; }
+
+BaseType_t xTaskGetSchedulerState(void) { return taskSCHEDULER_RUNNING; }
+
+alt_osal_task_handle alt_osal_get_current_task_handle(void) { return curTask; }
+
+int32_t alt_osal_set_taskflag(alt_osal_task_handle handle, uint32_t flags) {
+  struct task *t = handle;
+
+  pthread_mutex_lock(&t->mtx);
+  t->flags |= flags;
+  pthread_cond_signal(&t->cond);
+  pthread_mutex_unlock(&t->mtx);
+  return 0;
+}
+
+int32_t alt_osal_clear_taskflag(uint32_t flags) {
+  pthread_mutex_lock(&curTask->mtx);
+  curTask->flags &= ~flags;
+  pthread_mutex_unlock(&curTask->mtx);
+  return 0;
+}
+
+static void deadline_in(struct timespec *ts, uint32_t ms) {
+  clock_gettime(CLOCK_REALTIME, ts);
+  ts->tv_sec += ms / 1000;
+  ts->tv_nsec += (long)(ms % 1000) * 1000000;
+  if (ts->tv_nsec >= 1000000000) {
+    ts->tv_sec++;
+    ts->tv_nsec -= 1000000000;
+  }
+}
+
+int32_t alt_osal_wait_taskflag(uint32_t flags, uint32_t options, uint32_t timeout) {
+  struct task *t = curTask;
+  struct timespec ts;
+  uint32_t got;
+
+  (void)options;
+  deadline_in(&ts, timeout);
+  pthread_mutex_lock(&t->mtx);
+  while (!(t->flags & flags)) {
+    if (timeout != (uint32_t)ALT_OSAL_TIMEO_FEVR) {
+      if (pthread_cond_timedwait(&t->cond, &t->mtx, &ts) == ETIMEDOUT) break;
+    } else {
+      pthread_cond_wait(&t->cond, &t->mtx);
+    }
+  }
+  got = t->flags & flags;
+  t->flags &= ~flags;
+  pthread_mutex_unlock(&t->mtx);
+  return got ? (int32_t)got : -ETIMEDOUT;
+}
+
+int32_t alt_osal_sleep_task(int32_t timeout_ms) {
+  usleep(timeout_ms * 1000);
+  return 0;
+}
+
+int32_t alt_osal_create_mutex(alt_osal_mutex_handle *mutex, const alt_osal_mutex_attribute *attr) {
+  pthread_mutex_t *m = malloc(sizeof(*m));
+
+  (void)attr;
+  pthread_mutex_init(m, NULL);
+  *mutex = m;
+  return 0;
+}
+
+int32_t alt_osal_delete_mutex(alt_osal_mutex_handle *mutex) {
+  free(*mutex);
+  return 0;
+}
+
+int32_t alt_osal_lock_mutex(alt_osal_mutex_handle *mutex, int32_t timeout_ms) {
+  (void)timeout_ms;
+  return pthread_mutex_lock(*mutex);
+}
+
+int32_t alt_osal_unlock_mutex(alt_osal_mutex_handle *mutex) { return pthread_mutex_unlock(*mutex); }
+
+static void *task_main(void *arg) {
+  struct task *t = arg;
+
+  curTask = t;
+  t->function(t->arg);
+  return NULL;
+}
+
+static void spawn(void (*function)(void *arg), void *arg) {
+  pthread_t thread;
+
+  CHECK(pthread_create(&thread, NULL, task_main, task_new(function, arg)) == 0);
+  pthread_detach(thread);
+}
+
+int32_t alt_osal_create_task(alt_osal_task_handle *task, const alt_osal_task_attribute *attr) {
+  pthread_t thread;
+
+  // the handle is there before the task runs, as with FreeRTOS
+  *task = task_new(attr->function, attr->arg);
+  CHECK(pthread_create(&thread, NULL, task_main, *task) == 0);
+  pthread_detach(thread);
+  return 0;
+}
+
+/* the flash, one command at a time */
+static struct {
+  pthread_mutex_t mtx;
+  uint64_t busy_until;  // end of the running erase, ns
+  uint32_t programs, erases_4k, erases_64k, waits;
+} flash = {PTHREAD_MUTEX_INITIALIZER};
+
+static uint8_t *const flashMem = (uint8_t *)FLASH_BASE;
+static int flashFd;
+
+static void sleep_ns(uint64_t ns) {
+  struct timespec ts = {(time_t)(ns / 1000000000u), (long)(ns % 1000000000u)};
+
+  while (nanosleep(&ts, &ts) != 0) continue;
+}
+
+/* flash.mtx is held */
+static void flash_wait_ready(void) {
+  uint64_t now = ht_now_ns();
+
+  if (now >= flash.busy_until) return;
+  flash.waits++;
+  sleep_ns(flash.busy_until - now);
+}
+
+static int in_flash(uint32_t addr, size_t len) {
+  return addr >= FLASH_BASE && addr + len <= FLASH_BASE + FLASH_SIZE;
+}
+
+Flash_Err_Code DRV_FLASH_Write(void *src, void *dst, size_t len, int do_verify) {
+  uint32_t addr = (uint32_t)(uintptr_t)dst;
+  const uint8_t *s = src;
+  size_t size, i;
+
+  if (!in_flash(addr, len)) return FLASH_ERROR_ADDRESS_RANGE;
+  pthread_mutex_lock(&flash.mtx);
+  flash_wait_ready();
+  while (len) {
+    size = FLASH_SVC_PAGE_SIZE - addr % FLASH_SVC_PAGE_SIZE;
+    if (size > len) size = len;
+    sleep_ns(PROGRAM_US * 1000u);
+    for (i = 0; i < size; i++) flashMem[addr - FLASH_BASE + i] &= s[i];
+    if (do_verify) CHECK(memcmp(&flashMem[addr - FLASH_BASE], s, size) == 0);
+    flash.programs++;
+    addr += size;
+    s += size;
+    len -= size;
+  }
+  pthread_mutex_unlock(&flash.mtx);
+  return FLASH_ERROR_NONE;
+}
+
+Flash_Err_Code DRV_FLASH_Erase_Sector(void *addr, int is_64KB_sect, int wait_for_finish) {
+  uint32_t size = is_64KB_sect ? FLASH_SVC_64K_SIZE : SECT_SIZE;
+  uint32_t start = (uint32_t)(uintptr_t)addr & ~(size - 1);
+  uint8_t *sect = &flashMem[start - FLASH_BASE];
+  uint32_t i;
+
+  if (!in_flash(start, size)) return FLASH_ERROR_ADDRESS_RANGE;
+  pthread_mutex_lock(&flash.mtx);
+  for (i = 0; i < size && sect[i] == 0xFF; i++) continue;
+  if (i == size) {
+    pthread_mutex_unlock(&flash.mtx);
+    return FLASH_ERROR_NONE;
+  }
+  flash_wait_ready();
+  memset(sect, 0xFF, size);  // nothing reads it before the erase is over
+  flash.busy_until = ht_now_ns() + (is_64KB_sect ? ERASE_64K_MS : ERASE_4K_MS) * 1000000ull;
+  if (is_64KB_sect)
+    flash.erases_64k++;
+  else
+    flash.erases_4k++;
+  pthread_mutex_unlock(&flash.mtx);
+
+  // the caller polls the busy state, other commands wait for the erase in the driver
+  if (wait_for_finish) {
+    while (DRV_FLASH_Is_Busy()) sleep_ns(100000);
+  }
+  return FLASH_ERROR_NONE;
+}
+
+Flash_Err_Code DRV_FLASH_Read(void *src, void *dst, size_t size) {
+  if (!in_flash((uint32_t)(uintptr_t)src, size)) return FLASH_ERROR_ADDRESS_RANGE;
+  pthread_mutex_lock(&flash.mtx);
+  flash_wait_ready();
+  memcpy(dst, src, size);
+  pthread_mutex_unlock(&flash.mtx);
+  return FLASH_ERROR_NONE;
+}
+
+int DRV_FLASH_Is_Busy(void) {
+  int busy;
+
+  pthread_mutex_lock(&flash.mtx);
+  busy = ht_now_ns() < flash.busy_until;
+  pthread_mutex_unlock(&flash.mtx);
+  return busy;
+}
+
+static void flash_open(void) {
+  FILE *file = tmpfile();
+
+  CHECK(file != NULL);
+  flashFd = dup(fileno(file));
+  CHECK(flashFd >= 0 && ftruncate(flashFd, FLASH_SIZE) == 0);
+  CHECK(mmap(flashMem, FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, flashFd, 0) ==
+        flashMem);
+  fclose(file);
+  // a new file reads as zeros, so every sector starts out programmed
+}
+
+/* what earlier users left in a range */
+static void dirty(uint32_t addr, size_t len) { memset(&flashMem[addr - FLASH_BASE], 0x5A, len); }
+
+static int blank(uint32_t addr, size_t len) {
+  size_t i;
+
+  for (i = 0; i < len && flashMem[addr - FLASH_BASE + i] == 0xFF; i++) continue;
+  return i == len;
+}
+
+static void request(flash_svc_request *req, eFlashSvcOp op, eFlashSvcPrio prio, uint32_t addr,
+                    const void *src, size_t len) {
+  memset(req, 0, sizeof(*req));
+  req->op = op;
+  req->prio = prio;
+  req->addr = (void *)(uintptr_t)addr;
+  req->src = src;
+  req->len = len;
+}
+
+static uint64_t wait_ms(flash_svc_request *req) {
+  uint64_t t = ht_now_ns();
+
+  CHECK(flash_svc_wait(req, FLASH_SVC_WAIT_FOREVER) == FLASH_SVC_REQ_COMPLETE);
+  return (ht_now_ns() - t) / 1000000;
+}
+
+/* merging, behind an erase that keeps the service busy while the writes are queued */
+static flash_svc_request *doneOrder[NUM_MERGE];
+static uint32_t numDone;
+
+static void on_done(flash_svc_request *req) { doneOrder[numDone++] = req; }
+
+static void check_merging(void) {
+  static flash_svc_request reqs[NUM_MERGE], erase;
+  static uint8_t data[NUM_MERGE * MERGE_LEN];
+  uint32_t base = BLOCK(1), i, programs, merged;
+
+  for (i = 0; i < sizeof(data); i++) data[i] = (uint8_t)(i * 7 + (i >> 8));
+  dirty(base, 2 * SECT_SIZE);
+  request(&erase, FLASH_SVC_OP_ERASE, FLASH_SVC_PRIO_BACKGROUND, base, NULL, 2 * SECT_SIZE);
+  CHECK(flash_svc_submit(&erase) == 0);
+  programs = flash.programs;
+  merged = svc.counters.merged;
+
+  for (i = 0; i < NUM_MERGE; i++) {
+    request(&reqs[i], FLASH_SVC_OP_WRITE, FLASH_SVC_PRIO_BACKGROUND, base + i * MERGE_LEN,
+            &data[i * MERGE_LEN], MERGE_LEN);
+    reqs[i].callback = on_done;
+    CHECK(flash_svc_submit(&reqs[i]) == 0);
+  }
+  wait_ms(&reqs[NUM_MERGE - 1]);
+  CHECK(erase.status == FLASH_SVC_REQ_COMPLETE);
+  CHECK(memcmp(&flashMem[base - FLASH_BASE], data, sizeof(data)) == 0);
+  CHECK(flash.programs - programs == sizeof(data) / FLASH_SVC_PAGE_SIZE);
+  CHECK(svc.counters.merged - merged == NUM_MERGE - sizeof(data) / FLASH_SVC_PAGE_SIZE);
+  CHECK(numDone == NUM_MERGE);
+  for (i = 0; i < NUM_MERGE; i++) CHECK(doneOrder[i] == &reqs[i]);
+
+  // every other slot, nothing follows on
+  dirty(base + SECT_SIZE, SECT_SIZE);
+  CHECK(flash_svc_submit(&erase) == 0);
+  programs = flash.programs;
+  merged = svc.counters.merged;
+  for (i = 0; i < NUM_MERGE; i += 2) {
+    request(&reqs[i], FLASH_SVC_OP_WRITE, FLASH_SVC_PRIO_BACKGROUND,
+            base + SECT_SIZE + i * MERGE_LEN, &data[i * MERGE_LEN], MERGE_LEN);
+    CHECK(flash_svc_submit(&reqs[i]) == 0);
+  }
+  wait_ms(&reqs[NUM_MERGE - 2]);
+  CHECK(flash.programs - programs == NUM_MERGE / 2 && svc.counters.merged == merged);
+  for (i = 0; i < NUM_MERGE; i++) {
+    CHECK(memcmp(&flashMem[base + SECT_SIZE + i * MERGE_LEN - FLASH_BASE],
+                 i % 2 ? (const uint8_t *)"\xff\xff\xff\xff" : &data[i * MERGE_LEN], 4) == 0);
+  }
+}
+
+/* urgent requests and a read while a background erase runs */
+static uint64_t preemptMs[3];
+
+static void check_preemption(void) {
+  static flash_svc_request bg;
+  static uint8_t data[URGENT_LEN], back[URGENT_LEN];
+  uint32_t base = BLOCK(1) + 4 * SECT_SIZE, preemptions = svc.counters.preemptions;
+  uint64_t t;
+
+  memset(data, 0xA5, sizeof(data));
+  dirty(base, 12 * SECT_SIZE);
+  request(&bg, FLASH_SVC_OP_ERASE, FLASH_SVC_PRIO_BACKGROUND, base, NULL, 12 * SECT_SIZE);
+  CHECK(flash_svc_submit(&bg) == 0);
+  alt_osal_sleep_task(ERASE_4K_MS + ERASE_4K_MS / 2);
+
+  t = ht_now_ns();
+  CHECK(flash_svc_erase((void *)BLOCK(3), 0, 1) == FLASH_ERROR_NONE);
+  preemptMs[0] = (ht_now_ns() - t) / 1000000;
+  t = ht_now_ns();
+  CHECK(flash_svc_write(data, (void *)BLOCK(3), sizeof(data), 1) == FLASH_ERROR_NONE);
+  preemptMs[1] = (ht_now_ns() - t) / 1000000;
+  t = ht_now_ns();
+  CHECK(flash_svc_read((void *)BLOCK(3), back, sizeof(back)) == FLASH_ERROR_NONE);
+  preemptMs[2] = (ht_now_ns() - t) / 1000000;
+  CHECK(memcmp(back, data, sizeof(data)) == 0);
+  CHECK(bg.status == FLASH_SVC_REQ_QUEUED);
+
+  // each waits for one background sector at most, the erase for its own too
+  CHECK(preemptMs[0] < 2 * ERASE_4K_MS + 10);
+  CHECK(preemptMs[1] < ERASE_4K_MS + 10);
+  CHECK(preemptMs[2] < ERASE_4K_MS + 10);
+  CHECK(svc.counters.preemptions > preemptions);
+  wait_ms(&bg);
+  CHECK(blank(base, 12 * SECT_SIZE));
+}
+
+/* which sector size an erase takes */
+static void check_erase_size(eFlashSvcPrio prio, uint32_t addr, size_t len, uint32_t num_4k,
+                             uint32_t num_64k) {
+  flash_svc_request req;
+  uint32_t erases_4k = flash.erases_4k, erases_64k = flash.erases_64k;
+  uint32_t first = addr & SFLASH_4K_MASK;
+
+  dirty(first, (addr + len - first + SECT_SIZE - 1) & SFLASH_4K_MASK);
+  request(&req, FLASH_SVC_OP_ERASE, prio, addr, NULL, len);
+  CHECK(flash_svc_submit(&req) == 0);
+  wait_ms(&req);
+  CHECK(flash.erases_4k - erases_4k == num_4k && flash.erases_64k - erases_64k == num_64k);
+  CHECK(blank(first, len));
+}
+
+/* the benchmark: a logger and a hibernation-like writer, on the driver or through the service */
+struct bench {
+  uint64_t record_ns, record_max, urgent_ns, urgent_max;
+  uint32_t records, urgents, programs, waits;
+};
+
+static struct bench bench;
+static volatile int benchRunning, benchTasks;
+static int useSvc;
+
+static void logger_task(void *arg) {
+  static flash_svc_request slots[NUM_SLOTS], erase;
+  static uint8_t records[NUM_SLOTS][RECORD_LEN];
+  uint32_t n = 0, pos = 0, addr;
+  flash_svc_request *req;
+  uint64_t t;
+
+  (void)arg;
+  memset(slots, 0, sizeof(slots));
+  memset(&erase, 0, sizeof(erase));
+  while (benchRunning) {
+    addr = BLOCK(0) + pos;
+    t = ht_now_ns();
+    if (pos % SECT_SIZE == 0 || pos % SECT_SIZE + RECORD_LEN > SECT_SIZE) {
+      // the next sector goes before the first record that reaches into it
+      addr = BLOCK(0) + ((pos + RECORD_LEN - 1) & SFLASH_4K_MASK) % FLASH_SVC_64K_SIZE;
+      if (useSvc) {
+        if (erase.status == FLASH_SVC_REQ_QUEUED) flash_svc_wait(&erase, FLASH_SVC_WAIT_FOREVER);
+        request(&erase, FLASH_SVC_OP_ERASE, FLASH_SVC_PRIO_BACKGROUND, addr, NULL, SECT_SIZE);
+        CHECK(flash_svc_submit(&erase) == 0);
+      } else {
+        CHECK(flash_svc_erase((void *)(uintptr_t)addr, 0, 1) == FLASH_ERROR_NONE);
+      }
+      addr = BLOCK(0) + pos;
+    }
+    req = &slots[n % NUM_SLOTS];
+    if (useSvc && req->status == FLASH_SVC_REQ_QUEUED) {
+      flash_svc_wait(req, FLASH_SVC_WAIT_FOREVER);
+    }
+    memset(records[n % NUM_SLOTS], (uint8_t)n, RECORD_LEN);
+    if (useSvc) {
+      request(req, FLASH_SVC_OP_WRITE, FLASH_SVC_PRIO_BACKGROUND, addr, records[n % NUM_SLOTS],
+              RECORD_LEN);
+      CHECK(flash_svc_submit(req) == 0);
+    } else {
+      CHECK(flash_svc_write(records[n % NUM_SLOTS], (void *)(uintptr_t)addr, RECORD_LEN, 0) ==
+            FLASH_ERROR_NONE);
+    }
+    t = ht_now_ns() - t;
+    bench.record_ns += t;
+    if (t > bench.record_max) bench.record_max = t;
+    bench.records++;
+    n++;
+    pos = (pos + RECORD_LEN) % (FLASH_SVC_64K_SIZE - FLASH_SVC_64K_SIZE % RECORD_LEN);
+    sleep_ns(RECORD_US * 1000u);
+  }
+  if (useSvc) CHECK(flash_svc_flush(FLASH_SVC_WAIT_FOREVER) == 0);
+  __atomic_fetch_sub(&benchTasks, 1, __ATOMIC_SEQ_CST);
+}
+
+static void urgent_task(void *arg) {
+  static uint8_t data[URGENT_LEN];
+  uint32_t n = 0, addr;
+  uint64_t t;
+
+  (void)arg;
+  while (benchRunning) {
+    addr = BLOCK(3) + (n * URGENT_LEN) % FLASH_SVC_64K_SIZE;
+    memset(data, (uint8_t)(n + 1), sizeof(data));
+    t = ht_now_ns();
+    if (addr % SECT_SIZE == 0) {
+      CHECK(flash_svc_erase((void *)(uintptr_t)addr, 0, 1) == FLASH_ERROR_NONE);
+    }
+    CHECK(flash_svc_write(data, (void *)(uintptr_t)addr, sizeof(data), 1) == FLASH_ERROR_NONE);
+    t = ht_now_ns() - t;
+    bench.urgent_ns += t;
+    if (t > bench.urgent_max) bench.urgent_max = t;
+    bench.urgents++;
+    n++;
+    alt_osal_sleep_task(URGENT_MS);
+  }
+  __atomic_fetch_sub(&benchTasks, 1, __ATOMIC_SEQ_CST);
+}
+
+static struct bench run_bench(int svc_on) {
+  uint32_t programs = flash.programs, waits = flash.waits;
+
+  memset(&bench, 0, sizeof(bench));
+  dirty(BLOCK(0), FLASH_SVC_64K_SIZE);
+  dirty(BLOCK(3), FLASH_SVC_64K_SIZE);
+  useSvc = svc_on;
+  benchRunning = 1;
+  benchTasks = 2;
+  spawn(logger_task, NULL);
+  spawn(urgent_task, NULL);
+  alt_osal_sleep_task(WORK_MS);
+  benchRunning = 0;
+  while (benchTasks) alt_osal_sleep_task(1);
+  bench.programs = flash.programs - programs;
+  bench.waits = flash.waits - waits;
+  return bench;
+}
+
+static void print_bench(const char *name, const struct bench *b) {
+  printf("  %s: record %.1f us (max %.1f ms), urgent 1 KB %.1f ms (max %.1f ms), "
+         "%.2f programs per record, %u waits on the flash\n",
+         name, b->record_ns / 1e3 / b->records, b->record_max / 1e6,
+         b->urgent_ns / 1e6 / b->urgents, b->urgent_max / 1e6,
+         (double)(b->programs - b->urgents * URGENT_LEN / FLASH_SVC_PAGE_SIZE) / b->records,
+         b->waits);
+}
+
+int main(void) {
+  struct bench direct, queued;
+  uint8_t *copy;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  curTask = task_new(NULL, NULL);
+  flash_open();
+
+  // until the service runs, the calls go to the driver
+  direct = run_bench(0);
+  CHECK(direct.waits > 0);
+
+  CHECK(flash_svc_init() == 0);
+  check_merging();
+  check_preemption();
+
+  check_erase_size(FLASH_SVC_PRIO_URGENT, BLOCK(2), FLASH_SVC_64K_SIZE, 0, 1);
+  check_erase_size(FLASH_SVC_PRIO_BACKGROUND, BLOCK(2), FLASH_SVC_64K_SIZE, 16, 0);
+  check_erase_size(FLASH_SVC_PRIO_URGENT, BLOCK(2) + SECT_SIZE, FLASH_SVC_64K_SIZE, 16, 0);
+  check_erase_size(FLASH_SVC_PRIO_URGENT, BLOCK(1) + 15 * SECT_SIZE, SECT_SIZE + FLASH_SVC_64K_SIZE,
+                   1, 1);
+  check_erase_size(FLASH_SVC_PRIO_URGENT, BLOCK(2) + 100, 3 * SECT_SIZE, 4, 0);
+
+  queued = run_bench(1);
+  CHECK(flash.waits == direct.waits);  // none through the service
+  CHECK(queued.record_ns / queued.records * 10 < direct.record_ns / direct.records);
+
+  // the flash file holds what the service wrote
+  CHECK(msync(flashMem, FLASH_SIZE, MS_SYNC) == 0);
+  copy = malloc(FLASH_SIZE);
+  CHECK(copy && pread(flashFd, copy, FLASH_SIZE, 0) == (ssize_t)FLASH_SIZE);
+  CHECK(memcmp(copy, flashMem, FLASH_SIZE) == 0);
+  free(copy);
+
+  printf("flash svc: ok, %u programs (%u merged), %u erases (%u of 64 KB), %u preemptions\n",
+         svc.counters.programs, svc.counters.merged, svc.counters.erases, flash.erases_64k,
+         svc.counters.preemptions);
+  printf("  during a background erase: urgent erase %llu ms, write %llu ms, read %llu ms\n",
+         (unsigned long long)preemptMs[0], (unsigned long long)preemptMs[1],
+         (unsigned long long)preemptMs[2]);
+  print_bench("driver", &direct);
+  print_bench("service", &queued);
+  return 0;
+}
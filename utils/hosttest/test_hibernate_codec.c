@@ -0,0 +1,195 @@
+/*
+  LZ4 block codec of hibernate images, and the codecs against each other.
+
+  lz4blk_compress() is run over blocks of zeros, firmware-like state from sim_fill(), noise, short
+  periods (overlapping matches) and long runs (length bytes past 255), at the lengths around the
+  limits of the format. Then:
+  - every block decompresses to itself, and the compressed size stays within the bound of lz4blk.h;
+  - a block decompressed into one byte less than its size is refused;
+  - a block cut short, or with random bytes changed, never makes the safe decoder write past
+    maxout nor return more than it; crafted blocks with a zero or too long offset, a length running
+    off the input and a match or literals past maxout are refused;
+  - the report gives, for each codec and block size, the ratio and the compress and decompress
+    speed over a memory snapshot: sim_fill() of the hibernated regions, or the raw dumps named on
+    the command line (a RAM dump taken with the debugger, say).
+*/
+#include "pwr_mngr.h"
+
+#include "hibernate_sim.h"
+
+#define MAX_BLOCK (16 * 1024)
+#define BOUND(n) ((n) + (n) / 255 + 16)
+#define GUARD (64)
+#define NUM_CORRUPT (200)
+#define BENCH_ROUNDS (5)
+
+static uint8_t raw[MAX_BLOCK], packed[BOUND(MAX_BLOCK) + GUARD], out[MAX_BLOCK + GUARD];
+
+static void fill(int kind, size_t len) {
+  size_t i, period;
+
+  switch (kind) {
+    case 0:
+      memset(raw, 0, len);
+      break;
+    case 1:
+      sim_fill((char *)raw, len);
+      break;
+    case 2:
+      for (i = 0; i < len; i++) raw[i] = (uint8_t)ht_rand();
+      break;
+    case 3:
+      period = ht_range(1, 7);
+      for (i = 0; i < len; i++) raw[i] = (uint8_t)(i % period);
+      break;
+    default:
+      // a long literal run, then a long match of it
+      for (i = 0; i < len; i++) raw[i] = i < len / 2 ? (uint8_t)ht_rand() : raw[i - len / 2];
+      break;
+  }
+}
+
+/* decompress into maxout bytes followed by a guard, -1 if the guard was written */
+static int decode(const uint8_t *in, int length, int maxout) {
+  int r, i;
+
+  memset(out + maxout, 0xE7, GUARD);
+  r = lz4blk_decompress(in, length, out, maxout);
+  for (i = 0; i < GUARD; i++) {
+    if (out[maxout + i] != 0xE7) return -1;
+  }
+  return r;
+}
+
+static void check_round_trip(int kind, int len) {
+  int n, r, cut, k;
+
+  fill(kind, len);
+  memset(packed, 0xE7, sizeof(packed));
+  n = lz4blk_compress(raw, len, packed);
+  CHECK(n > 0 && n <= BOUND(len));
+  CHECK(packed[n] == 0xE7);
+  CHECK(decode(packed, n, len) == len && memcmp(out, raw, len) == 0);
+  if (len > 0) CHECK(decode(packed, n, len - 1) == 0);
+
+  for (cut = 0; cut < n; cut++) {
+    r = decode(packed, cut, len);
+    CHECK(r >= 0 && (r < len || r == 0));
+  }
+  for (k = 0; k < NUM_CORRUPT / 10; k++) {
+    packed[ht_rand() % n] = (uint8_t)ht_rand();
+    r = decode(packed, n, len);
+    CHECK(r >= 0 && r <= len);
+  }
+}
+
+static void check_crafted(void) {
+  static const uint8_t zeroOffset[] = {0x40, 'a', 'b', 'c', 'd', 0x00, 0x00, 0x00};
+  static const uint8_t farOffset[] = {0x40, 'a', 'b', 'c', 'd', 0x05, 0x00, 0x00};
+  static const uint8_t litRunsOff[] = {0xF0, 255, 255};
+  static const uint8_t matchRunsOff[] = {0x1F, 'a', 0x01, 0x00, 255};
+  static const uint8_t noOffset[] = {0x10, 'a', 0x01};
+  static const uint8_t longMatch[] = {0x1F, 'a', 0x01, 0x00, 200, 0x00};
+  static const uint8_t overlap[] = {0x2F, 'a', 'b', 0x02, 0x00, 10, 0x00};
+  int i;
+
+  CHECK(decode(zeroOffset, sizeof(zeroOffset), 64) == 0);
+  CHECK(decode(farOffset, sizeof(farOffset), 64) == 0);
+  CHECK(decode(litRunsOff, sizeof(litRunsOff), 1024) == 0);
+  CHECK(decode(matchRunsOff, sizeof(matchRunsOff), 1024) == 0);
+  CHECK(decode(noOffset, sizeof(noOffset), 64) == 0);
+  // 'a' and a match of 15 + 200 + 4 bytes: 220 in all, one byte short is refused
+  CHECK(decode(longMatch, sizeof(longMatch), 219) == 0);
+  CHECK(decode(longMatch, sizeof(longMatch), 220) == 220);
+  for (i = 0; i < 220; i++) CHECK(out[i] == 'a');
+  // a match at offset 2 repeats "ab"
+  CHECK(decode(overlap, sizeof(overlap), 2 + 29) == 2 + 29);
+  for (i = 0; i < 2 + 29; i++) CHECK(out[i] == "ab"[i % 2]);
+  CHECK(decode(overlap, 2, 1) == 0);
+  CHECK(decode(packed, 0, 0) == 0);
+}
+
+static uint8_t *load(const char *path, size_t *size) {
+  FILE *f = fopen(path, "rb");
+  uint8_t *p;
+  long n;
+
+  CHECK(f != NULL);
+  CHECK(fseek(f, 0, SEEK_END) == 0 && (n = ftell(f)) > 0);
+  rewind(f);
+  p = malloc(n);
+  CHECK(p != NULL && fread(p, 1, n, f) == (size_t)n);
+  fclose(f);
+  *size = n;
+  return p;
+}
+
+static void bench(const char *name, const uint8_t *snap, size_t size) {
+  static const int codecs[] = {HBN_CODEC_FASTLZ, HBN_CODEC_LZ4, HBN_CODEC_STORE};
+  static uint8_t blk[BOUND(MAX_BLOCK) * 2];
+  size_t c, off, len, bs, packedSize;
+  const struct hibernate_codec *codec;
+  uint64_t t, tc, td;
+  int n, round;
+
+  printf("  %s, %u KB:\n", name, (unsigned)(size / 1024));
+  for (c = 0; c < sizeof(codecs) / sizeof(codecs[0]); c++) {
+    codec = &Codecs[codecs[c]];
+    for (bs = 1024; bs <= MAX_BLOCK; bs *= 2) {
+      packedSize = 0;
+      tc = td = 0;
+      for (off = 0; off < size; off += len) {
+        len = size - off < bs ? size - off : bs;
+        t = ht_now_ns();
+        n = codec->compress(snap + off, (int)len, blk);
+        tc += ht_now_ns() - t;
+        CHECK(n > 0 && (size_t)n <= sizeof(blk));
+        t = ht_now_ns();
+        for (round = 0; round < BENCH_ROUNDS; round++)
+          CHECK(codec->decompress(blk, n, out, MAX_BLOCK) == (int)len);
+        td += ht_now_ns() - t;
+        CHECK(memcmp(out, snap + off, len) == 0);
+        packedSize += n;
+      }
+      printf("    %-6s %2uK blocks: %5.1f%%, compress %5.0f MB/s, decompress %5.0f MB/s\n",
+             CodecNames[codecs[c]], (unsigned)(bs / 1024), 100.0 * packedSize / size,
+             size * 1e3 / tc, size * 1e3 * BENCH_ROUNDS / td);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  static const int lengths[] = {0, 1, 4, 5, 12, 13, 14, 15, 16, 17, 18, 19, 20, 31, 255, 256,
+                                269, 270, 271, 525, 1024, 4095, 4096, 4097, MAX_BLOCK};
+  size_t i, region, len, size = 0;
+  uint8_t *snap;
+  int kind;
+
+  sim_init();
+  for (kind = 0; kind < 5; kind++) {
+    for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) check_round_trip(kind, lengths[i]);
+    for (i = 0; i < 20; i++) check_round_trip(kind, ht_range(1, MAX_BLOCK));
+  }
+  check_crafted();
+
+  printf("hibernate codec: ok, ratio and compress/decompress speed per block size\n");
+  sim_fill_all();
+  for (region = 0; region < SIM_NUM_REGIONS; region++)
+    size += MemRegions[region].end - MemRegions[region].start;
+  snap = malloc(size);
+  CHECK(snap != NULL);
+  for (size = 0, region = 0; region < SIM_NUM_REGIONS; region++) {
+    len = MemRegions[region].end - MemRegions[region].start;
+    memcpy(snap + size, MemRegions[region].start, len);
+    size += len;
+  }
+  bench("sim_fill() of the hibernated regions", snap, size);
+  free(snap);
+
+  for (i = 1; i < (size_t)argc; i++) {
+    snap = load(argv[i], &size);
+    bench(argv[i], snap, size);
+    free(snap);
+  }
+  return 0;
+}
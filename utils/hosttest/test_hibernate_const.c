@@ -0,0 +1,202 @@
+/*
+  Constant-block elision of hibernate images, on memory snapshots.
+
+  A snapshot is firmware-like state from sim_fill() with a share of the GPM and SRAM heaps free,
+  and a free task stack in .data/.bss, or a raw dump named on the command line laid over the
+  regions in their order (GPM heap, .data/.bss, SRAM heap), with no free list. Each one hibernates
+  to GPM and back with SRAM lost in between. Then:
+  - memory comes back byte for byte, free heap zeroed and the free stack filled with 0xA5;
+  - the classifier finds as many constant blocks as the image holds fill records;
+  - compressing every block instead gives a bigger image;
+  - the report gives, per snapshot, the constant blocks, the image size and the time to compress
+    and to restore the blocks with and without the classifier, as hibernate.c runs them.
+*/
+#include "pwr_mngr.h"
+
+#include "hibernate_sim.h"
+
+#define NUM_BLOCKS (0x38000 / WORKING_BLOCK_SIZE)  // of the three regions
+#define STACK_SIZE (3 * WORKING_BLOCK_SIZE)
+#define BENCH_ROUNDS (5)
+#define NUM_PERCENTS (5)
+
+struct pass {
+  uint32_t constBlocks, imageBytes;
+  uint64_t compressNs, restoreNs;
+};
+
+static char *packed;
+static size_t packedSize[NUM_BLOCKS];
+static char out[WORKING_BLOCK_SIZE];
+
+/* free about percent of the GPM and SRAM heaps in a few blocks, and a task stack */
+static void free_heap(uint32_t percent) {
+  static const size_t heaps[] = {0, 2};
+  struct hibernate_free_block *blk;
+  size_t h, size, len, i;
+
+  simNumFree = 0;
+  for (h = 0; h < 2 && percent > 0; h++) {
+    size = MemRegions[heaps[h]].end - MemRegions[heaps[h]].start;
+    len = size * percent / 100 / 2;
+    for (i = 0; i < 2; i++) {
+      blk = &simFree[simNumFree++];
+      blk->type = BLOCK_HEAP;
+      blk->size = len - ht_rand() % 256;
+      blk->start = MemRegions[heaps[h]].start + i * size / 2 + ht_rand() % (size / 2 - len);
+    }
+  }
+  blk = &simFree[simNumFree++];
+  blk->type = BLOCK_TCB;
+  blk->size = STACK_SIZE;
+  blk->start = MemRegions[1].start + ht_rand() % (MemRegions[1].end - MemRegions[1].start -
+                                                    STACK_SIZE);
+}
+
+/* the free stack comes back as ZeroFreeMem() filled it, sim_expect() zeroes it */
+static void expect_stack(void) {
+  size_t i;
+
+  for (i = 0; i < simNumFree; i++) {
+    if (simFree[i].type == BLOCK_TCB)
+      memset(simExpected[1] + ((char *)simFree[i].start - MemRegions[1].start), 0xA5,
+             simFree[i].size);
+  }
+}
+
+/* the block loop of hibernate_to_gpm() and DecompressPartial() over memory as it was compressed */
+static void blocks(int32_t classify, struct pass *p) {
+  struct hibernate_free_block *freeList;
+  struct free_range ranges[MAX_FREE_RANGES];
+  size_t region, size, numRanges, n;
+  uint64_t t;
+  char *src;
+  int round, fill;
+
+  GetFreeList(&freeList);
+  numRanges = GetFreeRanges(freeList, ranges);
+  memset(p, 0, sizeof(*p));
+
+  t = ht_now_ns();
+  for (round = 0; round < BENCH_ROUNDS; round++) {
+    for (n = 0, region = 0; region < SIM_NUM_REGIONS; region++) {
+      for (src = MemRegions[region].start; src < MemRegions[region].end; src += size, n++) {
+        size = MemRegions[region].end - src;
+        if (size > WORKING_BLOCK_SIZE) size = WORKING_BLOCK_SIZE;
+        fill = classify ? GetConstBlockFill(src, size, ranges, numRanges) : -1;
+        packedSize[n] = fill >= 0 ? CONST_BLOCK_FLAG | (size_t)fill
+                                  : CompressBlock(src, size, packed + n * MAX_COMPRESSED_BLOCK_SIZE,
+                                                  NULL);
+      }
+    }
+  }
+  p->compressNs = (ht_now_ns() - t) / BENCH_ROUNDS;
+  CHECK(n == NUM_BLOCKS);
+
+  for (n = 0; n < NUM_BLOCKS; n++) {
+    if (packedSize[n] & CONST_BLOCK_FLAG) {
+      p->constBlocks++;
+    } else {
+      p->imageBytes += packedSize[n] & BLOCK_SIZE_MASK;
+    }
+    p->imageBytes += RECORD_TRAILER_SIZE;
+  }
+
+  t = ht_now_ns();
+  for (round = 0; round < BENCH_ROUNDS; round++) {
+    for (n = 0, region = 0; region < SIM_NUM_REGIONS; region++) {
+      for (src = MemRegions[region].start; src < MemRegions[region].end; src += size, n++) {
+        size = MemRegions[region].end - src;
+        if (size > WORKING_BLOCK_SIZE) size = WORKING_BLOCK_SIZE;
+        if (packedSize[n] & CONST_BLOCK_FLAG) {
+          memset(out, packedSize[n] & CONST_BLOCK_FILL_MASK, size);
+        } else {
+          CHECK(Codecs[(packedSize[n] & BLOCK_CODEC_MASK) >> BLOCK_CODEC_SHIFT].decompress(
+                    packed + n * MAX_COMPRESSED_BLOCK_SIZE, packedSize[n] & BLOCK_SIZE_MASK, out,
+                    size) == (int)size);
+        }
+        CHECK(memcmp(out, src, size) == 0);
+      }
+    }
+  }
+  p->restoreNs = (ht_now_ns() - t) / BENCH_ROUNDS;
+}
+
+struct snapshot {
+  const char *name;
+  uint32_t constBlocks;
+  struct pass with, without;
+};
+
+static void snapshot(struct snapshot *snap) {
+  uint32_t region;
+
+  sim_expect();
+  expect_stack();
+  CHECK(hibernate_to_gpm(PWR_MNGR_MODE_STANDBY) == 0);
+  memset((void *)SIM_RAM_START, 0xA5, SIM_RAM_END - SIM_RAM_START);
+  CHECK(hibernate_from_gpm() == 0);
+  CHECK(sim_restored());
+  snap->constBlocks = 0;
+  for (region = 0; region < SIM_NUM_REGIONS; region++)
+    snap->constBlocks += Profile.regions[region].const_blocks;
+
+  blocks(1, &snap->with);
+  blocks(0, &snap->without);
+  CHECK(snap->with.constBlocks == snap->constBlocks);
+  CHECK(snap->without.constBlocks == 0 && snap->without.imageBytes > snap->with.imageBytes);
+}
+
+static void report(const struct snapshot *snap) {
+  printf("  %s: %u of %u blocks constant\n", snap->name, snap->constBlocks, NUM_BLOCKS);
+  printf("    classified: image %6u bytes, compress %6.0f us, restore %5.0f us\n",
+         snap->with.imageBytes, snap->with.compressNs / 1e3, snap->with.restoreNs / 1e3);
+  printf("    all coded:  image %6u bytes, compress %6.0f us, restore %5.0f us\n",
+         snap->without.imageBytes, snap->without.compressNs / 1e3, snap->without.restoreNs / 1e3);
+}
+
+/* lay a raw dump over the regions, what it leaves short keeps sim_fill() state */
+static void load(const char *path) {
+  FILE *f = fopen(path, "rb");
+  size_t region;
+
+  CHECK(f != NULL);
+  sim_fill_all();
+  for (region = 0; region < SIM_NUM_REGIONS; region++) {
+    if (fread(MemRegions[region].start, 1, MemRegions[region].end - MemRegions[region].start,
+              f) == 0)
+      break;
+  }
+  fclose(f);
+}
+
+int main(int argc, char **argv) {
+  static const uint32_t percents[NUM_PERCENTS] = {0, 25, 50, 75, 90};
+  static char names[NUM_PERCENTS][64];
+  struct snapshot *snaps;
+  size_t i, num = 0;
+
+  sim_init();
+  packed = malloc(NUM_BLOCKS * MAX_COMPRESSED_BLOCK_SIZE);
+  snaps = calloc(NUM_PERCENTS + argc, sizeof(*snaps));
+  CHECK(packed != NULL && snaps != NULL);
+
+  for (i = 0; i < NUM_PERCENTS; i++, num++) {
+    sim_fill_all();
+    free_heap(percents[i]);
+    snprintf(names[i], sizeof(names[i]), "sim_fill(), %u%% of the heaps free", percents[i]);
+    snaps[num].name = names[i];
+    snapshot(&snaps[num]);
+  }
+  for (i = 1; i < (size_t)argc; i++, num++) {
+    load(argv[i]);
+    simNumFree = 0;
+    snaps[num].name = argv[i];
+    snapshot(&snaps[num]);
+  }
+
+  printf("hibernate const: ok, %u snapshots, %u byte blocks, times of %u rounds averaged\n",
+         (unsigned)num, WORKING_BLOCK_SIZE, BENCH_ROUNDS);
+  for (i = 0; i < num; i++) report(&snaps[i]);
+  return 0;
+}
@@ -0,0 +1,108 @@
+/*
+  Delta hibernation: chains of full and delta images restore memory byte for byte.
+
+  Memory changes a little between most hibernations, which then write a delta against the full
+  image in flash, and is rewritten every few cycles, which falls back to a full image. Every
+  hibernation is followed by a shutdown and a warm boot from flash alone, with and without a
+  scratch block for the in-place compression of the GPM heap.
+
+  A full image written after its base was lost starts over at generation 1, at the same place as
+  the base when it has the same size. The delta the lost chain left behind names generation 1 too
+  and must not be applied to it. That is checked with the images at 64K alignment, and at 4K
+  alignment behind a firmware which leaves less than 64K of the partition.
+*/
+#include "pwr_mngr.h"
+
+#undef PWR_MNGR_EN_HIBERNATE_DELTA
+#define PWR_MNGR_EN_HIBERNATE_DELTA 1
+
+#include "hibernate_sim.h"
+
+#define NUM_CYCLES 80
+#define SIM_BIG_FIRMWARE (0x6E000UL)  // less than 64K left after it, images go at 4K alignment
+
+static void lose_base(void) {
+  CHECK(retain_flash_offset != 0);
+  CHECK(DRV_FLASH_Erase_Sector((void *)retain_flash_offset, 0, 1) == FLASH_ERROR_NONE);
+}
+
+static uint32_t base_size(void) { return ((const retain_flash_hdr *)retain_flash_offset)->size; }
+
+static void stale_delta(int32_t light) {
+  size_t region, size;
+  char *saved[SIM_NUM_REGIONS];
+  uint32_t size1;
+
+  simNumFree = 0;
+  for (region = 0; region < SIM_NUM_REGIONS; region++) {
+    size = MemRegions[region].end - MemRegions[region].start;
+    if (light) {
+      memset(MemRegions[region].start, 0, size);
+      size = 0x2000;
+    }
+    sim_fill(MemRegions[region].start, size);
+  }
+  for (region = 0; region < SIM_NUM_REGIONS; region++) {
+    size = MemRegions[region].end - MemRegions[region].start;
+    saved[region] = malloc(size);
+    CHECK(saved[region] != NULL);
+    memcpy(saved[region], MemRegions[region].start, size);
+  }
+
+  CHECK(sim_cycle() == 0);
+  CHECK(deltaImageOffset == 0 && retainGeneration == 1);
+  size1 = base_size();
+
+  sim_mutate(2, 8);
+  CHECK(sim_cycle() == 0);
+  CHECK(deltaImageOffset != 0 && retainGeneration == 1);
+
+  lose_base();
+  for (region = 0; region < SIM_NUM_REGIONS; region++) {
+    memcpy(MemRegions[region].start, saved[region],
+           MemRegions[region].end - MemRegions[region].start);
+    free(saved[region]);
+  }
+  CHECK(sim_cycle() == 0);
+  CHECK(deltaImageOffset == 0 && retainGeneration == 1);
+  CHECK(base_size() == size1);
+}
+
+int main(void) {
+  uint32_t cycle, full = 0, delta = 0;
+
+  sim_init();
+  sim_fill_all();
+
+  for (cycle = 0; cycle < NUM_CYCLES; cycle++) {
+    if (cycle % 10 == 0) {
+      sim_fill_all();
+    } else {
+      sim_mutate(ht_range(1, 3), ht_range(1, 16));
+    }
+    sim_free_blocks(cycle % 3 != 0);
+    CHECK(sim_cycle() == 0);
+
+    // the state of the hibernation came back with the GPM prefix
+    if (deltaImageOffset != 0) {
+      delta++;
+    } else {
+      full++;
+    }
+    if (cycle % 10 == 0) CHECK(deltaImageOffset == 0);
+  }
+  CHECK(delta >= NUM_CYCLES / 2);
+
+  sim_firmware(SIM_MCU_IMAGE_SIZE);
+  stale_delta(0);
+  sim_firmware(SIM_BIG_FIRMWARE);
+  stale_delta(1);
+
+  // and the chain goes on from the new base
+  sim_mutate(1, 4);
+  CHECK(sim_cycle() == 0);
+  CHECK(deltaImageOffset != 0);
+
+  printf("hibernate delta: ok, %u full and %u delta images\n", full, delta);
+  return 0;
+}
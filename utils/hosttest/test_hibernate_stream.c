@@ -0,0 +1,81 @@
+/*
+  Streamed hibernation: an image programmed while it is compressed, and decompressed straight
+  from flash, restores memory byte for byte.
+
+  The simulated flash stays busy for a while after every command, so compression has to carry on
+  while pages are programmed. Every hibernation is followed by a shutdown and a warm boot from
+  flash alone. An image cut short before its header, or with a flipped bit in its prefix or its
+  records, is refused at boot, and the next hibernation restores again.
+*/
+#include "pwr_mngr.h"
+
+#undef PWR_MNGR_EN_HIBERNATE_PIPELINE
+#define PWR_MNGR_EN_HIBERNATE_PIPELINE 1
+
+#include "hibernate_sim.h"
+
+#define NUM_CYCLES 40
+
+/* clear a set bit of the image at offset, as a failing flash cell would */
+static void flip_bit(uint32_t offset) {
+  uint8_t *p = (uint8_t *)retain_flash_offset + offset;
+
+  while (*p == 0) p++;
+  *p &= *p - 1;
+}
+
+static const retain_flash_hdr *image_hdr(void) {
+  return (const retain_flash_hdr *)retain_flash_offset;
+}
+
+int main(void) {
+  uint32_t cycle, pages;
+
+  sim_init();
+  sim_fill_all();
+
+  for (cycle = 0; cycle < NUM_CYCLES; cycle++) {
+    if (cycle % 8 == 0) {
+      sim_fill_all();
+    } else {
+      sim_mutate(ht_range(1, 6), ht_range(1, 64));
+    }
+    sim_free_blocks(cycle % 3 != 0);
+    CHECK(sim_cycle() == 0);
+    CHECK(streamFlash != NULL);
+    CHECK(image_hdr()->magic_num == RETAIN_STREAM_MAGIC);
+  }
+  // compression found the flash busy, so the two overlapped
+  CHECK(simFlashPolls > 0);
+  pages = (image_hdr()->size + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE;
+
+  // power lost between compression and the header: no image to restore
+  sim_mutate(2, 8);
+  sim_free_blocks(1);
+  sim_expect();
+  CHECK(hibernate_to_gpm(PWR_MNGR_MODE_SHUTDOWN) == 0);
+  sim_shutdown();
+  CHECK(sim_warm_boot() == -2);
+
+  // a bad prefix fails the header checksum, a bad record its own
+  sim_fill_all();
+  CHECK(sim_cycle() == 0);
+  CHECK(hibernate_to_gpm(PWR_MNGR_MODE_SHUTDOWN) == 0 && hibernate_to_flash() == 0);
+  flip_bit(sizeof(retain_flash_hdr) + image_hdr()->reserved1 / 2);
+  sim_shutdown();
+  CHECK(sim_warm_boot() == -3);
+
+  sim_fill_all();
+  CHECK(hibernate_to_gpm(PWR_MNGR_MODE_SHUTDOWN) == 0 && hibernate_to_flash() == 0);
+  flip_bit(sizeof(retain_flash_hdr) + image_hdr()->size / 2);
+  sim_shutdown();
+  CHECK(sim_warm_boot() == -3);
+
+  sim_fill_all();
+  sim_free_blocks(0);
+  CHECK(sim_cycle() == 0);
+
+  printf("hibernate stream: ok, %u cycles, last image %u pages, flash busy on %u polls\n",
+         NUM_CYCLES, pages, simFlashPolls);
+  return 0;
+}
@@ -0,0 +1,174 @@
+/*
+  KVPFS key directory: lookups in a full 8 KB mirror, through the directory and by the scan.
+
+  The store is filled through set_env()/save_env() with configuration-like keys until the mirror is
+  nearly full, with some keys overwritten and deleted on the way so the mirror has holes. Then:
+  - every stored key and a set of missing ones resolve to the same entry through the directory
+    and through the scan find_value_mirror falls back to;
+  - a directory slot pointing into the middle of an entry fails the check, the lookup still finds
+    the key by the scan and the next one rebuilds the directory;
+  - the benchmark times find_value_mirror() and get_env() both ways, one lookup in five for a key
+    that is not there, and the boot-time pattern of reading a few dozen keys once.
+*/
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "kvpfs_api.h"
+#include "kvpfs_config.h"
+#include "kvpfs_err.h"
+#include "kvpfs_sim.h"
+
+#include "../../middleware/kvpfs/src/flash_mirror.c"
+
+#define MAX_KEYS (KEYDIR_MAX_LOAD)
+#define NUM_MISSING (64)
+#define NUM_LOOKUPS (200000)
+#define NUM_BOOT_KEYS (40)
+#define FILL_LIMIT (ENV_SIZE - 256)  // room left for the CRC and the defaults
+
+static const char *const areas[] = {"lte", "net", "sock", "mqtt", "gps", "pwr", "app", "fota"};
+static char keys[MAX_KEYS][24];
+static char missing[NUM_MISSING][24];
+static uint32_t numKeys;
+
+static void use_scan(int32_t scan) {
+  keydir_full = scan;  // find_value_mirror neither trusts nor rebuilds a full directory
+  keydir_valid = 0;
+}
+
+static void fill(void) {
+  char value[KVPFS_LOG_INLINE_MAX + 1];
+  uint32_t i, len;
+
+  while (numKeys < MAX_KEYS - 8 && flm_info.used_byte < FILL_LIMIT) {
+    for (i = 0; i < 16 && numKeys < MAX_KEYS - 8; i++) {
+      snprintf(keys[numKeys], sizeof(keys[0]), "%s.%s%u", areas[ht_rand() % 8],
+               ht_rand() % 2 ? "param" : "cfg", numKeys);
+      len = ht_range(12, 40);
+      memset(value, 'a' + numKeys % 26, len);
+      value[len] = '\0';
+      CHECK(set_env(keys[numKeys], value) == KVPFS_OK);
+      numKeys++;
+    }
+    // overwrite and drop a few older ones, leaving holes
+    for (i = 0; i < 3; i++) CHECK(set_env(keys[ht_rand() % numKeys], "updated") == KVPFS_OK);
+    i = ht_rand() % numKeys;
+    CHECK(set_env(keys[i], NULL) == KVPFS_OK);
+    memcpy(keys[i], keys[--numKeys], sizeof(keys[0]));
+    CHECK(save_env() == KVPFS_OK);
+  }
+  for (i = 0; i < NUM_MISSING; i++) {
+    snprintf(missing[i], sizeof(missing[0]), "%s.none%u", areas[i % 8], i);
+  }
+}
+
+static const char *pick(uint32_t n) {
+  return n % 5 == 4 ? missing[n % NUM_MISSING] : keys[(n * 2654435761u >> 7) % numKeys];
+}
+
+static uint64_t time_find(int32_t scan) {
+  const char *value;
+  uint64_t t;
+  uint32_t n, found = 0;
+
+  use_scan(scan);
+  t = ht_now_ns();
+  for (n = 0; n < NUM_LOOKUPS; n++) found += find_value_mirror(pick(n), &value) != NULL;
+  t = ht_now_ns() - t;
+  CHECK(found == NUM_LOOKUPS - NUM_LOOKUPS / 5);
+  return t / NUM_LOOKUPS;
+}
+
+static uint64_t time_get_env(int32_t scan) {
+  char *value;
+  uint64_t t;
+  uint32_t n;
+  int32_t ret;
+
+  use_scan(scan);
+  t = ht_now_ns();
+  for (n = 0; n < NUM_LOOKUPS; n++) {
+    ret = get_env(pick(n), &value);
+    CHECK(ret == (n % 5 == 4 ? -KVPFS_KEY_NOT_FOUND : KVPFS_OK));
+    if (ret == KVPFS_OK) vPortFree(value);
+  }
+  t = ht_now_ns() - t;
+  return t / NUM_LOOKUPS;
+}
+
+/* a connector reading its configuration once at boot, the directory built by the first read */
+static uint64_t time_boot(int32_t scan) {
+  char *value;
+  uint64_t t;
+  uint32_t n;
+
+  use_scan(scan);
+  t = ht_now_ns();
+  for (n = 0; n < NUM_BOOT_KEYS; n++) {
+    CHECK(get_env(keys[n * numKeys / NUM_BOOT_KEYS], &value) == KVPFS_OK);
+    vPortFree(value);
+  }
+  return ht_now_ns() - t;
+}
+
+int main(void) {
+  const char *value, *scan_value;
+  char *pos, *scan_pos;
+  uint64_t find_dir, find_scan, get_dir, get_scan, boot_dir, boot_scan;
+  uint32_t i, idx, key_len;
+  int out, null;
+
+  sim_flash_map();
+  out = dup(1);
+  CHECK(out >= 0 && (null = open("/dev/null", O_WRONLY)) >= 0);
+  dup2(null, 1);  // the store reports its banks
+  kvpfs_init();
+  fill();
+  fflush(stdout);
+  dup2(out, 1);
+
+  use_scan(0);
+  CHECK(find_value_mirror(keys[0], &value) != NULL);
+  CHECK(keydir_valid && !keydir_full && keydir_entries == flm_info.num_of_data);
+
+  // the directory and the scan agree
+  for (i = 0; i < numKeys + NUM_MISSING; i++) {
+    const char *key = i < numKeys ? keys[i] : missing[i - numKeys];
+
+    use_scan(0);
+    pos = find_value_mirror(key, &value);
+    use_scan(1);
+    scan_pos = find_value_mirror(key, &scan_value);
+    CHECK(pos == scan_pos && (i < numKeys) == (pos != NULL));
+    CHECK(pos == NULL || value == scan_value);
+  }
+
+  // a slot that points into the middle of an entry
+  use_scan(0);
+  CHECK((pos = find_value_mirror(keys[1], &value)) != NULL);
+  idx = keydir_hash(keys[1], &key_len) & (KEYDIR_SLOTS - 1);
+  while (keydir[idx].pos != pos - flash_mirror + 1) idx = (idx + 1) & (KEYDIR_SLOTS - 1);
+  keydir[idx].pos += 2;
+  CHECK(find_value_mirror(keys[1], &value) == pos && !keydir_valid);
+  CHECK(find_value_mirror(keys[1], &value) == pos && keydir_valid);
+  CHECK(keydir_entries == flm_info.num_of_data);
+
+  find_dir = time_find(0);
+  find_scan = time_find(1);
+  get_dir = time_get_env(0);
+  get_scan = time_get_env(1);
+  boot_dir = time_boot(0);
+  boot_scan = time_boot(1);
+  CHECK(find_dir * 2 < find_scan);
+
+  printf("kvdir: ok, %u keys in %u of %u bytes\n", numKeys, flm_info.used_byte, ENV_SIZE);
+  printf("  find_value_mirror: %llu ns directory, %llu ns scan\n", (unsigned long long)find_dir,
+         (unsigned long long)find_scan);
+  printf("  get_env: %llu ns directory, %llu ns scan\n", (unsigned long long)get_dir,
+         (unsigned long long)get_scan);
+  printf("  %u keys at boot: %llu us directory, %llu us scan\n", NUM_BOOT_KEYS,
+         (unsigned long long)boot_dir / 1000, (unsigned long long)boot_scan / 1000);
+  return 0;
+}
@@ -0,0 +1,240 @@
+/*
+  KVPFS log store: crash consistency and recovery.
+
+  The store runs over the NOR flash of kvpfs_sim.h. A deterministic workload of
+  set_env()/save_env() steps and kvpfs_txn_*() transactions, with values both inline and spilled
+  to flash, runs long enough to wrap the sector ring several times. Then every step is replayed
+  from the flash image before it, with the power cut at each of its program and erase operations
+  in turn, the cut operation left half done. Each run is a forked child, so a boot starts from
+  nothing but the flash. After a cut:
+  - the store mounts and holds exactly the state before the step or after it, never a mix;
+  - a second cut during the recovery mount changes nothing;
+  - the recovered store takes the step again and ends in the state after it.
+A value that reads like a flash reference of a spilled value is refused, so it can't be mistaken
+for one.
+*/
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "kvpfs_api.h"
+#include "kvpfs_config.h"
+#include "kvpfs_err.h"
+#include "kvpfs_sim.h"
+
+#define NUM_KEYS (24)
+#define NUM_STEPS (120)
+#define MAX_OPS (8)
+#define MAX_VALUE (300)
+
+#define EXIT_DONE (0)
+#define EXIT_FAIL (4)
+
+static uint8_t *images;  // flash before each step, shared with the children
+static uint8_t cut_image[SIM_FLASH_SIZE];
+
+struct step {
+  uint32_t num;
+  uint8_t txn;
+  struct {
+    char key[8];
+    char value[MAX_VALUE + 1];
+    uint8_t del;
+  } op[MAX_OPS];
+};
+
+static struct step steps[NUM_STEPS];
+static char *model[NUM_STEPS + 1][NUM_KEYS];  // state after each step, NULL for no key
+
+/* workload */
+static void gen_value(char *value, uint32_t s, uint32_t i) {
+  uint32_t len, n;
+
+  // mostly short values, one in four is spilled to flash
+  len = (ht_rand() % 4 == 0) ? ht_range(KVPFS_LOG_INLINE_MAX + 1, MAX_VALUE)
+                             : ht_range(8, KVPFS_LOG_INLINE_MAX);
+  for (n = snprintf(value, MAX_VALUE + 1, "%u.%u.", s, i); n < len; n++)
+    value[n] = 'a' + (s * 7 + i * 3 + n) % 26;
+  value[n] = '\0';
+}
+
+static void gen_steps(void) {
+  struct step *st;
+  uint32_t s, i, k;
+
+  for (s = 0; s < NUM_STEPS; s++) {
+    st = &steps[s];
+    st->txn = (ht_rand() % 3 == 0);
+    st->num = st->txn ? ht_range(2, MAX_OPS) : ht_range(1, 3);
+    memcpy(model[s + 1], model[s], sizeof(model[s]));
+    for (i = 0; i < st->num; i++) {
+      k = ht_rand() % NUM_KEYS;
+      snprintf(st->op[i].key, sizeof(st->op[i].key), "k%02u", k);
+      st->op[i].del = (model[s + 1][k] != NULL && ht_rand() % 5 == 0);
+      if (st->op[i].del) {
+        model[s + 1][k] = NULL;
+      } else {
+        gen_value(st->op[i].value, s, i);
+        model[s + 1][k] = st->op[i].value;
+      }
+    }
+  }
+}
+
+static void apply_step(uint32_t s) {
+  const struct step *st = &steps[s];
+  kvpfs_txn_t *txn;
+  uint32_t i;
+
+  if (!st->txn) {
+    for (i = 0; i < st->num; i++) set_env(st->op[i].key, st->op[i].del ? NULL : st->op[i].value);
+    CHECK(save_env() == KVPFS_OK);
+    return;
+  }
+  CHECK(kvpfs_txn_begin(&txn) == KVPFS_OK);
+  for (i = 0; i < st->num; i++)
+    CHECK(kvpfs_txn_set(txn, st->op[i].key, st->op[i].del ? NULL : st->op[i].value) == KVPFS_OK);
+  CHECK(kvpfs_txn_commit(txn) == KVPFS_OK);
+}
+
+static int32_t matches(uint32_t s) {
+  char key[8], *value;
+  uint32_t k;
+  int32_t ret, same = 1;
+
+  for (k = 0; k < NUM_KEYS && same; k++) {
+    snprintf(key, sizeof(key), "k%02u", k);
+    ret = get_env(key, &value);
+    if (model[s][k] == NULL) {
+      same = (ret == -KVPFS_KEY_NOT_FOUND);
+    } else {
+      same = (ret == KVPFS_OK && strcmp(value, model[s][k]) == 0);
+    }
+    if (ret == KVPFS_OK) vPortFree(value);
+  }
+  return same;
+}
+
+/*
+  Boot from the flash in a child and run fn there, the cut counts the flash operations of the boot
+  too. Returns the exit code of the child.
+*/
+static int32_t run(int32_t cut, int32_t (*fn)(uint32_t), uint32_t arg) {
+  pid_t pid;
+  int status;
+
+  fflush(stdout);
+  ht_rand();  // every child tears its cut operation differently
+  pid = fork();
+  CHECK(pid >= 0);
+  if (pid == 0) {
+    CHECK(freopen("/dev/null", "w", stdout) != NULL);  // the store reports its banks
+    simCutAt = cut;
+    kvpfs_init();
+    _exit(fn(arg));
+  }
+  CHECK(waitpid(pid, &status, 0) == pid);
+  CHECK(WIFEXITED(status));
+  return WEXITSTATUS(status);
+}
+
+static int32_t do_step(uint32_t s) {
+  apply_step(s);
+  return EXIT_DONE;
+}
+
+/* exit code: 1 in the state after step s, 0 before it */
+static int32_t do_check(uint32_t s) {
+  if (matches(s + 1)) return 1;
+  if (matches(s)) return 0;
+  return EXIT_FAIL;
+}
+
+static int32_t do_nothing(uint32_t s) {
+  (void)s;
+  return EXIT_DONE;
+}
+
+/* count the flash operations of a boot */
+static int32_t do_count(uint32_t s) {
+  (void)s;
+  return simFlashOps > 250 ? 250 : simFlashOps;
+}
+
+/* "\x1b", address, length: a spilled value at the start of the flash */
+static int32_t do_ref_value(uint32_t s) {
+  static const char ref[] = "\x1b" "30000000" "0010";
+  kvpfs_txn_t *txn;
+  char *value;
+
+  CHECK(set_env("ref", ref) == -KVPFS_RESERVE_VALUE);
+  CHECK(kvpfs_txn_begin(&txn) == KVPFS_OK);
+  CHECK(kvpfs_txn_set(txn, "ref", ref) == -KVPFS_RESERVE_VALUE);
+  kvpfs_txn_abort(txn);
+  CHECK(get_env("ref", &value) == -KVPFS_KEY_NOT_FOUND);
+
+  // the mark anywhere else is a plain char
+  CHECK(set_env("ref", ref + 1) == KVPFS_OK && set_env("ref2", "a\x1b") == KVPFS_OK);
+  CHECK(save_env() == KVPFS_OK);
+  CHECK(get_env("ref", &value) == KVPFS_OK && strcmp(value, ref + 1) == 0);
+  vPortFree(value);
+  CHECK(matches(s));
+  return EXIT_DONE;
+}
+
+int main(void) {
+  uint32_t s, cuts = 0, recoveries = 0;
+  int32_t n, m, ret, state, boot_ops;
+  uint8_t *image;
+
+  sim_flash_map();
+  images = mmap(NULL, NUM_STEPS * SIM_FLASH_SIZE, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  CHECK(images != MAP_FAILED);
+  gen_steps();
+
+  // the uncut run, which also records the flash before every step
+  for (s = 0; s < NUM_STEPS; s++) {
+    memcpy(images + s * SIM_FLASH_SIZE, simFlash, SIM_FLASH_SIZE);
+    CHECK(run(-1, do_step, s) == EXIT_DONE);
+    CHECK(run(-1, do_check, s) == 1);
+  }
+
+  for (s = 0; s < NUM_STEPS; s++) {
+    image = images + s * SIM_FLASH_SIZE;
+    for (n = 0;; n++) {
+      memcpy(simFlash, image, SIM_FLASH_SIZE);
+      ret = run(n, do_step, s);
+      if (ret == EXIT_DONE) break;  // n is past the last operation of the step
+      CHECK(ret == SIM_EXIT_CUT);
+      cuts++;
+
+      memcpy(cut_image, simFlash, SIM_FLASH_SIZE);
+      state = run(-1, do_check, s);
+      CHECK(state == 0 || state == 1);
+      CHECK(run(-1, do_check, s) == state);
+
+      // cut the recovery mount too, when it has to write
+      memcpy(simFlash, cut_image, SIM_FLASH_SIZE);
+      boot_ops = run(-1, do_count, s);
+      for (m = 0; m < boot_ops; m++) {
+        memcpy(simFlash, cut_image, SIM_FLASH_SIZE);
+        CHECK(run(m, do_nothing, s) == SIM_EXIT_CUT);
+        CHECK(run(-1, do_check, s) == state);
+        recoveries++;
+      }
+
+      CHECK(run(-1, do_step, s) == EXIT_DONE);
+      CHECK(run(-1, do_check, s) == 1);
+    }
+  }
+
+  memcpy(simFlash, images + (NUM_STEPS - 1) * SIM_FLASH_SIZE, SIM_FLASH_SIZE);
+  CHECK(run(-1, do_step, NUM_STEPS - 1) == EXIT_DONE);
+  CHECK(run(-1, do_ref_value, NUM_STEPS) == EXIT_DONE);
+
+  printf("kvlog: ok, %u steps, %u cuts, %u cuts during recovery\n", NUM_STEPS, cuts, recoveries);
+  return 0;
+}
@@ -0,0 +1,268 @@
+/*
+  KVPFS typed accessors: set_env_u32/i64/blob() and the getters that read into caller memory.
+
+  A forked child stores integers at their limits and blobs of every length around the read chunk
+  and the inline limit, made of the bytes the encoding escapes (0x00, 0xFF and the escape 0x10
+  itself) and of other bytes, then saves. It checks on the way:
+  - a value reads back while it is only staged, before the save;
+  - a blob of 0xFFFF bytes stages and reads back, a longer one is refused, a save that has no room
+    for it fails and the store saves once it is dropped;
+  - a buffer one byte short fails with -KVPFS_BUFFER_TOO_SMALL, gives the length and is left as it
+    was, and a value of another type fails with -KVPFS_TYPE_MISMATCH.
+  The parent then boots from the flash and reads every value back, inline and spilled ones alike.
+  The benchmark times the hot configuration reads of a connector, decimal text through get_env()
+  and strtoul() against get_env_u32() and get_env_batch(), with the allocations of each.
+*/
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "kvpfs_api.h"
+#include "kvpfs_config.h"
+#include "kvpfs_err.h"
+#include "kvpfs_sim.h"
+
+#define NUM_PATTERNS (5)
+#define MAX_BLOB (200)
+#define BIG_BLOB (0xFFFF)
+#define NUM_CFG (8)
+#define NUM_READS (100000)
+#define GUARD (0x5A)
+
+static const uint32_t u32s[] = {0, 1, 0x10, 0xFF, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF};
+static const int64_t i64s[] = {0, -1, 1, INT64_MIN, INT64_MAX, -0x10, 0xFF00FF00FF};
+static const uint32_t lens[] = {0, 1, 2, 16, 31, 32, 33, KVPFS_LOG_INLINE_MAX, MAX_BLOB};
+
+#define NUM_LENS (sizeof(lens) / sizeof(lens[0]))
+
+static uint8_t big[BIG_BLOB + 1], got[BIG_BLOB + 1];
+
+/* the bytes the encoding escapes, alone and mixed with the digits an escape is followed by */
+static void blob(uint8_t *data, uint32_t pattern, uint32_t len) {
+  static const uint8_t mixed[] = {0x10, '0', 0x00, 0xFF, '1', 0x10, 0x10, '2', 0xFE, 0x01};
+  uint32_t i;
+
+  for (i = 0; i < len; i++) {
+    switch (pattern) {
+      case 0: data[i] = 0x00; break;
+      case 1: data[i] = 0xFF; break;
+      case 2: data[i] = 0x10; break;
+      case 3: data[i] = mixed[i % sizeof(mixed)]; break;
+      default: data[i] = (uint8_t)(i * 131 + len); break;
+    }
+  }
+}
+
+static void check_blob(const char *key, uint32_t pattern, uint32_t len) {
+  uint8_t data[MAX_BLOB], buf[MAX_BLOB + 1];
+  uint32_t n = 0xDEAD;
+
+  blob(data, pattern, len);
+  memset(buf, GUARD, sizeof(buf));
+  CHECK(get_env_blob(key, buf, len, &n) == KVPFS_OK && n == len);
+  CHECK(memcmp(buf, data, len) == 0 && buf[len] == GUARD);
+  if (len == 0) return;
+
+  memset(buf, GUARD, sizeof(buf));
+  n = 0;
+  CHECK(get_env_blob(key, buf, len - 1, &n) == -KVPFS_BUFFER_TOO_SMALL && n == len);
+  CHECK(buf[0] == GUARD && buf[len - 1] == GUARD);
+}
+
+static void check_all(void) {
+  char key[16];
+  uint32_t i, p, u;
+  int64_t v;
+
+  for (i = 0; i < sizeof(u32s) / sizeof(u32s[0]); i++) {
+    snprintf(key, sizeof(key), "u%u", i);
+    CHECK(get_env_u32(key, &u) == KVPFS_OK && u == u32s[i]);
+    CHECK(get_env_i64(key, &v) == -KVPFS_TYPE_MISMATCH);
+  }
+  for (i = 0; i < sizeof(i64s) / sizeof(i64s[0]); i++) {
+    snprintf(key, sizeof(key), "i%u", i);
+    CHECK(get_env_i64(key, &v) == KVPFS_OK && v == i64s[i]);
+    CHECK(get_env_u32(key, &u) == -KVPFS_TYPE_MISMATCH);
+  }
+  for (p = 0; p < NUM_PATTERNS; p++) {
+    for (i = 0; i < NUM_LENS; i++) {
+      snprintf(key, sizeof(key), "b%u.%u", p, lens[i]);
+      check_blob(key, p, lens[i]);
+    }
+  }
+  // decimal text from set_env() reads as an integer, a blob does not
+  CHECK(get_env_u32("dec", &u) == KVPFS_OK && u == 4000000000u);
+  CHECK(get_env_i64("neg", &v) == KVPFS_OK && v == -42);
+  CHECK(get_env_u32("b0.1", &u) == -KVPFS_TYPE_MISMATCH);
+  CHECK(get_env_blob("u1", got, sizeof(got), &u) == -KVPFS_TYPE_MISMATCH);
+}
+
+static void check_big(void) {
+  uint32_t i, n = 0;
+
+  for (i = 0; i < BIG_BLOB; i++) big[i] = "\x00\xff\x10\x30"[ht_rand() % 4];
+  CHECK(set_env_blob("big", big, BIG_BLOB + 1) == -KVPFS_VALUE_TOO_LARGE);
+  CHECK(set_env_blob("big", big, BIG_BLOB) == KVPFS_OK);
+  memset(got, GUARD, sizeof(got));
+  CHECK(get_env_blob("big", got, BIG_BLOB, &n) == KVPFS_OK && n == BIG_BLOB);
+  CHECK(memcmp(got, big, BIG_BLOB) == 0 && got[BIG_BLOB] == GUARD);
+  n = 0;
+  CHECK(get_env_blob("big", got, BIG_BLOB - 1, &n) == -KVPFS_BUFFER_TOO_SMALL && n == BIG_BLOB);
+
+  // far larger than the mirror, it stays staged until dropped
+  CHECK(save_env() == -KVPFS_FLASH_SPACE_NOT_ENOUGH);
+  CHECK(get_env_blob("big", got, BIG_BLOB, &n) == KVPFS_OK && n == BIG_BLOB);
+  CHECK(set_env("big", NULL) == KVPFS_OK);
+  CHECK(save_env() == KVPFS_OK);
+  CHECK(get_env_blob("big", got, BIG_BLOB, &n) == -KVPFS_KEY_NOT_FOUND);
+}
+
+static int32_t store(void) {
+  uint8_t data[MAX_BLOB];
+  char key[16];
+  uint32_t i, p;
+
+  kvpfs_init();
+  check_big();
+  for (i = 0; i < sizeof(u32s) / sizeof(u32s[0]); i++) {
+    snprintf(key, sizeof(key), "u%u", i);
+    CHECK(set_env_u32(key, u32s[i]) == KVPFS_OK);
+  }
+  for (i = 0; i < sizeof(i64s) / sizeof(i64s[0]); i++) {
+    snprintf(key, sizeof(key), "i%u", i);
+    CHECK(set_env_i64(key, i64s[i]) == KVPFS_OK);
+  }
+  for (p = 0; p < NUM_PATTERNS; p++) {
+    for (i = 0; i < NUM_LENS; i++) {
+      snprintf(key, sizeof(key), "b%u.%u", p, lens[i]);
+      blob(data, p, lens[i]);
+      CHECK(set_env_blob(key, data, lens[i]) == KVPFS_OK);
+    }
+  }
+  CHECK(set_env("dec", "4000000000") == KVPFS_OK && set_env("neg", "-42") == KVPFS_OK);
+  for (i = 0; i < NUM_CFG; i++) {
+    snprintf(key, sizeof(key), "cfg.text%u", i);
+    snprintf((char *)data, sizeof(data), "%u", 1000 * (i + 1));
+    CHECK(set_env(key, (char *)data) == KVPFS_OK);
+    snprintf(key, sizeof(key), "cfg.u32_%u", i);
+    CHECK(set_env_u32(key, 1000 * (i + 1)) == KVPFS_OK);
+  }
+
+  check_all();  // staged
+  CHECK(save_env() == KVPFS_OK);
+  check_all();
+  return 0;
+}
+
+struct bench {
+  uint64_t ns;
+  uint32_t allocs;
+};
+
+static struct bench time_text(void) {
+  struct bench b;
+  char key[16], *value;
+  uint32_t n, sum = 0;
+
+  simAllocs = 0;
+  b.ns = ht_now_ns();
+  for (n = 0; n < NUM_READS; n++) {
+    snprintf(key, sizeof(key), "cfg.text%u", n % NUM_CFG);
+    CHECK(get_env(key, &value) == KVPFS_OK);
+    sum += strtoul(value, NULL, 10);
+    vPortFree(value);
+  }
+  b.ns = (ht_now_ns() - b.ns) / NUM_READS;
+  b.allocs = simAllocs;
+  CHECK(sum == NUM_READS / NUM_CFG * 36000);
+  return b;
+}
+
+static struct bench time_u32(void) {
+  struct bench b;
+  char key[16];
+  uint32_t n, value, sum = 0;
+
+  simAllocs = 0;
+  b.ns = ht_now_ns();
+  for (n = 0; n < NUM_READS; n++) {
+    snprintf(key, sizeof(key), "cfg.u32_%u", n % NUM_CFG);
+    CHECK(get_env_u32(key, &value) == KVPFS_OK);
+    sum += value;
+  }
+  b.ns = (ht_now_ns() - b.ns) / NUM_READS;
+  b.allocs = simAllocs;
+  CHECK(sum == NUM_READS / NUM_CFG * 36000);
+  return b;
+}
+
+static struct bench time_batch(void) {
+  static char keys[NUM_CFG][16];
+  kvpfs_get_item_t items[NUM_CFG];
+  uint32_t values[NUM_CFG];
+  struct bench b;
+  uint32_t n, i, sum = 0;
+
+  for (i = 0; i < NUM_CFG; i++) {
+    snprintf(keys[i], sizeof(keys[0]), "cfg.u32_%u", i);
+    items[i] = (kvpfs_get_item_t){keys[i], KVPFS_TYPE_U32, &values[i], sizeof(values[i]), 0, 0};
+  }
+  simAllocs = 0;
+  b.ns = ht_now_ns();
+  for (n = 0; n < NUM_READS; n += NUM_CFG) {
+    CHECK(get_env_batch(items, NUM_CFG) == NUM_CFG);
+    for (i = 0; i < NUM_CFG; i++) sum += values[i];
+  }
+  b.ns = (ht_now_ns() - b.ns) / NUM_READS;
+  b.allocs = simAllocs;
+  CHECK(sum == NUM_READS / NUM_CFG * 36000);
+  return b;
+}
+
+int main(void) {
+  kvpfs_get_item_t item;
+  struct bench text, u32, batch;
+  uint32_t value;
+  int out, null;
+  pid_t pid;
+  int wstatus;
+
+  sim_flash_map();
+  out = dup(1);
+  CHECK(out >= 0 && (null = open("/dev/null", O_WRONLY)) >= 0);
+  dup2(null, 1);  // the store reports its banks
+
+  fflush(stdout);
+  pid = fork();
+  CHECK(pid >= 0);
+  if (pid == 0) _exit(store());
+  CHECK(waitpid(pid, &wstatus, 0) == pid);
+  CHECK(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+
+  kvpfs_init();
+  fflush(stdout);
+  dup2(out, 1);
+  check_all();
+
+  // the getters that take a size
+  item = (kvpfs_get_item_t){"u6", KVPFS_TYPE_U32, &value, sizeof(uint16_t), 0, 0};
+  CHECK(get_env_batch(&item, 1) == 0 && item.status == -KVPFS_BUFFER_TOO_SMALL);
+  CHECK(get_env_buf("dec", (char *)got, 10) == -KVPFS_BUFFER_TOO_SMALL);
+  CHECK(get_env_buf("dec", (char *)got, 11) == KVPFS_OK && strcmp((char *)got, "4000000000") == 0);
+
+  text = time_text();
+  u32 = time_u32();
+  batch = time_batch();
+  CHECK(u32.allocs == 0 && batch.allocs == 0 && text.allocs == NUM_READS);
+
+  printf("kvtyped: ok, %u integers and %u blobs round trip, staged and from flash\n",
+         (uint32_t)(sizeof(u32s) / sizeof(u32s[0]) + sizeof(i64s) / sizeof(i64s[0])),
+         (uint32_t)(NUM_PATTERNS * NUM_LENS));
+  printf("  %u configuration reads, per read: get_env() and strtoul() %llu ns, %.1f allocations\n",
+         NUM_READS, (unsigned long long)text.ns, (double)text.allocs / NUM_READS);
+  printf("  get_env_u32() %llu ns, get_env_batch() of %u keys %llu ns, no allocations\n",
+         (unsigned long long)u32.ns, NUM_CFG, (unsigned long long)batch.ns);
+  return 0;
+}
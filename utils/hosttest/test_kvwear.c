@@ -0,0 +1,142 @@
+/*
+  KVPFS log store endurance: how evenly the sector ring wears under a long save workload.
+
+  The store holds cold keys, written once at the first boot, and a few hot counters that most
+  saves update, as a connector keeping state across power cycles does. Boots are forked children
+  over the flash of kvpfs_sim.h, each one mounting the log, checking that the counters read back as
+  last saved and running a run of saves. Then:
+  - the erase count each sector header carries never runs ahead of the erases the flash saw, and
+    falls no further behind than the erases of the legacy banks before the log took over;
+  - the ring wears evenly: the erase counts of the most and the least worn sector stay within
+    WEAR_SPREAD of each other, although the cold records never change;
+  - the report gives the erase counts of the ring, the spread and the write amplification.
+*/
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "kvpfs_api.h"
+#include "kvpfs_config.h"
+#include "kvpfs_err.h"
+#include "kvpfs_sim.h"
+
+#include "../../middleware/kvpfs/src/kvpfs_log.c"
+
+#define NUM_BOOTS (20)
+#define SAVES_PER_BOOT (1000)
+#define NUM_COLD (32)
+#define NUM_HOT (4)
+#define WEAR_SPREAD (2)
+#define RING_FIRST ((KVPFS_LOG_BASE_ADDR - SIM_FLASH_BASE) / SIM_SECT_SIZE)
+
+/* what the boots leave for the next one and for the report, shared with the children */
+struct wear {
+  uint32_t hot[NUM_HOT];
+  uint32_t erases[SIM_NUM_SECTS];        // seen by the flash
+  uint32_t erase_cnt[KVLOG_NSECT];       // kept by the log, as the last boot had it
+  uint32_t first_erases[SIM_NUM_SECTS];  // both after the first boot
+  uint32_t first_erase_cnt[KVLOG_NSECT];
+  uint32_t saves, gc;
+  uint64_t programmed, user_bytes;
+};
+
+static struct wear *wear;
+
+static void cold_value(char *value, uint32_t k) {
+  uint32_t len = 16 + k % 40;
+
+  memset(value, 'A' + k % 26, len);
+  value[len] = '\0';
+}
+
+static int32_t boot(uint32_t first) {
+  char key[16], value[64], *got;
+  uint32_t s, k, n, sect;
+
+  kvpfs_init();
+  for (k = 0; k < NUM_COLD; k++) {
+    snprintf(key, sizeof(key), "cold%u", k);
+    cold_value(value, k);
+    if (first) {
+      CHECK(set_env(key, value) == KVPFS_OK);
+    } else {
+      CHECK(get_env(key, &got) == KVPFS_OK && strcmp(got, value) == 0);
+      vPortFree(got);
+    }
+  }
+  for (k = 0; k < NUM_HOT && !first; k++) {
+    snprintf(key, sizeof(key), "hot%u", k);
+    CHECK(get_env_u32(key, &n) == KVPFS_OK && n == wear->hot[k]);
+  }
+
+  for (s = 0; s < SAVES_PER_BOOT; s++) {
+    // one counter on most saves, all of them now and then
+    for (k = 0; k < NUM_HOT; k++) {
+      if (k != s % NUM_HOT && s % 16 != 0) continue;
+      snprintf(key, sizeof(key), "hot%u", k);
+      CHECK(set_env_u32(key, ++wear->hot[k]) == KVPFS_OK);
+      wear->user_bytes += strlen(key) + 1 + 1 + 8;
+    }
+    CHECK(save_env() == KVPFS_OK);
+  }
+
+  wear->saves += SAVES_PER_BOOT;
+  wear->gc += kvlog.gc_cnt;
+  wear->programmed += simProgrammed;
+  for (sect = 0; sect < SIM_NUM_SECTS; sect++) wear->erases[sect] += simErases[sect];
+  memcpy(wear->erase_cnt, kvlog.erase_cnt, sizeof(kvlog.erase_cnt));
+  if (first) {
+    memcpy(wear->first_erases, wear->erases, sizeof(wear->erases));
+    memcpy(wear->first_erase_cnt, wear->erase_cnt, sizeof(wear->erase_cnt));
+  }
+  return 0;
+}
+
+static void run(uint32_t first) {
+  pid_t pid;
+  int status, null;
+
+  fflush(stdout);
+  pid = fork();
+  CHECK(pid >= 0);
+  if (pid == 0) {
+    null = open("/dev/null", O_WRONLY);
+    CHECK(null >= 0 && dup2(null, 1) == 1);  // the store reports its banks
+    _exit(boot(first));
+  }
+  CHECK(waitpid(pid, &status, 0) == pid);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+int main(void) {
+  uint32_t b, sect, min = 0xFFFFFFFFUL, max = 0, total = 0;
+  int32_t behind;
+
+  sim_flash_map();
+  wear = mmap(NULL, sizeof(*wear), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  CHECK(wear != MAP_FAILED);
+  memset(wear, 0, sizeof(*wear));
+
+  for (b = 0; b < NUM_BOOTS; b++) run(b == 0);
+
+  for (sect = 0; sect < KVLOG_NSECT; sect++) {
+    behind = wear->erases[RING_FIRST + sect] - wear->erase_cnt[sect];
+    CHECK(behind >= 0 && behind <= (int32_t)(wear->first_erases[RING_FIRST + sect] -
+                                             wear->first_erase_cnt[sect]));
+    if (wear->erase_cnt[sect] < min) min = wear->erase_cnt[sect];
+    if (wear->erase_cnt[sect] > max) max = wear->erase_cnt[sect];
+    total += wear->erases[RING_FIRST + sect];
+  }
+  CHECK(min > 0 && max - min <= WEAR_SPREAD);
+
+  printf("kvwear: ok, %u boots, %u saves, %u collections\n", NUM_BOOTS, wear->saves, wear->gc);
+  printf("  erase_cnt of the %u sectors:", KVLOG_NSECT);
+  for (sect = 0; sect < KVLOG_NSECT; sect++) printf(" %u", wear->erase_cnt[sect]);
+  printf("\n  erases seen by the flash:");
+  for (sect = 0; sect < KVLOG_NSECT; sect++) printf(" %u", wear->erases[RING_FIRST + sect]);
+  printf("\n  erase_cnt min %u, max %u, %.1f saves per erase, write amplification %.1f\n", min,
+         max, (double)wear->saves / total, (double)wear->programmed / wear->user_bytes);
+  return 0;
+}
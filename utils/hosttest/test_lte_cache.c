@@ -0,0 +1,241 @@
+/*
+  LTE state cache: coherence of the cached network state with the report stream.
+
+  A modem model changes its attach and registration state at random and reports every change, a
+  registration change takes the attach state with it and reports only the registration. The
+  reports reach the real report jobs after a random delay, in order, as the callback worker would
+  run them, and some of them arrive while an lte_get_netstat() query is in flight, before or after
+  the modem answered it. An application polls the cached getters in between. A value served from
+  the cache without a query must be:
+  - a state the modem held no earlier than the last report delivered, so a query answered before
+    a report never overwrites it, and a registration change drops the attach state it predates;
+  - no older than the age asked for and ALTCOM_LTE_CACHE_MAX_AGE_MS.
+  The registration state has no getter and must be exactly the last report, while it is fresh.
+  Polling has to get away with a small share of queries, and the tick counter wraps on the way.
+*/
+#include <stdint.h>
+
+#include "../../middleware/altcomlib/altcom/api/lte/lte_cache.c"
+#include "../../middleware/altcomlib/altcom/api/lte/apicmdhdlr_repevt.c"
+#include "../../middleware/altcomlib/altcom/api/lte/apicmdhdlr_repnetstat.c"
+#include "../../middleware/altcomlib/altcom/api/lte/lte_getnetstat.c"
+#include "hosttest.h"
+
+#define NUM_STEPS 200000
+#define MAX_CHANGES (NUM_STEPS * 2)
+#define QUEUE_SIZE 64
+
+#define REP_NETSTAT (0)
+#define REP_REGSTATE (1)
+
+static uint32_t now = 0xFFFFFFFFu - 500000u;
+static uint32_t rpcs;
+
+/* modem: its state after every change, and the reports not delivered yet */
+static ltenetstate_e netAt[MAX_CHANGES];
+static uint8_t regAt[MAX_CHANGES];  // APICMD_REP_REGST_*
+static uint32_t version;
+
+static struct {
+  uint32_t kind;
+  uint32_t version;
+} queue[QUEUE_SIZE];
+static uint32_t queueHead, queueTail;
+
+/* host: what the delivered reports told */
+static uint32_t delivered;  // version of the last report delivered
+static lteregstate_e regState;  // and the last registration report, at regTick
+static uint32_t regTick;
+static bool regValid;
+
+/* target services */
+uint32_t alt_osal_get_tick_count(void) { return now; }
+
+uint32_t alt_osal_get_tick_freq(void) { return 1000; }
+
+int32_t alt_osal_disable_dispatch(void) { return 0; }
+
+int32_t alt_osal_enable_dispatch(void) { return 0; }
+
+void altcom_callback_lock(void) {}
+
+void altcom_callback_unlock(void) {}
+
+bool altcom_isinit(void) { return true; }
+
+void altcom_free_cmd(FAR uint8_t *dat) { free(dat); }
+
+bool altcom_generic_alloc_cmdandresbuff(FAR void **buff, int32_t id, uint16_t bufflen,
+                                        FAR void **res, uint16_t reslen) {
+  (void)id;
+  *buff = malloc(bufflen + 1);
+  *res = malloc(reslen);
+  return *buff != NULL && *res != NULL;
+}
+
+void altcom_generic_free_cmdandresbuff(FAR void *buff, FAR void *res) {
+  free(buff);
+  free(res);
+}
+
+/* modem */
+static const struct {
+  uint8_t code;
+  lteregstate_e state;
+  ltenetstate_e netstat;  // the attach state goes with the registration, unreported
+} regCodes[] = {
+    {APICMD_REP_REGST_REGHOME, LTE_REGSTAT_REGISTERED_HOME, LTE_NETSTAT_ATTACH},
+    {APICMD_REP_REGST_NOTATCH_SRCH, LTE_REGSTAT_NOT_REGISTERED_SEARCHING, LTE_NETSTAT_DETACH},
+    {APICMD_REP_REGST_REGROAMING, LTE_REGSTAT_REGISTERED_ROAMING, LTE_NETSTAT_ATTACH}};
+
+#define NUM_REG_CODES (sizeof(regCodes) / sizeof(regCodes[0]))
+
+static void modem_change(void) {
+  uint32_t kind = ht_rand() % 3 == 0 ? REP_REGSTATE : REP_NETSTAT, i;
+
+  CHECK(version + 1 < MAX_CHANGES && queueTail - queueHead < QUEUE_SIZE);
+  netAt[version + 1] = netAt[version];
+  regAt[version + 1] = regAt[version];
+  version++;
+  if (kind == REP_NETSTAT) {
+    netAt[version] = netAt[version] == LTE_NETSTAT_ATTACH ? LTE_NETSTAT_DETACH : LTE_NETSTAT_ATTACH;
+  } else {
+    i = ht_rand() % NUM_REG_CODES;
+    regAt[version] = regCodes[i].code;
+    netAt[version] = regCodes[i].netstat;
+  }
+  queue[queueTail % QUEUE_SIZE].kind = kind;
+  queue[queueTail % QUEUE_SIZE].version = version;
+  queueTail++;
+}
+
+/* run the job of the oldest pending report, as the callback worker does */
+static void deliver(void) {
+  FAR struct apicmd_cmddat_repnetstat_s *netstat;
+  FAR struct apicmd_cmddat_repevt_s *evt;
+  uint32_t v, i;
+
+  if (queueHead == queueTail) return;
+  v = queue[queueHead % QUEUE_SIZE].version;
+  if (queue[queueHead % QUEUE_SIZE].kind == REP_NETSTAT) {
+    netstat = malloc(sizeof(*netstat));
+    CHECK(netstat != NULL);
+    netstat->stat = netAt[v];
+    netstat->sessionid = 1;
+    repnetstat_job(netstat);
+  } else {
+    evt = malloc(sizeof(*evt));
+    CHECK(evt != NULL);
+    evt->type = htons(APICMD_REPORT_EVT_TYPE_REGSTATE);
+    evt->u.regstate.state = regAt[v];
+    repevt_job(evt);
+    for (i = 0; regCodes[i].code != regAt[v]; i++) {
+    }
+    regState = regCodes[i].state;
+    regTick = now;
+    regValid = true;
+  }
+  queueHead++;
+  delivered = v;
+}
+
+/* reports in flight and state changes, while the host waits for something */
+static void modem_activity(void) {
+  uint32_t n;
+
+  for (n = ht_range(0, 3); n > 0; n--) {
+    if (ht_rand() % 2) {
+      modem_change();
+    } else {
+      deliver();
+    }
+  }
+}
+
+int32_t apicmdgw_send(FAR uint8_t *cmd, FAR uint8_t *respbuff, uint16_t bufflen,
+                      FAR uint16_t *resplen, int32_t timeout_ms) {
+  FAR struct apicmd_cmddat_getnetstatres_s *res = (FAR void *)respbuff;
+
+  (void)cmd;
+  (void)timeout_ms;
+  rpcs++;
+  modem_activity();
+  res->result = LTE_RESULT_OK;
+  res->state = netAt[version] == LTE_NETSTAT_ATTACH ? APICMD_GETNETSTAT_RES_CNCT : 0;
+  *resplen = bufflen;
+  modem_activity();
+  now += ht_range(0, 20);
+  return 0;
+}
+
+/* the application */
+static uint32_t max_age(void) {
+  switch (ht_rand() % 8) {
+    case 0:
+      return 0;
+    case 1:
+      return 0xFFFFFFFFu;
+    default:
+      return ht_range(1, 2000);
+  }
+}
+
+static void poll_netstat(uint32_t *hits) {
+  ltenetstate_e state;
+  lte_cache_info_t info;
+  uint32_t age = max_age(), before = rpcs, floor = delivered, v;
+
+  CHECK(lte_get_netstat_cached(&state, age, &info) == LTE_RESULT_OK);
+  if (rpcs != before) {
+    CHECK(info.src == LTE_CACHE_SRC_QUERY && info.age_ms == 0);
+    return;
+  }
+  (*hits)++;
+  CHECK(age != 0);
+  CHECK(info.age_ms <= age && info.age_ms <= ALTCOM_LTE_CACHE_MAX_AGE_MS);
+  for (v = floor; v <= version && netAt[v] != state; v++) {
+  }
+  CHECK(v <= version);
+}
+
+static void poll_regstate(void) {
+  lteregstate_e state;
+  lte_cache_info_t info;
+  uint32_t age = max_age(), limit;
+  lteresult_e ret;
+
+  limit = age < ALTCOM_LTE_CACHE_MAX_AGE_MS ? age : ALTCOM_LTE_CACHE_MAX_AGE_MS;
+  ret = lte_get_regstate_cached(&state, age, &info);
+  if (!regValid || age == 0 || now - regTick > limit) {
+    CHECK(ret == LTE_RESULT_ERROR);
+    return;
+  }
+  CHECK(ret == LTE_RESULT_OK && state == regState && info.src == LTE_CACHE_SRC_REPORT);
+  CHECK(info.age_ms == now - regTick);
+}
+
+int main(void) {
+  uint32_t step, polls = 0, hits = 0;
+
+  netAt[0] = LTE_NETSTAT_DETACH;
+  regAt[0] = APICMD_REP_REGST_NOTATCH_SRCH;
+  lte_cache_init();
+
+  for (step = 0; step < NUM_STEPS; step++) {
+    // mostly quiet, with storms of reports now and then
+    if (ht_rand() % 64 == 0 || (step / 1000) % 16 == 0) modem_activity();
+    if (ht_rand() % 4 == 0) deliver();
+    now += ht_rand() % 16 == 0 ? ht_range(100, 20000) : ht_range(0, 10);
+
+    if (ht_rand() % 2) {
+      poll_netstat(&hits);
+    } else {
+      poll_regstate();
+    }
+    polls++;
+  }
+  CHECK(hits != 0 && rpcs < polls / 4);
+
+  printf("lte cache: ok, %u polls, %u netstat cache hits, %u queries\n", polls, hits, rpcs);
+  return 0;
+}
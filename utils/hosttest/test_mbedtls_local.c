@@ -0,0 +1,249 @@
+/*
+  SHA-1 and Base64 on the MCU, against the modem.
+
+  sha1_local.c and base64_local.c are built with MBEDTLS_SELF_TEST, and the one-shot calls with
+  ALTCOM_MBEDTLS_LOCAL_SHA1 and ALTCOM_MBEDTLS_LOCAL_BASE64 at 0, so they go to a modem model
+  behind apicmdgw_send() which answers with the local code. Then:
+  - the FIPS 180-2 and mbedtls Base64 known-answer self tests pass;
+  - the streaming SHA-1 API gives the same digest however the input is split;
+  - Base64 round trips, answers size queries, skips line breaks and refuses bad characters;
+  - the modem gives what the local code gives, and inputs over one request stay on the MCU;
+  - the report gives, per call and input size, the local time against the modem round trip: the
+    host time of the request plus both buffers on the internal UART at its default rate. The
+    modem's own processing is left out, so the round trip is a lower bound.
+*/
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "altcom_seterrno.h"
+#include "apicmd.h"
+#include "apicmd_cipher.h"
+#include "crypto_local.h"
+#include "hosttest.h"
+#include "mbedtls/base64.h"
+#include "mbedtls/sha1.h"
+
+#define UART_BAUD (460800)  // UARTI0_BAUDRATE_DEFAULT
+#define BENCH_CALLS (2000)
+
+static uint32_t rpcs, reqLen;
+static uint64_t wireBytes;
+
+/* ALTCOM as far as the one-shot calls use it */
+bool altcom_isinit(void) { return true; }
+
+void altcom_seterrno(int32_t err_no) { (void)err_no; }
+
+bool altcom_mbedtls_alloc_cmdandresbuff(void **buff, int32_t id, uint16_t bufflen, void **res,
+                                        uint16_t reslen) {
+  (void)id;
+  *buff = malloc(bufflen);
+  *res = malloc(reslen);
+  reqLen = bufflen;
+  return *buff != NULL && *res != NULL;
+}
+
+void altcom_mbedtls_free_cmdandresbuff(void *cmdbuff, void *resbuff) {
+  free(cmdbuff);
+  free(resbuff);
+}
+
+static uint32_t be32(uint32_t v) { return __builtin_bswap32(v); }
+
+/* the modem, answering with the local code */
+int32_t apicmdgw_send(uint8_t *cmd, uint8_t *respbuff, uint16_t bufflen, uint16_t *resplen,
+                      int32_t timeout_ms) {
+  struct apicmd_ciphercmd_s *req = (void *)cmd;
+  struct apicmd_ciphercmdres_s *res = (void *)respbuff;
+  mbedtls_sha1_context ctx;
+  size_t olen = 0;
+  int32_t ret;
+
+  (void)timeout_ms;
+  rpcs++;
+  wireBytes += reqLen + bufflen + 2 * sizeof(struct apicmd_cmdhdr_s);
+  res->subcmd_id = req->subcmd_id;
+  switch (be32(req->subcmd_id)) {
+    case APISUBCMDID_TLS_SHA1:
+      mbedtls_sha1_init(&ctx);
+      mbedtls_sha1_starts(&ctx);
+      mbedtls_sha1_update(&ctx, (uint8_t *)req->u.sha1.input, be32(req->u.sha1.ilen));
+      mbedtls_sha1_finish(&ctx, (uint8_t *)res->u.sha1res.output);
+      ret = 0;
+      break;
+    case APISUBCMDID_TLS_BASE64_ENCODE:
+      ret = base64_local_encode((uint8_t *)res->u.base64_encoderes.dst,
+                                be32(req->u.base64_encode.dlen) < APICMD_BASE64_ENCODE_DST_LEN
+                                    ? be32(req->u.base64_encode.dlen)
+                                    : APICMD_BASE64_ENCODE_DST_LEN,
+                                &olen, (uint8_t *)req->u.base64_encode.src,
+                                be32(req->u.base64_encode.slen));
+      res->u.base64_encoderes.olen = be32(olen);
+      break;
+    case APISUBCMDID_TLS_BASE64_DECODE:
+      ret = base64_local_decode((uint8_t *)res->u.base64_decoderes.dst,
+                                be32(req->u.base64_decode.dlen) < APICMD_BASE64_DECODE_DST_LEN
+                                    ? be32(req->u.base64_decode.dlen)
+                                    : APICMD_BASE64_DECODE_DST_LEN,
+                                &olen, (uint8_t *)req->u.base64_decode.src,
+                                be32(req->u.base64_decode.slen));
+      res->u.base64_decoderes.olen = be32(olen);
+      break;
+    default:
+      CHECK(0);
+  }
+  res->ret_code = be32(ret);
+  *resplen = bufflen;
+  return 0;
+}
+
+static void sha1_local(const uint8_t *in, size_t len, uint8_t out[20]) {
+  mbedtls_sha1_context ctx;
+
+  mbedtls_sha1_init(&ctx);
+  mbedtls_sha1_starts(&ctx);
+  mbedtls_sha1_update(&ctx, in, len);
+  mbedtls_sha1_finish(&ctx, out);
+  mbedtls_sha1_free(&ctx);
+}
+
+static void check_sha1(const uint8_t *in, size_t len) {
+  mbedtls_sha1_context ctx, copy;
+  uint8_t want[20], got[20];
+  size_t off, n;
+  uint32_t before = rpcs;
+
+  sha1_local(in, len, want);
+  mbedtls_sha1_init(&ctx);
+  mbedtls_sha1_starts(&ctx);
+  for (off = 0; off < len; off += n) {
+    n = ht_range(0, 200);
+    if (n > len - off) n = len - off;
+    mbedtls_sha1_update(&ctx, in + off, n);
+  }
+  mbedtls_sha1_clone(&copy, &ctx);
+  mbedtls_sha1_finish(&ctx, got);
+  CHECK(memcmp(got, want, sizeof(want)) == 0);
+  mbedtls_sha1_finish(&copy, got);
+  CHECK(memcmp(got, want, sizeof(want)) == 0);
+
+  mbedtls_sha1(in, len, got);
+  CHECK(memcmp(got, want, sizeof(want)) == 0);
+  CHECK(rpcs == before + (len <= APICMD_SHA1_INPUT_LEN));
+}
+
+static void check_base64(const uint8_t *in, size_t len) {
+  static uint8_t enc[8192], lines[8192], dec[4096], rpc[4096];
+  size_t elen, olen, need, i, n;
+  uint32_t before = rpcs;
+  int encRpc;
+
+  CHECK(base64_local_encode(NULL, 0, &need, in, len) ==
+        (len ? MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL : 0));
+  CHECK(base64_local_encode(enc, sizeof(enc), &elen, in, len) == 0);
+  CHECK(elen == (len + 2) / 3 * 4 && (len == 0 || need == elen + 1));
+  CHECK(base64_local_decode(dec, sizeof(dec), &olen, enc, elen) == 0);
+  CHECK(olen == len && memcmp(dec, in, len) == 0);
+  if (len > 0) {
+    CHECK(base64_local_decode(dec, len - 1, &need, enc, elen) ==
+          MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL);
+    CHECK(need == len);
+  }
+
+  // 64 characters to a line, as in PEM, some lines ending in spaces
+  for (i = n = 0; i < elen; i++) {
+    lines[n++] = enc[i];
+    if (i % 64 == 63) {
+      if (ht_rand() % 4 == 0) lines[n++] = ' ';
+      if (ht_rand() % 2) lines[n++] = '\r';
+      lines[n++] = '\n';
+    }
+  }
+  CHECK(base64_local_decode(dec, sizeof(dec), &olen, lines, n) == 0);
+  CHECK(olen == len && memcmp(dec, in, len) == 0);
+  if (elen > 4) {
+    lines[0] = '*';
+    CHECK(base64_local_decode(dec, sizeof(dec), &olen, lines, n) ==
+          MBEDTLS_ERR_BASE64_INVALID_CHARACTER);
+    lines[0] = ' ';
+    CHECK(base64_local_decode(dec, sizeof(dec), &olen, lines, n) ==
+          MBEDTLS_ERR_BASE64_INVALID_CHARACTER);
+  }
+
+  // the modem answers while the encoding fits its response, longer inputs stay on the MCU
+  encRpc = len <= APICMD_BASE64_ENCODE_SRC_LEN && elen + 1 <= APICMD_BASE64_ENCODE_DST_LEN;
+  if (encRpc || len > APICMD_BASE64_ENCODE_SRC_LEN) {
+    CHECK(mbedtls_base64_encode(rpc, sizeof(rpc), &olen, in, len) == 0);
+    CHECK(olen == elen && memcmp(rpc, enc, elen) == 0);
+  }
+  CHECK(mbedtls_base64_decode(rpc, sizeof(rpc), &olen, enc, elen) == 0);
+  CHECK(olen == len && memcmp(rpc, in, len) == 0);
+  CHECK(rpcs - before == encRpc + (elen <= APICMD_BASE64_DECODE_SRC_LEN));
+}
+
+static void bench(size_t len) {
+  static uint8_t in[1500], enc[2048], out[2048];
+  uint8_t sum[20];
+  size_t olen, elen, i;
+  uint64_t t, tl[3], tr[3], bytes[3];
+  uint32_t c;
+  static const char *const names[] = {"mbedtls_sha1()", "mbedtls_base64_encode()",
+                                      "mbedtls_base64_decode()"};
+
+  for (i = 0; i < len; i++) in[i] = (uint8_t)ht_rand();
+  CHECK(base64_local_encode(enc, sizeof(enc), &elen, in, len) == 0);
+
+  t = ht_now_ns();
+  for (c = 0; c < BENCH_CALLS; c++) sha1_local(in, len, sum);
+  tl[0] = ht_now_ns() - t;
+  t = ht_now_ns();
+  for (c = 0; c < BENCH_CALLS; c++)
+    CHECK(base64_local_encode(out, sizeof(out), &olen, in, len) == 0);
+  tl[1] = ht_now_ns() - t;
+  t = ht_now_ns();
+  for (c = 0; c < BENCH_CALLS; c++)
+    CHECK(base64_local_decode(out, sizeof(out), &olen, enc, elen) == 0);
+  tl[2] = ht_now_ns() - t;
+
+  for (i = 0; i < 3; i++) {
+    wireBytes = 0;
+    t = ht_now_ns();
+    for (c = 0; c < BENCH_CALLS; c++) {
+      if (i == 0) mbedtls_sha1(in, len, sum);
+      if (i == 1) CHECK(mbedtls_base64_encode(out, sizeof(out), &olen, in, len) == 0);
+      if (i == 2) CHECK(mbedtls_base64_decode(out, sizeof(out), &olen, enc, elen) == 0);
+    }
+    tr[i] = ht_now_ns() - t;
+    bytes[i] = wireBytes / BENCH_CALLS;
+  }
+
+  for (i = 0; i < 3; i++) {
+    printf("    %-24s %4u bytes: local %6.2f us, modem %6.2f ms (%u bytes on the UART)\n",
+           names[i], (unsigned)len, tl[i] / 1e3 / BENCH_CALLS,
+           (double)bytes[i] * 10 * 1e3 / UART_BAUD + tr[i] / 1e6 / BENCH_CALLS,
+           (unsigned)bytes[i]);
+  }
+}
+
+int main(void) {
+  static const size_t lengths[] = {0, 1, 2, 3, 55, 56, 63, 64, 65, 119, 120, 1000, 1499, 1500,
+                                   1501, 2000, 2001, 3000};
+  static const size_t sizes[] = {16, 256, 1024, 1400};  // encodings the modem can return
+  static uint8_t buf[3000];
+  size_t i, k;
+
+  CHECK(mbedtls_sha1_self_test(0) == 0);
+  CHECK(mbedtls_base64_self_test(0) == 0);
+
+  for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    for (k = 0; k < lengths[i]; k++) buf[k] = (uint8_t)ht_rand();
+    check_sha1(buf, lengths[i]);
+    check_base64(buf, lengths[i]);
+  }
+
+  printf("mbedtls local: ok, self tests passed, %u requests to the modem model agreed\n", rpcs);
+  printf("  per call, modem round trip at %u baud without its processing time:\n", UART_BAUD);
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) bench(sizes[i]);
+  return 0;
+}
@@ -0,0 +1,261 @@
+/*
+  LTE report coalescing: replay of bursty report traces through apicmdhdlr_repevt().
+
+  Local time and registration state reports are states, anti-tamper reports are events. Traces mix
+  quiet stretches with storms of all three, received faster than the callback worker runs them.
+  The worker is a sequential queue as deep as APICALLBACK_THRD_QNUM, a report it cannot take is
+  dropped. The callbacks registered by the application see:
+  - every event that was not dropped, once and in order;
+  - states in the order they were received, and whenever the worker is idle the last state of
+    each type that was not dropped, with ALTCOM_REPORT_COALESCE; every state that was not dropped
+    without it;
+  - at most one queued job per state type.
+  Every receive buffer is freed exactly once, and each report is delivered, coalesced or dropped,
+  as lte_get_report_stats() counts them.
+*/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../../middleware/altcomlib/altcom/api/common/apicmdhdlrbs.c"
+#include "../../middleware/altcomlib/altcom/api/lte/apicmdhdlr_repevt.c"
+#include "hosttest.h"
+
+#define NUM_ROUNDS 20000
+#define MAX_REPORTS (NUM_ROUNDS * 8)
+#define QUEUE_DEPTH 16  // APICALLBACK_THRD_QNUM
+
+#define REP_LTIME (0)
+#define REP_REGSTATE (1)
+#define REP_ANTITAMPER (2)
+#define NUM_REP (3)
+
+/* a receive buffer as the gateway hands it over: the command header, then the event */
+struct rxbuf {
+  struct apicmd_cmdhdr_s hdr;
+  struct apicmd_cmddat_repevt_s evt;
+  uint32_t kind;
+  bool live;
+} __attribute__((packed));
+
+static struct rxbuf *reports[MAX_REPORTS];
+static uint32_t received, freed;
+
+/* the callback worker */
+static struct {
+  thrdpool_jobif_t job;
+  void *arg;
+} queue[QUEUE_DEPTH];
+static uint32_t queueHead, queueTail;
+
+/* per type: seq of reports accepted by the worker, delivered so far, and dropped */
+static uint32_t accepted[NUM_REP][MAX_REPORTS];
+static uint32_t numAccepted[NUM_REP], numDelivered[NUM_REP], numDropped[NUM_REP];
+static uint32_t lastDelivered[NUM_REP];
+static uint8_t regCode[MAX_REPORTS];
+
+static const struct {
+  uint8_t code;
+  lteregstate_e state;
+} regCodes[] = {{APICMD_REP_REGST_NOTATCH_NOTSRCH, LTE_REGSTAT_NOT_REGISTERED_NOT_SEARCHING},
+                {APICMD_REP_REGST_REGHOME, LTE_REGSTAT_REGISTERED_HOME},
+                {APICMD_REP_REGST_NOTATCH_SRCH, LTE_REGSTAT_NOT_REGISTERED_SEARCHING},
+                {APICMD_REP_REGST_REGDENIED, LTE_REGSTAT_REGISTRATION_DENIED},
+                {APICMD_REP_REGST_REGROAMING, LTE_REGSTAT_REGISTERED_ROAMING}};
+
+#define NUM_REG_CODES (sizeof(regCodes) / sizeof(regCodes[0]))
+
+static struct rxbuf *rx_of(const void *evt) {
+  return (struct rxbuf *)((const char *)evt - offsetof(struct rxbuf, evt));
+}
+
+/* target services */
+uint32_t alt_osal_get_tick_count(void) { return 0; }
+
+uint32_t alt_osal_get_tick_freq(void) { return 1000; }
+
+int32_t alt_osal_disable_dispatch(void) { return 0; }
+
+int32_t alt_osal_enable_dispatch(void) { return 0; }
+
+void altcom_callback_lock(void) {}
+
+void altcom_callback_unlock(void) {}
+
+bool apicmdgw_cmdid_compare(FAR uint8_t *cmd, uint16_t cmdid) {
+  return cmd != NULL && ntohs(rx_of(cmd)->hdr.cmdid) == cmdid;
+}
+
+void altcom_free_cmd(FAR uint8_t *dat) {
+  struct rxbuf *rx = rx_of(dat);
+
+  CHECK(rx->live);
+  rx->live = false;
+  freed++;
+}
+
+/* the report a job refused by the worker takes with it */
+static void drop(thrdpool_jobif_t job, void *arg) {
+  struct rxbuf *rx;
+
+  if (job == (thrdpool_jobif_t)apicmdhdlrbs_latest_job) {
+    rx = rx_of(((struct apicmdhdlrbs_latest_s *)arg)->evt);
+  } else {
+    rx = rx_of(arg);
+  }
+  numDropped[rx->kind]++;
+  numAccepted[rx->kind]--;
+}
+
+int32_t evthdlbs_runjob(int8_t id, CODE thrdpool_jobif_t job, FAR void *arg) {
+  uint32_t i;
+
+  CHECK(id == WRKRID_API_CALLBACK_THREAD);
+  if (queueTail - queueHead == QUEUE_DEPTH) {
+    drop(job, arg);
+    return -1;
+  }
+  if (job == (thrdpool_jobif_t)apicmdhdlrbs_latest_job) {
+    for (i = queueHead; i != queueTail; i++) CHECK(queue[i % QUEUE_DEPTH].arg != arg);
+  }
+  queue[queueTail % QUEUE_DEPTH].job = job;
+  queue[queueTail % QUEUE_DEPTH].arg = arg;
+  queueTail++;
+  return 0;
+}
+
+static void worker(uint32_t jobs) {
+  uint32_t i;
+
+  for (; jobs > 0 && queueHead != queueTail; jobs--) {
+    i = queueHead++ % QUEUE_DEPTH;
+    queue[i].job(queue[i].arg);
+  }
+}
+
+/* the application */
+static lteregstate_e reg_state(uint32_t seq) {
+  uint32_t i;
+
+  for (i = 0; regCodes[i].code != regCode[seq]; i++) {
+  }
+  return regCodes[i].state;
+}
+
+static void on_localtime(lte_localtime_t *localtime, void *userPriv) {
+  uint32_t seq = (uint32_t)localtime->tz_sec, i = numDelivered[REP_LTIME]++;
+
+  (void)userPriv;
+#if (ALTCOM_REPORT_COALESCE == 1)
+  CHECK(i == 0 || seq > lastDelivered[REP_LTIME]);
+#else
+  CHECK(i < numAccepted[REP_LTIME] && seq == accepted[REP_LTIME][i]);
+#endif
+  lastDelivered[REP_LTIME] = seq;
+}
+
+static void on_regstate(lteregstate_e regstate, void *userPriv) {
+  uint32_t i = numDelivered[REP_REGSTATE]++;
+
+  (void)userPriv;
+#if (ALTCOM_REPORT_COALESCE == 0)
+  CHECK(i < numAccepted[REP_REGSTATE] && regstate == reg_state(accepted[REP_REGSTATE][i]));
+#else
+  (void)i;
+#endif
+  lastDelivered[REP_REGSTATE] = regstate;
+}
+
+static void on_antitamper(uint8_t data, void *userPriv) {
+  uint32_t i = numDelivered[REP_ANTITAMPER]++;
+
+  (void)userPriv;
+  CHECK(i < numAccepted[REP_ANTITAMPER] && data == (uint8_t)accepted[REP_ANTITAMPER][i]);
+}
+
+/* the modem */
+static void receive(uint32_t kind) {
+  struct rxbuf *rx = calloc(1, sizeof(*rx));
+  uint32_t seq = received;
+
+  CHECK(rx != NULL && received < MAX_REPORTS);
+  reports[received++] = rx;
+  rx->hdr.cmdid = htons(APICMDID_REPORT_EVT);
+  rx->kind = kind;
+  rx->live = true;
+  switch (kind) {
+    case REP_LTIME:
+      rx->evt.type = htons(APICMD_REPORT_EVT_TYPE_LTIME);
+      rx->evt.u.ltime.timezone = htonl(seq);
+      break;
+    case REP_REGSTATE:
+      rx->evt.type = htons(APICMD_REPORT_EVT_TYPE_REGSTATE);
+      regCode[seq] = regCodes[ht_rand() % NUM_REG_CODES].code;
+      rx->evt.u.regstate.state = regCode[seq];
+      break;
+    default:
+      rx->evt.type = htons(APICMD_REPORT_EVT_TYPE_ANTITAMPER);
+      rx->evt.u.antitamper.data = (uint8_t)seq;
+      break;
+  }
+  accepted[kind][numAccepted[kind]++] = seq;
+  apicmdhdlr_repevt((FAR uint8_t *)&rx->evt, sizeof(rx->evt));
+}
+
+/* with the worker idle, each state type shows its last report that was not dropped */
+static void check_idle(void) {
+  if (queueHead != queueTail) return;
+  CHECK(numDelivered[REP_ANTITAMPER] == numAccepted[REP_ANTITAMPER]);
+  if (numAccepted[REP_LTIME] != 0)
+    CHECK(lastDelivered[REP_LTIME] == accepted[REP_LTIME][numAccepted[REP_LTIME] - 1]);
+  if (numAccepted[REP_REGSTATE] != 0)
+    CHECK(lastDelivered[REP_REGSTATE] ==
+          reg_state(accepted[REP_REGSTATE][numAccepted[REP_REGSTATE] - 1]));
+}
+
+int main(void) {
+  lte_report_stats_t stats;
+  uint32_t round, n, kind, i, jobs = 0, idle = 0;
+
+  g_localtime_report_callback = on_localtime;
+  g_regstate_report_callback = on_regstate;
+  g_antitamper_report_callback = on_antitamper;
+
+  for (round = 0; round < NUM_ROUNDS; round++) {
+    // quiet most of the time, a storm every few dozen rounds
+    n = ht_rand() % 32 == 0 ? ht_range(8, 40) : ht_range(0, 2);
+    if (received + n > MAX_REPORTS) break;
+    while (n--) {
+      kind = ht_rand() % 8;
+      receive(kind < 4 ? REP_LTIME : kind < 7 ? REP_REGSTATE : REP_ANTITAMPER);
+    }
+    n = queueTail - queueHead;
+    worker(ht_range(0, 3));
+    jobs += n - (queueTail - queueHead);
+    check_idle();
+    idle += queueHead == queueTail;
+  }
+  worker(QUEUE_DEPTH);
+  check_idle();
+
+  CHECK(freed == received);
+  for (i = 0; i < received; i++) {
+    CHECK(!reports[i]->live);
+    free(reports[i]);
+  }
+  CHECK(lte_get_report_stats(&stats) == LTE_RESULT_OK);
+  CHECK(numDelivered[REP_LTIME] + numDelivered[REP_REGSTATE] + numDelivered[REP_ANTITAMPER] +
+            stats.coalesced + stats.dropped ==
+        received);
+  CHECK(stats.dropped == numDropped[REP_LTIME] + numDropped[REP_REGSTATE] +
+                             numDropped[REP_ANTITAMPER]);
+  CHECK(idle != 0);
+#if (ALTCOM_REPORT_COALESCE == 1)
+  CHECK(stats.coalesced != 0);
+#else
+  CHECK(stats.coalesced == 0);
+#endif
+
+  printf("report coalescing %s: ok, %u reports, %u jobs, %u coalesced, %u dropped\n",
+         ALTCOM_REPORT_COALESCE ? "on" : "off", received, jobs, stats.coalesced, stats.dropped);
+  return 0;
+}
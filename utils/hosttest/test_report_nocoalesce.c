@@ -0,0 +1,7 @@
+/*
+  LTE report replay with ALTCOM_REPORT_COALESCE off: every report that was not dropped is delivered,
+  once and in order, see test_report_coalesce.c.
+*/
+#define ALTCOM_REPORT_COALESCE (0)
+
+#include "test_report_coalesce.c"
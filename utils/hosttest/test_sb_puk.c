@@ -0,0 +1,135 @@
+/*
+  Secure boot key check: sb_puk_verify() against the code it replaced.
+
+  Random public keys, each followed by its crc32 as DRV_SB_Enable_MCU() finds them in flash, sit
+  in a page mapped at a 32-bit address. One key in four has its crc or a bit of the key changed.
+  The reference is the former path: the key copied out of flash, crc32 with its table steps in a
+  loop, then every word byte swapped into a second buffer and hashed with calc_sha256(). Then:
+  - calc_sha256() gives the FIPS 180-2 digest of "abc";
+  - crc32_calc_by_word() agrees with the loop on every multiple of 4 bytes up to 1 KB, and
+    refuses other lengths;
+  - on 1000 keys sb_puk_verify() finds the same crc mismatches and gives the same digests;
+  - the report gives the time of both paths per key.
+*/
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../../ALT125x/Driver/Source/Private/DRV_SB_ENABLE.c"
+#include "hosttest.h"
+
+#define KEY_PAGE (0x30000000UL)
+#define KEY_SIZE (SB_PUK2_SIZE + SB_CRC32_SIZE)
+#define NUM_KEYS (1000)
+#define BENCH_KEYS (20000)
+
+/* crc32_calc_by_word() as it was, one table step per loop */
+static uint32_t crc32_loop(const uint8_t *buf, uint32_t len) {
+  uint32_t crc = ENDIAN_SWAP_32BYTES(0xffffffff);
+  const uint32_t *p = (const uint32_t *)buf;
+  uint32_t i;
+
+  for (len /= CRC32_CALC_WORD_SZ; len > 0; len--) {
+    crc ^= *p++;
+    for (i = 0; i < CRC32_CALC_WORD_SZ; i++) crc = crc32_tab[crc >> 24] ^ (crc << 8);
+  }
+  return ENDIAN_RESVERSE_32BYTES(crc) ^ 0xffffffff;
+}
+
+/* the former key check of DRV_SB_Enable_MCU() */
+static otp_sb_enable_status_e puk_verify_copy(uint32_t addr, uint32_t *sha256_Out) {
+  uint32_t buffer[KEY_SIZE / 4], mbuffer[KEY_SIZE / 4];
+  uint32_t calcChecksum, designatedChecksum;
+  int i;
+
+  memcpy(buffer, (const void *)(uintptr_t)addr, sizeof(buffer));
+  designatedChecksum = buffer[SB_PUK2_SIZE / 4];
+  calcChecksum = crc32_loop((const uint8_t *)buffer, SB_PUK2_SIZE);
+  printf("calcChecksum = 0x%08lx, designatedChecksum = 0x%08lx\n", (unsigned long)calcChecksum,
+         (unsigned long)designatedChecksum);
+  for (i = 0; i < KEY_SIZE / 4; i++) mbuffer[i] = swap_uint32(buffer[i]);
+  calc_sha256((uint8_t *)mbuffer, SB_PUK2_SIZE, (uint8_t *)sha256_Out);
+  return designatedChecksum == calcChecksum ? OTP_SB_ENABLE_OK : OTP_SB_ENABLE_CHECKSUM_ERROR;
+}
+
+static void check_sha256(void) {
+  static const uint8_t abc[32] = {
+      0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde,
+      0x5d, 0xae, 0x22, 0x23, 0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+      0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad};
+  uint8_t out[32];
+
+  calc_sha256((uint8_t *)"abc", 3, out);
+  CHECK(memcmp(out, abc, sizeof(abc)) == 0);
+}
+
+static void check_crc(void) {
+  static uint32_t buf[256];
+  uint32_t len, i;
+
+  for (i = 0; i < 256; i++) buf[i] = ht_rand() ^ (ht_rand() << 16);
+  for (len = 4; len <= sizeof(buf); len += 4)
+    CHECK(crc32_calc_by_word((const uint8_t *)buf, len) == crc32_loop((const uint8_t *)buf, len));
+  CHECK(crc32_calc_by_word((const uint8_t *)buf, 0) == 0);
+  CHECK(crc32_calc_by_word((const uint8_t *)buf, 6) == 0);
+}
+
+/* a key with its crc at a random word of the page, the crc or the key changed one time in 4 */
+static uint32_t key(uint32_t *bad) {
+  uint32_t *p = (uint32_t *)KEY_PAGE + ht_rand() % ((0x1000 - KEY_SIZE) / 4);
+  uint32_t i;
+
+  for (i = 0; i < SB_PUK2_SIZE / 4; i++) p[i] = ht_rand() ^ (ht_rand() << 16);
+  p[SB_PUK2_SIZE / 4] = crc32_loop((const uint8_t *)p, SB_PUK2_SIZE);
+  *bad = ht_rand() % 4 == 0;
+  if (*bad) {
+    i = ht_rand() % (KEY_SIZE * 8);
+    ((uint8_t *)p)[i / 8] ^= 1 << (i % 8);
+  }
+  return (uint32_t)(uintptr_t)p;
+}
+
+int main(void) {
+  uint32_t want[8], got[8], addr, bad, mismatches = 0, k;
+  otp_sb_enable_status_e status;
+  uint64_t t, tCopy, tVerify;
+  int out, null;
+
+  CHECK(mmap((void *)KEY_PAGE, 0x1000, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == (void *)KEY_PAGE);
+  check_sha256();
+
+  // both paths print the crcs as DRV_SB_Enable_MCU() did, crc32_calc_by_word() its errors
+  fflush(stdout);
+  out = dup(1);
+  null = open("/dev/null", O_WRONLY);
+  CHECK(out >= 0 && null >= 0 && dup2(null, 1) == 1);
+  check_crc();
+
+  for (k = 0; k < NUM_KEYS; k++) {
+    addr = key(&bad);
+    status = puk_verify_copy(addr, want);
+    CHECK(status == (bad ? OTP_SB_ENABLE_CHECKSUM_ERROR : OTP_SB_ENABLE_OK));
+    CHECK(sb_puk_verify(addr, got) == status);
+    CHECK(memcmp(got, want, sizeof(want)) == 0);
+    mismatches += bad;
+  }
+
+  addr = key(&bad);
+  t = ht_now_ns();
+  for (k = 0; k < BENCH_KEYS; k++) puk_verify_copy(addr, want);
+  tCopy = ht_now_ns() - t;
+  t = ht_now_ns();
+  for (k = 0; k < BENCH_KEYS; k++) sb_puk_verify(addr, got);
+  tVerify = ht_now_ns() - t;
+
+  fflush(stdout);
+  CHECK(dup2(out, 1) == 1);
+  printf("sb puk: ok, %u keys, %u crc mismatches found by both, same digests\n", NUM_KEYS,
+         mismatches);
+  printf("  per key of %u bytes: copy, crc and hash %.2f us, sb_puk_verify() %.2f us\n", KEY_SIZE,
+         tCopy / 1e3 / BENCH_KEYS, tVerify / 1e3 / BENCH_KEYS);
+  return 0;
+}
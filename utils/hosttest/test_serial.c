@@ -0,0 +1,790 @@
+/*
+  Serial request queues: serial.c with its tasks, timer and UART interrupt as host threads, the
+  UART line being a socketpair.
+
+  The OSAL runs on pthreads: the critical section is one lock that the interrupt thread takes as
+  well, and a task leaving it is preempted now and then; task flags are per thread, the pump timer
+  has a thread of its own. The driver model hands
+  the line to serial.c the way DRV_UART.c does in interrupt mode: received bytes go to the pending
+  read or to a ring, and the socket holds the rest back when the ring is full; a send goes out in
+  chunks and now and then finds the interface down. A peer thread keeps the other end of the
+  line busy with a numbered stream and records what it receives.
+
+  Writer and reader tasks queue blocking, timed and asynchronous requests and cancel some. Main
+  closes the port while they are at it, and opens it again for the next round. The driver model
+  checks that it is not called while closed, nor closed with a transfer running; it keeps the line
+  across a close, so the received stream goes on where it stopped. Then:
+  - the line carries, in the order the driver took them, the bytes of every write up to what it
+    reported, and the writes of one task went out in the order it queued them. Tasks scribble
+    over their buffer once a request finishes, so a late access from the driver shows up too;
+  - the reads tile the received stream: every byte was handed to exactly one read, and reads
+    report what they got;
+  - every asynchronous request finished once, COMPLETE with all its bytes, TIMEOUT after its
+    deadline, ABORTED only when cancelled or closed;
+  - the counters add up.
+*/
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../middleware/serial/serial.c"
+#include "hosttest.h"
+
+#define RUN_MS 1500
+#define NUM_ROUNDS 30
+#define NUM_WRITERS 3
+#define NUM_READERS 2
+#define MAX_BATCH 4
+#define MAX_LEN 200
+#define RING_LEN 512
+#define MAX_LINE (8 << 20)
+#define MAX_LOG (1 << 18)
+
+uint32_t hostPrimask, hostBasepri;
+uint32_t SystemCoreClock = 160000000;
+
+static struct timespec t0;
+static pthread_mutex_t critical;
+
+/* OSAL */
+struct task {
+  pthread_mutex_t mtx;
+  pthread_cond_t cond;
+  uint32_t flags;
+};
+
+static __thread struct task *curTask;
+
+static void task_init(struct task *t) {
+  pthread_mutex_init(&t->mtx, NULL);
+  pthread_cond_init(&t->cond, NULL);
+  t->flags = 0;
+  curTask = t;
+}
+
+uint32_t alt_osal_get_tick_count(void) {
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint32_t)((t.tv_sec - t0.tv_sec) * 1000 + (t.tv_nsec - t0.tv_nsec) / 1000000);
+}
+
+uint32_t alt_osal_enter_critical(void) {
+  pthread_mutex_lock(&critical);
+  return 0;
+}
+
+/* tasks get preempted now and then on leaving a critical section, as by a higher priority task */
+int32_t alt_osal_exit_critical(uint32_t status) {
+  static __thread uint32_t seed = 1;
+
+  (void)status;
+  pthread_mutex_unlock(&critical);
+  seed = seed * 1103515245u + 12345u;
+  if (curTask && (seed >> 8) % 64 == 0) usleep((seed >> 16) % 300);
+  return 0;
+}
+
+alt_osal_task_handle alt_osal_get_current_task_handle(void) { return curTask; }
+
+int32_t alt_osal_set_taskflag(alt_osal_task_handle handle, uint32_t flags) {
+  struct task *t = handle;
+
+  pthread_mutex_lock(&t->mtx);
+  t->flags |= flags;
+  pthread_cond_signal(&t->cond);
+  pthread_mutex_unlock(&t->mtx);
+  return 0;
+}
+
+int32_t alt_osal_clear_taskflag(uint32_t flags) {
+  pthread_mutex_lock(&curTask->mtx);
+  curTask->flags &= ~flags;
+  pthread_mutex_unlock(&curTask->mtx);
+  return 0;
+}
+
+static void deadline_in(struct timespec *ts, uint32_t ms) {
+  clock_gettime(CLOCK_REALTIME, ts);
+  ts->tv_sec += ms / 1000;
+  ts->tv_nsec += (long)(ms % 1000) * 1000000;
+  if (ts->tv_nsec >= 1000000000) {
+    ts->tv_sec++;
+    ts->tv_nsec -= 1000000000;
+  }
+}
+
+int32_t alt_osal_wait_taskflag(uint32_t flags, uint32_t options, uint32_t timeout) {
+  struct task *t = curTask;
+  struct timespec ts;
+  uint32_t got;
+
+  (void)options;
+  deadline_in(&ts, timeout);
+  pthread_mutex_lock(&t->mtx);
+  while (!(t->flags & flags)) {
+    if (timeout != (uint32_t)ALT_OSAL_TIMEO_FEVR) {
+      if (pthread_cond_timedwait(&t->cond, &t->mtx, &ts) == ETIMEDOUT) break;
+    } else {
+      pthread_cond_wait(&t->cond, &t->mtx);
+    }
+  }
+  got = t->flags & flags;
+  t->flags &= ~flags;
+  pthread_mutex_unlock(&t->mtx);
+  return got ? (int32_t)got : -ETIMEDOUT;
+}
+
+int32_t alt_osal_sleep_task(int32_t timeout_ms) {
+  usleep(timeout_ms * 1000);
+  return 0;
+}
+
+/* the one timer serial.c creates, run by a daemon thread as FreeRTOS does */
+static struct {
+  pthread_mutex_t mtx;
+  pthread_cond_t cond;
+  alt_osal_timer_cb_t cb;
+  void *arg;
+  uint32_t active, expiry, quit, fired;
+} timer = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+
+int32_t alt_osal_create_timer(alt_osal_timer_handle *handle, bool autoreload,
+                              alt_osal_timer_cb_t callback, void *argument,
+                              alt_osal_timer_attribute *attr) {
+  (void)attr;
+  CHECK(!autoreload && timer.cb == NULL);
+  timer.cb = callback;
+  timer.arg = argument;
+  *handle = &timer;
+  return 0;
+}
+
+int32_t alt_osal_start_timer(alt_osal_timer_handle *handle, uint32_t period_ms) {
+  CHECK(*handle == &timer);
+  pthread_mutex_lock(&timer.mtx);
+  timer.active = 1;
+  timer.expiry = alt_osal_get_tick_count() + period_ms;
+  pthread_cond_signal(&timer.cond);
+  pthread_mutex_unlock(&timer.mtx);
+  return 0;
+}
+
+int32_t alt_osal_stop_timer(alt_osal_timer_handle *handle) {
+  CHECK(*handle == &timer);
+  pthread_mutex_lock(&timer.mtx);
+  timer.active = 0;
+  pthread_mutex_unlock(&timer.mtx);
+  return 0;
+}
+
+static void *timer_task(void *arg) {
+  static struct task self;
+  struct timespec ts;
+
+  (void)arg;
+  task_init(&self);
+  pthread_mutex_lock(&timer.mtx);
+  while (!timer.quit) {
+    if (!timer.active) {
+      pthread_cond_wait(&timer.cond, &timer.mtx);
+    } else if ((int32_t)(alt_osal_get_tick_count() - timer.expiry) < 0) {
+      deadline_in(&ts, 1);
+      pthread_cond_timedwait(&timer.cond, &timer.mtx, &ts);
+    } else {
+      timer.active = 0;
+      timer.fired++;
+      pthread_mutex_unlock(&timer.mtx);
+      timer.cb(timer.arg);
+      pthread_mutex_lock(&timer.mtx);
+    }
+  }
+  pthread_mutex_unlock(&timer.mtx);
+  return NULL;
+}
+
+/* the UART driver, its state under the critical lock as the interrupt masks it on target */
+static struct {
+  int fd;
+  DRV_UART_EventCallback_t cb;
+  void *user;
+  uint32_t open, opens, quit;
+  uint8_t ring[RING_LEN];
+  uint32_t head, tail;  // free running
+  uint8_t *rxBuf;
+  uint32_t rxLen, rxGot, rxBusy;
+  uint64_t rxOffset;  // stream bytes handed to reads so far
+  const uint8_t *txBuf;
+  uint32_t txLen, txSent, txBusy, hifcDown;
+} drv = {.fd = -1};
+
+/* what the driver took: reads with their stream offset, writes with the message id */
+static struct {
+  const void *buf;
+  uint64_t offset;
+  uint32_t id, count;
+} rxLog[MAX_LOG], txLog[MAX_LOG];
+static uint32_t numRxLog, numTxLog;
+
+static uint8_t stream_byte(uint64_t k) { return (uint8_t)(k ^ (k >> 8) ^ (k >> 16) * 7); }
+
+static uint8_t msg_byte(uint32_t id, uint32_t i) {
+  return i < 4 ? (uint8_t)(id >> (8 * i)) : (uint8_t)(id * 31 + i * 17 + (i >> 3));
+}
+
+DRV_IF_CFG_Status DRV_IF_CFG_SetIO(Interface_Id intf) {
+  (void)intf;
+  return DRV_IF_CFG_OK;
+}
+
+DRV_IF_CFG_Status DRV_IF_CFG_GetDefConfig(Interface_Id intf, void *config) {
+  (void)intf;
+  memset(config, 0, sizeof(DRV_UART_Config));
+  return DRV_IF_CFG_OK;
+}
+
+DRV_UART_Status DRV_UART_Initialize(UART_Type *base, const DRV_UART_Config *UART_config,
+                                    uint32_t clock) {
+  (void)base;
+  (void)UART_config;
+  (void)clock;
+  return DRV_UART_ERROR_NONE;
+}
+
+DRV_UART_Status DRV_UART_Create_Handle(UART_Type *base, DRV_UART_Handle *handle,
+                                       DRV_UART_EventCallback_t callback, void *userdata,
+                                       int8_t *buffer, size_t buffer_size) {
+  (void)buffer;
+  (void)buffer_size;
+  memset(handle, 0, sizeof(*handle));
+  handle->base = base;
+  alt_osal_enter_critical();
+  CHECK(!drv.open);
+  drv.cb = callback;
+  drv.user = userdata;
+  drv.open = 1;
+  drv.opens++;
+  alt_osal_exit_critical(0);
+  return DRV_UART_ERROR_NONE;
+}
+
+DRV_UART_Status DRV_UART_Uninitialize(DRV_UART_Handle *handle) {
+  alt_osal_enter_critical();
+  CHECK(drv.open && !drv.rxBusy && !drv.txBusy);
+  drv.open = 0;
+  alt_osal_exit_critical(0);
+  memset(handle, 0, sizeof(*handle));
+  return DRV_UART_ERROR_NONE;
+}
+
+static uint32_t ring_take(uint8_t *buf, uint32_t len) {
+  uint32_t n = 0;
+
+  while (n < len && drv.tail != drv.head) buf[n++] = drv.ring[drv.tail++ % RING_LEN];
+  drv.rxOffset += n;
+  return n;
+}
+
+DRV_UART_Status DRV_UART_Receive_Nonblock(DRV_UART_Handle *handle, void *buffer, size_t length) {
+  DRV_UART_Status ret;
+
+  (void)handle;
+  alt_osal_enter_critical();
+  CHECK(drv.open);
+  if (drv.rxBusy) {
+    ret = DRV_UART_ERROR_BUSY;
+  } else {
+    CHECK(numRxLog < MAX_LOG);
+    rxLog[numRxLog].buf = buffer;
+    rxLog[numRxLog].offset = drv.rxOffset;
+    drv.rxBuf = buffer;
+    drv.rxLen = length;
+    drv.rxGot = ring_take(buffer, length);
+    rxLog[numRxLog++].count = drv.rxGot;
+    drv.rxBusy = drv.rxGot < length;
+    ret = drv.rxBusy ? DRV_UART_WAIT_CB : DRV_UART_ERROR_NONE;
+  }
+  alt_osal_exit_critical(0);
+  return ret;
+}
+
+int32_t DRV_UART_Abort_Receive(DRV_UART_Handle *handle) {
+  int32_t got = -1;
+
+  (void)handle;
+  alt_osal_enter_critical();
+  CHECK(drv.open);
+  if (drv.rxBusy) {
+    got = drv.rxGot;
+    drv.rxBusy = 0;
+  }
+  alt_osal_exit_critical(0);
+  return got;
+}
+
+DRV_UART_Status DRV_UART_Send_Nonblock(DRV_UART_Handle *handle, void *data, uint32_t length) {
+  DRV_UART_Status ret = DRV_UART_WAIT_CB;
+  const uint8_t *buf = data;
+
+  (void)handle;
+  alt_osal_enter_critical();
+  CHECK(drv.open);
+  if (drv.txBusy) {
+    ret = DRV_UART_ERROR_BUSY;
+  } else if (ht_rand() % 32 == 0) {
+    drv.hifcDown++;
+    ret = DRV_UART_ERROR_HIFC_TIMEOUT;
+  } else {
+    CHECK(numTxLog < MAX_LOG && length >= 4);
+    txLog[numTxLog].buf = data;
+    txLog[numTxLog++].id = buf[0] | buf[1] << 8 | buf[2] << 16 | (uint32_t)buf[3] << 24;
+    drv.txBuf = data;
+    drv.txLen = length;
+    drv.txSent = 0;
+    drv.txBusy = 1;
+  }
+  alt_osal_exit_critical(0);
+  return ret;
+}
+
+int32_t DRV_UART_Abort_Send(DRV_UART_Handle *handle) {
+  int32_t sent = -1;
+
+  (void)handle;
+  alt_osal_enter_critical();
+  CHECK(drv.open);
+  if (drv.txBusy) {
+    sent = drv.txSent;
+    txLog[numTxLog - 1].count = drv.txSent;
+    drv.txBusy = 0;
+  }
+  alt_osal_exit_critical(0);
+  return sent;
+}
+
+void DRV_UART_DMA_Poll(DRV_UART_Handle *handle) { (void)handle; }
+
+/* the UART interrupt: move the line while the driver is open, complete requests */
+static void *irq_task(void *arg) {
+  struct pollfd pfd = {.fd = drv.fd};
+  uint8_t tmp[RING_LEN];
+  uint32_t room, chunk, i;
+  ssize_t n;
+
+  (void)arg;
+  for (;;) {
+    alt_osal_enter_critical();
+    if (drv.quit) {
+      alt_osal_exit_critical(0);
+      return NULL;
+    }
+    room = RING_LEN - (drv.head - drv.tail);
+    pfd.events = (drv.open && (drv.rxBusy || room)) ? POLLIN : 0;
+    pfd.events |= drv.txBusy ? POLLOUT : 0;
+    alt_osal_exit_critical(0);
+    poll(&pfd, 1, 1);
+
+    alt_osal_enter_critical();
+    if (drv.open && drv.rxBusy) {
+      n = read(drv.fd, drv.rxBuf + drv.rxGot, drv.rxLen - drv.rxGot);
+      if (n > 0) {
+        drv.rxGot += n;
+        drv.rxOffset += n;
+        rxLog[numRxLog - 1].count = drv.rxGot;
+        if (drv.rxGot == drv.rxLen) {
+          drv.rxBusy = 0;
+          drv.cb(NULL, CB_RX_COMPLETE, drv.user);
+        }
+      }
+    } else if (drv.open && room) {
+      n = read(drv.fd, tmp, room);
+      for (i = 0; n > 0 && i < (uint32_t)n; i++) drv.ring[drv.head++ % RING_LEN] = tmp[i];
+    }
+    if (drv.open && drv.txBusy) {
+      chunk = ht_range(1, 64);
+      if (chunk > drv.txLen - drv.txSent) chunk = drv.txLen - drv.txSent;
+      n = write(drv.fd, drv.txBuf + drv.txSent, chunk);
+      if (n > 0) {
+        drv.txSent += n;
+        txLog[numTxLog - 1].count = drv.txSent;
+        if (drv.txSent == drv.txLen) {
+          drv.txBusy = 0;
+          drv.cb(NULL, CB_TX_COMPLETE, drv.user);
+        }
+      }
+    }
+    alt_osal_exit_critical(0);
+  }
+}
+
+/* the other end of the line: the numbered stream out, what serial.c sends in, with stalls */
+static struct {
+  int fd;
+  volatile uint32_t quit;
+  uint64_t sent;  // stream bytes written
+  uint8_t line[MAX_LINE];
+  uint32_t lineLen;
+} peer = {.fd = -1};
+
+static void *peer_task(void *arg) {
+  struct pollfd pfd = {.fd = peer.fd, .events = POLLIN | POLLOUT};
+  uint8_t tmp[256];
+  uint32_t seed = 0x5eed, len, i;
+  ssize_t n;
+
+  (void)arg;
+  while (!peer.quit) {
+    seed = seed * 1103515245u + 12345u;
+    if ((seed >> 8) % 500 == 0) usleep((seed >> 16) % 8000);
+    poll(&pfd, 1, 1);
+    len = (seed >> 12) % sizeof(tmp) + 1;
+    for (i = 0; i < len; i++) tmp[i] = stream_byte(peer.sent + i);
+    n = write(peer.fd, tmp, len);
+    if (n > 0) peer.sent += n;
+    n = read(peer.fd, peer.line + peer.lineLen, MAX_LINE - peer.lineLen);
+    if (n > 0) peer.lineLen += n;
+    CHECK(peer.lineLen < MAX_LINE);
+  }
+  // serial.c sends nothing after it closed the port, take what is left
+  while ((n = read(peer.fd, peer.line + peer.lineLen, MAX_LINE - peer.lineLen)) > 0) {
+    peer.lineLen += n;
+  }
+  return NULL;
+}
+
+/* the tasks using the port */
+#define MAX_SEQ (1 << 18)
+#define NOT_DONE 0xFFFFFFFFu
+
+struct areq {
+  serial_request req;
+  uint8_t buf[MAX_LEN];
+  uint32_t submitted, cancelled, finished, finishTick;
+};
+
+static serial_handle port;
+static volatile uint32_t closing;
+static uint32_t txDone[NUM_WRITERS][MAX_SEQ];  // by sequence number, NOT_DONE if never queued
+static uint32_t writerSeed[NUM_WRITERS], writerSeq[NUM_WRITERS], readerSeed[NUM_READERS];
+static uint64_t rxTotal;
+static pthread_mutex_t totalMtx = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t numBlocking, numAsync, numCancels, numTimeouts, numAborts;
+
+static uint32_t task_rand(uint32_t *seed) {
+  *seed = *seed * 1103515245u + 12345u;
+  return *seed >> 8;
+}
+
+static uint32_t task_timeout(uint32_t *seed) {
+  switch (task_rand(seed) % 4) {
+    case 0:
+      return task_rand(seed) % 4;
+    case 1:
+      return task_rand(seed) % 30;
+    default:
+      return SERIAL_TIMEOUT_FOREVER;
+  }
+}
+
+static void count(uint32_t *n) { __atomic_fetch_add(n, 1, __ATOMIC_RELAXED); }
+
+/* the bytes of a finished read came from the stream, at the offset the driver took them from */
+static void rx_check(const uint8_t *buf, size_t done) {
+  uint64_t offset;
+  int32_t i;
+
+  if (done) {
+    alt_osal_enter_critical();
+    for (i = numRxLog - 1; i >= 0 && rxLog[i].buf != buf; i--) {
+    }
+    CHECK(i >= 0 && rxLog[i].count == done);
+    offset = rxLog[i].offset;
+    alt_osal_exit_critical(0);
+    for (i = 0; i < (int32_t)done; i++) CHECK(buf[i] == stream_byte(offset + i));
+  }
+  pthread_mutex_lock(&totalMtx);
+  rxTotal += done;
+  pthread_mutex_unlock(&totalMtx);
+}
+
+static void async_done(serial_handle handle, serial_request *req) {
+  struct areq *a = req->user_data;
+
+  CHECK(handle == port);
+  a->finishTick = alt_osal_get_tick_count();
+  CHECK(__atomic_fetch_add(&a->finished, 1, __ATOMIC_RELEASE) == 0);
+}
+
+/* a finished asynchronous request ended the way its history allows */
+static void async_check(struct areq *a) {
+  serial_request *req = &a->req;
+
+  CHECK(req->done <= req->len);
+  switch (req->status) {
+    case SERIAL_REQ_COMPLETE:
+      CHECK(req->done == req->len);
+      break;
+    case SERIAL_REQ_TIMEOUT:
+      CHECK(req->timeout != SERIAL_TIMEOUT_FOREVER);
+      CHECK((int32_t)(a->finishTick - req->deadline) >= 0);
+      count(&numTimeouts);
+      break;
+    case SERIAL_REQ_ABORTED:
+      CHECK(a->cancelled || closing);
+      count(&numAborts);
+      break;
+    default:
+      CHECK(0);
+  }
+}
+
+/* queue a batch, cancel some, wait for all of it by callback or by polling */
+static void async_batch(uint32_t *seed, Serial_Dir dir, uint32_t writer, uint32_t *seq,
+                        struct areq *batch) {
+  uint32_t num = task_rand(seed) % MAX_BATCH + 1, left, i, j;
+  struct areq *a;
+  int32_t ret;
+
+  for (i = 0; i < num; i++) {
+    a = &batch[i];
+    memset(&a->req, 0, sizeof(a->req));
+    a->req.buf = a->buf;
+    a->req.len = dir == SERIAL_DIR_TX ? 4 + task_rand(seed) % (MAX_LEN - 3)
+                                      : 1 + task_rand(seed) % MAX_LEN;
+    a->req.timeout = task_timeout(seed);
+    a->req.callback = task_rand(seed) % 2 ? async_done : NULL;
+    a->req.user_data = a;
+    a->cancelled = a->finished = 0;
+    if (dir == SERIAL_DIR_TX) {
+      CHECK(*seq < MAX_SEQ);
+      for (j = 0; j < a->req.len; j++) a->buf[j] = msg_byte(writer << 24 | *seq, j);
+      ret = serial_write_async(port, &a->req);
+    } else {
+      ret = serial_read_async(port, &a->req);
+    }
+    a->submitted = ret == 0;
+    if (!a->submitted) {
+      CHECK(closing);
+    } else {
+      count(&numAsync);
+      if (dir == SERIAL_DIR_TX) txDone[writer][*seq] = 0;
+    }
+    if (dir == SERIAL_DIR_TX) ++*seq;
+  }
+
+  do {
+    left = 0;
+    for (i = 0; i < num; i++) {
+      a = &batch[i];
+      if (!a->submitted || a->finished == NOT_DONE) continue;
+      if (!a->cancelled && task_rand(seed) % 16 == 0) {
+        a->cancelled = 1;
+        count(&numCancels);
+        serial_cancel(port, &a->req);
+      }
+      if (a->req.callback) {
+        if (!__atomic_load_n(&a->finished, __ATOMIC_ACQUIRE)) {
+          left++;
+          continue;
+        }
+      } else if (serial_poll(port, &a->req) <= SERIAL_REQ_ACTIVE) {
+        left++;
+        continue;
+      } else {
+        a->finishTick = alt_osal_get_tick_count();
+      }
+      async_check(a);
+      if (dir == SERIAL_DIR_TX) {
+        txDone[writer][(a->buf[0] | a->buf[1] << 8 | a->buf[2] << 16) & 0xFFFFFF] = a->req.done;
+      } else {
+        rx_check(a->buf, a->req.done);
+      }
+      memset(a->buf, 0xEE, sizeof(a->buf));  // a driver still at it shows on the line or the log
+      a->finished = NOT_DONE;
+    }
+    if (left) usleep(task_rand(seed) % 500);
+  } while (left);
+}
+
+static void *writer_task(void *arg) {
+  static uint8_t bufs[NUM_WRITERS][MAX_LEN];
+  static struct areq batches[NUM_WRITERS][MAX_BATCH];
+  struct task self;
+  uint32_t w = (uintptr_t)arg, seed = writerSeed[w], seq = writerSeq[w], len, timeout, start, i;
+  uint8_t *buf = bufs[w];
+  size_t done;
+
+  task_init(&self);
+  while (!closing) {
+    if (task_rand(&seed) % 2) {
+      async_batch(&seed, SERIAL_DIR_TX, w, &seq, batches[w]);
+      continue;
+    }
+    CHECK(seq < MAX_SEQ);
+    len = 4 + task_rand(&seed) % (MAX_LEN - 3);
+    for (i = 0; i < len; i++) buf[i] = msg_byte(w << 24 | seq, i);
+    timeout = task_timeout(&seed);
+    start = alt_osal_get_tick_count();
+    done = serial_write_timeout(port, buf, len, timeout);
+    CHECK(done <= len);
+    if (done < len && !closing) {
+      CHECK(timeout != SERIAL_TIMEOUT_FOREVER && alt_osal_get_tick_count() - start >= timeout);
+    }
+    txDone[w][seq++] = done;  // 0 as well when refused on closing, the line has none of it then
+    count(&numBlocking);
+    memset(buf, 0xEE, len);
+  }
+  writerSeed[w] = seed;
+  writerSeq[w] = seq;
+  return NULL;
+}
+
+static void *reader_task(void *arg) {
+  static uint8_t bufs[NUM_READERS][MAX_LEN];
+  static struct areq batches[NUM_READERS][MAX_BATCH];
+  struct task self;
+  uint32_t r = (uintptr_t)arg, seed = readerSeed[r], len, timeout, start;
+  uint8_t *buf = bufs[r];
+  size_t done;
+
+  task_init(&self);
+  while (!closing) {
+    if (task_rand(&seed) % 2) {
+      async_batch(&seed, SERIAL_DIR_RX, 0, NULL, batches[r]);
+      continue;
+    }
+    len = 1 + task_rand(&seed) % MAX_LEN;
+    timeout = task_timeout(&seed);
+    start = alt_osal_get_tick_count();
+    done = timeout == SERIAL_TIMEOUT_FOREVER ? serial_read(port, buf, len)
+                                             : serial_read_timeout(port, buf, len, timeout);
+    CHECK(done <= len);
+    if (done < len && !closing) {
+      CHECK(timeout != SERIAL_TIMEOUT_FOREVER && alt_osal_get_tick_count() - start >= timeout);
+    }
+    rx_check(buf, done);
+    count(&numBlocking);
+    memset(buf, 0xEE, len);
+  }
+  readerSeed[r] = seed;
+  return NULL;
+}
+
+static void *sim_map(uintptr_t start, size_t len) {
+  return mmap((void *)start, len, PROT_READ | PROT_WRITE,
+              MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+}
+
+int main(void) {
+  pthread_t timerThread, irqThread, peerThread, workers[NUM_WRITERS + NUM_READERS];
+  pthread_mutexattr_t attr;
+  struct task self;
+  sSerialCounters counters;
+  serial_request late;
+  uint64_t rxSum = 0;
+  uint32_t lastSeq[NUM_WRITERS], pos = 0, txSum = 0, seed = 1, round, id, w, seq, i, j;
+  int fds[2], size = 4096;
+
+  alarm(60);  // a request that never finishes hangs a join
+  CHECK(sim_map(0x1000000, 0x1000) == (void *)0x1000000);  // UARTF0_CFG
+  CHECK(sim_map(0xE000E000, 0x1000) == (void *)0xE000E000);  // NVIC
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);  // nests like taskENTER_CRITICAL
+  pthread_mutex_init(&critical, &attr);
+  task_init(&self);
+  memset(txDone, 0xFF, sizeof(txDone));
+
+  // small socket buffers, so stalls of either side reach the other soon
+  CHECK(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+  for (i = 0; i < 2; i++) {
+    setsockopt(fds[i], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    setsockopt(fds[i], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  }
+  drv.fd = fds[0];
+  peer.fd = fds[1];
+  CHECK(pthread_create(&timerThread, NULL, timer_task, NULL) == 0);
+  CHECK(pthread_create(&irqThread, NULL, irq_task, NULL) == 0);
+  CHECK(pthread_create(&peerThread, NULL, peer_task, NULL) == 0);
+
+  for (i = 0; i < NUM_WRITERS; i++) writerSeed[i] = 77 + i;
+  for (i = 0; i < NUM_READERS; i++) readerSeed[i] = 99 + i;
+  memset(&late, 0, sizeof(late));
+  late.buf = &late;
+  late.len = 1;
+  for (round = 0; round < NUM_ROUNDS; round++) {
+    port = serial_open(ACTIVE_UARTF0);
+    CHECK(port != NULL && drv.open);
+    for (i = 0; i < NUM_WRITERS; i++) {
+      CHECK(pthread_create(&workers[i], NULL, writer_task, (void *)(uintptr_t)i) == 0);
+    }
+    for (i = 0; i < NUM_READERS; i++) {
+      CHECK(pthread_create(&workers[NUM_WRITERS + i], NULL, reader_task, (void *)(uintptr_t)i) ==
+            0);
+    }
+
+    // close with every task busy on the port
+    usleep((RUN_MS / NUM_ROUNDS / 2 + task_rand(&seed) % (RUN_MS / NUM_ROUNDS)) * 1000);
+    closing = 1;
+    CHECK(serial_close(port) == 0);
+    CHECK(!drv.open);
+    CHECK(serial_write_async(port, &late) != 0 && serial_read_async(port, &late) != 0);
+    for (i = 0; i < NUM_WRITERS + NUM_READERS; i++) pthread_join(workers[i], NULL);
+    closing = 0;
+  }
+  CHECK(drv.opens == NUM_ROUNDS);
+
+  alt_osal_enter_critical();
+  drv.quit = 1;
+  alt_osal_exit_critical(0);
+  pthread_join(irqThread, NULL);
+  peer.quit = 1;
+  pthread_join(peerThread, NULL);
+  pthread_mutex_lock(&timer.mtx);
+  timer.quit = 1;
+  pthread_cond_signal(&timer.cond);
+  pthread_mutex_unlock(&timer.mtx);
+  pthread_join(timerThread, NULL);
+
+  // the line: each write up to what it reported, one task's writes in its order
+  memset(lastSeq, 0xFF, sizeof(lastSeq));
+  for (i = 0; i < numTxLog; i++) {
+    id = txLog[i].id;
+    w = id >> 24;
+    seq = id & 0xFFFFFF;
+    CHECK(w < NUM_WRITERS && seq < MAX_SEQ);
+    CHECK(lastSeq[w] == NOT_DONE || seq > lastSeq[w]);
+    lastSeq[w] = seq;
+    CHECK(txLog[i].count == txDone[w][seq]);
+    CHECK(pos + txLog[i].count <= peer.lineLen);
+    for (j = 0; j < txLog[i].count; j++) CHECK(peer.line[pos + j] == msg_byte(id, j));
+    pos += txLog[i].count;
+  }
+  CHECK(pos == peer.lineLen);
+  for (w = 0; w < NUM_WRITERS; w++) {
+    for (seq = 0; seq < MAX_SEQ; seq++) txSum += txDone[w][seq] != NOT_DONE ? txDone[w][seq] : 0;
+  }
+  CHECK(txSum == pos);
+
+  // the reads tile the received stream
+  for (i = 0; i + 1 < numRxLog; i++) CHECK(rxLog[i].offset + rxLog[i].count == rxLog[i + 1].offset);
+  for (i = 0; i < numRxLog; i++) rxSum += rxLog[i].count;
+  CHECK(numRxLog == 0 || rxLog[numRxLog - 1].offset + rxLog[numRxLog - 1].count == drv.rxOffset);
+  CHECK(rxSum == drv.rxOffset && rxTotal == drv.rxOffset);
+
+  CHECK(serial_get_counters(port, &counters) == 0);
+  CHECK(counters.tx_bytes == pos && counters.rx_bytes == drv.rxOffset);
+  CHECK(counters.timeouts >= numTimeouts && counters.aborts >= numAborts);
+
+  printf("serial: ok, %u rounds, %u blocking and %u asynchronous requests, %u cancels, "
+         "%u timeouts, %u aborts, %u bytes out, %llu in, %u interface retries, %u timer runs\n",
+         NUM_ROUNDS, numBlocking, numAsync, numCancels, counters.timeouts, counters.aborts, pos,
+         (unsigned long long)drv.rxOffset, drv.hifcDown, timer.fired);
+  return 0;
+}
@@ -0,0 +1,287 @@
+/*
+  Deferred format logging: utils/sfpdecode.py on entries sfp_log_fmt() stores, and throughput.
+
+  The binary is not position independent, so format strings sit below 4 GB and their addresses
+  fit the entries as on the MCU. A mix of sfp_log_fmt(), sfp_log_hash() and sfp_log_str() entries
+  goes to a database whose raw image is decoded by sfpdecode.py, with an ELF32 file holding the
+  strings at their addresses for a dictionary and a .sfpmap of the file hashes. Then:
+  - every entry decodes to the line expected from the host printf of its format and arguments,
+    the name and line of its file, or its text, in the order logged;
+  - the report gives calls per second and bytes per entry of sfp_log_fmt() against
+    sfp_log_formatted(), and entries per second of sfpdecode.py on a database of 1 MB, the start
+    of the interpreter included.
+*/
+#include <unistd.h>
+
+#include "../../middleware/sfplogger/sfplogger.c"
+#include "hosttest.h"
+
+#define DB_SIZE (64 * 1024)
+#define BENCH_DB_SIZE (1024 * 1024)
+#define BENCH_CALLS (1000000)
+#define MAX_LINE (256)
+#define NUM_FILES (4)
+
+struct format {
+  const char *format;
+  const char *args;  // d: any word, c: a printable character, s: a string of strPool
+};
+
+static const struct format formats[] = {
+    {"boot", ""},
+    {"rx %d bytes from %s, rssi %d", "dsd"},
+    {"state %u -> %u", "dd"},
+    {"addr %#x len %#X mask %#010x", "ddd"},
+    {"%5d|%-5d|%05d|% d|%+d|%.3d", "dddddd"},
+    {"%x %X %o %#o %#x", "ddddd"},
+    {"char '%c' is %d%%", "cd"},
+    {"%hd %hu %hhd %hhx", "dddd"},
+    {"%10s|%-10s|%.2s", "sss"},
+    {"%i %lu %lx", "ddd"},
+    {"six %d %d %d %d %d %d", "dddddd"},
+    {"trailing spaces %d   ", "d"},
+};
+
+static const char *const strPool[] = {"", "modem", "a longer string, with a comma", "%d"};
+
+static const char *const files[NUM_FILES] = {"../../middleware/serial/serial.c",
+                                             "../../middleware/sfplogger/sfplogger.c",
+                                             "../../applib/main.c", "x.c"};
+
+static uint32_t tick;
+static char dir[] = "/tmp/sfplogXXXXXX";
+static char (*expected)[MAX_LINE];
+static size_t numExpected;
+
+/* FreeRTOS, OSAL and ALTCOM as far as the logger uses them */
+void vPortEnterCritical(void) {}
+
+void vPortExitCritical(void) {}
+
+uint32_t alt_osal_get_tick_count(void) { return tick; }
+
+static char *path(const char *name) {
+  static char p[sizeof(dir) + 32];
+
+  snprintf(p, sizeof(p), "%s/%s", dir, name);
+  return p;
+}
+
+/* an ELF32 file holding [lo, hi) of this image at its address */
+static void write_elf(uintptr_t lo, uintptr_t hi) {
+  uint8_t ehdr[52] = {0x7f, 'E', 'L', 'F', 1, 1, 1};
+  uint32_t shdr[2][10] = {{0}, {0, 1, 2, (uint32_t)lo, sizeof(ehdr) + sizeof(shdr),
+                                (uint32_t)(hi - lo)}};
+  uint32_t shoff = sizeof(ehdr);
+  uint16_t half[] = {2, 40, 52, 0, 0, 40, 2, 0};  // type, machine, ehsize to shstrndx
+  FILE *f = fopen(path("app.elf"), "wb");
+
+  CHECK(f != NULL);
+  memcpy(ehdr + 16, half, 4);
+  ehdr[20] = 1;  // version
+  memcpy(ehdr + 0x20, &shoff, 4);
+  memcpy(ehdr + 0x28, half + 2, 12);
+  CHECK(fwrite(ehdr, sizeof(ehdr), 1, f) == 1 && fwrite(shdr, sizeof(shdr), 1, f) == 1);
+  CHECK(fwrite((const void *)lo, hi - lo, 1, f) == 1);
+  fclose(f);
+}
+
+static void write_dictionary(void) {
+  uintptr_t lo = UINTPTR_MAX, hi = 0, a;
+  size_t i;
+  FILE *f;
+
+  for (i = 0; i < sizeof(formats) / sizeof(formats[0]) + sizeof(strPool) / sizeof(strPool[0]);
+       i++) {
+    a = (uintptr_t)(i < sizeof(formats) / sizeof(formats[0])
+                        ? formats[i].format
+                        : strPool[i - sizeof(formats) / sizeof(formats[0])]);
+    CHECK(a < 0x100000000ULL);
+    if (a < lo) lo = a;
+    if (a + strlen((const char *)a) + 1 > hi) hi = a + strlen((const char *)a) + 1;
+  }
+  write_elf(lo, hi);
+
+  f = fopen(path("app.sfpmap"), "w");
+  CHECK(f != NULL);
+  for (i = 0; i < NUM_FILES; i++)
+    fprintf(f, "0x%05x %s\n", sfp_calc_hash_from_filename((void *)files[i]) & 0xFFFFF, files[i]);
+  fclose(f);
+}
+
+static void use_db(unsigned int size) {
+  free(sfpdbasearr[0].sfpdbp);
+  memset(&sfpdbasearr[0], 0, sizeof(sfpdbasearr[0]));
+  sfpdbasearr[0].sfpdbp = calloc(1, size);
+  CHECK(sfpdbasearr[0].sfpdbp != NULL);
+  sfpdbasearr[0].buffer_size = size;
+  numExpected = 0;
+}
+
+static char *expect(void) {
+  CHECK(expected != NULL);
+  return expected[numExpected++];
+}
+
+static void rstrip(char *s) {
+  size_t n = strlen(s);
+
+  while (n > 0 && s[n - 1] == ' ') s[--n] = '\0';
+}
+
+/* one entry of a random kind, and the line sfpdecode.py should print for it */
+static void log_one(void) {
+  const struct format *f = &formats[ht_rand() % (sizeof(formats) / sizeof(formats[0]))];
+  unsigned int sev = ht_rand() % SFPLOG_SEVERITY_NUM, line, hash, i;
+  uintptr_t a[SFPLOG_FMT_MAX_ARGS] = {0};
+  char text[MAX_LINE / 2], *e = expect();
+  const char *name;
+  int p[3];
+
+  tick += ht_range(0, 3000);
+  switch (ht_rand() % 4) {
+    case 0:
+      name = files[ht_rand() % NUM_FILES];
+      hash = sfp_calc_hash_from_filename((void *)name);
+      line = ht_rand() % 4 ? ht_range(1, 0x7ff) : ht_range(0x800, 50000);
+      for (i = 0; i < 3; i++) p[i] = (int)(ht_rand() ^ (ht_rand() << 16));
+      CHECK(sfp_log_hash(p[0], p[1], p[2], (sev << 28) | SFPLOG_TRACE, line, hash) == 0);
+      snprintf(e, MAX_LINE, "%u.%03u %s:%u %d %d %d", tick / 1000, tick % 1000, name, line, p[0],
+               p[1], p[2]);
+      break;
+    case 1:
+      snprintf(text, sizeof(text), "string entry %u of %s", ht_rand(), strPool[ht_rand() % 4]);
+      CHECK(sfp_log_str(SFPLOG_TRACE, sev, text) == 0);
+      rstrip(text);
+      snprintf(e, MAX_LINE, "%u.%03u %s %s", tick / 1000, tick % 1000, spfprintseverarr[sev],
+               text);
+      break;
+    default:
+      for (i = 0; f->args[i]; i++) {
+        if (f->args[i] == 's') {
+          a[i] = (uintptr_t)strPool[ht_rand() % (sizeof(strPool) / sizeof(strPool[0]))];
+        } else if (f->args[i] == 'c') {
+          a[i] = ht_range(' ', '~');
+        } else {
+          a[i] = ht_rand() % 3 ? ht_rand() ^ (ht_rand() << 16) : ht_range(0, 20);
+        }
+      }
+      CHECK(sfp_log_fmt(SFPLOG_TRACE, sev, f->format, i, (unsigned int)a[0], (unsigned int)a[1],
+                        (unsigned int)a[2], (unsigned int)a[3], (unsigned int)a[4],
+                        (unsigned int)a[5]) == 0);
+      // 32-bit words widened as they are, the same bits on the stack of the MCU
+      snprintf(text, sizeof(text), f->format, a[0], a[1], a[2], a[3], a[4], a[5]);
+      rstrip(text);
+      snprintf(e, MAX_LINE, "%u.%03u %s %s", tick / 1000, tick % 1000, spfprintseverarr[sev],
+               text);
+      break;
+  }
+}
+
+/* fill the database short of a wrap */
+static void fill(void) {
+  spflogdbentry_t *db = &sfpdbasearr[0];
+
+  tick = 0;
+  while (db->next_entry_delta + SFPLOG_STRING_ENTRYHEADER_SIZE + SFPLOG_STRING_DATA_MAX_SIZE <
+         db->buffer_size)
+    log_one();
+}
+
+/* decode the database with sfpdecode.py, the time it took in ns */
+static uint64_t decode(int check) {
+  char cmd[512], line[MAX_LINE + 64];
+  uint64_t t;
+  size_t n = 0;
+  FILE *f = fopen(path("db.bin"), "wb");
+
+  CHECK(f != NULL);
+  CHECK(fwrite(sfpdbasearr[0].sfpdbp, sfpdbasearr[0].buffer_size, 1, f) == 1);
+  fclose(f);
+  // one path() at a time, it returns the same buffer
+  snprintf(cmd, sizeof(cmd), "%s --raw %s", SFPDECODE, path("db.bin"));
+  snprintf(cmd + strlen(cmd), sizeof(cmd) - strlen(cmd), " --elf %s", path("app.elf"));
+  snprintf(cmd + strlen(cmd), sizeof(cmd) - strlen(cmd), " --map %s", path("app.sfpmap"));
+
+  t = ht_now_ns();
+  f = popen(cmd, "r");
+  CHECK(f != NULL);
+  while (fgets(line, sizeof(line), f) != NULL) {
+    line[strcspn(line, "\n")] = '\0';
+    CHECK(n < numExpected);
+    if (check && strcmp(line, expected[n]) != 0) {
+      fprintf(stderr, "entry %u\n  decoded  '%s'\n  expected '%s'\n", (unsigned)n, line,
+              expected[n]);
+      CHECK(0);
+    }
+    n++;
+  }
+  CHECK(pclose(f) == 0);
+  t = ht_now_ns() - t;
+  CHECK(n == numExpected);
+  return t;
+}
+
+/* calls per second of a message logged deferred and formatted, and the bytes it takes */
+static void bench_log(void) {
+  static const char format[] = "rx %d bytes from %s, rssi %d";
+  unsigned int before, fmtBytes, strBytes;
+  uint64_t t, tFmt, tStr;
+  uint32_t i;
+
+  use_db(BENCH_DB_SIZE);
+  before = sfpdbasearr[0].written;
+  t = ht_now_ns();
+  for (i = 0; i < BENCH_CALLS; i++)
+    sfp_log_fmt(SFPLOG_TRACE, SFPLOG_INFO, format, 3, i, (unsigned int)(uintptr_t)"modem", -70);
+  tFmt = ht_now_ns() - t;
+  fmtBytes = (sfpdbasearr[0].written - before) / BENCH_CALLS;
+
+  before = sfpdbasearr[0].written;
+  t = ht_now_ns();
+  for (i = 0; i < BENCH_CALLS; i++)
+    sfp_log_formatted(SFPLOG_TRACE, SFPLOG_INFO, format, i, "modem", -70);
+  tStr = ht_now_ns() - t;
+  strBytes = (sfpdbasearr[0].written - before) / BENCH_CALLS;
+
+  printf("  \"%s\" per call:\n", format);
+  printf("    sfp_log_fmt()       %5.1f M calls/s, %u bytes\n", BENCH_CALLS * 1e3 / tFmt, fmtBytes);
+  printf("    sfp_log_formatted() %5.1f M calls/s, %u bytes\n", BENCH_CALLS * 1e3 / tStr, strBytes);
+}
+
+int main(void) {
+  uint64_t t;
+  int round;
+
+  CHECK(mkdtemp(dir) != NULL);
+  write_dictionary();
+  sfplogmodarr[SFPLOG_TRACE].dbid = 0;
+  sfplogmodarr[SFPLOG_TRACE].severity = SFPLOG_VERBOSE;
+
+  expected = malloc(DB_SIZE / SFPLOG_COMPLEX_STRING_ENTRYHEADER_SIZE_PLUS_NULL_TERM *
+                    sizeof(*expected));
+  for (round = 0; round < 3; round++) {
+    use_db(DB_SIZE);
+    fill();
+    decode(1);
+  }
+  printf("sfplog fmt: ok, %u entries of each of 3 databases decoded as logged\n",
+         (unsigned)numExpected);
+  free(expected);
+
+  expected = malloc(BENCH_DB_SIZE / SFPLOG_COMPLEX_STRING_ENTRYHEADER_SIZE_PLUS_NULL_TERM *
+                    sizeof(*expected));
+  use_db(BENCH_DB_SIZE);
+  fill();
+  t = decode(0);
+  printf("  sfpdecode.py: %u entries of %u KB in %.2f s, %.0f entries/s\n", (unsigned)numExpected,
+         BENCH_DB_SIZE / 1024, t / 1e9, numExpected * 1e9 / t);
+  free(expected);
+  bench_log();
+
+  unlink(path("db.bin"));
+  unlink(path("app.elf"));
+  unlink(path("app.sfpmap"));
+  rmdir(dir);
+  return 0;
+}
@@ -0,0 +1,191 @@
+/*
+  File name hash of sfp_log: utils/sfphash.py against sfp_calc_hash_from_filename(), and the cost
+  of a log call with the hash from the build.
+
+  This file is built with SFP_FILE_HASH from sfphash.py, as the sfplogger component builds every
+  C file. Then:
+  - sfphash.py gives the hash sfp_calc_hash_from_filename() gives, on names around the three path
+    components it reads and on every C file and header of the tree, named as make passes them
+    and with their absolute path;
+  - SFP_FILE_HASH is the hash of __FILE__, and sfp_log() and sfp_log_hash() store the same
+    regular and extended entries;
+  - the report gives calls per second of a log call stored and filtered out: hashing the name
+    first as sfp_log() used to, sfp_log() as it is, and SFP_LOG_3 with the hash from the build.
+*/
+#define _XOPEN_SOURCE 700
+#include <ftw.h>
+#include <limits.h>
+#include <string.h>
+
+#include "../../middleware/sfplogger/sfplogger.c"
+#include "hosttest.h"
+
+#define MAX_PATHS (8192)
+#define DB_SIZE (SFPLOG_DB_SIZE)
+#define BENCH_CALLS (2000000)
+#define LONG_NAME "../../middleware/altcomlib/altcom/api/mbedtls/ssl_read.c"
+
+static uint32_t tick;
+static char *paths[MAX_PATHS];
+static size_t numPaths;
+
+/* FreeRTOS and OSAL as far as sfp_log uses them */
+void vPortEnterCritical(void) {}
+
+void vPortExitCritical(void) {}
+
+uint32_t alt_osal_get_tick_count(void) { return tick; }
+
+static void add_path(const char *path) {
+  CHECK(numPaths < MAX_PATHS);
+  paths[numPaths] = strdup(path);
+  CHECK(paths[numPaths] != NULL);
+  numPaths++;
+}
+
+/* a source or header of the tree, absolute and as make names it from the root */
+static int add_source(const char *path, const struct stat *sb, int type, struct FTW *ftw) {
+  size_t len = strlen(path);
+  char rel[PATH_MAX];
+
+  (void)sb;
+  (void)ftw;
+  if (type == FTW_F && len > 2 && path[len - 2] == '.' && (path[len - 1] == 'c' ||
+                                                           path[len - 1] == 'h')) {
+    add_path(path);
+    snprintf(rel, sizeof(rel), "../../%s", path + strlen(SFP_ROOT) + 1);
+    add_path(rel);
+  }
+  return 0;
+}
+
+/* hash paths from first on with one run of sfphash.py, as many as fit its command line */
+static size_t run_sfphash(size_t first) {
+  static char cmd[64 * 1024];
+  char line[64];
+  size_t i, at;
+  uint32_t want;
+  FILE *out;
+
+  at = snprintf(cmd, sizeof(cmd), "%s", SFPHASH);
+  for (i = first; i < numPaths && at + strlen(paths[i]) + 4 < sizeof(cmd); i++) {
+    CHECK(strchr(paths[i], '\'') == NULL);
+    at += sprintf(cmd + at, " '%s'", paths[i]);
+  }
+  out = popen(cmd, "r");
+  CHECK(out != NULL);
+  for (; first < i; first++) {
+    CHECK(fgets(line, sizeof(line), out) != NULL);
+    want = sfp_calc_hash_from_filename(paths[first]) & 0xFFFFF;
+    if (strtoul(line, NULL, 16) != want) {
+      fprintf(stderr, "%s: sfphash.py %s", paths[first], line);
+      CHECK(0);
+    }
+  }
+  CHECK(fgets(line, sizeof(line), out) == NULL);
+  CHECK(pclose(out) == 0);
+  return i;
+}
+
+static void check_sfphash(void) {
+  static const char *const names[] = {
+      "", "c", ".c", "a.c", "/a.c", "a/b.c", "/a/b.c", "a/b/c.c", "/a/b/c.c", "a/b/c/d.c",
+      "/a/b/c/d.c", "x/y/a/b/c/d.c", "a//b.c", "///", "./a.c", "../a.c", "...", "a/../b/./c.c",
+      "src.v1.2/file.name.c", "~/tilde_and_UPPER/Z.c", "main.cpp", "startup.S"};
+  char long_name[400];
+  size_t i;
+
+  for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) add_path(names[i]);
+  // sums past the modulus
+  memset(long_name, 'z', sizeof(long_name) - 1);
+  long_name[sizeof(long_name) - 1] = '\0';
+  add_path(long_name);
+  long_name[150] = '/';
+  long_name[300] = '/';
+  add_path(long_name);
+  CHECK(nftw(SFP_ROOT, add_source, 16, FTW_PHYS) == 0);
+
+  for (i = 0; i < numPaths;) i = run_sfphash(i);
+}
+
+static spflogdbentry_t *db(void) { return &sfpdbasearr[(int)sfplogmodarr[SFPLOG_TRACE].dbid]; }
+
+static const char *last_entry(unsigned int size) {
+  return db()->sfpdbp + db()->next_entry_delta - size;
+}
+
+/* both calls store the same entry, extended from line 0x800 on */
+static void check_entries(void) {
+  char want[SFPLOG_EXTENDED_ENTRY_SIZE];
+  unsigned int sev = (SFPLOG_DEBUG << 28) | SFPLOG_TRACE, line, size, word;
+
+  CHECK(SFP_FILE_HASH == (sfp_calc_hash_from_filename(__FILE__) & 0xFFFFF));
+  for (line = 1; line < 0x1000; line += ht_range(1, 97)) {
+    size = line > 0x7ff ? SFPLOG_EXTENDED_ENTRY_SIZE : SFPLOG_ENTRY_SIZE;
+    tick = ht_rand();
+    CHECK(sfp_log(-1, line, 3, sev, line, __FILE__) == 0);
+    memcpy(want, last_entry(size), size);
+    CHECK(sfp_log_hash(-1, line, 3, sev, line, SFP_FILE_HASH) == 0);
+    CHECK(memcmp(last_entry(size), want, size) == 0);
+    memcpy(&word, want, 4);
+    // the type bits of the first byte cover bit 7 of the hash, and bit 6 in extended entries
+    CHECK((word & (size == SFPLOG_ENTRY_SIZE ? 0xFFF7F : 0xFFF3F)) ==
+          (SFP_FILE_HASH & (size == SFPLOG_ENTRY_SIZE ? 0xFFF7F : 0xFFF3F)));
+  }
+  SFP_LOG_3_DEBUG(SFPLOG_TRACE, "entry", 1, 2, 3);
+  line = __LINE__ - 1;
+  memcpy(&word, last_entry(SFPLOG_ENTRY_SIZE), 4);
+  CHECK(word >> 20 == line && (word & 0xFFF7F) == (SFP_FILE_HASH & 0xFFF7F));
+}
+
+/* calls per second of one way of logging */
+enum way { HASH_FIRST, SFP_LOG, BUILD_HASH };
+
+static double bench(enum way way, const char *name, unsigned int severity) {
+  unsigned int sev = (severity << 28) | SFPLOG_TRACE;
+  uint64_t t = ht_now_ns();
+  uint32_t i;
+
+  for (i = 0; i < BENCH_CALLS; i++) {
+    switch (way) {
+      case HASH_FIRST:
+        sfp_log_hash(i, 2, 3, sev, __LINE__, sfp_calc_hash_from_filename((void *)name));
+        break;
+      case SFP_LOG:
+        sfp_log(i, 2, 3, sev, __LINE__, (void *)name);
+        break;
+      default:
+        SFP_LOG_CALL(i, 2, 3, sev);
+        break;
+    }
+  }
+  return BENCH_CALLS * 1e9 / (ht_now_ns() - t);
+}
+
+int main(void) {
+  static const struct {
+    const char *what;
+    unsigned int severity;
+  } rows[] = {{"stored", SFPLOG_DEBUG}, {"filtered out", SFPLOG_VERBOSE}};
+  size_t r;
+
+  sfpdbasearr[0].sfpdbp = calloc(1, DB_SIZE);
+  CHECK(sfpdbasearr[0].sfpdbp != NULL);
+  sfpdbasearr[0].buffer_size = DB_SIZE;
+  sfplogmodarr[SFPLOG_TRACE].dbid = 0;
+  sfplogmodarr[SFPLOG_TRACE].severity = SFPLOG_DEBUG;
+
+  check_sfphash();
+  check_entries();
+
+  printf("sfplog hash: ok, sfphash.py agrees on %u names, entries the same with SFP_FILE_HASH\n",
+         (unsigned)numPaths);
+  printf("  calls per second, file name of %u characters:\n", (unsigned)strlen(LONG_NAME));
+  for (r = 0; r < sizeof(rows) / sizeof(rows[0]); r++) {
+    printf("    %-12s hash, then filter %5.1f M, sfp_log() %5.1f M, build-time hash %5.1f M\n",
+           rows[r].what, bench(HASH_FIRST, LONG_NAME, rows[r].severity) / 1e6,
+           bench(SFP_LOG, LONG_NAME, rows[r].severity) / 1e6,
+           bench(BUILD_HASH, LONG_NAME, rows[r].severity) / 1e6);
+  }
+  return 0;
+}
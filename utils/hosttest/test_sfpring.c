@@ -0,0 +1,309 @@
+/*
+  SFP log task rings: sfpring.c with its producers and merger as host threads.
+
+  Task producers log through sfpring_put() in waves, each task handing its ring back through
+  sfpring_task_deleted() when it ends, so the next wave takes rings over. Interrupt producers run
+  in parallel on the interrupt ring, which is harder on its slot claim than nested interrupts are.
+  When a ring is full the producer stores the entry directly, as sfp_log_fmt() does. The merger task
+  runs as it does on target and main merges as well, as the CLI does. One task is cut off between
+  claiming a slot and publishing it, then deleted. Then:
+  - every entry reached the database exactly once, through the merge or directly, except the one
+    cut off, and the direct ones are the overflows sfpring counted;
+  - the merged entries of each producer are in the order it logged them, and the merged time
+    stamps never go back;
+  - the rings are empty at the end.
+  The report gives how many entries were merged ahead of one logged before them, which the merge
+  allows when it scans a ring before a producer publishes into it.
+*/
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../middleware/sfplogger/sfpring.c"
+#include "hosttest.h"
+
+#define NUM_TASKS (6)
+#define NUM_WAVES (3)
+#define NUM_ISRS (2)
+#define NUM_PRODUCERS (NUM_TASKS * NUM_WAVES + NUM_ISRS + 1)
+#define CUT_PRODUCER (NUM_PRODUCERS - 1)
+#define NUM_ENTRIES (20000)
+#define CUT_AT (5)
+#define MAX_STORED (NUM_PRODUCERS * NUM_ENTRIES)
+
+char sfpPreventEntries;
+
+static struct timespec t0;
+
+/* OSAL and FreeRTOS on pthreads */
+struct task {
+  pthread_mutex_t mtx;
+  pthread_cond_t cond;
+  uint32_t flags;
+  void (*function)(void *arg);
+  void *arg;
+};
+
+static __thread struct task *curTask;
+static __thread int inIrq, producer = -1;
+static __thread uint32_t ticksLeft;  // tick reads before a cut producer stops for good
+
+static struct task *task_new(void (*function)(void *arg), void *arg) {
+  struct task *t = calloc(1, sizeof(*t));
+
+  pthread_mutex_init(&t->mtx, NULL);
+  pthread_cond_init(&t->cond, NULL);
+  t->function = function;
+  t->arg = arg;
+  return t;
+}
+
+BaseType_t xTaskGetSchedulerState(void) { return taskSCHEDULER_RUNNING; }
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return (TaskHandle_t)curTask; }
+
+uint32_t alt_osal_irq_context(void) { return inIrq; }
+
+static volatile int cutParked;
+static struct task *cutTask;
+
+uint32_t alt_osal_get_tick_count(void) {
+  struct timespec t;
+
+  // sfpring_put reads the tick between the claim of a slot and its publication
+  if (ticksLeft && --ticksLeft == 0) {
+    cutParked = 1;
+    for (;;) pause();
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint32_t)((t.tv_sec - t0.tv_sec) * 1000 + (t.tv_nsec - t0.tv_nsec) / 1000000);
+}
+
+int32_t alt_osal_set_taskflag(alt_osal_task_handle handle, uint32_t flags) {
+  struct task *t = handle;
+
+  pthread_mutex_lock(&t->mtx);
+  t->flags |= flags;
+  pthread_cond_signal(&t->cond);
+  pthread_mutex_unlock(&t->mtx);
+  return 0;
+}
+
+int32_t alt_osal_wait_taskflag(uint32_t flags, uint32_t options, uint32_t timeout) {
+  struct task *t = curTask;
+  struct timespec ts;
+  uint32_t got;
+
+  (void)options;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_nsec += (long)timeout * 1000000;
+  ts.tv_sec += ts.tv_nsec / 1000000000;
+  ts.tv_nsec %= 1000000000;
+  pthread_mutex_lock(&t->mtx);
+  while (!(t->flags & flags)) {
+    if (pthread_cond_timedwait(&t->cond, &t->mtx, &ts) == ETIMEDOUT) break;
+  }
+  got = t->flags & flags;
+  t->flags &= ~flags;
+  pthread_mutex_unlock(&t->mtx);
+  return got ? (int32_t)got : -ETIMEDOUT;
+}
+
+int32_t alt_osal_create_mutex(alt_osal_mutex_handle *mutex, const alt_osal_mutex_attribute *attr) {
+  pthread_mutex_t *m = malloc(sizeof(*m));
+
+  (void)attr;
+  pthread_mutex_init(m, NULL);
+  *mutex = m;
+  return 0;
+}
+
+int32_t alt_osal_delete_mutex(alt_osal_mutex_handle *mutex) {
+  free(*mutex);
+  return 0;
+}
+
+int32_t alt_osal_lock_mutex(alt_osal_mutex_handle *mutex, int32_t timeout_ms) {
+  (void)timeout_ms;
+  return pthread_mutex_lock(*mutex);
+}
+
+int32_t alt_osal_unlock_mutex(alt_osal_mutex_handle *mutex) { return pthread_mutex_unlock(*mutex); }
+
+static void *task_main(void *arg) {
+  struct task *t = arg;
+
+  curTask = t;
+  t->function(t->arg);
+  return NULL;
+}
+
+int32_t alt_osal_create_task(alt_osal_task_handle *task, const alt_osal_task_attribute *attr) {
+  pthread_t thread;
+
+  *task = task_new(attr->function, attr->arg);
+  CHECK(pthread_create(&thread, NULL, task_main, *task) == 0);
+  pthread_detach(thread);
+  return 0;
+}
+
+/* the database: what reached it, in order */
+static struct stored {
+  uint16_t producer;
+  uint8_t merged;
+  uint32_t count, tick;
+} stored[MAX_STORED];
+static uint32_t numStored;
+static pthread_mutex_t dbLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* when each entry was logged: a ticket taken before sfpring_put, another once it returned */
+static uint32_t startTicket[NUM_PRODUCERS][NUM_ENTRIES], doneTicket[NUM_PRODUCERS][NUM_ENTRIES];
+static uint32_t tickets;
+
+unsigned int sfpdb_entry_size(const char *entry) {
+  return (unsigned char)entry[1] + SFPLOG_COMPLEX_STRING_ENTRYHEADER_SIZE_PLUS_NULL_TERM;
+}
+
+int sfpdb_store_entry(int dbid, const char *entry, unsigned int entry_size) {
+  struct stored *s;
+  uint32_t arg[2];
+
+  CHECK(dbid == 1 && entry_size == sfpdb_entry_size(entry));
+  memcpy(arg, entry + SFPLOG_COMPLEX_STRING_ENTRYHEADER_SIZE_PLUS_NULL_TERM, sizeof(arg));
+  pthread_mutex_lock(&dbLock);
+  CHECK(numStored < MAX_STORED && arg[0] < NUM_PRODUCERS && arg[1] < NUM_ENTRIES);
+  s = &stored[numStored++];
+  s->producer = arg[0];
+  s->count = arg[1];
+  s->merged = producer < 0;
+  memcpy(&s->tick, entry + 4, 4);
+  pthread_mutex_unlock(&dbLock);
+  return 0;
+}
+
+/* an sfp_log_fmt entry of two arguments, the producer and its count */
+static void log_one(uint32_t n) {
+  char entry[SFPLOG_FMT_ENTRY_MAX_SIZE];
+  uint32_t arg[2] = {(uint32_t)producer, n};
+
+  entry[0] = (char)(SFP_MSB_FMT_TYPE | 3);
+  entry[1] = (char)sizeof(arg);
+  entry[2] = 0;
+  entry[3] = 2;
+  memset(entry + 4, 0, 8);
+  memcpy(entry + SFPLOG_COMPLEX_STRING_ENTRYHEADER_SIZE_PLUS_NULL_TERM, arg, sizeof(arg));
+
+  startTicket[producer][n] = __atomic_load_n(&tickets, __ATOMIC_SEQ_CST);
+  if (sfpring_put(1, entry, sfpdb_entry_size(entry)) != 0) {
+    sfpdb_store_entry(1, entry, sfpdb_entry_size(entry));
+  }
+  doneTicket[producer][n] = __atomic_add_fetch(&tickets, 1, __ATOMIC_SEQ_CST);
+}
+
+static void *producer_main(void *arg) {
+  uint32_t seed = (uintptr_t)arg * 2654435761u, n;
+
+  producer = (int)(uintptr_t)arg;
+  inIrq = producer >= NUM_TASKS * NUM_WAVES && producer != CUT_PRODUCER;
+  curTask = task_new(NULL, NULL);
+  if (producer == CUT_PRODUCER) {
+    cutTask = curTask;
+    ticksLeft = CUT_AT + 1;
+  }
+  for (n = 0; n < NUM_ENTRIES; n++) {
+    log_one(n);
+    seed = seed * 1103515245u + 12345u;
+    if ((seed >> 8) % 8 == 0) usleep((seed >> 16) % 20);
+  }
+  if (!inIrq) sfpring_task_deleted(curTask);  // as vTaskDelete does
+  return NULL;
+}
+
+static void start(pthread_t *thread, uint32_t p) {
+  CHECK(pthread_create(thread, NULL, producer_main, (void *)(uintptr_t)p) == 0);
+}
+
+static volatile int producing;
+
+static void *cli_main(void *arg) {
+  (void)arg;
+  while (producing) {
+    sfpring_merge();
+    usleep(1000);
+  }
+  return NULL;
+}
+
+int main(void) {
+  pthread_t tasks[NUM_TASKS], isrs[NUM_ISRS], cut, cli;
+  static uint32_t next[NUM_PRODUCERS], minDone[MAX_STORED + 1];
+  static uint8_t seen[NUM_PRODUCERS][NUM_ENTRIES];
+  uint32_t w, i, p, direct = 0, ahead = 0, tick = 0;
+  struct stored *s;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  curTask = task_new(NULL, NULL);
+  CHECK(sfpring_init() == 0);
+  producing = 1;
+  CHECK(pthread_create(&cli, NULL, cli_main, NULL) == 0);
+
+  // the cut task holds a ring with a claimed slot that is never published
+  start(&cut, CUT_PRODUCER);
+  while (!cutParked) usleep(100);
+  for (i = 0; i < NUM_ISRS; i++) start(&isrs[i], NUM_TASKS * NUM_WAVES + i);
+  for (w = 0; w < NUM_WAVES; w++) {
+    for (i = 0; i < NUM_TASKS; i++) start(&tasks[i], w * NUM_TASKS + i);
+    if (w == 0) {
+      usleep(20000);
+      sfpring_task_deleted(cutTask);
+    }
+    for (i = 0; i < NUM_TASKS; i++) pthread_join(tasks[i], NULL);
+  }
+  for (i = 0; i < NUM_ISRS; i++) pthread_join(isrs[i], NULL);
+  producing = 0;
+  pthread_join(cli, NULL);
+  while (sfpring_merge() > 0) continue;
+
+  for (i = 0; i < SFPLOG_RING_MAX; i++) CHECK(sfprings[i].head == sfprings[i].tail);
+  CHECK(numStored == MAX_STORED - (NUM_ENTRIES - CUT_AT));
+
+  // the oldest entry merged after each position, by the ticket its sfpring_put returned with
+  minDone[numStored] = UINT32_MAX;
+  for (i = numStored; i-- > 0;) {
+    s = &stored[i];
+    minDone[i] = minDone[i + 1];
+    if (s->merged && doneTicket[s->producer][s->count] < minDone[i]) {
+      minDone[i] = doneTicket[s->producer][s->count];
+    }
+  }
+  for (i = 0; i < numStored; i++) {
+    s = &stored[i];
+    CHECK(s->producer != CUT_PRODUCER || s->count < CUT_AT);
+    CHECK(!seen[s->producer][s->count]);
+    seen[s->producer][s->count] = 1;
+    if (!s->merged) {
+      direct++;
+      continue;
+    }
+    // each producer's merged entries in order
+    CHECK(s->count >= next[s->producer]);
+    next[s->producer] = s->count + 1;
+    CHECK((int32_t)(s->tick - tick) >= 0);
+    tick = s->tick;
+    if (minDone[i + 1] < startTicket[s->producer][s->count]) ahead++;
+  }
+  CHECK(direct == sfpring_overflow_count());
+  CHECK(sfpring_merged_count() == numStored - direct);
+
+  for (p = 0; p < NUM_PRODUCERS; p++) {
+    for (i = 0; i < (p == CUT_PRODUCER ? CUT_AT : NUM_ENTRIES); i++) CHECK(seen[p][i]);
+  }
+
+  printf("sfpring: ok, %u producers, %u entries, %u merged, %u direct on overflow, "
+         "%u merged ahead of an older one\n",
+         NUM_PRODUCERS, numStored, numStored - direct, direct, ahead);
+  return 0;
+}
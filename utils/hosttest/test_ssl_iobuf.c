@@ -0,0 +1,362 @@
+/*
+  SSL read-ahead and write coalescing: ssl_iobuf.c under mbedtls_ssl_read(), mbedtls_ssl_write()
+  and mbedtls_ssl_get_bytes_avail().
+
+  A modem model behind apicmdgw_send() gives each context a peer stream cut in records of random
+  size, a read never crossing a record, and takes writes, now and then only part of one. More
+  contexts are used than there are slots, the others going one RPC per call. Then:
+  - reads of random sizes get the stream in order, an RPC only when nothing is read ahead, and
+    bytes read ahead are counted as available without asking the modem;
+  - coalesced writes reach the peer in order, small ones without an RPC, pending ones before a
+    read and when coalescing is stopped;
+  - tasks taking slots at the same time never share one, and no buffer is left after
+    ssl_iobuf_uninitialize();
+  - the report gives, per read and write size, the RPCs and the time on the internal UART at its
+    default rate of a small-read (or write) heavy stream with and without the buffers.
+*/
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "alt_osal.h"
+#include "altcom_seterrno.h"
+#include "apicmd.h"
+#include "apicmd_ssl.h"
+#include "hosttest.h"
+#include "mbedtls/ssl.h"
+#include "ssl_iobuf.h"
+
+#define UART_BAUD (460800)  // UARTI0_BAUDRATE_DEFAULT
+#define NUM_PEERS (8)
+#define STREAM_LEN (256 * 1024)
+#define BENCH_LEN (64 * 1024)
+#define NUM_TASKS (4)
+#define NUM_RACES (2000)
+
+struct peer {
+  uint32_t rxPos, recLeft, recMax;
+  uint8_t sent[STREAM_LEN];
+  uint32_t sentLen;
+  bool partial;
+};
+
+static struct peer peers[NUM_PEERS];
+static uint32_t rpcs, allocs;
+static uint64_t wireBytes;
+static pthread_mutex_t allocLock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint8_t stream(uint32_t id, uint32_t pos) { return (uint8_t)(pos * 131 + (pos >> 9) + id); }
+
+static uint32_t be32(uint32_t v) { return __builtin_bswap32(v); }
+
+/* ALTCOM and OSAL as far as the SSL calls use them */
+bool altcom_isinit(void) { return true; }
+
+void altcom_seterrno(int32_t err_no) { (void)err_no; }
+
+bool altcom_mbedtls_alloc_cmdandresbuff(void **buff, int32_t id, uint16_t bufflen, void **res,
+                                        uint16_t reslen) {
+  (void)id;
+  *buff = calloc(1, bufflen);
+  *res = calloc(1, reslen);
+  return *buff != NULL && *res != NULL;
+}
+
+void altcom_mbedtls_free_cmdandresbuff(void *cmdbuff, void *resbuff) {
+  free(cmdbuff);
+  free(resbuff);
+}
+
+void *buffpoolwrapper_alloc(uint32_t size) {
+  pthread_mutex_lock(&allocLock);
+  allocs++;
+  pthread_mutex_unlock(&allocLock);
+  return malloc(size);
+}
+
+int32_t buffpoolwrapper_free(void *buf) {
+  pthread_mutex_lock(&allocLock);
+  allocs--;
+  pthread_mutex_unlock(&allocLock);
+  free(buf);
+  return 0;
+}
+
+int32_t alt_osal_create_mutex(alt_osal_mutex_handle *mutex, const alt_osal_mutex_attribute *attr) {
+  pthread_mutex_t *m = malloc(sizeof(*m));
+
+  (void)attr;
+  pthread_mutex_init(m, NULL);
+  *mutex = m;
+  return 0;
+}
+
+int32_t alt_osal_delete_mutex(alt_osal_mutex_handle *mutex) {
+  free(*mutex);
+  return 0;
+}
+
+int32_t alt_osal_lock_mutex(alt_osal_mutex_handle *mutex, int32_t timeout_ms) {
+  (void)timeout_ms;
+  return pthread_mutex_lock(*mutex);
+}
+
+int32_t alt_osal_unlock_mutex(alt_osal_mutex_handle *mutex) { return pthread_mutex_unlock(*mutex); }
+
+/* the modem: a read stops at the end of a record, a write may be taken in part */
+int32_t apicmdgw_send(uint8_t *cmd, uint8_t *respbuff, uint16_t bufflen, uint16_t *resplen,
+                      int32_t timeout_ms) {
+  struct apicmd_sslcmd_s *req = (void *)cmd;
+  struct apicmd_sslcmdres_s *res = (void *)respbuff;
+  struct peer *p = &peers[be32(req->ssl)];
+  uint32_t n = 0, i;
+
+  (void)timeout_ms;
+  rpcs++;
+  wireBytes += 2 * sizeof(struct apicmd_cmdhdr_s) + APICMD_TLS_SSL_CMD_DATA_SIZE +
+               APICMD_TLS_SSL_CMDRES_DATA_SIZE + sizeof(uint32_t);
+  res->subcmd_id = req->subcmd_id;
+  switch (be32(req->subcmd_id)) {
+    case APISUBCMDID_TLS_SSL_READ:
+      if (p->recLeft == 0) p->recLeft = ht_range(1, p->recMax);
+      n = be32(req->u.read.len);
+      if (n > p->recLeft) n = p->recLeft;
+      for (i = 0; i < n; i++) res->u.readres.buf[i] = (int8_t)stream(be32(req->ssl), p->rxPos + i);
+      p->rxPos += n;
+      p->recLeft -= n;
+      wireBytes += n;
+      break;
+    case APISUBCMDID_TLS_SSL_WRITE:
+      n = be32(req->u.write.len);
+      if (p->partial && ht_rand() % 8 == 0) n = ht_range(1, n);
+      CHECK(p->sentLen + n <= STREAM_LEN);
+      memcpy(p->sent + p->sentLen, req->u.write.buf, n);
+      p->sentLen += n;
+      wireBytes += be32(req->u.write.len);
+      break;
+    case APISUBCMDID_TLS_SSL_BYTES_AVAIL:
+      n = p->recLeft;
+      res->u.bytes_availres.avail_bytes = be32(n);
+      break;
+    default:
+      CHECK(0);
+  }
+  res->ret_code = be32(n);
+  *resplen = bufflen;
+  return 0;
+}
+
+static void peer_reset(uint32_t id, uint32_t recMax, bool partial) {
+  memset(&peers[id], 0, sizeof(peers[id]));
+  peers[id].recMax = recMax;
+  peers[id].partial = partial;
+}
+
+/* read len bytes in reads of lo to hi bytes, a read making an RPC only when none are ahead */
+static void read_stream(mbedtls_ssl_context *ssl, uint32_t len, uint32_t lo, uint32_t hi,
+                        bool buffered) {
+  static unsigned char buf[4096];
+  uint32_t pos = 0, before, ahead, n, i;
+  int r;
+
+  while (pos < len) {
+    n = ht_range(lo, hi);
+    if (n > len - pos) n = len - pos;
+    ahead = ssl_iobuf_rx_avail(ssl->id);
+    CHECK(buffered || ahead == 0);
+    if (ahead > 0) {
+      before = rpcs;
+      CHECK(mbedtls_ssl_get_bytes_avail(ssl) == ahead && rpcs == before);
+    }
+    before = rpcs;
+    r = mbedtls_ssl_read(ssl, buf, n);
+    CHECK(r > 0 && (uint32_t)r <= n);
+    CHECK(rpcs - before == (ahead == 0));
+    for (i = 0; i < (uint32_t)r; i++) CHECK(buf[i] == stream(ssl->id, pos + i));
+    pos += r;
+  }
+}
+
+static void check_read(void) {
+  static const uint32_t ranges[][2] = {{1, 1}, {1, 64}, {1, 1999}, {1500, 4096}};
+  mbedtls_ssl_context ssl[3] = {{.id = 1}, {.id = 2}, {.id = 3}};
+  size_t i, c;
+
+  // the first two contexts read ahead, the third one has no slot left
+  for (i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+    for (c = 0; c < 3; c++) {
+      ssl_iobuf_release(ssl[c].id);
+      peer_reset(ssl[c].id, 4000, false);
+      read_stream(&ssl[c], 16 * 1024, ranges[i][0], ranges[i][1], c < ALTCOM_SSL_IOBUF_NUM);
+    }
+  }
+  for (c = 0; c < 3; c++) ssl_iobuf_release(ssl[c].id);
+  CHECK(allocs == 0);
+}
+
+/* write len bytes in writes of lo to hi bytes, a queued one making no RPC */
+static void write_stream(mbedtls_ssl_context *ssl, uint32_t len, uint32_t lo, uint32_t hi,
+                         bool readBack) {
+  static unsigned char buf[4096];
+  uint32_t pos = 0, before, n, i;
+  bool queued;
+  int r;
+
+  while (pos < len) {
+    n = ht_range(lo, hi);
+    if (n > len - pos) n = len - pos;
+    for (i = 0; i < n; i++) buf[i] = stream(ssl->id, pos + i);
+    queued = n <= ssl_iobuf_tx_room(ssl->id);
+    before = rpcs;
+    r = mbedtls_ssl_write(ssl, buf, n);
+    CHECK(r > 0 && (uint32_t)r <= n);
+    CHECK(r == (int)n || peers[ssl->id].partial);
+    CHECK(!queued || rpcs == before);
+    pos += r;
+    if (readBack && ht_rand() % 64 == 0) {
+      CHECK(mbedtls_ssl_read(ssl, buf, 1) == 1);
+      CHECK(peers[ssl->id].sentLen == pos);
+    }
+  }
+}
+
+static void check_write(void) {
+  static const uint32_t ranges[][2] = {{1, 1}, {1, 64}, {1, 1999}, {1500, 4096}};
+  mbedtls_ssl_context ssl = {.id = 4};
+  unsigned char byte = 0;
+  uint32_t before, pending, i, r;
+
+  for (r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+    peer_reset(ssl.id, 4000, true);
+    CHECK(mbedtls_ssl_set_write_coalescing(&ssl, 1) == 0);
+    write_stream(&ssl, 32 * 1024, ranges[r][0], ranges[r][1], true);
+    CHECK(mbedtls_ssl_flush_output(&ssl) == 0);
+    for (i = 0; i < 32 * 1024; i++) CHECK(peers[ssl.id].sent[i] == stream(ssl.id, i));
+
+    // a write that fits goes out only with the next flush, here when coalescing stops
+    pending = peers[ssl.id].sentLen;
+    before = rpcs;
+    CHECK(mbedtls_ssl_write(&ssl, &byte, 1) == 1 && rpcs == before);
+    CHECK(peers[ssl.id].sentLen == pending);
+    CHECK(mbedtls_ssl_set_write_coalescing(&ssl, 0) == 0);
+    CHECK(peers[ssl.id].sentLen == pending + 1 && !ssl_iobuf_tx_enabled(ssl.id));
+    ssl_iobuf_release(ssl.id);
+  }
+  CHECK(allocs == 0);
+}
+
+/* tasks taking their first slots at the same time */
+static pthread_barrier_t raceStart;
+static unsigned char *raceBuf[NUM_TASKS];
+
+static void *race_task(void *arg) {
+  uintptr_t k = (uintptr_t)arg;
+  size_t size;
+
+  pthread_barrier_wait(&raceStart);
+  raceBuf[k] = ssl_iobuf_rx_space(100 + k, &size);
+  return NULL;
+}
+
+static void check_race(void) {
+  pthread_t tasks[NUM_TASKS];
+  uintptr_t k, j;
+  uint32_t taken, round;
+
+  CHECK(pthread_barrier_init(&raceStart, NULL, NUM_TASKS) == 0);
+  for (round = 0; round < NUM_RACES; round++) {
+    for (k = 0; k < NUM_TASKS; k++)
+      CHECK(pthread_create(&tasks[k], NULL, race_task, (void *)k) == 0);
+    for (taken = 0, k = 0; k < NUM_TASKS; k++) {
+      pthread_join(tasks[k], NULL);
+      taken += raceBuf[k] != NULL;
+    }
+    CHECK(taken == ALTCOM_SSL_IOBUF_NUM);
+    for (k = 0; k < NUM_TASKS; k++) {
+      for (j = 0; j < k; j++) CHECK(raceBuf[k] == NULL || raceBuf[k] != raceBuf[j]);
+    }
+    for (k = 0; k < NUM_TASKS; k++) ssl_iobuf_release(100 + k);
+  }
+  pthread_barrier_destroy(&raceStart);
+  CHECK(allocs == 0);
+}
+
+/* RPCs and UART time of BENCH_LEN bytes read or written size bytes at a time */
+struct cost {
+  uint32_t rpcs;
+  double ms;
+};
+
+static struct cost bench_read(mbedtls_ssl_context *ssl, uint32_t size, bool buffered) {
+  struct cost c;
+  uint64_t t;
+
+  peer_reset(ssl->id, 16 * 1024, false);
+  rpcs = 0;
+  wireBytes = 0;
+  t = ht_now_ns();
+  read_stream(ssl, BENCH_LEN, size, size, buffered);
+  c.rpcs = rpcs;
+  c.ms = wireBytes * 10 * 1e3 / UART_BAUD + (ht_now_ns() - t) / 1e6;
+  return c;
+}
+
+static struct cost bench_write(mbedtls_ssl_context *ssl, uint32_t size, int coalesce) {
+  struct cost c;
+  uint64_t t;
+
+  peer_reset(ssl->id, 16 * 1024, false);
+  CHECK(mbedtls_ssl_set_write_coalescing(ssl, coalesce) == 0);
+  rpcs = 0;
+  wireBytes = 0;
+  t = ht_now_ns();
+  write_stream(ssl, BENCH_LEN, size, size, false);
+  CHECK(mbedtls_ssl_flush_output(ssl) == 0 && peers[ssl->id].sentLen == BENCH_LEN);
+  c.rpcs = rpcs;
+  c.ms = wireBytes * 10 * 1e3 / UART_BAUD + (ht_now_ns() - t) / 1e6;
+  CHECK(mbedtls_ssl_set_write_coalescing(ssl, 0) == 0);
+  return c;
+}
+
+static void bench(void) {
+  static const uint32_t sizes[] = {1, 16, 64, 256, 1024};
+  mbedtls_ssl_context buffered = {.id = 1}, plain = {.id = 3}, holder = {.id = 2};
+  struct cost with, without;
+  size_t i;
+
+  printf("  %u KB in records of up to 16 KB, RPCs and time at %u baud:\n", BENCH_LEN / 1024,
+         UART_BAUD);
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    // the first two contexts hold the slots, the third reads as before
+    CHECK(ssl_iobuf_tx_enable(holder.id, true) == 0);
+    with = bench_read(&buffered, sizes[i], true);
+    without = bench_read(&plain, sizes[i], false);
+    printf("    reads of %4u bytes: read ahead %5u RPCs %7.1f ms, one RPC each %6u RPCs %8.1f ms\n",
+           sizes[i], with.rpcs, with.ms, without.rpcs, without.ms);
+    ssl_iobuf_release(buffered.id);
+    ssl_iobuf_release(holder.id);
+  }
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    with = bench_write(&buffered, sizes[i], 1);
+    without = bench_write(&buffered, sizes[i], 0);
+    printf("    writes of %4u bytes: coalesced %5u RPCs %7.1f ms, one RPC each %6u RPCs %8.1f ms\n",
+           sizes[i], with.rpcs, with.ms, without.rpcs, without.ms);
+    ssl_iobuf_release(buffered.id);
+  }
+}
+
+int main(void) {
+  CHECK(ssl_iobuf_initialize() == 0);
+  check_read();
+  check_write();
+  check_race();
+  printf("ssl iobuf: ok, reads ahead and coalesced writes in order, slots taken once\n");
+  bench();
+
+  // buffers still held are freed with the library
+  CHECK(mbedtls_ssl_set_write_coalescing(&(mbedtls_ssl_context){.id = 5}, 1) == 0);
+  CHECK(allocs == 1);
+  CHECK(ssl_iobuf_uninitialize() == 0 && allocs == 0);
+  return 0;
+}
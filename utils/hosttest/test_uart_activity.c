@@ -0,0 +1,160 @@
+/*
+  UART inactivity check: the receive ISR records one activity per invocation instead of refreshing
+  the power manager for every character.
+
+  Random receive traffic is replayed through two models of the ISR, and the sleep decision of
+  pwr_check_uart_inactive_time() is compared at every tick with the decision of the per-character
+  code it replaced:
+  - while the ring buffer has room, both decisions are identical (the tick cannot advance within
+    one ISR, the tick interrupt has the lowest priority);
+  - with a full ring, characters that were dropped now count as activity too, so the check may stay
+    awake longer than before but never sleeps where the old code stayed awake;
+  - activity on another port never changes the decision of UARTF0.
+  The activity statistics read back by pwr_mngr_get_uart_activity() are checked against the bursts.
+*/
+#include <stdint.h>
+
+#include "../../middleware/pwrmanager/src/pwr_mngr.c"
+#include "hosttest.h"
+
+#define NUM_BURSTS 3000
+
+static uint32_t tick;
+
+uint32_t alt_osal_get_tick_count(void) { return tick; }
+
+/* pwr_check_uart_inactive_time() and pwr_mngr_refresh_uart_inactive_time() before the change */
+static volatile uint32_t base_last;
+
+static void base_refresh(void) { base_last = tick / portTICK_PERIOD_MS; }
+
+static int32_t base_check(void) {
+  uint32_t now = tick / portTICK_PERIOD_MS;
+  uint32_t delta = 0;
+
+  if (uart_inactivity_time == 0) return 0;
+
+  if (base_last == 0) {
+    base_last = now;
+    delta = 0;
+  } else {
+    delta = ((now / 1000) - (base_last / 1000));
+  }
+  return (delta < uart_inactivity_time) ? 1 : 0;
+}
+
+/*
+  Receive ISR before the change: the pending request loop refreshes once per iteration, including
+  the one that finds the FIFO empty, then the ring loop once per character it stores.
+*/
+static void base_isr(uint32_t chars, uint32_t pending, uint32_t room) {
+  while (pending != 0) {
+    base_refresh();
+    if (chars == 0) return;
+    chars--;
+    pending--;
+  }
+  while (chars != 0 && room != 0) {
+    base_refresh();
+    chars--;
+    room--;
+  }
+}
+
+/* Receive ISR now: one record if there is a pending request or the FIFO is not empty */
+static void new_isr(uint32_t port, uint32_t chars, uint32_t pending) {
+  if (pending != 0 || chars != 0) pwr_mngr_refresh_uart_activity(port);
+}
+
+static uint32_t next_gap(void) {
+  switch (ht_rand() % 8) {
+    case 0:
+      return ht_range(0, 3);
+    case 1:
+    case 2:
+    case 3:
+    case 4:
+      return ht_range(1, 200);
+    case 5:
+    case 6:
+      return ht_range(200, 6000);
+    default:
+      return ht_range(4000, 12000);
+  }
+}
+
+/* Replay one trace. Returns the number of ticks where the new check stayed awake and the old slept */
+static uint32_t run(uint32_t inact, bool ring_full, uint32_t start) {
+  PWR_MNGR_UartActivity act;
+  uint32_t n, gap, chars, pending, room;
+  uint32_t bursts = 0, last_burst = 0, max_idle = 0, widened = 0;
+  int32_t old_dec, new_dec;
+
+  memset(uart_activity, 0, sizeof(uart_activity));
+  base_last = 0;
+  uart_inactivity_time = inact;
+  tick = start;
+
+  for (n = 0; n < NUM_BURSTS; n++) {
+    for (gap = next_gap(); gap != 0; gap--) {
+      old_dec = base_check();
+      new_dec = pwr_check_uart_inactive_time();
+      if (!ring_full) CHECK(new_dec == old_dec);
+      CHECK(new_dec >= old_dec);
+      if (new_dec != old_dec) widened++;
+      tick++;
+    }
+    /* a record at tick 0 reads as "never" to both checks, the statistics would follow the reset */
+    if (tick == 0) tick++;
+
+    chars = ht_range(0, 32);
+    pending = (ht_rand() % 4 == 0) ? ht_range(1, 64) : 0;
+    room = 1024;
+    if (ring_full && ht_rand() % 3 == 0) room = ht_range(0, 4);
+
+    if (ht_rand() % 5 == 0) {
+      /* traffic on the internal UART only */
+      new_isr(DRV_UART_I0, chars, pending);
+      continue;
+    }
+
+    base_isr(chars, pending, room);
+    new_isr(DRV_UART_F0, chars, pending);
+    if (pending != 0 || chars != 0) {
+      if (bursts != 0 && tick - last_burst > max_idle) max_idle = tick - last_burst;
+      last_burst = tick;
+      bursts++;
+    }
+
+    old_dec = base_check();
+    new_dec = pwr_check_uart_inactive_time();
+    if (!ring_full) CHECK(new_dec == old_dec);
+    CHECK(new_dec >= old_dec);
+  }
+
+  CHECK(pwr_mngr_get_uart_activity(DRV_UART_F0, &act) == 0);
+  CHECK(act.activity_cnt == bursts);
+  CHECK(act.max_idle_time == max_idle * portTICK_PERIOD_MS);
+  CHECK(act.idle_time == (tick - last_burst) * portTICK_PERIOD_MS);
+  CHECK(pwr_mngr_get_uart_activity(DRV_UART_MAX, &act) == -1);
+
+  return widened;
+}
+
+int main(void) {
+  static const uint32_t inact[] = {0, 1, 5, 10};
+  uint32_t i, widened = 0;
+
+  for (i = 0; i < sizeof(inact) / sizeof(inact[0]); i++) {
+    run(inact[i], false, 1);
+    /* the trace crosses the tick counter wrap */
+    run(inact[i], false, 0xFFFFFFFFu - 4000000u);
+    widened += run(inact[i], true, 1);
+  }
+  /* a full ring must have mattered at least once, or the trace did not cover it */
+  CHECK(widened != 0);
+
+  printf("uart activity: ok, full ring kept the MCU awake for %lu more ticks\n",
+         (unsigned long)widened);
+  return 0;
+}
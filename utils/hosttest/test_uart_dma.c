@@ -0,0 +1,440 @@
+/*
+  UART GDMA mode: DRV_UART.c and DRV_GDMA.c on a host model of the UARTF0 and GDMA registers.
+
+  The model stands in for the hardware between driver calls, as interrupts see the driver on target
+  where it masks the UART and GDMA interrupts around its own updates:
+  - GDMA takes a command when the channel's CMD_CNT_INC is written and drops it when the command
+    FIFO index is reset by DRV_GDMA_Stop_Channel(). Progress is published in the DMA_CMD_*_STAT
+    registers for the command the engine moved data for last. A completed command gets its status
+    valid, sets the channel's done status and runs the channel handler if it asked for an interrupt;
+  - the line delivers characters, with the odd frame or overrun error, into a 32 deep FIFO that the
+    Rx command drains one sample at a time while RXDMAE is set, as single requests do. Every slot it
+    writes must still read 0xFFFF, so a half is always cleared before GDMA gets it back;
+  - the Tx command moves bytes of the caller's buffer to the line while TXDMAE is set;
+  - the Rx timeout interrupt fires at random with RTIM unmasked, the FIFO being already drained;
+  - a standby drops every armed command and runs the sleep notifications of both drivers.
+  A reader and a writer run on top with random lengths, polls and aborts. The reader must get every
+  character without a frame error once, in order, and an aborted send must report what the line got
+  or DRV_UART_ABORT_COUNT_UNKNOWN when the engine status shows another command.
+*/
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "../../ALT125x/Driver/Source/DRV_GDMA.c"
+#include "../../ALT125x/Driver/Source/DRV_UART.c"
+#include "hosttest.h"
+
+#define NUM_TICKS 200000
+#define RING_SIZE 512
+#define RX_HALF_LEN 48  // samples in each ping-pong half
+#define MAX_STREAM (NUM_TICKS * 8)
+#define MAX_SEND 300
+#define MAX_NOTIFY 4
+
+uint32_t hostPrimask, hostBasepri;
+
+/* target services */
+enum hifc_request_to_send request_to_send(hifc_sys_lpuart_t *base) {
+  (void)base;
+  return hifc_req_success;
+}
+
+int32_t generic_reset_inactivity_timer(hifc_sys_lpuart_t *base, uint32_t do_reset) {
+  (void)base;
+  (void)do_reset;
+  return 0;
+}
+
+int32_t hifc_host_interface_init(hifc_sys_lpuart_t *uart_base) {
+  (void)uart_base;
+  return 0;
+}
+
+void set_hifc_mode(enum hifc_mode mode) { (void)mode; }
+
+void pwr_mngr_refresh_uart_activity(uint32_t port) { (void)port; }
+
+static int32_t (*sleepNotify[MAX_NOTIFY])(DRV_SLEEP_NotifyType, DRV_PM_PwrMode, void *);
+static int32_t numNotify;
+
+int32_t DRV_SLEEP_RegNotification(int32_t (*ptr_callback)(DRV_SLEEP_NotifyType, DRV_PM_PwrMode,
+                                                          void *),
+                                  int32_t *item_idx, void *ptr_context) {
+  (void)ptr_context;
+  CHECK(numNotify < MAX_NOTIFY);
+  *item_idx = numNotify;
+  sleepNotify[numNotify++] = ptr_callback;
+  return 0;
+}
+
+int32_t DRV_SLEEP_UnRegNotification(int32_t item_idx) {
+  sleepNotify[item_idx] = NULL;
+  return 0;
+}
+
+/* the hardware */
+static void (*const simHandler[DRV_GDMA_Channel_MAX])(void) = {
+    gdma_channel_0_handler, gdma_channel_1_handler, gdma_channel_2_handler,
+    gdma_channel_3_handler, gdma_channel_4_handler, gdma_channel_5_handler,
+    gdma_channel_6_handler, gdma_channel_7_handler};
+
+static struct {
+  DRV_GDMA_Command *cmd;  // the command taken from the FIFO, NULL when there is none
+  uint32_t moved;         // bytes moved for it
+} simCh[DRV_GDMA_Channel_MAX];
+
+static uint16_t simFifo[UART_FIFO_DEPTH];
+static uint32_t simFifoLen;
+static uint8_t simLine[MAX_STREAM];  // what the Tx side put on the line
+static uint32_t simLineLen;
+
+static void *sim_map(uintptr_t start, size_t len) {
+  return mmap((void *)start, len, PROT_READ | PROT_WRITE,
+              MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+}
+
+/* take the commands armed since the last look, forget the ones that were dropped */
+static void sim_fetch(void) {
+  uint32_t n;
+
+  for (n = 0; n < DRV_GDMA_Channel_MAX; n++) {
+    if (simCh[n].cmd && DRV_GDMA_CMD_IDX(n) == 0) simCh[n].cmd = NULL;
+    if (DRV_GDMA_CMD_CNT_INC(n) != 0) {
+      DRV_GDMA_CMD_CNT_INC(n) = 0;
+      CHECK(DRV_GDMA_CMD_SIZE(n) == 1);
+      simCh[n].cmd = (DRV_GDMA_Command *)(uintptr_t)DRV_GDMA_CMD_BASEADDR(n);
+      CHECK(simCh[n].cmd == &gdma_peripheral.dma_cmd[n]);
+      simCh[n].moved = 0;
+      DRV_GDMA_CMD_IDX(n) = 1;
+    }
+  }
+}
+
+static void sim_progress(uint32_t n) {
+  DRV_GDMA_Command *cmd = simCh[n].cmd;
+
+  GDMA->DMA_CMD_RD_ADDR_STAT = cmd->read_addr + (cmd->dma_ctrl_b.RD_ADDR_MODE ? simCh[n].moved : 0);
+  GDMA->DMA_CMD_WR_ADDR_STAT = cmd->write_addr + (cmd->dma_ctrl_b.WR_ADDR_MODE ? simCh[n].moved : 0);
+  GDMA->DMA_CMD_CMD_LEN_STAT = (uint32_t)cmd->cmd_translen_b.cmd_id << 24 |
+                               (cmd->cmd_translen_b.transaction_len - simCh[n].moved);
+}
+
+static void sim_complete(uint32_t n) {
+  DRV_GDMA_Command *cmd = simCh[n].cmd;
+
+  simCh[n].cmd = NULL;
+  cmd->dma_ctrl_b.STAT_FIFO_VALIDNESS = 1;
+  DRV_GDMA_DONE_INT_STAT(n) = GDMA_DMA_CH0_DONE_INT_STAT_STAT_Msk;
+  if (cmd->dma_ctrl_b.INTR_MODE) simHandler[n]();
+  sim_fetch();
+}
+
+static int32_t sim_channel(uint32_t readAddr) {
+  uint32_t n;
+
+  for (n = 0; n < DRV_GDMA_Channel_MAX; n++) {
+    if (simCh[n].cmd && simCh[n].cmd->read_addr == readAddr) return n;
+  }
+  return -1;
+}
+
+static int32_t sim_tx_channel(void) {
+  uint32_t n;
+
+  for (n = 0; n < DRV_GDMA_Channel_MAX; n++) {
+    if (simCh[n].cmd && simCh[n].cmd->write_addr == (uint32_t)(uintptr_t)&UARTF0->DR) return n;
+  }
+  return -1;
+}
+
+/* move the FIFO to the armed Rx half while the request is up */
+static void sim_rx_drain(void) {
+  int32_t n;
+  uint16_t *slot;
+
+  while (simFifoLen != 0 && (UART_DMACR(UARTF0) & UART_DMACR_RXDMAE) &&
+         (n = sim_channel((uint32_t)(uintptr_t)&UARTF0->DR)) >= 0) {
+    CHECK(simCh[n].cmd->dma_ctrl_b.WAIT4READY && !simCh[n].cmd->dma_ctrl_b.RD_ADDR_MODE);
+    slot = (uint16_t *)(uintptr_t)(simCh[n].cmd->write_addr + simCh[n].moved);
+    CHECK(*slot == UART_DMA_RX_EMPTY_SAMPLE);
+    *slot = simFifo[0];
+    memmove(simFifo, simFifo + 1, --simFifoLen * sizeof(simFifo[0]));
+    simCh[n].moved += sizeof(uint16_t);
+    sim_progress(n);
+    if (simCh[n].moved == simCh[n].cmd->cmd_translen_b.transaction_len) sim_complete(n);
+  }
+}
+
+static void sim_rx_char(uint16_t sample) {
+  CHECK(simFifoLen < UART_FIFO_DEPTH);  // the drain keeps up, GDMA re-arms in its handler
+  simFifo[simFifoLen++] = sample;
+  sim_rx_drain();
+}
+
+static void sim_tx(uint32_t bytes) {
+  int32_t n;
+
+  while (bytes-- != 0 && (UART_DMACR(UARTF0) & UART_DMACR_TXDMAE) && (n = sim_tx_channel()) >= 0) {
+    CHECK(simLineLen < MAX_STREAM);
+    simLine[simLineLen++] = *(uint8_t *)(uintptr_t)(simCh[n].cmd->read_addr + simCh[n].moved);
+    simCh[n].moved++;
+    sim_progress(n);
+    if (simCh[n].moved == simCh[n].cmd->cmd_translen_b.transaction_len) sim_complete(n);
+  }
+}
+
+static void sim_rx_timeout(void) {
+  if (!(UARTF0->IMSC & UARTF0_IMSC_RTIM_Msk)) return;
+  UARTF0->MIS = UARTF0_MIS_RTMIS_Msk;
+  hw_uart_interrupt_handler0();
+  UARTF0->MIS = 0;
+}
+
+static void sim_standby(void) {
+  int32_t i;
+
+  for (i = 0; i < numNotify; i++)
+    if (sleepNotify[i]) sleepNotify[i](DRV_SLEEP_NTFY_SUSPENDING, DRV_PM_MODE_STANDBY, NULL);
+  memset(simCh, 0, sizeof(simCh));
+  for (i = 0; i < DRV_GDMA_Channel_MAX; i++) DRV_GDMA_CMD_CNT_INC(i) = 0;
+  UART_DMACR(UARTF0) = 0;
+  for (i = 0; i < numNotify; i++)
+    if (sleepNotify[i]) sleepNotify[i](DRV_SLEEP_NTFY_RESUMING, DRV_PM_MODE_STANDBY, NULL);
+  sim_fetch();
+}
+
+/* the application */
+static DRV_UART_Handle handle;
+static int8_t ring[RING_SIZE];
+static uint16_t rxHalves[2 * RX_HALF_LEN];
+
+static uint8_t expected[MAX_STREAM], got[MAX_STREAM];
+static uint32_t numGot;
+static uint8_t readBuf[RING_SIZE];
+static uint32_t readLen, readPending, readDone;
+
+static uint8_t sendBuf[MAX_SEND];
+static uint32_t sendLen, sendLine, sendPending, sendDone;
+static uint32_t sends, aborts, unknown;
+
+static void on_event(DRV_UART_Handle *h, uint32_t status, void *user_data) {
+  (void)h;
+  (void)user_data;
+  if (status == CB_RX_COMPLETE) {
+    CHECK(readPending);
+    readDone = 1;
+  } else if (status == CB_TX_COMPLETE) {
+    CHECK(sendPending);
+    sendDone = 1;
+  }
+}
+
+static void take(uint32_t len) {
+  CHECK(numGot + len <= MAX_STREAM);
+  memcpy(got + numGot, readBuf, len);
+  numGot += len;
+  CHECK(memcmp(got, expected, numGot) == 0);
+}
+
+static void reader(void) {
+  int32_t n;
+
+  if (readPending && readDone) {
+    take(readLen);
+    readPending = readDone = 0;
+  }
+  if (readPending) {
+    if (ht_rand() % 64 == 0) {
+      n = DRV_UART_Abort_Receive(&handle);
+      CHECK(n >= 0 && (uint32_t)n < readLen);
+      take(n);
+      readPending = 0;
+    }
+    return;
+  }
+  if (ht_rand() % 4 != 0) return;
+  readLen = ht_range(1, 200);
+  switch (DRV_UART_Receive_Nonblock(&handle, readBuf, readLen)) {
+    case DRV_UART_ERROR_NONE:
+      take(readLen);
+      break;
+    case DRV_UART_WAIT_CB:
+      readPending = 1;
+      break;
+    default:
+      CHECK(0);
+  }
+}
+
+static void check_sent(uint32_t len) {
+  CHECK(simLineLen - sendLine == len);
+  CHECK(memcmp(simLine + sendLine, sendBuf, len) == 0);
+  sendPending = sendDone = 0;
+}
+
+static void writer(void) {
+  int32_t n, moved;
+
+  if (sendPending && sendDone) {
+    check_sent(sendLen);
+    sends++;
+    return;
+  }
+  if (sendPending) {
+    if (ht_rand() % 16 == 0) {
+      // the count is known while the engine status shows this command
+      n = sim_tx_channel();
+      moved = n >= 0 && (GDMA->DMA_CMD_CMD_LEN_STAT >> 24) == simCh[n].cmd->cmd_translen_b.cmd_id
+                  ? (int32_t)simCh[n].moved
+                  : -1;
+      n = DRV_UART_Abort_Send(&handle);
+      sim_fetch();
+      CHECK(sim_tx_channel() < 0 && !handle.tx_dma_busy);
+      if (n == DRV_UART_ABORT_COUNT_UNKNOWN) {
+        CHECK(moved < 0);
+        unknown++;
+        sendPending = 0;
+      } else {
+        CHECK(n == moved);
+        check_sent(n);
+        aborts++;
+      }
+    }
+    return;
+  }
+  if (ht_rand() % 8 != 0) return;
+  sendLen = ht_range(UART_DMA_TX_MIN_LEN, MAX_SEND);
+  for (n = 0; n < (int32_t)sendLen; n++) sendBuf[n] = (uint8_t)ht_rand();
+  sendLine = simLineLen;
+  sendPending = 1;
+  CHECK(DRV_UART_Send_Nonblock(&handle, sendBuf, sendLen) == DRV_UART_WAIT_CB);
+  sim_fetch();
+}
+
+/* with every channel taken, GDMA mode is refused and the UART stays on its interrupts */
+static void check_no_channel(void) {
+  DRV_GDMA_Channel ch[DRV_GDMA_Channel_MAX];
+  DRV_UART_DMA_Config config = {rxHalves, sizeof(rxHalves), 1};
+  uint32_t n;
+
+  for (n = 0; n < DRV_GDMA_Channel_MAX; n++) CHECK(DRV_GDMA_Acquire_Channel(&ch[n]) == DRV_GDMA_OK);
+  CHECK(DRV_GDMA_Acquire_Channel(&ch[0]) == DRV_GDMA_ERROR_NO_CHANNEL);
+  CHECK(DRV_UART_Enable_DMA(&handle, &config) == DRV_UART_ERROR_BUSY);
+  CHECK(!handle.rx_dma_enabled && !handle.tx_dma_enabled && UART_DMACR(UARTF0) == 0);
+  CHECK(UARTF0->IMSC & UARTF0_IMSC_RXIM_Msk);
+  for (n = 0; n < DRV_GDMA_Channel_MAX; n++) DRV_GDMA_Release_Channel(ch[n]);
+}
+
+int main(void) {
+  const DRV_UART_Config uartConfig = {DRV_UART_BAUD_115200, DRV_UART_WORD_LENGTH_8B,
+                                      DRV_UART_STOP_BITS_1, DRV_UART_PARITY_MODE_DISABLE,
+                                      DRV_UART_HWCONTROL_NONE};
+  DRV_UART_DMA_Config config = {rxHalves, sizeof(rxHalves), 1};
+  DRV_UART_Statistic stat;
+  uint32_t tick, n, good = 0, fe = 0, standbys = 0;
+  uint16_t sample;
+
+  CHECK(sim_map(UARTF0_BASE, UARTI2_BASE + 0x1000 - UARTF0_BASE) == (void *)UARTF0_BASE);
+  CHECK(sim_map(UARTF0_CFG_BASE, 0x1000) == (void *)UARTF0_CFG_BASE);
+  CHECK(sim_map(GDMA_BASE, 0x1000) == (void *)GDMA_BASE);
+  CHECK(sim_map(SCS_BASE, 0x1000) == (void *)SCS_BASE);
+  UARTF0->FR = UARTF0_FR_RXFE_Msk | UARTF0_FR_TXFE_Msk;
+
+  CHECK(DRV_GDMA_Initialize() == DRV_GDMA_OK);
+  CHECK(DRV_UART_Initialize(UARTF0, &uartConfig, 38400000) == DRV_UART_ERROR_NONE);
+  CHECK(DRV_UART_Create_Handle(UARTF0, &handle, on_event, NULL, ring, RING_SIZE) ==
+        DRV_UART_ERROR_NONE);
+  CHECK(numNotify == 2);  // GDMA first, as on target
+
+  check_no_channel();
+
+  // the caller's interrupt mask survives the channel allocation
+  hostPrimask = 1;
+  CHECK(DRV_UART_Enable_DMA(&handle, &config) == DRV_UART_ERROR_NONE);
+  CHECK(hostPrimask == 1);
+  hostPrimask = 0;
+  CHECK(handle.rx_dma_enabled && handle.tx_dma_enabled);
+  CHECK(!(UARTF0->IMSC & UARTF0_IMSC_RXIM_Msk) && (UARTF0->IMSC & UARTF0_IMSC_RTIM_Msk));
+  sim_fetch();
+
+  for (tick = 0; tick < NUM_TICKS; tick++) {
+    // a burst now and then, never more than the ring can hold until the reader gets to it
+    n = ht_rand() % 16 == 0 ? ht_range(1, 120) : ht_range(0, 2);
+    while (n-- != 0 && good - numGot < RING_SIZE - 1) {
+      sample = (uint16_t)(ht_rand() & 0xFF);
+      switch (ht_rand() % 64) {
+        case 0:
+          sample |= UARTF0_DR_FE_Msk;  // dropped by the driver
+          fe++;
+          break;
+        case 1:
+          sample |= UARTF0_DR_OE_Msk;  // kept, the character itself is fine
+          break;
+      }
+      if (!(sample & UARTF0_DR_FE_Msk)) expected[good++] = (uint8_t)sample;
+      sim_rx_char(sample);
+    }
+    sim_tx(ht_rand() % 4 == 0 ? 0 : ht_range(1, 24));
+
+    switch (ht_rand() % 16) {
+      case 0:
+        sim_rx_timeout();
+        break;
+      case 1:
+        DRV_UART_DMA_Poll(&handle);
+        break;
+      case 2:
+        if (!sendPending && ht_rand() % 64 == 0) {
+          sim_standby();
+          standbys++;
+        }
+        break;
+    }
+    reader();
+    writer();
+    sim_fetch();
+  }
+
+  // let the writer finish and the reader pick up the rest
+  while (sendPending && !sendDone) sim_tx(MAX_SEND);
+  writer();
+  DRV_UART_DMA_Poll(&handle);
+  if (readPending && !readDone) readLen = DRV_UART_Abort_Receive(&handle);
+  if (readPending) take(readLen);
+  while (numGot < good) {
+    readLen = good - numGot < RING_SIZE ? good - numGot : RING_SIZE;
+    CHECK(DRV_UART_Receive_Nonblock(&handle, readBuf, readLen) == DRV_UART_ERROR_NONE);
+    take(readLen);
+  }
+
+  CHECK(DRV_UART_Get_Statistic(&handle, &stat) == DRV_UART_ERROR_NONE);
+  CHECK(stat.rx_drop_cnt == 0 && stat.fe_cnt == fe && stat.rx_cnt_isr == 0);
+  CHECK(stat.rx_cnt_dma == good);
+  CHECK(sends != 0 && aborts != 0 && unknown != 0 && standbys != 0);
+
+  // the engine status of a completed send is not taken for the progress of the next one
+  sendLine = simLineLen;
+  sendPending = 1;
+  CHECK(DRV_UART_Send_Nonblock(&handle, sendBuf, 64) == DRV_UART_WAIT_CB);
+  sim_fetch();
+  sim_tx(64);
+  CHECK(sendDone);
+  check_sent(64);
+  sendPending = 1;
+  CHECK(DRV_UART_Send_Nonblock(&handle, sendBuf, 64) == DRV_UART_WAIT_CB);
+  sim_fetch();
+  CHECK(DRV_UART_Abort_Send(&handle) == DRV_UART_ABORT_COUNT_UNKNOWN);
+  sendPending = 0;
+
+  // dropping the GDMA mode stops the Rx command, nothing lands in rx_buffer afterwards
+  CHECK(DRV_UART_Uninitialize(&handle) == DRV_UART_ERROR_NONE);
+  sim_fetch();
+  for (n = 0; n < DRV_GDMA_Channel_MAX; n++) CHECK(simCh[n].cmd == NULL);
+  CHECK(UART_DMACR(UARTF0) == 0);
+
+  printf("uart dma: ok, %u characters, %u frame errors, %u sends, %u aborts, %u of unknown length, "
+         "%u standbys\n",
+         good, fe, sends, aborts + unknown, unknown, standbys);
+  return 0;
+}
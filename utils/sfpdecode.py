@@ -0,0 +1,217 @@
+#!/usr/bin/env python
+
+'''
+Decode an SFP logger database into text.
+
+Input is the output of the SFP hex dump CLI (sfplogger_dump_hex), or a raw database image with
+--raw. Deferred format entries (SFP_LOG_FMT) only carry the address of their format string and
+the argument words, the strings are read back from the application elf. Binary sfp_log entries
+are resolved to their source file with the $(PROGRAM).sfpmap the build writes.
+'''
+
+from __future__ import print_function
+import sys
+import re
+import struct
+import argparse
+
+SEVERITY = ["[CRI]", "[ERR]", "[D2] ", "[D3] ", "[D4] ", "[D5] ", "[D6] ", "[D7] "]
+
+ENTRY_SIZE = 20
+EXTENDED_ENTRY_SIZE = 24
+STRING_HEADER_SIZE = 6
+COMPLEX_HEADER_SIZE = 12
+FMT_MAX_ARGS = 6
+
+C_FORMAT = re.compile(r'%([-+ #0]*)(\d*)(\.\d+)?(hh|h|ll|l|z|t)?([diouxXcspn%])')
+
+
+class Elf(object):
+    '''Just enough of a little endian ELF32 reader to fetch strings by address'''
+
+    def __init__(self, filename):
+        with open(filename, 'rb') as f:
+            self.data = f.read()
+        if self.data[:4] != b'\x7fELF' or self.data[4:5] != b'\x01':
+            sys.exit("{:s} is not an ELF32 file".format(filename))
+        shoff, = struct.unpack_from('<I', self.data, 0x20)
+        shentsize, shnum = struct.unpack_from('<HH', self.data, 0x2e)
+        self.sections = []
+        for i in range(shnum):
+            (_, sh_type, sh_flags, sh_addr, sh_offset,
+             sh_size) = struct.unpack_from('<IIIIII', self.data, shoff + i * shentsize)
+            # allocated and with contents in the file
+            if sh_flags & 0x2 and sh_type == 1 and sh_size:
+                self.sections.append((sh_addr, sh_offset, sh_size))
+
+    def string(self, addr):
+        for sh_addr, sh_offset, sh_size in self.sections:
+            if sh_addr <= addr < sh_addr + sh_size:
+                start = sh_offset + addr - sh_addr
+                end = self.data.find(b'\x00', start, sh_offset + sh_size)
+                if end < 0:
+                    end = sh_offset + sh_size
+                return self.data[start:end].decode('ascii', 'replace')
+        return None
+
+
+def load_map(filename):
+    '''File names by hash, as regular and as extended entries keep it'''
+    files = {0xFFF7F: {}, 0xFFF3F: {}}
+    with open(filename, 'r') as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) == 2:
+                for mask, names in files.items():
+                    names.setdefault(int(fields[0], 16) & mask, fields[1])
+    return files
+
+
+def pad(text, flags, width, prec):
+    if '-' in flags:
+        return text.ljust(int(width or 0))
+    if '0' in flags and not prec:
+        return text.rjust(int(width or 0), '0')
+    return text.rjust(int(width or 0))
+
+
+def format_c(fmt, args, elf):
+    '''Apply a C printf format to 32-bit argument words, as the MCU's printf does'''
+    out = []
+    pos = 0
+    argi = 0
+    for m in C_FORMAT.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, prec, length, conv = m.groups()
+        if conv == '%':
+            out.append('%')
+            continue
+        word = args[argi] if argi < len(args) else 0
+        argi += 1
+        # int arguments are promoted, h and hh convert them back
+        bits = {'hh': 8, 'h': 16}.get(length, 32)
+        word &= (1 << bits) - 1
+        spec = '%' + flags.replace('#', '') + width + (prec or '')
+        if conv in 'di':
+            value = word - (1 << bits) if word >> (bits - 1) else word
+            out.append((spec + 'd') % value)
+        elif conv == 'u':
+            out.append((spec.replace('+', '').replace(' ', '') + 'd') % word)
+        elif conv in 'xX':
+            # C leaves 0x out for zero, Python does not
+            out.append(((spec if '#' not in flags or word == 0 else '%' + flags + width +
+                         (prec or '')) + conv) % word)
+        elif conv == 'o':
+            digits = ('%' + (prec or '') + 'o') % word
+            if '#' in flags and not digits.startswith('0'):
+                digits = '0' + digits
+            out.append(pad(digits, flags, width, prec))
+        elif conv == 'c':
+            out.append((spec + 's') % chr(word & 0xFF))
+        elif conv == 'p':
+            out.append((spec + 's') % '0x{:08x}'.format(word))
+        elif conv == 's':
+            text = elf.string(word) if elf else None
+            out.append((spec + 's') % (text if text is not None else '<0x{:08x}>'.format(word)))
+        else:
+            out.append(m.group(0))
+    out.append(fmt[pos:])
+    return ''.join(out)
+
+
+def time_str(msec):
+    return "{:d}.{:03d}".format(msec // 1000, msec % 1000)
+
+
+def decode(db, elf, files, out):
+    pos = 0
+    while pos + 1 < len(db):
+        b0 = db[pos]
+        if b0 == 0 and db[pos + 1] == 0:
+            break
+        if b0 & 0xF0 == 0xE0:  # empty filler
+            size = (b0 & 0x0F) * 256 + db[pos + 1]
+            line = None
+        elif b0 & 0x80 == 0x00 or b0 & 0xC0 == 0x80:  # sfp_log entry, regular or extended
+            size = ENTRY_SIZE if b0 & 0x80 == 0 else EXTENDED_ENTRY_SIZE
+            word, tick, p1, p2, p3 = struct.unpack_from('<IIiii', db, pos)
+            if size == EXTENDED_ENTRY_SIZE:
+                lineno, = struct.unpack_from('<I', db, pos + ENTRY_SIZE)
+                mask = 0xFFF3F  # the type bits overwrite bits 6 and 7 of the hash
+            else:
+                lineno = (word >> 20) & 0x7FF
+                mask = 0xFFF7F
+            name = files.get(mask, {}).get(word & mask, '{:05x}'.format(word & 0xFFFFF))
+            line = "{:s} {:s}:{:d} {:d} {:d} {:d}".format(time_str(tick), name, lineno, p1, p2, p3)
+        elif b0 & 0xE0 == 0xC0:  # string
+            size = db[pos + 1] + STRING_HEADER_SIZE
+            tick, = struct.unpack_from('>I', db, pos + 2)
+            text = db[pos + STRING_HEADER_SIZE:pos + size].split(b'\x00')[0]
+            line = "{:s} {:s} {:s}".format(time_str(tick), SEVERITY[b0 & 0x7],
+                                          text.decode('ascii', 'replace').rstrip())
+        elif b0 & 0xF8 == 0xF8:  # deferred format
+            size = db[pos + 1] + COMPLEX_HEADER_SIZE
+            nargs = min(db[pos + 3], FMT_MAX_ARGS)
+            tick, fmt_addr = struct.unpack_from('<II', db, pos + 4)
+            args = struct.unpack_from('<' + 'I' * nargs, db, pos + COMPLEX_HEADER_SIZE)
+            fmt = elf.string(fmt_addr) if elf else None
+            if fmt is None:
+                text = "<format 0x{:08x}> {:s}".format(fmt_addr,
+                                                       ' '.join('0x%08x' % a for a in args))
+            else:
+                text = format_c(fmt, args, elf).rstrip()
+            line = "{:s} {:s} {:s}".format(time_str(tick), SEVERITY[b0 & 0x7], text)
+        elif b0 & 0xF0 == 0xF0:  # complex string
+            size = db[pos + 1] + COMPLEX_HEADER_SIZE
+            line = "<complex string entry>"
+        else:
+            print("Unknown entry 0x{:02x} at offset {:d}".format(b0, pos), file=sys.stderr)
+            break
+        if size == 0:
+            break
+        if line is not None:
+            out.write(line + "\n")
+        pos += size
+
+
+def read_dump(filename):
+    '''Split the CLI hex dump into the bytes of each database'''
+    dbs = []
+    current = None
+    with open(filename, 'r') as f:
+        for text in f:
+            if 'Dumping buffer' in text:
+                current = []
+                dbs.append(current)
+                continue
+            if current is None or 'SFP Logger' in text:
+                continue
+            current.append(re.sub(r'[^0-9a-fA-F]', '', text.replace('::', '')))
+    return [bytearray.fromhex(''.join(db)) for db in dbs]
+
+
+def main(opts):
+    elf = Elf(opts.elf) if opts.elf else None
+    files = load_map(opts.map) if opts.map else {}
+    if opts.raw:
+        with open(opts.dump, 'rb') as f:
+            dbs = [bytearray(f.read())]
+    else:
+        dbs = read_dump(opts.dump)
+    for i, db in enumerate(dbs):
+        if len(dbs) > 1:
+            sys.stdout.write("--- buffer {:d}\n".format(i))
+        decode(db, elf, files, sys.stdout)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description="SFP logger decoder.")
+    parser.add_argument('dump', help='hex dump captured from the SFP dump CLI')
+    parser.add_argument('--raw', action='store_true',
+                        help='dump is a raw database image instead of the hex dump')
+    parser.add_argument('--elf', action='store',
+                        help='application elf, needed for deferred format entries')
+    parser.add_argument('--map', action='store',
+                        help='file name hash map ($(PROGRAM).sfpmap) of the build')
+    main(parser.parse_args())
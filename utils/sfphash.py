@@ -0,0 +1,64 @@
+#!/usr/bin/env python
+
+from __future__ import print_function
+import sys
+import os
+import argparse
+
+MAP_SUFFIX = ".sfph"
+
+
+def file_hash(filename):
+    # Same as sfp_calc_hash_from_filename() in sfplogger.c: Adler-like sum over the last three
+    # path components, walking back from the end and skipping '.' and '/'
+    a, b, num_slash = 1, 0, 0
+    for ch in reversed(filename):
+        if num_slash >= 3:
+            break
+        if ch == '/':
+            num_slash += 1
+        if ch not in './':
+            a = (a + ord(ch)) % 65521
+            b = (b + a) % 65521
+    return ((b << 16) | a) & 0xFFFFF
+
+
+def main(opts):
+    if opts.collect:
+        # Gather the per object lines into one file hash map for the log decoder
+        lines = set()
+        for root, _, files in os.walk(opts.collect[0]):
+            for name in files:
+                if name.endswith(MAP_SUFFIX):
+                    with open(os.path.join(root, name), 'r') as f:
+                        lines.update(l for l in f.read().splitlines() if l)
+        with open(opts.collect[1], 'w') as f:
+            for line in sorted(lines):
+                f.write(line + "\n")
+        return
+
+    if not opts.sources:
+        sys.exit("no source file")
+    if opts.map:
+        if len(opts.sources) != 1:
+            sys.exit("--map takes one source file")
+        # make expands the whole recipe before the line that creates the object directory
+        map_dir = os.path.dirname(opts.map)
+        if map_dir and not os.path.isdir(map_dir):
+            os.makedirs(map_dir)
+        with open(opts.map, 'w') as f:
+            f.write("0x{:05x} {:s}\n".format(file_hash(opts.sources[0]), opts.sources[0]))
+    for source in opts.sources:
+        print("0x{:05x}".format(file_hash(source)))
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description="sfp_log file name hash tool.")
+    parser.add_argument('sources', nargs='*', metavar='source',
+                        help='source file name, as passed to the compiler, one hash per line '
+                        'for several')
+    parser.add_argument('--map', action='store',
+                        help='also write the hash and file name to this file')
+    parser.add_argument('--collect', nargs=2, metavar=('BUILD_DIR', 'OUT'),
+                        help='merge the ' + MAP_SUFFIX + ' files under BUILD_DIR into OUT')
+    main(parser.parse_args())
@@ -0,0 +1,178 @@
+#!/usr/bin/env python
+
+'''
+Host end of the SFP log export (sfpexport_serial_sink).
+
+Reads the exported segments from a serial port or from a capture of one, checks the segment
+sequence, expands FastLZ compressed segments and decodes the entries with sfpdecode. The
+entries can also be kept as raw database images, one per database, for sfpdecode.py --raw.
+'''
+
+from __future__ import print_function
+import sys
+import os
+import struct
+import argparse
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import sfpdecode  # noqa: E402
+
+MAGIC = b'SX'
+HEADER = struct.Struct('<2sBBIHHI')
+FLAG_COMPRESSED = 1 << 0
+FLAG_LOST = 1 << 1
+
+
+def fastlz_decompress(data):
+    '''FastLZ level 1, as fastlz_decompress_internal() in middleware/pwrmanager/src/fastlz.c'''
+    out = bytearray()
+    ip = 0
+    ctrl = data[ip] & 31
+    ip += 1
+    while True:
+        if ctrl >= 32:
+            length = (ctrl >> 5) - 1
+            ofs = (ctrl & 31) << 8
+            if length == 7 - 1:
+                length += data[ip]
+                ip += 1
+            ref = len(out) - ofs - data[ip] - 1
+            ip += 1
+            if ref < 0:
+                raise ValueError("match before start of data")
+            # byte by byte, the match may overlap what it produces
+            for _ in range(length + 3):
+                out.append(out[ref])
+                ref += 1
+        else:
+            ctrl += 1
+            if ip + ctrl > len(data):
+                raise ValueError("literal run past end of data")
+            out += data[ip:ip + ctrl]
+            ip += ctrl
+        if ip >= len(data):
+            break
+        ctrl = data[ip]
+        ip += 1
+    return bytes(out)
+
+
+class Sink(object):
+    def __init__(self, opts):
+        self.elf = sfpdecode.Elf(opts.elf) if opts.elf else None
+        self.files = sfpdecode.load_map(opts.map) if opts.map else {}
+        self.raw_prefix = opts.raw_out
+        self.raw_files = {}
+        self.buf = bytearray()
+        self.last_seq = None
+        self.segments = 0
+        self.duplicates = 0
+        self.missing = 0
+        self.lost = 0
+        self.skipped = 0
+
+    def feed(self, data):
+        self.buf += data
+        while True:
+            start = self.buf.find(MAGIC)
+            if start < 0:
+                # keep a trailing 'S', it may be the start of the next header
+                keep = 1 if self.buf[-1:] == MAGIC[:1] else 0
+                self.skipped += len(self.buf) - keep
+                del self.buf[:len(self.buf) - keep]
+                return
+            if start:
+                self.skipped += start
+                del self.buf[:start]
+            if len(self.buf) < HEADER.size:
+                return
+            _, dbid, flags, seq, raw_len, length, lost = HEADER.unpack_from(self.buf, 0)
+            if flags & ~(FLAG_COMPRESSED | FLAG_LOST) or length == 0 or \
+                    (not flags & FLAG_COMPRESSED and length != raw_len):
+                # console output which happened to contain the magic
+                self.skipped += 1
+                del self.buf[:1]
+                continue
+            if len(self.buf) < HEADER.size + length:
+                return
+            payload = bytes(self.buf[HEADER.size:HEADER.size + length])
+            if flags & FLAG_COMPRESSED:
+                try:
+                    payload = fastlz_decompress(bytearray(payload))
+                except (ValueError, IndexError):
+                    payload = None
+                if payload is None or len(payload) != raw_len:
+                    self.skipped += 1
+                    del self.buf[:1]
+                    continue
+            del self.buf[:HEADER.size + length]
+            self.segment(dbid, seq, lost, bytearray(payload))
+
+    def segment(self, dbid, seq, lost, payload):
+        if self.last_seq is not None:
+            delta = (seq - self.last_seq) & 0xFFFFFFFF
+            if delta == 0 or delta >= 0x80000000:
+                # sent again after the sink reported a failure
+                self.duplicates += 1
+                return
+            if delta > 1:
+                self.missing += delta - 1
+                sys.stdout.write("--- {:d} segment(s) missing\n".format(delta - 1))
+        self.last_seq = seq
+        self.segments += 1
+        if lost:
+            self.lost += lost
+            sys.stdout.write("--- buffer {:d}: {:d} bytes overwritten before export\n".format(
+                dbid, lost))
+        if self.raw_prefix:
+            if dbid not in self.raw_files:
+                self.raw_files[dbid] = open("{:s}.{:d}.bin".format(self.raw_prefix, dbid), 'wb')
+            self.raw_files[dbid].write(payload)
+        sfpdecode.decode(payload, self.elf, self.files, sys.stdout)
+        sys.stdout.flush()
+
+    def close(self):
+        for f in self.raw_files.values():
+            f.close()
+        print("segments {:d}, duplicates {:d}, missing {:d}, lost bytes {:d}, skipped bytes {:d}"
+              .format(self.segments, self.duplicates, self.missing, self.lost, self.skipped),
+              file=sys.stderr)
+
+
+def main(opts):
+    sink = Sink(opts)
+    try:
+        if opts.port:
+            import serial
+            port = serial.Serial(opts.port, opts.baud, timeout=0.5)
+            capture = open(opts.capture, 'wb') if opts.capture else None
+            while True:
+                data = port.read(4096)
+                if data:
+                    if capture:
+                        capture.write(data)
+                    sink.feed(bytearray(data))
+        else:
+            with open(opts.capture, 'rb') as f:
+                sink.feed(bytearray(f.read()))
+    except KeyboardInterrupt:
+        pass
+    sink.close()
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description="SFP log export receiver.")
+    parser.add_argument('--port', action='store', help='serial port the export sink writes to')
+    parser.add_argument('--baud', action='store', type=int, default=115200)
+    parser.add_argument('--capture', action='store',
+                        help='capture file to read, or to write along with --port')
+    parser.add_argument('--raw-out', action='store',
+                        help='also write the entries to RAW_OUT.<dbid>.bin')
+    parser.add_argument('--elf', action='store',
+                        help='application elf, needed for deferred format entries')
+    parser.add_argument('--map', action='store',
+                        help='file name hash map ($(PROGRAM).sfpmap) of the build')
+    opts = parser.parse_args()
+    if not opts.port and not opts.capture:
+        parser.error("one of --port or --capture is needed")
+    main(opts)
@@ -0,0 +1,178 @@
+#!/usr/bin/env python
+
+'''
+Replay an idle trace through the power manager sleep planner.
+
+The planner model mirrors pwr_mngr_plan_sleep() and pwr_mngr_plan_learn() and reads its currents
+and default costs from pwr_mngr.h, so a trace can be replayed against the constants of the build.
+Each trace line is "<time_ms> <event> [args]", in time order:
+
+    <t> idle <timer_ms>                   the MCU goes idle, the next RTOS timer is timer_ms away
+    <t> wake                              an interrupt ends the idle window before the timer
+    <t> hint <app|lte> <delay_ms> [<period_ms>]   pwr_mngr_set_activity_hint()
+
+The report lists the planned mode of every idle window with --verbose, then the charge spent by
+the planner against always using the configured mode and against OS sleep only.
+'''
+
+from __future__ import print_function
+import os
+import re
+import sys
+import argparse
+
+MODES = ["run", "sleep", "stop", "standby", "shutdown"]
+RUN, SLEEP, STOP, STANDBY, SHUTDOWN = range(len(MODES))
+HINTS = ["app", "lte"]
+
+COST_SHIFT = 4   # costs in 1/16 ms, as PWR_MNGR_PLAN_COST_SHIFT
+LEARN_SHIFT = 3  # PWR_MNGR_PLAN_LEARN_SHIFT
+
+DEFAULT_HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'middleware',
+                              'pwrmanager', 'inc', 'pwr_mngr.h')
+
+
+def read_constants(filename):
+    consts = {}
+    with open(filename, 'r') as f:
+        for line in f:
+            m = re.match(r'#define\s+PWR_MNGR_PLAN_(\w+)\s+\(?(\d+)\)?', line)
+            if m:
+                consts[m.group(1)] = int(m.group(2))
+    current = [consts['RUN_UA'], consts['SLEEP_UA'], consts['STOP_UA'], consts['STANDBY_UA'],
+               consts['SHUTDOWN_UA']]
+    cost = [0, 0, consts['STOP_COST_MS'], consts['STANDBY_COST_MS'], consts['SHUTDOWN_COST_MS']]
+    return current, cost
+
+
+class Planner(object):
+    def __init__(self, current, cost):
+        self.current = current
+        self.cost = [c << COST_SHIFT for c in cost]
+        self.learnt = set()
+        self.hints = {}
+
+    def set_hint(self, now, src, delay, period):
+        if delay == 0:
+            self.hints.pop(src, None)
+        else:
+            self.hints[src] = [now + delay, period]
+
+    def idle_time(self, now, idle):
+        for src in list(self.hints):
+            hint = self.hints[src]
+            if hint[0] <= now:
+                if hint[1] == 0:
+                    del self.hints[src]
+                    continue
+                hint[0] += ((now - hint[0]) // hint[1] + 1) * hint[1]
+            idle = min(idle, hint[0] - now)
+        return idle
+
+    def plan(self, now, max_mode, idle):
+        idle = self.idle_time(now, idle)
+        window = idle << COST_SHIFT
+        best, best_energy = SLEEP, window * self.current[SLEEP]
+        for mode in range(STOP, max_mode + 1):
+            if self.cost[mode] >= window:
+                break
+            energy = (self.cost[mode] * self.current[RUN] +
+                      (window - self.cost[mode]) * self.current[mode])
+            if energy < best_energy:
+                best, best_energy = mode, energy
+        return best, idle
+
+    def learn(self, mode, overhead):
+        sample = overhead << COST_SHIFT
+        if mode in self.learnt:
+            self.cost[mode] += (sample - self.cost[mode]) >> LEARN_SHIFT
+        else:
+            self.cost[mode] = sample
+            self.learnt.add(mode)
+
+
+def charge(current, mode, cost, length):
+    '''Charge in uA x ms of one idle window, a window shorter than the cost pays the whole cost'''
+    if mode == SLEEP:
+        return current[SLEEP] * length
+    if length <= cost:
+        return current[RUN] * cost
+    return current[RUN] * cost + current[mode] * (length - cost)
+
+
+def read_trace(filename):
+    events = []
+    with open(filename, 'r') as f:
+        for text in f:
+            fields = text.split('#')[0].split()
+            if fields:
+                events.append((int(fields[0]), fields[1], fields[2:]))
+    return events
+
+
+def main(opts):
+    current, cost = read_constants(opts.header)
+    true_cost = list(cost)
+    for item in opts.cost.split(',') if opts.cost else []:
+        name, value = item.split('=')
+        true_cost[MODES.index(name)] = int(value)
+    max_mode = MODES.index(opts.mode)
+    planner = Planner(current, cost)
+    events = read_trace(opts.trace)
+
+    totals = {'plan': 0, 'fixed': 0, 'sleep': 0}
+    chosen = [0] * len(MODES)
+    late = 0
+    idle_ms = 0
+    for i, (now, event, args) in enumerate(events):
+        if event == 'hint':
+            planner.set_hint(now, HINTS.index(args[0]), int(args[1]),
+                             int(args[2]) if len(args) > 2 else 0)
+        elif event == 'idle':
+            timer = int(args[0])
+            # the window ends at the next wake, or at the timer
+            end = now + timer
+            for later, later_event, _ in events[i + 1:]:
+                if later_event == 'wake':
+                    end = min(end, later)
+                    break
+            length = end - now
+            mode, predicted = planner.plan(now, max_mode, timer)
+            chosen[mode] += 1
+            idle_ms += length
+            if mode != SLEEP:
+                planner.learn(mode, true_cost[mode])
+                if length < true_cost[mode]:
+                    late += 1
+            totals['plan'] += charge(current, mode, true_cost[mode], length)
+            totals['fixed'] += charge(current, max_mode, true_cost[max_mode], length)
+            totals['sleep'] += charge(current, SLEEP, 0, length)
+            if opts.verbose:
+                print("{:9d} idle {:8d} predicted {:8d} -> {:s}".format(now, length, predicted,
+                                                                          MODES[mode]))
+        elif event != 'wake':
+            sys.exit("unknown event '{:s}' at {:d}".format(event, now))
+
+    print("idle windows: " + ", ".join("{:s} {:d}".format(MODES[m], chosen[m])
+                                       for m in range(SLEEP, max_mode + 1)))
+    print("woke up before the cost was paid: {:d}".format(late))
+    print("learnt cost: " + ", ".join("{:s} {:d} ms".format(MODES[m], planner.cost[m] >> COST_SHIFT)
+                                      for m in range(STOP, max_mode + 1)))
+    for name in ('plan', 'fixed', 'sleep'):
+        # uA x ms -> mC, average over the idle time in uA
+        print("{:<6s} {:10.3f} mC, average {:8.1f} uA".format(
+            name, totals[name] / 1e6, float(totals[name]) / idle_ms if idle_ms else 0))
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description="Sleep planner trace replay.")
+    parser.add_argument('trace', help='idle trace, see the module documentation')
+    parser.add_argument('--mode', choices=MODES[STOP:], default='shutdown',
+                        help='configured power mode, the deepest the planner may pick')
+    parser.add_argument('--cost', action='store',
+                        help='real enter plus wake up cost per mode in ms, e.g. '
+                        'stop=4,standby=70,shutdown=750; defaults to the pwr_mngr.h ones')
+    parser.add_argument('--header', action='store', default=DEFAULT_HEADER,
+                        help='pwr_mngr.h to read the planner constants from')
+    parser.add_argument('--verbose', action='store_true', help='print every idle window')
+    main(parser.parse_args())